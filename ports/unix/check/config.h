@@ -0,0 +1,2 @@
+/* config.h for the unit tests (test/unit/lwip_check.h includes it):
+ * nothing needs to be configured on the host. */
@@ -0,0 +1,127 @@
+/**
+ * @file
+ * lwIP options for the unit tests in test/unit (Makefile.host 'check').
+ *
+ * These are the minimal changes to opt.h the tests need; in particular
+ * DNS is off as test_mem expects an empty heap after lwip_init().
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+/* Prevent having to link sys_arch.c (we don't test the API layers in unit tests) */
+#define NO_SYS                          1
+#define SYS_LIGHTWEIGHT_PROT            1
+#define LWIP_SDK_TUNABLES               0
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+
+#define MEM_ALIGNMENT                   4
+
+/* Minimal changes to opt.h required for tcp unit tests: */
+#define MEM_SIZE                        16000
+#define TCP_MSS                         1460
+#define TCP_SND_QUEUELEN                40
+#define MEMP_NUM_TCP_SEG                TCP_SND_QUEUELEN
+#define TCP_SND_BUF                     (12 * TCP_MSS)
+#define TCP_WND                         (10 * TCP_MSS)
+/* Leave room for the 36 bytes pbuf_alloc() reserves ahead of the link
+   header with PBUF_RSV_FOR_WLAN, so full-sized frames fit one pool pbuf */
+#define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN+36)
+
+/* The mem unit tests run on the TLSF heap, build with -DMEM_TLSF=0 to run
+   them on the first-fit heap: */
+#ifndef MEM_TLSF
+#define MEM_TLSF                        1
+#endif
+
+/* Required for the memp statistics unit tests: */
+#define MEMP_STATS_CALLERS              4
+#define MEMP_STATS_HIST_BUCKETS         8
+
+/* Required for the memp MIB unit test: */
+#define LWIP_SNMP                       1
+#define SNMP_MEMP_MIB                   1
+
+/* Required for the pbuf unit tests: */
+#define PBUF_RAM_SLAB                   1
+
+/* Required for the reclaim unit tests: */
+#define LWIP_RECLAIM                    1
+
+/* Required for the perf unit tests: */
+#define LWIP_PERF                       1
+
+/* Required for the checksum unit tests: */
+#define LWIP_CHKSUM_SELECT              1
+#define LWIP_CHECKSUM_ON_COPY           1
+#define LWIP_CHKSUM_COPY_ALGORITHM      2
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
+
+/* Required for the TCP demultiplexing unit test (small tables so pcbs
+   share buckets): */
+#define TCP_PCB_HASH                    1
+#define TCP_PCB_HASH_SIZE               2
+#define TCP_LISTEN_HASH_SIZE            2
+
+/* Required for the SYN cookie unit test: */
+#define TCP_SYNCOOKIES                  1
+
+/* Required for the window scaling unit test: */
+#define LWIP_WND_SCALE                  1
+#define TCP_RCV_SCALE                   2
+
+/* Required for the SACK unit test: */
+#define LWIP_TCP_SACK                   1
+
+/* Required for the timestamp unit test: */
+#define LWIP_TCP_TIMESTAMPS             1
+
+/* Required for the millisecond timer unit test: */
+#define LWIP_TCP_TIMERS_MS              1
+
+/* Required for the RACK and tail loss probe unit test: */
+#define LWIP_TCP_RACK                   1
+
+/* Required for the zero-copy tcp_writev() unit test: */
+#define LWIP_TCP_WRITEV                 1
+
+/* Required for the congestion control unit test: */
+#define LWIP_TCP_CC                     1
+#define TCP_CC_CUBIC                    1
+#define TCP_CC_LOWMEM                   1
+
+/* Required for the UDP demultiplexing unit test: */
+#define UDP_PCB_HASH                    1
+#define UDP_PCB_HASH_SIZE               2
+
+/* Minimal changes to opt.h required for etharp unit tests: */
+#define ETHARP_SUPPORT_STATIC_ENTRIES   1
+
+#endif /* __LWIPOPTS_H__ */
@@ -0,0 +1,152 @@
+/**
+ * @file
+ * SIMD checksum kernels for LWIP_CHKSUM_SELECT on the host.
+ *
+ * Registered in lwip_chksum_kernels[] through LWIP_CHKSUM_ARCH_KERNELS
+ * (arch/cc.h). Unlike the portable kernels, these use unaligned vector
+ * loads, so they sum 16-bit words starting at dataptr at any alignment
+ * and need no byte swap at the end. Each 32-bit accumulator lane takes at
+ * most 2 * 0xffff per vector, which can not overflow for len up to
+ * and including 0x1ff00.
+ */
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_CHKSUM_SELECT /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/inet_chksum.h"
+
+#include <string.h>
+
+#ifdef UNIX_CHKSUM_X86
+#include <immintrin.h>
+#endif
+#ifdef UNIX_CHKSUM_NEON
+#include <arm_neon.h>
+#endif
+
+/** Add the remaining 16-bit words and the odd byte, fold to 16 bits */
+static u16_t
+unix_chksum_finish(unsigned long long sum, const u8_t *pb, int len)
+{
+  u16_t w, t = 0;
+  u32_t sum32;
+
+  while (len > 1) {
+    memcpy(&w, pb, sizeof(w));
+    sum += w;
+    pb += 2;
+    len -= 2;
+  }
+  if (len > 0) {
+    ((u8_t *)&t)[0] = *pb;
+  }
+  sum += t;
+
+  sum = (sum >> 32) + (sum & 0xffffffffULL);
+  sum = (sum >> 32) + (sum & 0xffffffffULL);
+  sum32 = (u32_t)sum;
+  sum32 = FOLD_U32T(sum32);
+  sum32 = FOLD_U32T(sum32);
+  return (u16_t)sum32;
+}
+
+#ifdef UNIX_CHKSUM_X86
+u16_t
+unix_chksum_sse2(void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  __m128i zero = _mm_setzero_si128();
+  __m128i acc = zero, v;
+  u32_t lanes[4];
+
+  while (len > 15) {
+    v = _mm_loadu_si128((const __m128i *)(const void *)pb);
+    acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+    acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+    pb += 16;
+    len -= 16;
+  }
+  _mm_storeu_si128((__m128i *)(void *)lanes, acc);
+  return unix_chksum_finish((unsigned long long)lanes[0] + lanes[1] + lanes[2] + lanes[3],
+    pb, len);
+}
+
+__attribute__((target("avx2"))) u16_t
+unix_chksum_avx2(void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  __m256i zero = _mm256_setzero_si256();
+  __m256i acc = zero, v;
+  u32_t lanes[8];
+  unsigned long long sum = 0;
+  int i;
+
+  while (len > 31) {
+    v = _mm256_loadu_si256((const __m256i *)(const void *)pb);
+    acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+    acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+    pb += 32;
+    len -= 32;
+  }
+  _mm256_storeu_si256((__m256i *)(void *)lanes, acc);
+  for (i = 0; i < 8; i++) {
+    sum += lanes[i];
+  }
+  return unix_chksum_finish(sum, pb, len);
+}
+
+int
+unix_chksum_avx2_supported(void)
+{
+  return __builtin_cpu_supports("avx2");
+}
+#endif /* UNIX_CHKSUM_X86 */
+
+#ifdef UNIX_CHKSUM_NEON
+u16_t
+unix_chksum_neon(void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  uint32x4_t acc = vdupq_n_u32(0);
+
+  while (len > 15) {
+    acc = vpadalq_u16(acc, vreinterpretq_u16_u8(vld1q_u8(pb)));
+    pb += 16;
+    len -= 16;
+  }
+  return unix_chksum_finish((unsigned long long)vgetq_lane_u32(acc, 0) +
+    vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3),
+    pb, len);
+}
+#endif /* UNIX_CHKSUM_NEON */
+
+#endif /* LWIP_CHKSUM_SELECT */
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ * Author: Adam Dunkels <adam@sics.se>
+ *
+ */
+#ifndef __ARCH_CC_H__
+#define __ARCH_CC_H__
+
+/* Compiler and type definitions for the Linux/x86 host port. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <sys/time.h>
+
+#define LWIP_TIMEVAL_PRIVATE 0
+
+/* lwip/arch.h provides errno values matching those of Linux */
+#define LWIP_PROVIDE_ERRNO
+
+/* Define platform endianness */
+#ifndef BYTE_ORDER
+#define BYTE_ORDER LITTLE_ENDIAN
+#endif /* BYTE_ORDER */
+
+/* Define generic types used in lwIP */
+typedef uint8_t    u8_t;
+typedef int8_t     s8_t;
+typedef uint16_t   u16_t;
+typedef int16_t    s16_t;
+typedef uint32_t   u32_t;
+typedef int32_t    s32_t;
+/* only used by the host port (ports/unix), the core does not need it */
+typedef uint64_t   u64_t;
+
+typedef uintptr_t  mem_ptr_t;
+
+/* Used by SYS_ARCH_PROTECT: sys_arch.h is not included with NO_SYS==1 */
+typedef u32_t      sys_prot_t;
+
+/* Used by MEMP_LOCKFREE */
+#define SYS_ARCH_CAS32(ptr, oldval, newval) __sync_bool_compare_and_swap((ptr), (oldval), (newval))
+
+/* Define (sn)printf formatters for these lwIP types */
+#define X8_F  "02x"
+#define U16_F "hu"
+#define S16_F "hd"
+#define X16_F "hx"
+#define U32_F "u"
+#define S32_F "d"
+#define X32_F "x"
+#define SZT_F "zu"
+
+/* Compiler hints for packing structures */
+#define PACK_STRUCT_FIELD(x) x
+#define PACK_STRUCT_STRUCT __attribute__((packed))
+#define PACK_STRUCT_BEGIN
+#define PACK_STRUCT_END
+
+/* The ESP8266 SDK places code and constant data in flash through these
+ * section attributes; on the host everything lives in normal memory. */
+#define ICACHE_FLASH_ATTR
+#define ICACHE_RODATA_ATTR
+
+/* Plaform specific diagnostic output */
+#define LWIP_PLATFORM_DIAG(x) do { printf x; } while(0)
+
+#define LWIP_PLATFORM_ASSERT(x) do { printf("Assertion \"%s\" failed at line %d in %s\n", \
+                                     x, __LINE__, __FILE__); fflush(NULL); abort(); } while(0)
+
+/* ESP8266 SDK functions the core calls directly, provided by sdk_dummy.c.
+ * LWIP_RAND() is mapped to r_rand() by igmp.h. */
+unsigned long os_random(void);
+int r_rand(void);
+u8_t system_get_data_of_array_8(const u8_t *array, int index);
+void *eagle_lwip_getif(u8_t index);
+void system_pp_recycle_rx_pkt(void *eb);
+
+/* SIMD checksum kernels for LWIP_CHKSUM_SELECT, see chksum_simd.c */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define UNIX_CHKSUM_X86  1
+u16_t unix_chksum_sse2(void *dataptr, int len);
+u16_t unix_chksum_avx2(void *dataptr, int len);
+int unix_chksum_avx2_supported(void);
+#define LWIP_CHKSUM_ARCH_KERNELS \
+  { "sse2", unix_chksum_sse2, NULL }, \
+  { "avx2", unix_chksum_avx2, unix_chksum_avx2_supported },
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define UNIX_CHKSUM_NEON 1
+u16_t unix_chksum_neon(void *dataptr, int len);
+#define LWIP_CHKSUM_ARCH_KERNELS \
+  { "neon", unix_chksum_neon, NULL },
+#endif
+
+#endif /* __ARCH_CC_H__ */
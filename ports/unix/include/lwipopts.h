@@ -0,0 +1,167 @@
+/**
+ * @file
+ * lwIP options for the Linux host build.
+ *
+ * The sizing below follows the profile shipped with the ESP8266 SDK so
+ * that numbers measured on a developer machine are comparable to the
+ * device. Differences to the device profile are:
+ * - mem.c/memp.c are used instead of the SDK heap (MEM_LIBC_MALLOC and
+ *   MEMP_MEM_MALLOC are 0) so the allocators themselves can be measured
+ * - statistics are enabled
+ * - SYS_LIGHTWEIGHT_PROT is implemented with a pthread mutex
+ *
+ * Every option can be overridden from the command line (CFLAGS_EXTRA in
+ * Makefile.host), e.g. -DNO_SYS=0 to build the sequential APIs on top
+ * of the pthreads sys_arch.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+/* ---------- Platform ---------- */
+#ifndef NO_SYS
+#define NO_SYS                          1
+#endif
+#define SYS_LIGHTWEIGHT_PROT            1
+/* Tunables are constants here, not SDK variables */
+#define LWIP_SDK_TUNABLES               0
+
+/* ---------- Memory options ---------- */
+#define MEM_LIBC_MALLOC                 0
+#define MEMP_MEM_MALLOC                 0
+#define MEM_ALIGNMENT                   4
+#ifndef MEM_SIZE
+#define MEM_SIZE                        16000
+#endif
+
+#ifndef MEMP_NUM_PBUF
+#define MEMP_NUM_PBUF                   10
+#endif
+#ifndef MEMP_NUM_RAW_PCB
+#define MEMP_NUM_RAW_PCB                4
+#endif
+#ifndef MEMP_NUM_UDP_PCB
+#define MEMP_NUM_UDP_PCB                4
+#endif
+#ifndef MEMP_NUM_TCP_PCB
+#define MEMP_NUM_TCP_PCB                5
+#endif
+#ifndef MEMP_NUM_TCP_PCB_LISTEN
+#define MEMP_NUM_TCP_PCB_LISTEN         2
+#endif
+#ifndef MEMP_NUM_TCP_SEG
+#define MEMP_NUM_TCP_SEG                16
+#endif
+#ifndef MEMP_NUM_SYS_TIMEOUT
+#define MEMP_NUM_SYS_TIMEOUT            8
+#endif
+#ifndef PBUF_POOL_SIZE
+#define PBUF_POOL_SIZE                  10
+#endif
+/* Leave room for the 36 bytes pbuf_alloc() reserves ahead of the link
+   header with PBUF_RSV_FOR_WLAN, so full-sized frames fit one pool pbuf */
+#define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN+36)
+
+/* ---------- ARP options ---------- */
+#define LWIP_ARP                        1
+#define ARP_TABLE_SIZE                  10
+#define ARP_QUEUEING                    1
+
+/* ---------- IP options ---------- */
+#define IP_FORWARD                      0
+#define IP_REASSEMBLY                   1
+#define IP_FRAG                         1
+
+/* ---------- Loopback options ---------- */
+/* 127.0.0.1, used by test/bench */
+#define LWIP_HAVE_LOOPIF                1
+
+/* ---------- DHCP/DNS/IGMP options ---------- */
+#define LWIP_DHCP                       1
+#define LWIP_DNS                        1
+#define LWIP_IGMP                       1
+#define LWIP_NETIF_HOSTNAME             1
+
+/* ---------- UDP options ---------- */
+#define LWIP_UDP                        1
+
+/* ---------- TCP options ---------- */
+#define LWIP_TCP                        1
+#ifndef TCP_MSS
+#define TCP_MSS                         1460
+#endif
+#ifndef TCP_WND
+#define TCP_WND                         (4 * TCP_MSS)
+#endif
+#ifndef TCP_SND_BUF
+#define TCP_SND_BUF                     (2 * TCP_MSS)
+#endif
+#ifndef TCP_SND_QUEUELEN
+#define TCP_SND_QUEUELEN                ((4 * (TCP_SND_BUF) + (TCP_MSS - 1))/(TCP_MSS))
+#endif
+#define TCP_MAXRTX                      12
+#define TCP_SYNMAXRTX                   6
+#ifndef TCP_QUEUE_OOSEQ
+#define TCP_QUEUE_OOSEQ                 1
+#endif
+#define LWIP_TCP_KEEPALIVE              1
+
+/* ---------- Sequential APIs (only with an OS) ---------- */
+#define LWIP_NETCONN                    (!NO_SYS)
+#define LWIP_SOCKET                     (!NO_SYS)
+#define LWIP_COMPAT_SOCKETS             0
+#define LWIP_POSIX_SOCKETS_IO_NAMES     0
+#define TCPIP_MBOX_SIZE                 16
+#define DEFAULT_RAW_RECVMBOX_SIZE       8
+#define DEFAULT_UDP_RECVMBOX_SIZE       8
+#define DEFAULT_TCP_RECVMBOX_SIZE       8
+#define DEFAULT_ACCEPTMBOX_SIZE         8
+
+/* ---------- Checksum options ---------- */
+/* Pick the fastest kernel of this CPU (SSE2/AVX2/NEON, see chksum_simd.c),
+   build with -DLWIP_CHKSUM_SELECT=0 for the device's compile-time routine */
+#ifndef LWIP_CHKSUM_SELECT
+#define LWIP_CHKSUM_SELECT              1
+#endif
+/* Sum TCP/UDP payload while copying it from the application. The one pass
+   copy (LWIP_CHKSUM_COPY_ALGORITHM 2) is for targets without a data cache;
+   here MEMCPY followed by the SIMD kernel is faster except for small
+   datagrams (lwip_chksum_bench -c) */
+#define LWIP_CHECKSUM_ON_COPY           1
+/* no checksums on the loopback netif */
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
+#ifndef LWIP_CHKSUM_COPY_ALGORITHM
+#define LWIP_CHKSUM_COPY_ALGORITHM      1
+#endif
+
+/* ---------- Statistics options ---------- */
+#define LWIP_STATS                      1
+#define LWIP_STATS_DISPLAY              1
+
+#endif /* __LWIPOPTS_H__ */
@@ -0,0 +1,427 @@
+/**
+ * @file
+ * Ethernet interface backed by pcap capture files.
+ *
+ * Based on the src/netif/ethernetif.c skeleton. Instead of hardware, frames
+ * are read from a capture file (one frame per pcapif_poll() call) and every
+ * frame the stack sends is appended to an output capture file. The files use
+ * the classic libpcap format (LINKTYPE_ETHERNET); libpcap itself is not
+ * needed. Captures in either byte order and with micro- or nanosecond
+ * timestamps are accepted.
+ *
+ * This gives a deterministic, hardware-less way to drive the receive path
+ * with recorded traffic and to inspect what the stack sends in response
+ * (e.g. with wireshark).
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#include "lwip/def.h"
+#include "lwip/mem.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/stats.h"
+#include "lwip/snmp.h"
+#include "lwip/timers.h"
+#include "arch/sys_arch.h"
+#include "netif/etharp.h"
+#include "netif/pcapif.h"
+
+/* Define those to better describe your network interface. */
+#define IFNAME0 'p'
+#define IFNAME1 'c'
+
+#define PCAP_MAGIC          0xa1b2c3d4UL
+#define PCAP_MAGIC_NSEC     0xa1b23c4dUL
+#define PCAP_LINKTYPE_ETH   1
+#define PCAP_SNAPLEN        65535
+
+/** Largest frame replayed into the stack (larger records are skipped) */
+#define PCAPIF_FRAME_MAX    1518
+
+/** On-disk pcap file header */
+struct pcap_file_hdr {
+  u32_t magic;
+  u16_t version_major;
+  u16_t version_minor;
+  s32_t thiszone;
+  u32_t sigfigs;
+  u32_t snaplen;
+  u32_t linktype;
+};
+
+/** On-disk pcap record header */
+struct pcap_rec_hdr {
+  u32_t ts_sec;
+  u32_t ts_usec;
+  u32_t incl_len;
+  u32_t orig_len;
+};
+
+/**
+ * Helper struct to hold private data used to operate the capture files.
+ */
+struct pcapif {
+  FILE *rx;
+  FILE *tx;
+  /* the input file was written on a machine with different byte order */
+  u8_t rx_swapped;
+  /* the input file has nanosecond timestamps */
+  u8_t rx_nsec;
+  /* drive sys_now() from the input timestamps */
+  u8_t capture_clock;
+  /* a record has been read, rx_start is valid */
+  u8_t rx_started;
+  /* timestamp of the first record (ms) */
+  u64_t rx_start;
+  /* timestamp of the last record relative to the first (ms) */
+  u32_t rx_time;
+};
+
+static u32_t
+pcapif_swap32(u32_t v)
+{
+  return ((v & 0xff) << 24) | ((v & 0xff00) << 8) |
+         ((v & 0xff0000UL) >> 8) | ((v & 0xff000000UL) >> 24);
+}
+
+/**
+ * Open the capture files.
+ * Called from pcapif_init().
+ *
+ * @param netif the already initialized lwip network interface structure
+ *        for this pcapif
+ * @param files names of the capture files
+ * @return ERR_OK on success, ERR_IF if a file could not be opened or the
+ *         input file is not an ethernet capture
+ */
+static err_t
+low_level_init(struct netif *netif, const struct pcapif_files *files)
+{
+  struct pcapif *pcapif = (struct pcapif *)netif->state;
+  struct pcap_file_hdr hdr;
+
+  /* set MAC hardware address length */
+  netif->hwaddr_len = ETHARP_HWADDR_LEN;
+
+  /* set MAC hardware address (locally administered) */
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[1] = 0x12;
+  netif->hwaddr[2] = 0x34;
+  netif->hwaddr[3] = 0x56;
+  netif->hwaddr[4] = 0x78;
+  netif->hwaddr[5] = 0xcd;
+
+  /* maximum transfer unit */
+  netif->mtu = 1500;
+
+  /* device capabilities */
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+
+  pcapif->rx = NULL;
+  pcapif->tx = NULL;
+  pcapif->rx_swapped = 0;
+  pcapif->rx_nsec = 0;
+  pcapif->capture_clock = (files != NULL) && files->capture_clock;
+  pcapif->rx_started = 0;
+  pcapif->rx_time = 0;
+
+  if ((files != NULL) && (files->rx_file != NULL)) {
+    pcapif->rx = fopen(files->rx_file, "rb");
+    if (pcapif->rx == NULL) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_init: could not open %s\n", files->rx_file));
+      return ERR_IF;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, pcapif->rx) != 1) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_init: %s: short file\n", files->rx_file));
+      return ERR_IF;
+    }
+    if ((hdr.magic == pcapif_swap32(PCAP_MAGIC)) || (hdr.magic == pcapif_swap32(PCAP_MAGIC_NSEC))) {
+      pcapif->rx_swapped = 1;
+      hdr.magic = pcapif_swap32(hdr.magic);
+      hdr.linktype = pcapif_swap32(hdr.linktype);
+    }
+    if ((hdr.magic != PCAP_MAGIC) && (hdr.magic != PCAP_MAGIC_NSEC)) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_init: %s: not a pcap file\n", files->rx_file));
+      return ERR_IF;
+    }
+    if (hdr.linktype != PCAP_LINKTYPE_ETH) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_init: %s: link type %"U32_F" is not ethernet\n",
+        files->rx_file, hdr.linktype));
+      return ERR_IF;
+    }
+    pcapif->rx_nsec = (hdr.magic == PCAP_MAGIC_NSEC);
+  }
+
+  if ((files != NULL) && (files->tx_file != NULL)) {
+    pcapif->tx = fopen(files->tx_file, "wb");
+    if (pcapif->tx == NULL) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_init: could not create %s\n", files->tx_file));
+      return ERR_IF;
+    }
+    hdr.magic = PCAP_MAGIC;
+    hdr.version_major = 2;
+    hdr.version_minor = 4;
+    hdr.thiszone = 0;
+    hdr.sigfigs = 0;
+    hdr.snaplen = PCAP_SNAPLEN;
+    hdr.linktype = PCAP_LINKTYPE_ETH;
+    fwrite(&hdr, sizeof(hdr), 1, pcapif->tx);
+  }
+  return ERR_OK;
+}
+
+/**
+ * Append one frame to the output capture, timestamped with sys_now().
+ *
+ * @param netif the lwip network interface structure for this pcapif
+ * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
+ * @return ERR_OK (frames are dropped silently if there is no output file)
+ */
+static err_t
+low_level_output(struct netif *netif, struct pbuf *p)
+{
+  struct pcapif *pcapif = (struct pcapif *)netif->state;
+  struct pcap_rec_hdr rec;
+  struct pbuf *q;
+  u32_t now;
+
+#if ETH_PAD_SIZE
+  pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
+#endif
+
+  if (pcapif->tx != NULL) {
+    now = sys_now();
+    rec.ts_sec = now / 1000;
+    rec.ts_usec = (now % 1000) * 1000;
+    rec.incl_len = rec.orig_len = p->tot_len;
+    fwrite(&rec, sizeof(rec), 1, pcapif->tx);
+    for(q = p; q != NULL; q = q->next) {
+      fwrite(q->payload, 1, q->len, pcapif->tx);
+    }
+  }
+
+#if ETH_PAD_SIZE
+  pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
+#endif
+
+  LINK_STATS_INC(link.xmit);
+  snmp_add_ifoutoctets(netif, p->tot_len);
+  return ERR_OK;
+}
+
+/**
+ * Update pcapif->rx_time from a record header. Timestamps that go backwards
+ * (e.g. in merged captures) don't move the time.
+ */
+static void
+pcapif_record_time(struct pcapif *pcapif, const struct pcap_rec_hdr *rec)
+{
+  u64_t ms;
+  u32_t rel;
+
+  ms = (u64_t)rec->ts_sec * 1000 + rec->ts_usec / (pcapif->rx_nsec ? 1000000 : 1000);
+  if (!pcapif->rx_started) {
+    pcapif->rx_started = 1;
+    pcapif->rx_start = ms;
+  }
+  if (ms >= pcapif->rx_start) {
+    rel = (u32_t)(ms - pcapif->rx_start);
+    if (rel > pcapif->rx_time) {
+      pcapif->rx_time = rel;
+    }
+  }
+}
+
+/**
+ * Read the next frame of the input capture into a newly allocated pbuf.
+ *
+ * @param netif the lwip network interface structure for this pcapif
+ * @param eof set to 1 when the end of the capture has been reached
+ * @return a pbuf filled with the received packet (including MAC header)
+ *         NULL on memory error, for skipped records or at the end of file
+ */
+static struct pbuf *
+low_level_input(struct netif *netif, int *eof)
+{
+  struct pcapif *pcapif = (struct pcapif *)netif->state;
+  struct pcap_rec_hdr rec;
+  struct pbuf *p;
+  u8_t buf[PCAPIF_FRAME_MAX];
+  u16_t len;
+
+  *eof = 0;
+  if ((pcapif->rx == NULL) || (fread(&rec, sizeof(rec), 1, pcapif->rx) != 1)) {
+    *eof = 1;
+    return NULL;
+  }
+  if (pcapif->rx_swapped) {
+    rec.ts_sec = pcapif_swap32(rec.ts_sec);
+    rec.ts_usec = pcapif_swap32(rec.ts_usec);
+    rec.incl_len = pcapif_swap32(rec.incl_len);
+  }
+  pcapif_record_time(pcapif, &rec);
+  if (rec.incl_len > PCAPIF_FRAME_MAX) {
+    /* jumbo frames can't be received by this interface */
+    LINK_STATS_INC(link.lenerr);
+    LINK_STATS_INC(link.drop);
+    fseek(pcapif->rx, (long)rec.incl_len, SEEK_CUR);
+    return NULL;
+  }
+  len = (u16_t)rec.incl_len;
+  if (fread(buf, 1, len, pcapif->rx) != len) {
+    *eof = 1;
+    return NULL;
+  }
+
+#if ETH_PAD_SIZE
+  len += ETH_PAD_SIZE; /* allow room for Ethernet padding */
+#endif
+
+  /* We allocate a pbuf chain of pbufs from the pool. */
+  p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+  if (p != NULL) {
+#if ETH_PAD_SIZE
+    pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
+#endif
+    pbuf_take(p, buf, (u16_t)rec.incl_len);
+#if ETH_PAD_SIZE
+    pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
+#endif
+    LINK_STATS_INC(link.recv);
+    snmp_add_ifinoctets(netif, rec.incl_len);
+  } else {
+    LINK_STATS_INC(link.memerr);
+    LINK_STATS_INC(link.drop);
+  }
+  return p;
+}
+
+/**
+ * Pass the next frame of the input capture to netif->input.
+ *
+ * @param netif the lwip network interface structure for this pcapif
+ * @return 1 if a record was consumed (even if it had to be dropped),
+ *         0 at the end of the capture
+ */
+int
+pcapif_poll(struct netif *netif)
+{
+  struct pbuf *p;
+  int eof;
+
+  p = low_level_input(netif, &eof);
+  if (eof) {
+    return 0;
+  }
+  if (((struct pcapif *)netif->state)->capture_clock) {
+    sys_now_set(((struct pcapif *)netif->state)->rx_time);
+#if NO_SYS
+    sys_check_timeouts();
+#endif /* NO_SYS */
+  }
+  if (p != NULL) {
+    if (netif->input(p, netif) != ERR_OK) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_poll: IP input error\n"));
+      pbuf_free(p);
+    }
+  }
+  return 1;
+}
+
+/**
+ * Close the capture files (flushing the output capture).
+ *
+ * @param netif the lwip network interface structure for this pcapif
+ */
+void
+pcapif_shutdown(struct netif *netif)
+{
+  struct pcapif *pcapif = (struct pcapif *)netif->state;
+
+  if (pcapif != NULL) {
+    if (pcapif->rx != NULL) {
+      fclose(pcapif->rx);
+    }
+    if (pcapif->tx != NULL) {
+      fclose(pcapif->tx);
+    }
+    mem_free(pcapif);
+    netif->state = NULL;
+  }
+}
+
+/**
+ * Should be called at the beginning of the program to set up the
+ * network interface.
+ *
+ * This function should be passed as a parameter to netif_add(), with a
+ * pointer to a struct pcapif_files as 'state'.
+ *
+ * @param netif the lwip network interface structure for this pcapif
+ * @return ERR_OK if the interface is initialized
+ *         ERR_MEM if private data couldn't be allocated
+ *         ERR_IF if a capture file couldn't be opened
+ */
+err_t
+pcapif_init(struct netif *netif)
+{
+  struct pcapif *pcapif;
+  const struct pcapif_files *files;
+  err_t err;
+
+  LWIP_ASSERT("netif != NULL", (netif != NULL));
+
+  files = (const struct pcapif_files *)netif->state;
+  pcapif = (struct pcapif *)mem_malloc(sizeof(struct pcapif));
+  if (pcapif == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapif_init: out of memory\n"));
+    return ERR_MEM;
+  }
+
+#if LWIP_NETIF_HOSTNAME
+  /* Initialize interface hostname */
+  netif->hostname = "lwip";
+#endif /* LWIP_NETIF_HOSTNAME */
+
+  NETIF_INIT_SNMP(netif, snmp_ifType_ethernet_csmacd, 100000000);
+
+  netif->state = pcapif;
+  netif->name[0] = IFNAME0;
+  netif->name[1] = IFNAME1;
+  netif->output = etharp_output;
+  netif->linkoutput = low_level_output;
+
+  err = low_level_init(netif, files);
+  if (err != ERR_OK) {
+    pcapif_shutdown(netif);
+  }
+  return err;
+}
@@ -0,0 +1,331 @@
+/**
+ * @file
+ * Ethernet interface on top of a Linux TAP device.
+ *
+ * Based on the src/netif/ethernetif.c skeleton. Frames are read from and
+ * written to /dev/net/tun opened in IFF_TAP mode, so the stack can talk to
+ * the host's network (or to another process) through a virtual ethernet
+ * device. The interface is polled: call tapif_poll() (or tapif_select() to
+ * sleep until traffic arrives) from the main loop.
+ *
+ * If netif->state is not NULL when tapif_init() is called, it is taken to
+ * be the name of the TAP device (const char*); otherwise TAPIF_DEFAULT_NAME
+ * is used. The device must exist and be configured by the user, e.g.:
+ *   ip tuntap add dev tap0 mode tap user $USER
+ *   ip addr add 192.168.0.1/24 dev tap0 && ip link set tap0 up
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ * Author: Adam Dunkels <adam@sics.se>
+ *
+ */
+
+#include "lwip/opt.h"
+
+#include "lwip/def.h"
+#include "lwip/mem.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/stats.h"
+#include "lwip/snmp.h"
+#include "netif/etharp.h"
+#include "netif/tapif.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+#define DEVTAP "/dev/net/tun"
+
+/* Define those to better describe your network interface. */
+#define IFNAME0 't'
+#define IFNAME1 'p'
+
+/** Largest frame we read from the device (MTU + ethernet header + VLAN tag) */
+#define TAPIF_FRAME_MAX 1518
+
+/**
+ * Helper struct to hold private data used to operate the TAP device.
+ */
+struct tapif {
+  /* file descriptor of the opened TAP device */
+  int fd;
+};
+
+/**
+ * Open the TAP device and set up the hardware address.
+ * Called from tapif_init().
+ *
+ * @param netif the already initialized lwip network interface structure
+ *        for this tapif
+ * @param devname name of the TAP device to attach to
+ * @return ERR_OK on success, ERR_IF if the device could not be opened
+ */
+static err_t
+low_level_init(struct netif *netif, const char *devname)
+{
+  struct tapif *tapif = (struct tapif *)netif->state;
+  struct ifreq ifr;
+
+  /* set MAC hardware address length */
+  netif->hwaddr_len = ETHARP_HWADDR_LEN;
+
+  /* set MAC hardware address (locally administered) */
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[1] = 0x12;
+  netif->hwaddr[2] = 0x34;
+  netif->hwaddr[3] = 0x56;
+  netif->hwaddr[4] = 0x78;
+  netif->hwaddr[5] = 0xab;
+
+  /* maximum transfer unit */
+  netif->mtu = 1500;
+
+  /* device capabilities */
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+
+  tapif->fd = open(DEVTAP, O_RDWR);
+  if (tapif->fd < 0) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("tapif_init: could not open %s: %s\n", DEVTAP, strerror(errno)));
+    return ERR_IF;
+  }
+
+  memset(&ifr, 0, sizeof(ifr));
+  ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+  strncpy(ifr.ifr_name, devname, sizeof(ifr.ifr_name) - 1);
+  if (ioctl(tapif->fd, TUNSETIFF, (void *)&ifr) < 0) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("tapif_init: TUNSETIFF %s failed: %s\n", devname, strerror(errno)));
+    close(tapif->fd);
+    tapif->fd = -1;
+    return ERR_IF;
+  }
+  fcntl(tapif->fd, F_SETFL, fcntl(tapif->fd, F_GETFL) | O_NONBLOCK);
+  return ERR_OK;
+}
+
+/**
+ * Write one frame to the TAP device. The pbuf might be chained, so it is
+ * flattened into a stack buffer first: the device wants one write() per
+ * frame.
+ *
+ * @param netif the lwip network interface structure for this tapif
+ * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
+ * @return ERR_OK if the packet could be sent
+ *         an err_t value if the packet couldn't be sent
+ */
+static err_t
+low_level_output(struct netif *netif, struct pbuf *p)
+{
+  struct tapif *tapif = (struct tapif *)netif->state;
+  u8_t buf[TAPIF_FRAME_MAX];
+  u16_t len;
+
+#if ETH_PAD_SIZE
+  pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
+#endif
+
+  if (p->tot_len > sizeof(buf)) {
+    LINK_STATS_INC(link.lenerr);
+#if ETH_PAD_SIZE
+    pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
+#endif
+    return ERR_BUF;
+  }
+  len = pbuf_copy_partial(p, buf, p->tot_len, 0);
+
+#if ETH_PAD_SIZE
+  pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
+#endif
+
+  if (write(tapif->fd, buf, len) != len) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("tapif: write failed: %s\n", strerror(errno)));
+    LINK_STATS_INC(link.err);
+    return ERR_IF;
+  }
+  LINK_STATS_INC(link.xmit);
+  snmp_add_ifoutoctets(netif, len);
+  return ERR_OK;
+}
+
+/**
+ * Read one frame from the device into a newly allocated pbuf chain.
+ *
+ * @param netif the lwip network interface structure for this tapif
+ * @param again set to 0 if the device had no more frames pending
+ * @return a pbuf filled with the received packet (including MAC header)
+ *         NULL on memory error or if no frame was pending
+ */
+static struct pbuf *
+low_level_input(struct netif *netif, int *again)
+{
+  struct tapif *tapif = (struct tapif *)netif->state;
+  struct pbuf *p;
+  u8_t buf[TAPIF_FRAME_MAX];
+  ssize_t readlen;
+  u16_t len;
+
+  readlen = read(tapif->fd, buf, sizeof(buf));
+  if (readlen <= 0) {
+    *again = 0;
+    return NULL;
+  }
+  *again = 1;
+  len = (u16_t)readlen;
+
+#if ETH_PAD_SIZE
+  len += ETH_PAD_SIZE; /* allow room for Ethernet padding */
+#endif
+
+  /* We allocate a pbuf chain of pbufs from the pool. */
+  p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+  if (p != NULL) {
+#if ETH_PAD_SIZE
+    pbuf_header(p, -ETH_PAD_SIZE); /* drop the padding word */
+#endif
+    pbuf_take(p, buf, (u16_t)readlen);
+#if ETH_PAD_SIZE
+    pbuf_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
+#endif
+    LINK_STATS_INC(link.recv);
+    snmp_add_ifinoctets(netif, (u32_t)readlen);
+  } else {
+    LINK_STATS_INC(link.memerr);
+    LINK_STATS_INC(link.drop);
+  }
+  return p;
+}
+
+/**
+ * Pass all frames pending on the TAP device to netif->input.
+ *
+ * @param netif the lwip network interface structure for this tapif
+ * @return the number of frames read from the device
+ */
+int
+tapif_poll(struct netif *netif)
+{
+  struct pbuf *p;
+  int again = 1;
+  int count = 0;
+
+  while (again) {
+    p = low_level_input(netif, &again);
+    if (p == NULL) {
+      continue;
+    }
+    count++;
+    if (netif->input(p, netif) != ERR_OK) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("tapif_poll: IP input error\n"));
+      pbuf_free(p);
+    }
+  }
+  return count;
+}
+
+/**
+ * Wait up to 'timeout_ms' for the TAP device to become readable and pass
+ * everything pending to the stack.
+ *
+ * @param netif the lwip network interface structure for this tapif
+ * @param timeout_ms maximum time to sleep
+ * @return the number of frames read from the device, -1 on error
+ */
+int
+tapif_select(struct netif *netif, u32_t timeout_ms)
+{
+  struct tapif *tapif = (struct tapif *)netif->state;
+  fd_set fdset;
+  struct timeval tv;
+  int ret;
+
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  FD_ZERO(&fdset);
+  FD_SET(tapif->fd, &fdset);
+
+  ret = select(tapif->fd + 1, &fdset, NULL, NULL, &tv);
+  if (ret > 0) {
+    return tapif_poll(netif);
+  }
+  return ret;
+}
+
+/**
+ * Should be called at the beginning of the program to set up the
+ * network interface.
+ *
+ * This function should be passed as a parameter to netif_add().
+ *
+ * @param netif the lwip network interface structure for this tapif
+ * @return ERR_OK if the device is initialized
+ *         ERR_MEM if private data couldn't be allocated
+ *         ERR_IF if the TAP device couldn't be opened
+ */
+err_t
+tapif_init(struct netif *netif)
+{
+  struct tapif *tapif;
+  const char *devname;
+  err_t err;
+
+  LWIP_ASSERT("netif != NULL", (netif != NULL));
+
+  devname = (netif->state != NULL) ? (const char *)netif->state : TAPIF_DEFAULT_NAME;
+  tapif = (struct tapif *)mem_malloc(sizeof(struct tapif));
+  if (tapif == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("tapif_init: out of memory\n"));
+    return ERR_MEM;
+  }
+
+#if LWIP_NETIF_HOSTNAME
+  /* Initialize interface hostname */
+  netif->hostname = "lwip";
+#endif /* LWIP_NETIF_HOSTNAME */
+
+  NETIF_INIT_SNMP(netif, snmp_ifType_ethernet_csmacd, 100000000);
+
+  netif->state = tapif;
+  netif->name[0] = IFNAME0;
+  netif->name[1] = IFNAME1;
+  netif->output = etharp_output;
+  netif->linkoutput = low_level_output;
+
+  err = low_level_init(netif, devname);
+  if (err != ERR_OK) {
+    mem_free(tapif);
+    netif->state = NULL;
+  }
+  return err;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file
+ * Host replacements for the ESP8266 SDK functions called by the core.
+ *
+ * The device build links these from the SDK's closed libraries; on the host
+ * they are reduced to what the stack needs to behave like it does on the
+ * device: random numbers, flash-array reads, the WLAN RX buffer pool and
+ * the station interface lookup.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/netif.h"
+
+/** Number of free RX descriptors the emulated WLAN driver reports to
+ * tcp_input() (which trims ooseq data when this drops below 2). */
+char sdk_dummy_rx_nodes = 8;
+
+unsigned long
+os_random(void)
+{
+  return (unsigned long)random();
+}
+
+int
+r_rand(void)
+{
+  return (int)random();
+}
+
+u8_t
+system_get_data_of_array_8(const u8_t *array, int index)
+{
+  return array[index];
+}
+
+/** Index 0 is the station interface on the device; the host has none, so
+ * ip_route() falls back to netif_default. */
+void *
+eagle_lwip_getif(u8_t index)
+{
+  LWIP_UNUSED_ARG(index);
+  return NULL;
+}
+
+/** Host drivers allocate PBUF_ESF_RX buffers with malloc() and store them
+ * in pbuf->eb, other pbufs have eb == NULL. */
+void
+system_pp_recycle_rx_pkt(void *eb)
+{
+  if (eb != NULL) {
+    free(eb);
+  }
+}
+
+char
+RxNodeNum(void)
+{
+  return sdk_dummy_rx_nodes;
+}
+
+/** The soft-AP DHCP server (src/app/dhcpserver.c) is not part of the host
+ * build, but timers.c calls its lease timer. */
+void
+dhcps_coarse_tmr(void)
+{
+}
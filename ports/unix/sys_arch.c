@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ * Author: Adam Dunkels <adam@sics.se>
+ *
+ */
+
+/*
+ * Wait for a message on a mailbox / semaphore with a timeout: sys_arch for
+ * Linux and other POSIX hosts based on pthreads.
+ *
+ * Semaphores are counting semaphores built from a mutex and a condition
+ * variable (waits use CLOCK_MONOTONIC so that wall clock changes don't
+ * disturb the timeouts), mailboxes are fixed-size ring buffers protected
+ * by a mutex with 'not empty'/'not full' condition variables.
+ *
+ * With NO_SYS==1 only sys_init(), sys_now(), sys_jiffies() and the
+ * SYS_LIGHTWEIGHT_PROT functions are compiled.
+ *
+ * sys_now() normally follows CLOCK_MONOTONIC; after sys_now_set() it
+ * returns a virtual time instead (used for deterministic capture replay).
+ */
+
+#include "lwip/opt.h"
+
+#include "lwip/sys.h"
+#include "lwip/def.h"
+#include "lwip/stats.h"
+#include "lwip/debug.h"
+#include "arch/sys_arch.h"
+
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+static struct timespec starttime;
+/* sys_now() returns sys_virtual_now once sys_now_set() has been called */
+static u8_t sys_virtual;
+static u32_t sys_virtual_now;
+
+#if SYS_LIGHTWEIGHT_PROT
+static pthread_mutex_t lwprot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t lwprot_thread = (pthread_t)0xDEAD;
+static int lwprot_count = 0;
+#endif /* SYS_LIGHTWEIGHT_PROT */
+
+/** Milliseconds elapsed between 'starttime' and 'ts' */
+static u32_t
+sys_ms_since_start(const struct timespec *ts)
+{
+  return (u32_t)((ts->tv_sec - starttime.tv_sec) * 1000 +
+                 (ts->tv_nsec - starttime.tv_nsec) / 1000000);
+}
+
+void
+sys_init(void)
+{
+  clock_gettime(CLOCK_MONOTONIC, &starttime);
+}
+
+u32_t
+sys_now(void)
+{
+  struct timespec ts;
+  if (sys_virtual) {
+    return sys_virtual_now;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return sys_ms_since_start(&ts);
+}
+
+void
+sys_now_set(u32_t now)
+{
+  LWIP_ASSERT("virtual time must not go backwards",
+    !sys_virtual || ((s32_t)(now - sys_virtual_now) >= 0));
+  sys_virtual_now = now;
+  sys_virtual = 1;
+}
+
+u32_t
+sys_jiffies(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u32_t)(ts.tv_sec * 1000000000L + ts.tv_nsec);
+}
+
+#if SYS_LIGHTWEIGHT_PROT
+/**
+ * The "fast" protection is a recursive lock: the owning thread may call
+ * sys_arch_protect() again (e.g. pbuf_free() from within a memp critical
+ * section) without deadlocking. The returned level is not needed.
+ */
+sys_prot_t
+sys_arch_protect(void)
+{
+  if (lwprot_thread != pthread_self()) {
+    pthread_mutex_lock(&lwprot_mutex);
+    lwprot_thread = pthread_self();
+    lwprot_count = 1;
+  } else {
+    lwprot_count++;
+  }
+  return 0;
+}
+
+void
+sys_arch_unprotect(sys_prot_t pval)
+{
+  LWIP_UNUSED_ARG(pval);
+  if (lwprot_thread == pthread_self()) {
+    if (--lwprot_count == 0) {
+      lwprot_thread = (pthread_t)0xDEAD;
+      pthread_mutex_unlock(&lwprot_mutex);
+    }
+  }
+}
+#endif /* SYS_LIGHTWEIGHT_PROT */
+
+#if !NO_SYS
+
+struct sys_sem {
+  unsigned int c;
+  pthread_cond_t cond;
+  pthread_mutex_t mutex;
+};
+
+struct sys_mutex {
+  pthread_mutex_t mutex;
+};
+
+struct sys_mbox {
+  int first, last, size;
+  void **msgs;
+  struct sys_sem *not_empty;
+  struct sys_sem *not_full;
+  struct sys_sem *mutex;
+  int wait_send;
+};
+
+struct sys_thread {
+  pthread_t pthread;
+};
+
+struct sys_thread_arg {
+  lwip_thread_fn function;
+  void *arg;
+};
+
+/*-----------------------------------------------------------------------------------*/
+/* Threads */
+
+static void *
+sys_thread_start(void *arg)
+{
+  struct sys_thread_arg ta = *(struct sys_thread_arg *)arg;
+  free(arg);
+  ta.function(ta.arg);
+  return NULL;
+}
+
+sys_thread_t
+sys_thread_new(const char *name, lwip_thread_fn function, void *arg, int stacksize, int prio)
+{
+  struct sys_thread *thread;
+  struct sys_thread_arg *ta;
+  pthread_attr_t attr;
+  LWIP_UNUSED_ARG(name);
+  LWIP_UNUSED_ARG(prio);
+
+  thread = (struct sys_thread *)malloc(sizeof(struct sys_thread));
+  ta = (struct sys_thread_arg *)malloc(sizeof(struct sys_thread_arg));
+  LWIP_ASSERT("sys_thread_new: out of memory", (thread != NULL) && (ta != NULL));
+  ta->function = function;
+  ta->arg = arg;
+
+  pthread_attr_init(&attr);
+  if (stacksize > PTHREAD_STACK_MIN) {
+    pthread_attr_setstacksize(&attr, (size_t)stacksize);
+  }
+  if (pthread_create(&thread->pthread, &attr, sys_thread_start, ta) != 0) {
+    LWIP_ASSERT("sys_thread_new: pthread_create failed", 0);
+    free(ta);
+    free(thread);
+    thread = NULL;
+  }
+  pthread_attr_destroy(&attr);
+  return thread;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Semaphores */
+
+static struct sys_sem *
+sys_sem_new_internal(u8_t count)
+{
+  struct sys_sem *sem;
+  pthread_condattr_t cattr;
+
+  sem = (struct sys_sem *)malloc(sizeof(struct sys_sem));
+  if (sem != NULL) {
+    sem->c = count;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sem->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+    pthread_mutex_init(&sem->mutex, NULL);
+  }
+  return sem;
+}
+
+static void
+sys_sem_free_internal(struct sys_sem *sem)
+{
+  pthread_cond_destroy(&sem->cond);
+  pthread_mutex_destroy(&sem->mutex);
+  free(sem);
+}
+
+/** Wait on the condition of a locked semaphore.
+ * @return milliseconds waited or SYS_ARCH_TIMEOUT */
+static u32_t
+cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, u32_t timeout)
+{
+  struct timespec start, deadline, now;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (timeout == 0) {
+    pthread_cond_wait(cond, mutex);
+  } else {
+    deadline.tv_sec = start.tv_sec + timeout / 1000;
+    deadline.tv_nsec = start.tv_nsec + (long)(timeout % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    if (pthread_cond_timedwait(cond, mutex, &deadline) == ETIMEDOUT) {
+      return SYS_ARCH_TIMEOUT;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (u32_t)((now.tv_sec - start.tv_sec) * 1000 +
+                 (now.tv_nsec - start.tv_nsec) / 1000000);
+}
+
+err_t
+sys_sem_new(sys_sem_t *sem, u8_t count)
+{
+  SYS_STATS_INC_USED(sem);
+  *sem = sys_sem_new_internal(count);
+  if (*sem == NULL) {
+    SYS_STATS_INC(sem.err);
+    return ERR_MEM;
+  }
+  return ERR_OK;
+}
+
+u32_t
+sys_arch_sem_wait(sys_sem_t *s, u32_t timeout)
+{
+  u32_t time_needed = 0;
+  struct sys_sem *sem = *s;
+
+  pthread_mutex_lock(&sem->mutex);
+  while (sem->c <= 0) {
+    u32_t waited = cond_wait(&sem->cond, &sem->mutex, timeout);
+    if (waited == SYS_ARCH_TIMEOUT) {
+      pthread_mutex_unlock(&sem->mutex);
+      return SYS_ARCH_TIMEOUT;
+    }
+    time_needed += waited;
+    if ((timeout != 0) && (time_needed < timeout)) {
+      /* spurious wakeup: wait for the rest only */
+      timeout -= waited;
+    }
+  }
+  sem->c--;
+  pthread_mutex_unlock(&sem->mutex);
+  return time_needed;
+}
+
+void
+sys_sem_signal(sys_sem_t *s)
+{
+  struct sys_sem *sem = *s;
+
+  pthread_mutex_lock(&sem->mutex);
+  sem->c++;
+  if (sem->c > 1) {
+    sem->c = 1;
+  }
+  pthread_cond_broadcast(&sem->cond);
+  pthread_mutex_unlock(&sem->mutex);
+}
+
+void
+sys_sem_free(sys_sem_t *sem)
+{
+  if ((sem != NULL) && (*sem != SYS_SEM_NULL)) {
+    SYS_STATS_DEC(sem.used);
+    sys_sem_free_internal(*sem);
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Mutexes */
+
+err_t
+sys_mutex_new(sys_mutex_t *mutex)
+{
+  struct sys_mutex *mtx;
+
+  mtx = (struct sys_mutex *)malloc(sizeof(struct sys_mutex));
+  if (mtx == NULL) {
+    return ERR_MEM;
+  }
+  pthread_mutex_init(&mtx->mutex, NULL);
+  *mutex = mtx;
+  return ERR_OK;
+}
+
+void
+sys_mutex_lock(sys_mutex_t *mutex)
+{
+  pthread_mutex_lock(&((*mutex)->mutex));
+}
+
+void
+sys_mutex_unlock(sys_mutex_t *mutex)
+{
+  pthread_mutex_unlock(&((*mutex)->mutex));
+}
+
+void
+sys_mutex_free(sys_mutex_t *mutex)
+{
+  pthread_mutex_destroy(&((*mutex)->mutex));
+  free(*mutex);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Mailboxes */
+
+err_t
+sys_mbox_new(struct sys_mbox **mb, int size)
+{
+  struct sys_mbox *mbox;
+
+  if (size <= 0) {
+    size = 128;
+  }
+  mbox = (struct sys_mbox *)malloc(sizeof(struct sys_mbox));
+  if (mbox == NULL) {
+    return ERR_MEM;
+  }
+  mbox->msgs = (void **)malloc(sizeof(void *) * (size_t)size);
+  if (mbox->msgs == NULL) {
+    free(mbox);
+    return ERR_MEM;
+  }
+  mbox->size = size;
+  mbox->first = mbox->last = 0;
+  mbox->not_empty = sys_sem_new_internal(0);
+  mbox->not_full = sys_sem_new_internal(0);
+  mbox->mutex = sys_sem_new_internal(1);
+  mbox->wait_send = 0;
+
+  SYS_STATS_INC_USED(mbox);
+  *mb = mbox;
+  return ERR_OK;
+}
+
+void
+sys_mbox_free(struct sys_mbox **mb)
+{
+  if ((mb != NULL) && (*mb != SYS_MBOX_NULL)) {
+    struct sys_mbox *mbox = *mb;
+    SYS_STATS_DEC(mbox.used);
+    sys_arch_sem_wait(&mbox->mutex, 0);
+
+    sys_sem_free_internal(mbox->not_empty);
+    sys_sem_free_internal(mbox->not_full);
+    sys_sem_free_internal(mbox->mutex);
+    mbox->not_empty = mbox->not_full = mbox->mutex = NULL;
+    free(mbox->msgs);
+    free(mbox);
+  }
+}
+
+err_t
+sys_mbox_trypost(struct sys_mbox **mb, void *msg)
+{
+  u8_t first;
+  struct sys_mbox *mbox = *mb;
+
+  sys_arch_sem_wait(&mbox->mutex, 0);
+
+  if ((mbox->last + 1) >= (mbox->first + mbox->size)) {
+    sys_sem_signal(&mbox->mutex);
+    return ERR_MEM;
+  }
+
+  mbox->msgs[mbox->last % mbox->size] = msg;
+  first = (mbox->last == mbox->first);
+  mbox->last++;
+
+  if (first) {
+    sys_sem_signal(&mbox->not_empty);
+  }
+  sys_sem_signal(&mbox->mutex);
+  return ERR_OK;
+}
+
+void
+sys_mbox_post(struct sys_mbox **mb, void *msg)
+{
+  u8_t first;
+  struct sys_mbox *mbox = *mb;
+
+  sys_arch_sem_wait(&mbox->mutex, 0);
+
+  while ((mbox->last + 1) >= (mbox->first + mbox->size)) {
+    mbox->wait_send++;
+    sys_sem_signal(&mbox->mutex);
+    sys_arch_sem_wait(&mbox->not_full, 0);
+    sys_arch_sem_wait(&mbox->mutex, 0);
+    mbox->wait_send--;
+  }
+
+  mbox->msgs[mbox->last % mbox->size] = msg;
+  first = (mbox->last == mbox->first);
+  mbox->last++;
+
+  if (first) {
+    sys_sem_signal(&mbox->not_empty);
+  }
+  sys_sem_signal(&mbox->mutex);
+}
+
+u32_t
+sys_arch_mbox_tryfetch(struct sys_mbox **mb, void **msg)
+{
+  struct sys_mbox *mbox = *mb;
+
+  sys_arch_sem_wait(&mbox->mutex, 0);
+
+  if (mbox->first == mbox->last) {
+    sys_sem_signal(&mbox->mutex);
+    return SYS_MBOX_EMPTY;
+  }
+
+  if (msg != NULL) {
+    *msg = mbox->msgs[mbox->first % mbox->size];
+  }
+  mbox->first++;
+
+  if (mbox->wait_send) {
+    sys_sem_signal(&mbox->not_full);
+  }
+  sys_sem_signal(&mbox->mutex);
+  return 0;
+}
+
+u32_t
+sys_arch_mbox_fetch(struct sys_mbox **mb, void **msg, u32_t timeout)
+{
+  u32_t time_needed = 0;
+  struct sys_mbox *mbox = *mb;
+
+  /* The mutex lock is quick so we don't bother with the timeout stuff here. */
+  sys_arch_sem_wait(&mbox->mutex, 0);
+
+  while (mbox->first == mbox->last) {
+    sys_sem_signal(&mbox->mutex);
+
+    /* We block while waiting for a mail to arrive in the mailbox. We
+       must be prepared to timeout. */
+    if (timeout != 0) {
+      time_needed = sys_arch_sem_wait(&mbox->not_empty, timeout);
+      if (time_needed == SYS_ARCH_TIMEOUT) {
+        return SYS_ARCH_TIMEOUT;
+      }
+    } else {
+      sys_arch_sem_wait(&mbox->not_empty, 0);
+    }
+
+    sys_arch_sem_wait(&mbox->mutex, 0);
+  }
+
+  if (msg != NULL) {
+    *msg = mbox->msgs[mbox->first % mbox->size];
+  }
+  mbox->first++;
+
+  if (mbox->wait_send) {
+    sys_sem_signal(&mbox->not_full);
+  }
+  sys_sem_signal(&mbox->mutex);
+  return time_needed;
+}
+
+#endif /* !NO_SYS */
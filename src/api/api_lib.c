@@ -335,11 +335,13 @@ netconn_accept(struct netconn *conn, struct netconn **new_conn)
  *
  * @param conn the netconn from which to receive data
  * @param new_buf pointer where a new pbuf/netbuf is stored when received data
+ * @param recved TCP: 0 to leave updating the receive window to the caller
+ *               (even without NETCONN_FLAG_NO_AUTO_RECVED)
  * @return ERR_OK if data has been received, an error code otherwise (timeout,
  *                memory error or another error)
  */
 static err_t
-netconn_recv_data(struct netconn *conn, void **new_buf)
+netconn_recv_data(struct netconn *conn, void **new_buf, u8_t recved)
 {
   void *buf = NULL;
   u16_t len;
@@ -373,7 +375,7 @@ netconn_recv_data(struct netconn *conn, void **new_buf)
 
 #if LWIP_TCP
   if (conn->type == NETCONN_TCP) {
-    if (!netconn_get_noautorecved(conn) || (buf == NULL)) {
+    if ((recved && !netconn_get_noautorecved(conn)) || (buf == NULL)) {
       /* Let the stack know that we have taken the data. */
       /* TODO: Speedup: Don't block and wait for the answer here
          (to prevent multiple thread-switches). */
@@ -436,7 +438,7 @@ netconn_recv_tcp_pbuf(struct netconn *conn, struct pbuf **new_buf)
   LWIP_ERROR("netconn_recv: invalid conn", (conn != NULL) &&
              netconn_type(conn) == NETCONN_TCP, return ERR_ARG;);
 
-  return netconn_recv_data(conn, (void **)new_buf);
+  return netconn_recv_data(conn, (void **)new_buf, 1);
 }
 
 /**
@@ -471,7 +473,7 @@ netconn_recv(struct netconn *conn, struct netbuf **new_buf)
       return ERR_MEM;
     }
 
-    err = netconn_recv_data(conn, (void **)&p);
+    err = netconn_recv_data(conn, (void **)&p, 1);
     if (err != ERR_OK) {
       memp_free(MEMP_NETBUF, buf);
       return err;
@@ -489,7 +491,7 @@ netconn_recv(struct netconn *conn, struct netbuf **new_buf)
 #endif /* LWIP_TCP */
   {
 #if (LWIP_UDP || LWIP_RAW)
-    return netconn_recv_data(conn, (void **)new_buf);
+    return netconn_recv_data(conn, (void **)new_buf, 1);
 #endif /* (LWIP_UDP || LWIP_RAW) */
   }
 }
@@ -526,6 +528,177 @@ netconn_recved(struct netconn *conn, u32_t length)
 #endif /* LWIP_TCP */
 }
 
+#if LWIP_NETCONN_RECV_ZC
+/** Count the driver buffers (esf_buf) referenced by a pbuf chain */
+static s16_t
+netconn_zc_esf(struct pbuf *p)
+{
+  s16_t n = 0;
+
+  for (; p != NULL; p = p->next) {
+    if (p->eb != NULL) {
+      n++;
+    }
+  }
+  return n;
+}
+
+/**
+ * Account the driver buffers of a pbuf chain handed to the application by
+ * netconn_recv_zc(). If that would exceed LWIP_NETCONN_RECV_ZC_ESF_MAX, the
+ * data is copied into PBUF_RAM instead and the driver buffers are recycled.
+ * Also used by the socket layer for data left over by lwip_recvfrom().
+ *
+ * @param conn the netconn the data was received on
+ * @param p pointer to the received pbuf chain, may be replaced by a copy
+ */
+void
+netconn_recv_zc_take(struct netconn *conn, struct pbuf **p)
+{
+  struct pbuf *q;
+  s16_t n;
+  u8_t copy = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  n = netconn_zc_esf(*p);
+  if (n == 0) {
+    return;
+  }
+  SYS_ARCH_PROTECT(lev);
+  if (conn->zc_esf + n > LWIP_NETCONN_RECV_ZC_ESF_MAX) {
+    copy = 1;
+  } else {
+    conn->zc_esf += n;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (copy) {
+    q = pbuf_alloc(PBUF_RAW, (*p)->tot_len, PBUF_RAM);
+    if ((q != NULL) && (pbuf_copy(q, *p) == ERR_OK)) {
+      LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_recv_zc: %"S16_F" driver buffers held, copying\n",
+        conn->zc_esf));
+      pbuf_free(*p);
+      *p = q;
+      return;
+    }
+    if (q != NULL) {
+      pbuf_free(q);
+    }
+    /* no memory for a copy: hand out the driver buffers anyway */
+    SYS_ARCH_INC(conn->zc_esf, n);
+  }
+}
+
+/**
+ * Receive data from a netconn without copying: the application gets the
+ * pbuf chain as received by the driver (for PBUF_ESF_RX, the WLAN buffers
+ * themselves) and must give it back with netconn_recv_zc_release().
+ * For TCP, the receive window is opened on release, not on receive.
+ *
+ * @param conn the netconn from which to receive data
+ * @param new_buf pointer where the received pbuf chain is stored
+ * @param addr if != NULL, the remote address is stored here
+ * @param port if != NULL, the remote port is stored here
+ * @return ERR_OK if data has been received, an error code otherwise (timeout,
+ *                memory error or another error)
+ */
+err_t
+netconn_recv_zc(struct netconn *conn, struct pbuf **new_buf,
+                ip_addr_t *addr, u16_t *port)
+{
+  void *buf;
+  struct pbuf *p;
+  err_t err;
+
+  LWIP_ERROR("netconn_recv_zc: invalid pointer", (new_buf != NULL), return ERR_ARG;);
+  *new_buf = NULL;
+  LWIP_ERROR("netconn_recv_zc: invalid conn",    (conn != NULL),    return ERR_ARG;);
+
+  err = netconn_recv_data(conn, &buf, 0);
+  if (err != ERR_OK) {
+    return err;
+  }
+
+#if LWIP_TCP
+  if (conn->type == NETCONN_TCP) {
+    ip_addr_t remote;
+    u16_t remote_port;
+
+    p = (struct pbuf *)buf;
+    if ((addr != NULL) || (port != NULL)) {
+      netconn_getaddr(conn, &remote, &remote_port, 0);
+      if (addr != NULL) {
+        ip_addr_copy(*addr, remote);
+      }
+      if (port != NULL) {
+        *port = remote_port;
+      }
+    }
+  } else
+#endif /* LWIP_TCP */
+  {
+    struct netbuf *nbuf = (struct netbuf *)buf;
+
+    p = nbuf->p;
+    if (addr != NULL) {
+      ip_addr_copy(*addr, *netbuf_fromaddr(nbuf));
+    }
+    if (port != NULL) {
+      *port = netbuf_fromport(nbuf);
+    }
+    /* keep the pbuf, free only the netbuf */
+    nbuf->p = nbuf->ptr = NULL;
+    netbuf_delete(nbuf);
+  }
+
+  netconn_recv_zc_take(conn, &p);
+  *new_buf = p;
+  return ERR_OK;
+}
+
+/**
+ * Give back data received with netconn_recv_zc(): frees the pbuf chain
+ * (recycling driver buffers) and, for TCP, opens the receive window
+ * (unless NETCONN_FLAG_NO_AUTO_RECVED is set, as for sockets).
+ *
+ * @param conn the netconn the data was received on (NULL if it has been
+ *             deleted in the meantime)
+ * @param p the pbuf chain returned by netconn_recv_zc()
+ */
+void
+netconn_recv_zc_release(struct netconn *conn, struct pbuf *p)
+{
+  u32_t len;
+  s16_t n;
+
+  if (p == NULL) {
+    return;
+  }
+  len = p->tot_len;
+  n = netconn_zc_esf(p);
+  pbuf_free(p);
+
+  if (conn == NULL) {
+    return;
+  }
+  if (n > 0) {
+    SYS_ARCH_DEC(conn->zc_esf, n);
+  }
+#if LWIP_TCP
+  if ((conn->type == NETCONN_TCP) && !netconn_get_noautorecved(conn)) {
+    struct api_msg msg;
+    msg.function = do_recv;
+    msg.msg.conn = conn;
+    msg.msg.msg.r.len = len;
+    /* don't care for the return value of do_recv */
+    TCPIP_APIMSG(&msg);
+  }
+#else /* LWIP_TCP */
+  LWIP_UNUSED_ARG(len);
+#endif /* LWIP_TCP */
+}
+#endif /* LWIP_NETCONN_RECV_ZC */
+
 /**
  * Send data (in form of a netbuf) to a specific remote IP address and port.
  * Only to be used for UDP and RAW netconns (not TCP).
@@ -603,6 +776,9 @@ netconn_write(struct netconn *conn, const void *dataptr, size_t size, u8_t apifl
   msg.msg.msg.w.dataptr = dataptr;
   msg.msg.msg.w.apiflags = apiflags;
   msg.msg.msg.w.len = size;
+#if LWIP_TCP && LWIP_TCP_WRITEV
+  msg.msg.msg.w.iov = NULL;
+#endif /* LWIP_TCP && LWIP_TCP_WRITEV */
   /* For locking the core: this _can_ be delayed on low memory/low send buffer,
      but if it is, this is done inside api_msg.c:do_write(), so we can use the
      non-blocking version here. */
@@ -612,6 +788,76 @@ netconn_write(struct netconn *conn, const void *dataptr, size_t size, u8_t apifl
   return err;
 }
 
+#if LWIP_TCP && LWIP_TCP_WRITEV
+/**
+ * Send a list of application buffers over a TCP netconn without copying
+ * them (see tcp_writev()). Each buffer is queued whole, so none may be
+ * larger than TCP_SND_BUF or need more than TCP_SND_QUEUELEN pbufs (see
+ * doc/rawapi.txt); such a buffer fails with ERR_VAL. The 'done' callbacks
+ * of the tcp_iovecs are called from the tcpip_thread (or a netif driver
+ * freeing the last reference) once the buffers may be reused.
+ *
+ * @param conn the TCP netconn over which to send data
+ * @param iov array of buffers, which must stay valid until the 'done'
+ *        callbacks of all queued entries were called
+ * @param iovcnt number of entries in 'iov'
+ * @param apiflags combination of NETCONN_COPY, NETCONN_MORE and
+ *        NETCONN_DONTBLOCK; a nonblocking write returns as soon as at least
+ *        one buffer was queued
+ * @param queued receives the number of buffers queued (may be NULL)
+ * @return ERR_OK if at least one buffer (all if blocking) was queued,
+ *         ERR_WOULDBLOCK if a nonblocking write could not queue any, any
+ *         other err_t on error
+ */
+err_t
+netconn_writev(struct netconn *conn, struct tcp_iovec *iov, u8_t iovcnt,
+               u8_t apiflags, u8_t *queued)
+{
+  struct api_msg msg;
+  err_t err;
+  u32_t pbufs;
+  u8_t i;
+
+  if (queued != NULL) {
+    *queued = 0;
+  }
+  LWIP_ERROR("netconn_writev: invalid conn",  (conn != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_writev: invalid conn->type",  (conn->type == NETCONN_TCP), return ERR_VAL;);
+  LWIP_ERROR("netconn_writev: invalid iov",  (iov != NULL) || (iovcnt == 0), return ERR_ARG;);
+  if (iovcnt == 0) {
+    return ERR_OK;
+  }
+  for (i = 0; i < iovcnt; i++) {
+    /* a buffer that never fits into the send queue would block forever:
+       it needs a pbuf per segment of up to TCP_MSS bytes (two, header and
+       data, if not copied) and one for the part appended to the last
+       segment queued before it */
+    pbufs = ((u32_t)iov[i].len + TCP_MSS - 1) / TCP_MSS;
+    if (!(apiflags & NETCONN_COPY)) {
+      pbufs *= 2;
+    }
+    if ((iov[i].len > TCP_SND_BUF) || (pbufs + 1 > TCP_SND_QUEUELEN)) {
+      return ERR_VAL;
+    }
+  }
+
+  msg.function = do_write;
+  msg.msg.conn = conn;
+  msg.msg.msg.w.dataptr = NULL;
+  msg.msg.msg.w.apiflags = apiflags;
+  msg.msg.msg.w.len = iovcnt;
+  msg.msg.msg.w.iov = iov;
+  msg.msg.msg.w.queued = 0;
+  err = TCPIP_APIMSG(&msg);
+  if (queued != NULL) {
+    *queued = msg.msg.msg.w.queued;
+  }
+
+  NETCONN_SET_SAFE_ERR(conn, err);
+  return err;
+}
+#endif /* LWIP_TCP && LWIP_TCP_WRITEV */
+
 /**
  * Close ot shutdown a TCP netconn (doesn't delete it).
  *
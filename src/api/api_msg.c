@@ -631,6 +631,9 @@ netconn_alloc(enum netconn_type t, netconn_callback callback)
   conn->recv_bufsize = RECV_BUFSIZE_DEFAULT;
   conn->recv_avail   = 0;
 #endif /* LWIP_SO_RCVBUF */
+#if LWIP_NETCONN_RECV_ZC
+  conn->zc_esf       = 0;
+#endif /* LWIP_NETCONN_RECV_ZC */
   conn->flags = 0;
   return conn;
 }
@@ -1184,6 +1187,92 @@ do_recv(struct api_msg_msg *msg)
   TCPIP_APIMSG_ACK(msg);
 }
 
+#if LWIP_TCP_WRITEV
+/**
+ * do_writemore() for netconn_writev(): write_offset counts the tcp_iovecs
+ * queued so far. Buffers are queued whole; a blocking write waits for
+ * space for the next one, a nonblocking write returns once at least one
+ * buffer was queued (or ERR_WOULDBLOCK if none could be).
+ *
+ * @param conn netconn (that is currently in state NETCONN_WRITE) to process
+ * @return ERR_OK
+ *         ERR_MEM if LWIP_TCPIP_CORE_LOCKING=1 and sending hasn't yet finished
+ */
+static err_t
+do_writemore_iov(struct netconn *conn)
+{
+  struct api_msg_msg *msg = conn->current_msg;
+  err_t err;
+  u8_t queued = 0;
+  u8_t write_finished = 0;
+  u8_t dontblock = netconn_is_nonblocking(conn) ||
+       (msg->msg.w.apiflags & NETCONN_DONTBLOCK);
+
+  err = tcp_writev(conn->pcb.tcp, msg->msg.w.iov + conn->write_offset,
+                   (u8_t)(msg->msg.w.len - conn->write_offset),
+                   (u8_t)(msg->msg.w.apiflags & ~NETCONN_DONTBLOCK), &queued);
+  conn->write_offset += queued;
+  msg->msg.w.queued = (u8_t)conn->write_offset;
+
+  if (((err == ERR_OK) || (err == ERR_MEM)) &&
+      ((tcp_sndbuf(conn->pcb.tcp) <= TCP_SNDLOWAT) ||
+       (tcp_sndqueuelen(conn->pcb.tcp) >= TCP_SNDQUEUELOWAT))) {
+    /* The queued byte- or pbuf-count exceeds the configured low-water limit,
+       let select mark this pcb as non-writable. */
+    API_EVENT(conn, NETCONN_EVT_SENDMINUS, 0);
+  }
+  if ((err == ERR_OK) || (err == ERR_MEM)) {
+    tcp_output(conn->pcb.tcp);
+  }
+
+  if (err == ERR_OK) {
+    /* everything was written */
+    write_finished = 1;
+  } else if (err == ERR_MEM) {
+    if (dontblock) {
+      /* return what was queued; nothing at all means the write would block */
+      write_finished = 1;
+      if (conn->write_offset == 0) {
+        err = ERR_WOULDBLOCK;
+        /* let poll_tcp check writable space to mark the pcb
+           writable again */
+        conn->flags |= NETCONN_FLAG_CHECK_WRITESPACE;
+        API_EVENT(conn, NETCONN_EVT_SENDMINUS, 0);
+      } else {
+        err = ERR_OK;
+      }
+    } else {
+      /* wait for sent_tcp or poll_tcp to free space for the next buffer */
+#if LWIP_TCPIP_CORE_LOCKING
+      conn->flags |= NETCONN_FLAG_WRITE_DELAYED;
+#endif
+    }
+  } else {
+    /* On errors != ERR_MEM, we don't try writing any more but return
+       the error to the application thread. */
+    write_finished = 1;
+  }
+
+  if (write_finished) {
+    conn->write_offset = 0;
+    msg->err = err;
+    conn->current_msg = NULL;
+    conn->state = NETCONN_NONE;
+#if LWIP_TCPIP_CORE_LOCKING
+    if ((conn->flags & NETCONN_FLAG_WRITE_DELAYED) != 0)
+#endif
+    {
+      sys_sem_signal(&conn->op_completed);
+    }
+  }
+#if LWIP_TCPIP_CORE_LOCKING
+  else
+    return ERR_MEM;
+#endif
+  return ERR_OK;
+}
+#endif /* LWIP_TCP_WRITEV */
+
 /**
  * See if more data needs to be written from a previous call to netconn_write.
  * Called initially from do_write. If the first call can't send all data
@@ -1214,6 +1303,12 @@ do_writemore(struct netconn *conn)
   LWIP_ASSERT("conn->write_offset < conn->current_msg->msg.w.len",
     conn->write_offset < conn->current_msg->msg.w.len);
 
+#if LWIP_TCP_WRITEV
+  if (conn->current_msg->msg.w.iov != NULL) {
+    return do_writemore_iov(conn);
+  }
+#endif /* LWIP_TCP_WRITEV */
+
   dataptr = (u8_t*)conn->current_msg->msg.w.dataptr + conn->write_offset;
   diff = conn->current_msg->msg.w.len - conn->write_offset;
   if (diff > 0xffffUL) { /* max_u16_t */
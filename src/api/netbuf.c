@@ -42,6 +42,9 @@
 
 #include "lwip/netbuf.h"
 #include "lwip/memp.h"
+#if LWIP_CHECKSUM_ON_COPY
+#include "lwip/inet_chksum.h"
+#endif /* LWIP_CHECKSUM_ON_COPY */
 
 #include <string.h>
 
@@ -112,6 +115,9 @@ netbuf_alloc(struct netbuf *buf, u16_t size)
   if (buf->p != NULL) {
     pbuf_free(buf->p);
   }
+#if LWIP_CHECKSUM_ON_COPY
+  buf->flags &= ~NETBUF_FLAG_CHKSUM;
+#endif /* LWIP_CHECKSUM_ON_COPY */
   buf->p = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_RAM);
   if (buf->p == NULL) {
      return NULL;
@@ -153,6 +159,9 @@ netbuf_ref(struct netbuf *buf, const void *dataptr, u16_t size)
   if (buf->p != NULL) {
     pbuf_free(buf->p);
   }
+#if LWIP_CHECKSUM_ON_COPY
+  buf->flags &= ~NETBUF_FLAG_CHKSUM;
+#endif /* LWIP_CHECKSUM_ON_COPY */
   buf->p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
   if (buf->p == NULL) {
     buf->ptr = NULL;
@@ -164,6 +173,35 @@ netbuf_ref(struct netbuf *buf, const void *dataptr, u16_t size)
   return ERR_OK;
 }
 
+#if LWIP_CHECKSUM_ON_COPY
+/**
+ * Copy data into the packet buffer of a netbuf (like netbuf_take()) and
+ * keep the checksum computed while copying, so that sending the netbuf
+ * over UDP does not read the data again.
+ * The data in the netbuf must not be changed afterwards.
+ *
+ * @param buf netbuf with a packet buffer allocated by netbuf_alloc()
+ * @param dataptr pointer to the data to copy
+ * @param len length of the data, must be the size given to netbuf_alloc()
+ * @return ERR_OK if the data was copied
+ *         ERR_ARG if it does not fit into the packet buffer
+ */
+err_t
+netbuf_take_chksum(struct netbuf *buf, const void *dataptr, u16_t len)
+{
+  LWIP_ERROR("netbuf_take_chksum: invalid buf", ((buf != NULL) && (buf->p != NULL)), return ERR_ARG;);
+  LWIP_ERROR("netbuf_take_chksum: invalid dataptr", (dataptr != NULL), return ERR_ARG;);
+
+  if ((buf->p->len != len) || (buf->p->tot_len != len)) {
+    /* the checksum must cover the whole (single) pbuf */
+    buf->flags &= ~NETBUF_FLAG_CHKSUM;
+    return pbuf_take(buf->p, dataptr, len);
+  }
+  netbuf_set_chksum(buf, LWIP_CHKSUM_COPY(buf->p->payload, dataptr, len));
+  return ERR_OK;
+}
+#endif /* LWIP_CHECKSUM_ON_COPY */
+
 /**
  * Chain one netbuf to another (@see pbuf_chain)
  *
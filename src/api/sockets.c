@@ -742,6 +742,191 @@ lwip_recv(int s, void *mem, size_t len, int flags)
   return lwip_recvfrom(s, mem, len, flags, NULL, NULL);
 }
 
+#if LWIP_NETCONN_RECV_ZC
+/**
+ * Zero-copy variant of lwip_recvfrom(): instead of copying into user memory,
+ * the received pbuf chain is returned in *p. For TCP, that is everything
+ * received in one segment (or left over by a previous lwip_recvfrom()),
+ * for UDP/RAW one datagram. The caller must give it back with
+ * lwip_recv_zc_release(); for TCP, the receive window is opened then.
+ * MSG_PEEK is not supported.
+ *
+ * @return number of bytes in *p, 0 if the connection was closed or -1 on error
+ */
+int
+lwip_recvfrom_zc(int s, struct pbuf **p, int flags,
+        struct sockaddr *from, socklen_t *fromlen)
+{
+  struct lwip_sock *sock;
+  struct pbuf      *q;
+  ip_addr_t        addr;
+  u16_t            port = 0;
+  u16_t            off;
+  err_t            err;
+  u8_t             want_addr = (from != NULL) && (fromlen != NULL);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_zc(%d, %p, 0x%x, ..)\n", s, (void *)p, flags));
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  if ((p == NULL) || ((flags & MSG_PEEK) != 0)) {
+    sock_set_errno(sock, (p == NULL) ? EINVAL : EOPNOTSUPP);
+    return -1;
+  }
+  *p = NULL;
+  ip_addr_set_any(&addr);
+
+  if (sock->lastdata != NULL) {
+    /* hand out what lwip_recvfrom() has left */
+    if (netconn_type(sock->conn) == NETCONN_TCP) {
+      q = (struct pbuf *)sock->lastdata;
+      off = sock->lastoffset;
+      /* drop the pbufs already read completely from the head */
+      while (off >= q->len) {
+        struct pbuf *next = q->next;
+        LWIP_ASSERT("lastoffset < tot_len", next != NULL);
+        off -= q->len;
+        q->next = NULL;
+        q->tot_len = q->len;
+        /* next keeps the reference q had on it */
+        pbuf_free(q);
+        q = next;
+      }
+      pbuf_header(q, -(s16_t)off);
+      if (want_addr) {
+        netconn_getaddr(sock->conn, &addr, &port, 0);
+      }
+    } else {
+      struct netbuf *buf = (struct netbuf *)sock->lastdata;
+      q = buf->p;
+      ip_addr_copy(addr, *netbuf_fromaddr(buf));
+      port = netbuf_fromport(buf);
+      buf->p = buf->ptr = NULL;
+      netbuf_delete(buf);
+    }
+    sock->lastdata = NULL;
+    sock->lastoffset = 0;
+    netconn_recv_zc_take(sock->conn, &q);
+  } else {
+    if (((flags & MSG_DONTWAIT) || netconn_is_nonblocking(sock->conn)) &&
+        (sock->rcvevent <= 0)) {
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_zc(%d): returning EWOULDBLOCK\n", s));
+      sock_set_errno(sock, EWOULDBLOCK);
+      return -1;
+    }
+    err = netconn_recv_zc(sock->conn, &q, want_addr ? &addr : NULL, want_addr ? &port : NULL);
+    if (err != ERR_OK) {
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_zc(%d): error is \"%s\"!\n",
+        s, lwip_strerr(err)));
+      sock_set_errno(sock, err_to_errno(err));
+      return (err == ERR_CLSD) ? 0 : -1;
+    }
+  }
+
+  if (want_addr) {
+    struct sockaddr_in sin;
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_len = sizeof(sin);
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    inet_addr_from_ipaddr(&sin.sin_addr, &addr);
+
+    if (*fromlen > sizeof(sin)) {
+      *fromlen = sizeof(sin);
+    }
+    MEMCPY(from, &sin, *fromlen);
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_zc(%d): %p len=%"U16_F"\n", s, (void *)q, q->tot_len));
+  *p = q;
+  sock_set_errno(sock, 0);
+  return q->tot_len;
+}
+
+/**
+ * Give back a pbuf chain received with lwip_recvfrom_zc(). The chain is
+ * freed (recycling the driver buffers) even if the socket is not valid
+ * any more.
+ *
+ * @return 0 on success, -1 if s is not a valid socket
+ */
+int
+lwip_recv_zc_release(int s, struct pbuf *p)
+{
+  struct lwip_sock *sock;
+  u16_t len;
+
+  sock = get_socket(s);
+  if (!sock) {
+    if (p != NULL) {
+      pbuf_free(p);
+    }
+    return -1;
+  }
+  if (p != NULL) {
+    len = p->tot_len;
+    netconn_recv_zc_release(sock->conn, p);
+    /* sockets don't let the netconn update the receive window */
+    netconn_recved(sock->conn, len);
+  }
+  sock_set_errno(sock, 0);
+  return 0;
+}
+#endif /* LWIP_NETCONN_RECV_ZC */
+
+#if LWIP_TCP && LWIP_TCP_WRITEV
+/**
+ * Send a list of application buffers on a TCP socket without copying them
+ * (see netconn_writev()). The 'done' callback of each queued tcp_iovec
+ * tells when its buffer may be reused. Supported flags are MSG_MORE and
+ * MSG_DONTWAIT; a nonblocking call queues as many whole buffers as fit.
+ *
+ * @return the number of buffers queued, -1 on error (EMSGSIZE if a buffer
+ *         is larger than the send queue, EWOULDBLOCK if none could be
+ *         queued without blocking)
+ */
+int
+lwip_writev_zc(int s, struct tcp_iovec *iov, int iovcnt, int flags)
+{
+  struct lwip_sock *sock;
+  err_t err;
+  u8_t write_flags;
+  u8_t queued = 0;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_writev_zc(%d, iov=%p, iovcnt=%d, flags=0x%x)\n",
+                              s, (void *)iov, iovcnt, flags));
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (sock->conn->type != NETCONN_TCP) {
+    sock_set_errno(sock, EOPNOTSUPP);
+    return -1;
+  }
+  if ((iovcnt < 0) || (iovcnt > 0xff) || ((iov == NULL) && (iovcnt != 0))) {
+    sock_set_errno(sock, EINVAL);
+    return -1;
+  }
+
+  write_flags = ((flags & MSG_MORE)     ? NETCONN_MORE      : 0) |
+                ((flags & MSG_DONTWAIT) ? NETCONN_DONTBLOCK : 0);
+  err = netconn_writev(sock->conn, iov, (u8_t)iovcnt, write_flags, &queued);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_writev_zc(%d) err=%d queued=%"U16_F"\n", s, err, (u16_t)queued));
+  if (err == ERR_VAL) {
+    /* a buffer is too large to ever be queued */
+    sock_set_errno(sock, EMSGSIZE);
+    return -1;
+  }
+  sock_set_errno(sock, err_to_errno(err));
+  return (err == ERR_OK ? (int)queued : -1);
+}
+#endif /* LWIP_TCP && LWIP_TCP_WRITEV */
+
 int
 lwip_send(int s, const void *data, size_t size, int flags)
 {
@@ -826,23 +1011,31 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
   {
     struct pbuf* p;
     ip_addr_t *remote_addr;
-
-#if LWIP_NETIF_TX_SINGLE_PBUF
-    p = pbuf_alloc(PBUF_TRANSPORT, short_size, PBUF_RAM);
-    if (p != NULL) {
 #if LWIP_CHECKSUM_ON_COPY
-      u16_t chksum = 0;
-      if (sock->conn->type != NETCONN_RAW) {
+    u16_t chksum = 0;
+
+    if (sock->conn->type != NETCONN_RAW) {
+      /* copy into a new pbuf, summing the data on the way */
+      p = pbuf_alloc(PBUF_TRANSPORT, short_size, PBUF_RAM);
+      if (p != NULL) {
         chksum = LWIP_CHKSUM_COPY(p->payload, data, short_size);
-      } else
+      }
+    } else
 #endif /* LWIP_CHECKSUM_ON_COPY */
-      MEMCPY(p->payload, data, size);
+    {
+#if LWIP_NETIF_TX_SINGLE_PBUF
+      p = pbuf_alloc(PBUF_TRANSPORT, short_size, PBUF_RAM);
+      if (p != NULL) {
+        MEMCPY(p->payload, data, size);
+      }
 #else /* LWIP_NETIF_TX_SINGLE_PBUF */
-    p = pbuf_alloc(PBUF_TRANSPORT, short_size, PBUF_REF);
-    if (p != NULL) {
-      p->payload = (void*)data;
+      p = pbuf_alloc(PBUF_TRANSPORT, short_size, PBUF_REF);
+      if (p != NULL) {
+        p->payload = (void*)data;
+      }
 #endif /* LWIP_NETIF_TX_SINGLE_PBUF */
-
+    }
+    if (p != NULL) {
       if (to_in != NULL) {
         inet_addr_to_ipaddr_p(remote_addr, &to_in->sin_addr);
         remote_port = ntohs(to_in->sin_port);
@@ -856,13 +1049,13 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
         err = sock->conn->last_err = raw_sendto(sock->conn->pcb.raw, p, remote_addr);
       } else {
 #if LWIP_UDP
-#if LWIP_CHECKSUM_ON_COPY && LWIP_NETIF_TX_SINGLE_PBUF
+#if LWIP_CHECKSUM_ON_COPY
         err = sock->conn->last_err = udp_sendto_chksum(sock->conn->pcb.udp, p,
           remote_addr, remote_port, 1, chksum);
-#else /* LWIP_CHECKSUM_ON_COPY && LWIP_NETIF_TX_SINGLE_PBUF */
+#else /* LWIP_CHECKSUM_ON_COPY */
         err = sock->conn->last_err = udp_sendto(sock->conn->pcb.udp, p,
           remote_addr, remote_port);
-#endif /* LWIP_CHECKSUM_ON_COPY && LWIP_NETIF_TX_SINGLE_PBUF */
+#endif /* LWIP_CHECKSUM_ON_COPY */
 #else /* LWIP_UDP */
         err = ERR_ARG;
 #endif /* LWIP_UDP */
@@ -896,25 +1089,29 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
   LWIP_DEBUGF(SOCKETS_DEBUG, (" port=%"U16_F"\n", remote_port));
 
   /* make the buffer point to the data that should be sent */
-#if LWIP_NETIF_TX_SINGLE_PBUF
-  /* Allocate a new netbuf and copy the data into it. */
-  if (netbuf_alloc(&buf, short_size) == NULL) {
-    err = ERR_MEM;
-  } else {
 #if LWIP_CHECKSUM_ON_COPY
-    if (sock->conn->type != NETCONN_RAW) {
-      u16_t chksum = LWIP_CHKSUM_COPY(buf.p->payload, data, short_size);
-      netbuf_set_chksum(&buf, chksum);
-      err = ERR_OK;
-    } else
+  if (sock->conn->type != NETCONN_RAW) {
+    /* Copy the data into a new netbuf, summing it on the way so that
+       udp_sendto_if() does not read it again. */
+    if (netbuf_alloc(&buf, short_size) == NULL) {
+      err = ERR_MEM;
+    } else {
+      err = netbuf_take_chksum(&buf, data, short_size);
+    }
+  } else
 #endif /* LWIP_CHECKSUM_ON_COPY */
-    {
+  {
+#if LWIP_NETIF_TX_SINGLE_PBUF
+    /* Allocate a new netbuf and copy the data into it. */
+    if (netbuf_alloc(&buf, short_size) == NULL) {
+      err = ERR_MEM;
+    } else {
       err = netbuf_take(&buf, data, short_size);
     }
-  }
 #else /* LWIP_NETIF_TX_SINGLE_PBUF */
-  err = netbuf_ref(&buf, data, short_size);
+    err = netbuf_ref(&buf, data, short_size);
 #endif /* LWIP_NETIF_TX_SINGLE_PBUF */
+  }
   if (err == ERR_OK) {
     /* send the data */
     err = netconn_send(sock->conn, &buf);
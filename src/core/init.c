@@ -55,6 +55,8 @@
 #include "lwip/igmp.h"
 #include "lwip/dns.h"
 #include "lwip/timers.h"
+#include "lwip/reclaim.h"
+#include "lwip/inet_chksum.h"
 #include "netif/etharp.h"
 
 /* Compile-time sanity checks for configuration errors.
@@ -96,13 +98,34 @@
 #if (LWIP_UDP && (MEMP_NUM_UDP_PCB<=0))
   #error "If you want to use UDP, you have to define MEMP_NUM_UDP_PCB>=1 in your lwipopts.h"
 #endif
-#if 0  // Not constants, but vars for esp8266
+#if !LWIP_SDK_TUNABLES /* Not constants, but vars for esp8266 */
 #if (LWIP_TCP && (MEMP_NUM_TCP_PCB<=0))
   #error "If you want to use TCP, you have to define MEMP_NUM_TCP_PCB>=1 in your lwipopts.h"
 #endif
+#if !LWIP_WND_SCALE
 #if (LWIP_TCP && (TCP_WND > 0xffff))
   #error "If you want to use TCP, TCP_WND must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
 #endif
+#if (LWIP_TCP && (TCP_SND_BUF > 0xffff))
+  #error "If you want to use TCP, TCP_SND_BUF must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
+#endif
+#else /* !LWIP_WND_SCALE */
+#if (LWIP_TCP && (TCP_WND > (0xffffUL << TCP_RCV_SCALE)))
+  #error "TCP_WND is bigger than TCP_RCV_SCALE can announce, increase TCP_RCV_SCALE or reduce TCP_WND in your lwipopts.h"
+#endif
+#endif /* !LWIP_WND_SCALE */
+#endif
+#if (LWIP_TCP && LWIP_WND_SCALE && (TCP_RCV_SCALE > 14))
+  #error "TCP_RCV_SCALE must be 14 or less (RFC 7323)"
+#endif
+#if (LWIP_TCP && LWIP_TCP_SACK && !TCP_QUEUE_OOSEQ)
+  #error "LWIP_TCP_SACK needs TCP_QUEUE_OOSEQ to report out-of-sequence data"
+#endif
+#if (LWIP_TCP && LWIP_TCP_RACK && (!LWIP_TCP_SACK || !LWIP_TCP_TIMERS_MS))
+  #error "LWIP_TCP_RACK needs LWIP_TCP_SACK and LWIP_TCP_TIMERS_MS"
+#endif
+#if (LWIP_TCP && LWIP_TCP_CC && !(TCP_CC_NEWRENO || TCP_CC_CUBIC || TCP_CC_LOWMEM))
+  #error "LWIP_TCP_CC needs at least one of TCP_CC_NEWRENO, TCP_CC_CUBIC or TCP_CC_LOWMEM"
 #endif
 #if (LWIP_TCP && (TCP_SND_QUEUELEN > 0xffff))
   #error "If you want to use TCP, TCP_SND_QUEUELEN must fit in an u16_t, so, you have to reduce it in your lwipopts.h"
@@ -110,7 +133,7 @@
 #if (LWIP_TCP && (TCP_SND_QUEUELEN < 2))
   #error "TCP_SND_QUEUELEN must be at least 2 for no-copy TCP writes to work"
 #endif
-#if 0 // Not constants, but vars for esp8266
+#if !LWIP_SDK_TUNABLES /* Not constants, but vars for esp8266 */
 #if (LWIP_TCP && ((TCP_MAXRTX > 12) || (TCP_SYNMAXRTX > 12)))
   #error "If you want to use TCP, TCP_MAXRTX and TCP_SYNMAXRTX must less or equal to 12 (due to tcp_backoff table), so, you have to reduce them in your lwipopts.h"
 #endif
@@ -263,11 +286,13 @@ lwip_sanity_check(void)
 void
 lwip_init(void)
 {
+#if LWIP_SDK_TUNABLES
   MEMP_NUM_TCP_PCB = 5;
   TCP_WND = (4 * TCP_MSS);
   TCP_MAXRTX = 12;
   TCP_SYNMAXRTX = 6;
   DHCP_MAXRTX = 0;
+#endif /* LWIP_SDK_TUNABLES */
 
   /* Sanity check user-configurable values */
   lwip_sanity_check();
@@ -279,7 +304,13 @@ lwip_init(void)
 #endif /* !NO_SYS */
   mem_init();
   memp_init();
+#if LWIP_RECLAIM
+  reclaim_init();
+#endif /* LWIP_RECLAIM */
   pbuf_init();
+#if LWIP_CHKSUM_SELECT
+  inet_chksum_init();
+#endif /* LWIP_CHKSUM_SELECT */
   netif_init();
 #if LWIP_SOCKET
   lwip_socket_init();
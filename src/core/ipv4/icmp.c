@@ -134,12 +134,14 @@ icmp_input(struct pbuf *p, struct netif *inp)
       LWIP_DEBUGF(ICMP_DEBUG, ("icmp_input: bad ICMP echo received\n"));
       goto lenerr;
     }
-    if (inet_chksum_pbuf(p) != 0) {
-      LWIP_DEBUGF(ICMP_DEBUG, ("icmp_input: checksum failed for received ICMP echo\n"));
-      pbuf_free(p);
-      ICMP_STATS_INC(icmp.chkerr);
-      snmp_inc_icmpinerrors();
-      return;
+    IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_ICMP) {
+      if (inet_chksum_pbuf(p) != 0) {
+        LWIP_DEBUGF(ICMP_DEBUG, ("icmp_input: checksum failed for received ICMP echo\n"));
+        pbuf_free(p);
+        ICMP_STATS_INC(icmp.chkerr);
+        snmp_inc_icmpinerrors();
+        return;
+      }
     }
 #if LWIP_ICMP_ECHO_CHECK_INPUT_PBUF_LEN
     if (pbuf_header(p, (PBUF_IP_HLEN + PBUF_LINK_HLEN))) {
@@ -190,18 +192,34 @@ icmp_input(struct pbuf *p, struct netif *inp)
     ip_addr_copy(iphdr->src, *ip_current_dest_addr());
     ip_addr_copy(iphdr->dest, *ip_current_src_addr());
     ICMPH_TYPE_SET(iecho, ICMP_ER);
-    /* adjust the checksum */
-    if (iecho->chksum >= PP_HTONS(0xffff - (ICMP_ECHO << 8))) {
-      iecho->chksum += PP_HTONS(ICMP_ECHO << 8) + 1;
-    } else {
-      iecho->chksum += PP_HTONS(ICMP_ECHO << 8);
+    /* adjust the checksum (swapping the addresses doesn't change it) */
+    IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_GEN_ICMP) {
+      iecho->chksum = inet_chksum_adjust16(iecho->chksum,
+        htons((ICMP_ECHO << 8) | ICMPH_CODE(iecho)), htons((ICMP_ER << 8) | ICMPH_CODE(iecho)));
+    }
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+    else {
+      iecho->chksum = 0;
     }
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
 
-    /* Set the correct TTL and recalculate the header checksum. */
+    /* Set the correct TTL and update the header checksum. */
+#if CHECKSUM_GEN_IP
+    {
+      u16_t ttlproto = IPH_TTLPROTO(iphdr);
+      IPH_TTL_SET(iphdr, ICMP_TTL);
+      IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_GEN_IP) {
+        IPH_CHKSUM_SET(iphdr, inet_chksum_adjust16(IPH_CHKSUM(iphdr), ttlproto, IPH_TTLPROTO(iphdr)));
+      }
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+      else {
+        IPH_CHKSUM_SET(iphdr, 0);
+      }
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+    }
+#else /* CHECKSUM_GEN_IP */
     IPH_TTL_SET(iphdr, ICMP_TTL);
     IPH_CHKSUM_SET(iphdr, 0);
-#if CHECKSUM_GEN_IP
-    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
 #endif /* CHECKSUM_GEN_IP */
 
     ICMP_STATS_INC(icmp.xmit);
@@ -40,6 +40,7 @@
 
 #include "lwip/inet_chksum.h"
 #include "lwip/def.h"
+#include "lwip/perf.h"
 
 #include <stddef.h>
 #include <string.h>
@@ -52,9 +53,23 @@
  * #define LWIP_CHKSUM <your_checksum_routine> 
  *
  * Or you can select from the implementations below by defining
- * LWIP_CHKSUM_ALGORITHM to 1, 2 or 3.
+ * LWIP_CHKSUM_ALGORITHM to 1, 2, 3, 4 or 5, or choose one at run time
+ * with LWIP_CHKSUM_SELECT.
  */
 
+#if LWIP_CHKSUM_SELECT
+# ifdef LWIP_CHKSUM
+#  error "LWIP_CHKSUM_SELECT replaces LWIP_CHKSUM"
+# endif
+# ifndef LWIP_CHKSUM_ALGORITHM
+#  define LWIP_CHKSUM_ALGORITHM 2
+# endif
+# if (LWIP_CHKSUM_ALGORITHM != 2) && (LWIP_CHKSUM_ALGORITHM != 3)
+#  error "LWIP_CHKSUM_SELECT needs LWIP_CHKSUM_ALGORITHM 2 or 3 as the standard kernel"
+# endif
+# define LWIP_CHKSUM(dataptr, len) lwip_chksum_cur(dataptr, len)
+#endif /* LWIP_CHKSUM_SELECT */
+
 #ifndef LWIP_CHKSUM
 # define LWIP_CHKSUM lwip_standard_chksum
 # ifndef LWIP_CHKSUM_ALGORITHM
@@ -256,6 +271,258 @@ lwip_standard_chksum(void *dataptr, int len)
 }
 #endif
 
+#if (LWIP_CHKSUM_ALGORITHM == 4) || LWIP_CHKSUM_SELECT /* Alternative version #4 */
+/**
+ * Checksum 16 bytes per iteration for 32-bit CPUs without a carry flag
+ * (like the lx106): each aligned 32-bit word is split into its two 16-bit
+ * halves, which are added without carry tests. The sum can not overflow
+ * for len up to and including 0x1ff00.
+ *
+ * @param dataptr points to start of data to be summed at any boundary
+ * @param len length of data to be summed
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+static u16_t
+lwip_chksum_unrolled32(void *dataptr, int len)
+{
+  u8_t *pb = (u8_t *)dataptr;
+  u16_t *ps, t = 0;
+  u32_t *pl;
+  u32_t sum = 0, w;
+  int odd = ((mem_ptr_t)pb & 1);
+
+  if (odd && len > 0) {
+    ((u8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  ps = (u16_t *)(void *)pb;
+  if (((mem_ptr_t)ps & 3) && len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+
+  pl = (u32_t *)(void *)ps;
+  while (len > 15) {
+    w = pl[0];
+    sum += (w & 0xffff) + (w >> 16);
+    w = pl[1];
+    sum += (w & 0xffff) + (w >> 16);
+    w = pl[2];
+    sum += (w & 0xffff) + (w >> 16);
+    w = pl[3];
+    sum += (w & 0xffff) + (w >> 16);
+    pl += 4;
+    len -= 16;
+  }
+  while (len > 3) {
+    w = *pl++;
+    sum += (w & 0xffff) + (w >> 16);
+    len -= 4;
+  }
+
+  ps = (u16_t *)pl;
+  if (len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+  if (len > 0) {
+    ((u8_t *)&t)[0] = *(u8_t *)ps;
+  }
+  sum += t;
+
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+
+  if (odd) {
+    sum = SWAP_BYTES_IN_WORD(sum);
+  }
+
+  return (u16_t)sum;
+}
+#endif
+
+#if (LWIP_CHKSUM_ALGORITHM == 5) || LWIP_CHKSUM_SELECT /* Alternative version #5 */
+/**
+ * Checksum with a 64-bit accumulator for 64-bit CPUs: 32-bit words are
+ * added without carry handling, 16 bytes per iteration.
+ *
+ * @param dataptr points to start of data to be summed at any boundary
+ * @param len length of data to be summed
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+static u16_t
+lwip_chksum_acc64(void *dataptr, int len)
+{
+  u8_t *pb = (u8_t *)dataptr;
+  u16_t *ps, t = 0;
+  u32_t *pl;
+  unsigned long long sum = 0;
+  u32_t sum32;
+  int odd = ((mem_ptr_t)pb & 1);
+
+  if (odd && len > 0) {
+    ((u8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  ps = (u16_t *)(void *)pb;
+  if (((mem_ptr_t)ps & 3) && len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+
+  pl = (u32_t *)(void *)ps;
+  while (len > 15) {
+    sum += (unsigned long long)pl[0] + pl[1] + pl[2] + pl[3];
+    pl += 4;
+    len -= 16;
+  }
+  while (len > 3) {
+    sum += *pl++;
+    len -= 4;
+  }
+
+  ps = (u16_t *)pl;
+  if (len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+  if (len > 0) {
+    ((u8_t *)&t)[0] = *(u8_t *)ps;
+  }
+  sum += t;
+
+  /* fold 64 to 32 bits (twice for the carry), then to 16 bits */
+  sum = (sum >> 32) + (sum & 0xffffffffULL);
+  sum = (sum >> 32) + (sum & 0xffffffffULL);
+  sum32 = (u32_t)sum;
+  sum32 = FOLD_U32T(sum32);
+  sum32 = FOLD_U32T(sum32);
+
+  if (odd) {
+    sum32 = SWAP_BYTES_IN_WORD(sum32);
+  }
+
+  return (u16_t)sum32;
+}
+#endif
+
+#if (LWIP_CHKSUM_ALGORITHM == 4)
+# define lwip_standard_chksum lwip_chksum_unrolled32
+#elif (LWIP_CHKSUM_ALGORITHM == 5)
+# define lwip_standard_chksum lwip_chksum_acc64
+#endif
+
+#if LWIP_CHKSUM_SELECT
+const struct lwip_chksum_kernel lwip_chksum_kernels[] = {
+  { "standard",   lwip_standard_chksum,   NULL },
+  { "unrolled32", lwip_chksum_unrolled32, NULL },
+  { "acc64",      lwip_chksum_acc64,      NULL },
+#ifdef LWIP_CHKSUM_ARCH_KERNELS
+  LWIP_CHKSUM_ARCH_KERNELS
+#endif /* LWIP_CHKSUM_ARCH_KERNELS */
+  { NULL, NULL, NULL }
+};
+
+/** The kernel used by LWIP_CHKSUM, set by inet_chksum_init() */
+static const struct lwip_chksum_kernel *lwip_chksum_kernel = &lwip_chksum_kernels[0];
+static lwip_chksum_fn lwip_chksum_cur = lwip_standard_chksum;
+
+/**
+ * Select the checksum kernel: the last one in lwip_chksum_kernels[] that
+ * this CPU supports (the table is ordered by preference).
+ */
+void
+inet_chksum_init(void)
+{
+  const struct lwip_chksum_kernel *k;
+
+  for (k = lwip_chksum_kernels; k->name != NULL; k++) {
+    if ((k->supported == NULL) || k->supported()) {
+      lwip_chksum_kernel = k;
+    }
+  }
+  lwip_chksum_cur = lwip_chksum_kernel->fn;
+  LWIP_DEBUGF(INET_DEBUG, ("inet_chksum_init: using %s\n", lwip_chksum_kernel->name));
+}
+
+/**
+ * Use a specific checksum kernel.
+ *
+ * @param name name of an entry in lwip_chksum_kernels[]
+ * @return ERR_OK, or ERR_ARG if there is no such kernel or the CPU does
+ *         not support it
+ */
+err_t
+inet_chksum_select(const char *name)
+{
+  const struct lwip_chksum_kernel *k;
+
+  for (k = lwip_chksum_kernels; k->name != NULL; k++) {
+    if (strcmp(k->name, name) == 0) {
+      if ((k->supported != NULL) && !k->supported()) {
+        return ERR_ARG;
+      }
+      lwip_chksum_kernel = k;
+      lwip_chksum_cur = k->fn;
+      return ERR_OK;
+    }
+  }
+  return ERR_ARG;
+}
+
+/** @return the name of the checksum kernel in use */
+const char *
+inet_chksum_selected(void)
+{
+  return lwip_chksum_kernel->name;
+}
+#endif /* LWIP_CHKSUM_SELECT */
+
+/**
+ * Update a checksum after a 16-bit field it covers changed from oldval to
+ * newval, without summing the data again (RFC 1624, eqn. 3:
+ * HC' = ~(~HC + ~m + m')). Use the enclosing 16-bit word for 8-bit fields.
+ *
+ * @param chksum the checksum as stored in the header (network order)
+ * @param oldval previous value of the field (network order)
+ * @param newval new value of the field (network order)
+ * @return the new checksum to be stored in the header
+ */
+u16_t
+inet_chksum_adjust16(u16_t chksum, u16_t oldval, u16_t newval)
+{
+  u32_t acc;
+
+  acc = (u32_t)(u16_t)~chksum + (u16_t)~oldval + newval;
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return (u16_t)~acc;
+}
+
+/**
+ * Update a checksum after a 32-bit field it covers changed (sequence
+ * numbers, IP addresses).
+ *
+ * @param chksum the checksum as stored in the header (network order)
+ * @param oldval previous value of the field (network order)
+ * @param newval new value of the field (network order)
+ * @return the new checksum to be stored in the header
+ */
+u16_t
+inet_chksum_adjust32(u16_t chksum, u32_t oldval, u32_t newval)
+{
+  u32_t acc;
+
+  acc = (u32_t)(u16_t)~chksum +
+    (u16_t)~(oldval >> 16) + (u16_t)~(oldval & 0xffff) +
+    (newval >> 16) + (newval & 0xffff);
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return (u16_t)~acc;
+}
+
 /* inet_chksum_pseudo:
  *
  * Calculates the pseudo Internet checksum used by TCP and UDP for a pbuf chain.
@@ -278,6 +545,8 @@ inet_chksum_pseudo(struct pbuf *p,
   struct pbuf *q;
   u8_t swapped;
 
+  PERF_START;
+
   acc = 0;
   swapped = 0;
   /* iterate through all pbuf in chain */
@@ -313,6 +582,7 @@ inet_chksum_pseudo(struct pbuf *p,
   acc = FOLD_U32T(acc);
   acc = FOLD_U32T(acc);
   LWIP_DEBUGF(INET_DEBUG, ("inet_chksum_pseudo(): pbuf chain lwip_chksum()=%"X32_F"\n", acc));
+  PERF_STOP("inet_chksum_pseudo");
   return (u16_t)~(acc & 0xffffUL);
 }
 
@@ -448,3 +718,92 @@ lwip_chksum_copy(void *dst, const void *src, u16_t len)
   return LWIP_CHKSUM(dst, len);
 }
 #endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 1) */
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2) /* Version #2 */
+/** Single pass: every 32-bit word is loaded once, stored and added to a
+ * 64-bit accumulator (as in lwip_chksum_acc64()), so the data does not
+ * have to be read again after copying.
+ * Loads are aligned; stores are word-wide if dst has the same alignment
+ * as src, otherwise they go through SMEMCPY.
+ */
+u16_t
+lwip_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  const u8_t *s = (const u8_t *)src;
+  u8_t *d = (u8_t *)dst;
+  unsigned long long sum = 0;
+  u32_t sum32, w;
+  u16_t h, t = 0;
+  int odd = ((mem_ptr_t)s & 1);
+  int n = len;
+
+  if (odd && n > 0) {
+    ((u8_t *)&t)[1] = *d++ = *s++;
+    n--;
+  }
+  if (((mem_ptr_t)s & 3) && n > 1) {
+    h = *(const u16_t *)(const void *)s;
+    SMEMCPY(d, &h, 2);
+    sum += h;
+    s += 2;
+    d += 2;
+    n -= 2;
+  }
+
+  if (((mem_ptr_t)d & 3) == 0) {
+    const u32_t *ps = (const u32_t *)(const void *)s;
+    u32_t *pd = (u32_t *)(void *)d;
+    u32_t w1, w2, w3;
+    while (n > 15) {
+      w = ps[0];
+      w1 = ps[1];
+      w2 = ps[2];
+      w3 = ps[3];
+      pd[0] = w;
+      pd[1] = w1;
+      pd[2] = w2;
+      pd[3] = w3;
+      sum += (unsigned long long)w + w1 + w2 + w3;
+      ps += 4;
+      pd += 4;
+      n -= 16;
+    }
+    s = (const u8_t *)ps;
+    d = (u8_t *)pd;
+  }
+  while (n > 3) {
+    w = *(const u32_t *)(const void *)s;
+    SMEMCPY(d, &w, 4);
+    sum += w;
+    s += 4;
+    d += 4;
+    n -= 4;
+  }
+
+  if (n > 1) {
+    h = *(const u16_t *)(const void *)s;
+    SMEMCPY(d, &h, 2);
+    sum += h;
+    s += 2;
+    d += 2;
+    n -= 2;
+  }
+  if (n > 0) {
+    ((u8_t *)&t)[0] = *d = *s;
+  }
+  sum += t;
+
+  /* fold 64 to 32 bits (twice for the carry), then to 16 bits */
+  sum = (sum >> 32) + (sum & 0xffffffffULL);
+  sum = (sum >> 32) + (sum & 0xffffffffULL);
+  sum32 = (u32_t)sum;
+  sum32 = FOLD_U32T(sum32);
+  sum32 = FOLD_U32T(sum32);
+
+  if (odd) {
+    sum32 = SWAP_BYTES_IN_WORD(sum32);
+  }
+
+  return (u16_t)sum32;
+}
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
@@ -259,6 +259,39 @@ ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed)
 }
 #endif /* IP_REASS_FREE_OLDEST */
 
+#if LWIP_RECLAIM
+/**
+ * Reclaim handler: frees the oldest datagram being reassembled.
+ */
+u8_t
+ip_reass_reclaim(reclaim_src_t src, void *arg)
+{
+  struct ip_reassdata *r, *prev, *oldest, *oldest_prev;
+
+  LWIP_UNUSED_ARG(arg);
+  if (!RECLAIM_SRC_IS_PBUF(src) && (src != MEMP_REASSDATA)) {
+    return 0;
+  }
+  oldest = NULL;
+  oldest_prev = NULL;
+  prev = NULL;
+  for (r = reassdatagrams; r != NULL; r = r->next) {
+    /* the timer counts down */
+    if ((oldest == NULL) || (r->timer <= oldest->timer)) {
+      oldest = r;
+      oldest_prev = prev;
+    }
+    prev = r;
+  }
+  if (oldest == NULL) {
+    return 0;
+  }
+  LWIP_DEBUGF(IP_REASS_DEBUG, ("ip_reass_reclaim: freeing datagram %p\n", (void *)oldest));
+  ip_reass_free_complete_datagram(oldest, oldest_prev);
+  return 1;
+}
+#endif /* LWIP_RECLAIM */
+
 /**
  * Enqueues a new fragment into the fragment queue
  * @param fraghdr points to the new fragments IP hdr
@@ -18,6 +18,10 @@
  * LWIP_MALLOC_MEMPOOL(10, 512)
  * LWIP_MALLOC_MEMPOOL(5, 1512)
  * LWIP_MALLOC_MEMPOOL_END
+ *
+ * To get allocation and free times that do not depend on the number of blocks
+ * on the heap, define MEM_TLSF to 1: free blocks are then kept in segregated
+ * free lists (two-level segregated fit) instead of being searched first-fit.
  */
 
 /*
@@ -62,6 +66,7 @@
 #include "lwip/sys.h"
 #include "lwip/stats.h"
 #include "lwip/err.h"
+#include "lwip/reclaim.h"
 
 #include <string.h>
 
@@ -186,15 +191,36 @@ u8_t ram_heap[MEM_SIZE_ALIGNED + (2*SIZEOF_STRUCT_MEM) + MEM_ALIGNMENT];
 static u8_t *ram;
 /** the last entry, always unused! */
 static struct mem *ram_end;
+#if !MEM_TLSF
 /** pointer to the lowest free block, this is used for faster search */
 static struct mem *lfree;
+#endif /* !MEM_TLSF */
 
-/** concurrent access protection */
+#if !NO_SYS
+/** concurrent access protection (the sys_mutex functions are empty with NO_SYS) */
 static sys_mutex_t mem_mutex;
+#endif /* !NO_SYS */
+
+#if LWIP_RECLAIM
+/** bytes in use (like lwip_stats.mem.used), for the reclaim watermarks */
+static mem_size_t mem_used;
+#define MEM_USED_INC(x) do { mem_used += (x); MEM_STATS_INC_USED(used, x); } while(0)
+#define MEM_USED_DEC(x) do { mem_used -= (x); MEM_STATS_DEC_USED(used, x); } while(0)
+/** (called outside of the heap protection, this may queue a message to tcpip_thread) */
+#define MEM_RECLAIM_CHECK()  RECLAIM_CHECK(RECLAIM_HEAP, mem_avail())
+#define MEM_RECLAIM_SIGNAL() reclaim_signal(RECLAIM_HEAP)
+#else /* LWIP_RECLAIM */
+#define MEM_USED_INC(x) MEM_STATS_INC_USED(used, x)
+#define MEM_USED_DEC(x) MEM_STATS_DEC_USED(used, x)
+#define MEM_RECLAIM_CHECK()
+#define MEM_RECLAIM_SIGNAL()
+#endif /* LWIP_RECLAIM */
 
 #if LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT
 
+#if !MEM_TLSF
 static volatile u8_t mem_free_count;
+#endif /* !MEM_TLSF */
 
 /* Allow mem_free from other (e.g. interrupt) context */
 #define LWIP_MEM_FREE_DECL_PROTECT()  SYS_ARCH_DECL_PROTECT(lev_free)
@@ -217,6 +243,510 @@ static volatile u8_t mem_free_count;
 
 #endif /* LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT */
 
+#if MEM_TLSF
+/* Two-level segregated fit: every free block is on one of the free lists
+ * tlsf_heads[fl][sl]. The first level splits the block sizes in powers of
+ * two, the second level splits each power of two into TLSF_SL_COUNT lists.
+ * Two bitmaps tell which lists are non-empty, so finding a block that is big
+ * enough takes two 'find first set' operations instead of a walk over the
+ * heap. Blocks are the same struct mems as in the first-fit heap (below);
+ * a free block stores its list links in its data area. */
+
+/** log2 of the number of second-level lists per first-level list.
+ * Smaller values save RAM (list heads), larger values waste less memory
+ * per allocation (the lists are finer grained). */
+#ifndef MEM_TLSF_SL_LOG2
+#define MEM_TLSF_SL_LOG2     4
+#endif /* MEM_TLSF_SL_LOG2 */
+#define TLSF_SL_COUNT        (1 << MEM_TLSF_SL_LOG2)
+#define TLSF_ALIGN_LOG2      ((MEM_ALIGNMENT >= 8) ? 3 : (MEM_ALIGNMENT >= 4) ? 2 : (MEM_ALIGNMENT >= 2) ? 1 : 0)
+/* blocks smaller than TLSF_SMALL_BLOCK are all on first-level list 0,
+   with one second-level list per MEM_ALIGNMENT */
+#define TLSF_FL_SHIFT        (MEM_TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_BLOCK     (1UL << TLSF_FL_SHIFT)
+#define TLSF_FL_COUNT        (sizeof(mem_size_t) * 8 - TLSF_FL_SHIFT + 1)
+/** end of a free list (the index of ram_end) */
+#define TLSF_NIL             MEM_SIZE_ALIGNED
+
+/** free list links, kept in the data area of a free struct mem */
+struct mem_free_link {
+  mem_size_t next;
+  mem_size_t prev;
+};
+
+#define TLSF_MEM(ptr)        ((struct mem *)(void *)&ram[ptr])
+#define TLSF_PTR(mem)        ((mem_size_t)((u8_t *)(mem) - ram))
+#define TLSF_LINK(mem)       ((struct mem_free_link *)(void *)((u8_t *)(mem) + SIZEOF_STRUCT_MEM))
+/** size of the data area of a struct mem */
+#define TLSF_DATA_SIZE(mem)  ((mem_size_t)((mem)->next - TLSF_PTR(mem) - SIZEOF_STRUCT_MEM))
+
+/** bit fl set: tlsf_sl_bitmap[fl] != 0 */
+static u32_t tlsf_fl_bitmap;
+/** bit sl set: tlsf_heads[fl][sl] is not empty */
+static u32_t tlsf_sl_bitmap[TLSF_FL_COUNT];
+/** free list heads (indices into ram) */
+static mem_size_t tlsf_heads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+
+/** index of the most significant bit set in x (x must not be 0) */
+static u8_t
+tlsf_fls(u32_t x)
+{
+#ifdef __GNUC__
+  return (u8_t)(31 - __builtin_clz(x));
+#else /* __GNUC__ */
+  u8_t bit = 0;
+  if (x & 0xffff0000UL) {
+    bit += 16;
+    x >>= 16;
+  }
+  if (x & 0xff00UL) {
+    bit += 8;
+    x >>= 8;
+  }
+  if (x & 0xf0UL) {
+    bit += 4;
+    x >>= 4;
+  }
+  if (x & 0xcUL) {
+    bit += 2;
+    x >>= 2;
+  }
+  if (x & 0x2UL) {
+    bit += 1;
+  }
+  return bit;
+#endif /* __GNUC__ */
+}
+
+/** index of the least significant bit set in x (x must not be 0) */
+#define tlsf_ffs(x)          tlsf_fls((x) & (~(x) + 1))
+
+/** Get the free list for blocks with 'size' bytes of data */
+static void
+tlsf_mapping(u32_t size, u8_t *fl, u8_t *sl)
+{
+  if (size < TLSF_SMALL_BLOCK) {
+    *fl = 0;
+    *sl = (u8_t)(size >> TLSF_ALIGN_LOG2);
+  } else {
+    u8_t bit = tlsf_fls(size);
+    *sl = (u8_t)((size >> (bit - MEM_TLSF_SL_LOG2)) ^ TLSF_SL_COUNT);
+    *fl = (u8_t)(bit - TLSF_FL_SHIFT + 1);
+  }
+}
+
+/** Put a free block on the head of its free list */
+static void
+tlsf_insert(struct mem *mem)
+{
+  mem_size_t ptr = TLSF_PTR(mem);
+  u8_t fl, sl;
+
+  LWIP_ASSERT("tlsf_insert: mem->used == 0", mem->used == 0);
+  tlsf_mapping(TLSF_DATA_SIZE(mem), &fl, &sl);
+  TLSF_LINK(mem)->prev = TLSF_NIL;
+  TLSF_LINK(mem)->next = tlsf_heads[fl][sl];
+  if (tlsf_heads[fl][sl] != TLSF_NIL) {
+    TLSF_LINK(TLSF_MEM(tlsf_heads[fl][sl]))->prev = ptr;
+  }
+  tlsf_heads[fl][sl] = ptr;
+  tlsf_fl_bitmap |= 1UL << fl;
+  tlsf_sl_bitmap[fl] |= 1UL << sl;
+}
+
+/** Take a free block off its free list */
+static void
+tlsf_remove(struct mem *mem)
+{
+  struct mem_free_link *link = TLSF_LINK(mem);
+  u8_t fl, sl;
+
+  LWIP_ASSERT("tlsf_remove: mem->used == 0", mem->used == 0);
+  tlsf_mapping(TLSF_DATA_SIZE(mem), &fl, &sl);
+  if (link->next != TLSF_NIL) {
+    TLSF_LINK(TLSF_MEM(link->next))->prev = link->prev;
+  }
+  if (link->prev != TLSF_NIL) {
+    TLSF_LINK(TLSF_MEM(link->prev))->next = link->next;
+  } else {
+    LWIP_ASSERT("tlsf_remove: mem is list head", tlsf_heads[fl][sl] == TLSF_PTR(mem));
+    tlsf_heads[fl][sl] = link->next;
+    if (link->next == TLSF_NIL) {
+      tlsf_sl_bitmap[fl] &= ~(1UL << sl);
+      if (tlsf_sl_bitmap[fl] == 0) {
+        tlsf_fl_bitmap &= ~(1UL << fl);
+      }
+    }
+  }
+}
+
+/**
+ * Find a free block with at least 'size' bytes of data. Only lists of which
+ * every block is big enough are considered, so this is the head of the first
+ * non-empty list at or above the one 'size' rounded up to the next list
+ * boundary maps to.
+ *
+ * @return a free block that is big enough (still on its list) or NULL
+ */
+static struct mem *
+tlsf_search(mem_size_t size)
+{
+  u32_t rounded = size;
+  u32_t map;
+  u8_t fl, sl;
+
+  if (rounded >= TLSF_SMALL_BLOCK) {
+    rounded += (1UL << (tlsf_fls(rounded) - MEM_TLSF_SL_LOG2)) - 1;
+  }
+  tlsf_mapping(rounded, &fl, &sl);
+  if (fl >= TLSF_FL_COUNT) {
+    return NULL;
+  }
+  map = tlsf_sl_bitmap[fl] & (u32_t)(~0UL << sl);
+  if (map == 0) {
+    /* nothing left in this power of two, go to the next non-empty one */
+    map = tlsf_fl_bitmap & (u32_t)(~0UL << (fl + 1));
+    if (map == 0) {
+      return NULL;
+    }
+    fl = tlsf_ffs(map);
+    map = tlsf_sl_bitmap[fl];
+  }
+  sl = tlsf_ffs(map);
+  return TLSF_MEM(tlsf_heads[fl][sl]);
+}
+
+/**
+ * Combine a struct mem which just has been freed with its unused neighbours
+ * and put the result on its free list (this is plug_holes() for TLSF, there
+ * are never two unused struct mems next to each other).
+ *
+ * This assumes access to the heap is protected by the calling function
+ * already.
+ */
+static void
+tlsf_coalesce(struct mem *mem)
+{
+  struct mem *nmem;
+  struct mem *pmem;
+
+  LWIP_ASSERT("tlsf_coalesce: mem >= ram", (u8_t *)mem >= ram);
+  LWIP_ASSERT("tlsf_coalesce: mem < ram_end", (u8_t *)mem < (u8_t *)ram_end);
+  LWIP_ASSERT("tlsf_coalesce: mem->next <= MEM_SIZE_ALIGNED", mem->next <= MEM_SIZE_ALIGNED);
+
+  nmem = TLSF_MEM(mem->next);
+  if (nmem != ram_end && nmem->used == 0) {
+    tlsf_remove(nmem);
+    mem->next = nmem->next;
+    TLSF_MEM(nmem->next)->prev = TLSF_PTR(mem);
+  }
+  pmem = TLSF_MEM(mem->prev);
+  if (pmem != mem && pmem->used == 0) {
+    tlsf_remove(pmem);
+    pmem->next = mem->next;
+    TLSF_MEM(mem->next)->prev = TLSF_PTR(pmem);
+    mem = pmem;
+  }
+  tlsf_insert(mem);
+}
+
+/**
+ * Zero the heap and put it on the free lists as one block
+ */
+void
+mem_init(void)
+{
+  struct mem *mem;
+  u8_t fl, sl;
+
+  LWIP_ASSERT("Sanity check alignment",
+    (SIZEOF_STRUCT_MEM & (MEM_ALIGNMENT-1)) == 0);
+  LWIP_ASSERT("MIN_SIZE must hold the free list links",
+    MIN_SIZE_ALIGNED >= sizeof(struct mem_free_link));
+
+  /* align the heap */
+  ram = (u8_t *)LWIP_MEM_ALIGN(LWIP_RAM_HEAP_POINTER);
+  /* initialize the start of the heap */
+  mem = (struct mem *)(void *)ram;
+  mem->next = MEM_SIZE_ALIGNED;
+  mem->prev = 0;
+  mem->used = 0;
+  /* initialize the end of the heap */
+  ram_end = (struct mem *)(void *)&ram[MEM_SIZE_ALIGNED];
+  ram_end->used = 1;
+  ram_end->next = MEM_SIZE_ALIGNED;
+  ram_end->prev = MEM_SIZE_ALIGNED;
+
+  /* all lists are empty but the one for the whole heap */
+  tlsf_fl_bitmap = 0;
+  for (fl = 0; fl < TLSF_FL_COUNT; fl++) {
+    tlsf_sl_bitmap[fl] = 0;
+    for (sl = 0; sl < TLSF_SL_COUNT; sl++) {
+      tlsf_heads[fl][sl] = TLSF_NIL;
+    }
+  }
+  tlsf_insert(mem);
+
+  MEM_STATS_AVAIL(avail, MEM_SIZE_ALIGNED);
+
+  if(sys_mutex_new(&mem_mutex) != ERR_OK) {
+    LWIP_ASSERT("failed to create mem_mutex", 0);
+  }
+}
+
+/**
+ * Put a struct mem back on the heap
+ *
+ * @param rmem is the data portion of a struct mem as returned by a previous
+ *             call to mem_malloc()
+ */
+void
+mem_free(void *rmem)
+{
+  struct mem *mem;
+  LWIP_MEM_FREE_DECL_PROTECT();
+
+  if (rmem == NULL) {
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_LEVEL_SERIOUS, ("mem_free(p == NULL) was called.\n"));
+    return;
+  }
+  LWIP_ASSERT("mem_free: sanity check alignment", (((mem_ptr_t)rmem) & (MEM_ALIGNMENT-1)) == 0);
+
+  LWIP_ASSERT("mem_free: legal memory", (u8_t *)rmem >= (u8_t *)ram &&
+    (u8_t *)rmem < (u8_t *)ram_end);
+
+  if ((u8_t *)rmem < (u8_t *)ram || (u8_t *)rmem >= (u8_t *)ram_end) {
+    SYS_ARCH_DECL_PROTECT(lev);
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("mem_free: illegal memory\n"));
+    /* protect mem stats from concurrent access */
+    SYS_ARCH_PROTECT(lev);
+    MEM_STATS_INC(illegal);
+    SYS_ARCH_UNPROTECT(lev);
+    return;
+  }
+  /* protect the heap from concurrent access */
+  LWIP_MEM_FREE_PROTECT();
+  /* Get the corresponding struct mem ... */
+  mem = (struct mem *)(void *)((u8_t *)rmem - SIZEOF_STRUCT_MEM);
+  /* ... which has to be in a used state ... */
+  LWIP_ASSERT("mem_free: mem->used", mem->used);
+  /* ... and is now unused. */
+  mem->used = 0;
+
+  MEM_USED_DEC(mem->next - TLSF_PTR(mem));
+
+  /* merge with free neighbours and put it on its free list */
+  tlsf_coalesce(mem);
+  LWIP_MEM_FREE_UNPROTECT();
+}
+
+/**
+ * Shrink memory returned by mem_malloc().
+ *
+ * @param rmem pointer to memory allocated by mem_malloc the is to be shrinked
+ * @param newsize required size after shrinking (needs to be smaller than or
+ *                equal to the previous size)
+ * @return for compatibility reasons: is always == rmem, at the moment
+ *         or NULL if newsize is > old size, in which case rmem is NOT touched
+ *         or freed!
+ */
+void *
+mem_trim(void *rmem, mem_size_t newsize)
+{
+  mem_size_t size;
+  mem_size_t ptr, ptr2;
+  struct mem *mem, *mem2;
+  /* use the FREE_PROTECT here: it protects with sem OR SYS_ARCH_PROTECT */
+  LWIP_MEM_FREE_DECL_PROTECT();
+
+  /* Expand the size of the allocated memory region so that we can
+     adjust for alignment. */
+  newsize = LWIP_MEM_ALIGN_SIZE(newsize);
+
+  if(newsize < MIN_SIZE_ALIGNED) {
+    /* every data block must be at least MIN_SIZE_ALIGNED long */
+    newsize = MIN_SIZE_ALIGNED;
+  }
+
+  if (newsize > MEM_SIZE_ALIGNED) {
+    return NULL;
+  }
+
+  LWIP_ASSERT("mem_trim: legal memory", (u8_t *)rmem >= (u8_t *)ram &&
+   (u8_t *)rmem < (u8_t *)ram_end);
+
+  if ((u8_t *)rmem < (u8_t *)ram || (u8_t *)rmem >= (u8_t *)ram_end) {
+    SYS_ARCH_DECL_PROTECT(lev);
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("mem_trim: illegal memory\n"));
+    /* protect mem stats from concurrent access */
+    SYS_ARCH_PROTECT(lev);
+    MEM_STATS_INC(illegal);
+    SYS_ARCH_UNPROTECT(lev);
+    return rmem;
+  }
+  /* Get the corresponding struct mem ... */
+  mem = (struct mem *)(void *)((u8_t *)rmem - SIZEOF_STRUCT_MEM);
+  /* ... and its offset pointer */
+  ptr = TLSF_PTR(mem);
+
+  size = mem->next - ptr - SIZEOF_STRUCT_MEM;
+  LWIP_ASSERT("mem_trim can only shrink memory", newsize <= size);
+  if (newsize > size) {
+    /* not supported */
+    return NULL;
+  }
+  if (newsize == size) {
+    /* No change in size, simply return */
+    return rmem;
+  }
+
+  /* protect the heap from concurrent access */
+  LWIP_MEM_FREE_PROTECT();
+
+  mem2 = TLSF_MEM(mem->next);
+  if (mem2->used == 0) {
+    /* The next struct is unused: take it off its list, move it down to
+       directly after the shrinked mem and put it on its new list */
+    mem_size_t next;
+    tlsf_remove(mem2);
+    next = mem2->next;
+    ptr2 = ptr + SIZEOF_STRUCT_MEM + newsize;
+    mem2 = TLSF_MEM(ptr2);
+    mem2->used = 0;
+    mem2->next = next;
+    mem2->prev = ptr;
+    mem->next = ptr2;
+    if (mem2->next != MEM_SIZE_ALIGNED) {
+      TLSF_MEM(mem2->next)->prev = ptr2;
+    }
+    tlsf_insert(mem2);
+    MEM_USED_DEC((size - newsize));
+  } else if (newsize + SIZEOF_STRUCT_MEM + MIN_SIZE_ALIGNED <= size) {
+    /* Next struct is used but there's room for another struct mem with
+     * at least MIN_SIZE_ALIGNED of data: split off a free block */
+    ptr2 = ptr + SIZEOF_STRUCT_MEM + newsize;
+    mem2 = TLSF_MEM(ptr2);
+    mem2->used = 0;
+    mem2->next = mem->next;
+    mem2->prev = ptr;
+    mem->next = ptr2;
+    if (mem2->next != MEM_SIZE_ALIGNED) {
+      TLSF_MEM(mem2->next)->prev = ptr2;
+    }
+    tlsf_insert(mem2);
+    MEM_USED_DEC((size - newsize));
+  }
+  /* else: the remaining space stays unused since it is too small */
+  LWIP_MEM_FREE_UNPROTECT();
+  return rmem;
+}
+
+/**
+ * Allocate a block of memory with a minimum of 'size' bytes from the free
+ * lists (constant time).
+ *
+ * @param size is the minimum size of the requested block in bytes.
+ * @return pointer to allocated memory or NULL if no free memory was found.
+ *
+ * Note that the returned value will always be aligned (as defined by MEM_ALIGNMENT).
+ */
+void *
+mem_malloc(mem_size_t size)
+{
+  mem_size_t ptr, ptr2;
+  struct mem *mem, *mem2;
+  LWIP_MEM_ALLOC_DECL_PROTECT();
+
+  if (size == 0) {
+    return NULL;
+  }
+
+  /* Expand the size of the allocated memory region so that we can
+     adjust for alignment. */
+  size = LWIP_MEM_ALIGN_SIZE(size);
+
+  if(size < MIN_SIZE_ALIGNED) {
+    /* every data block must be at least MIN_SIZE_ALIGNED long */
+    size = MIN_SIZE_ALIGNED;
+  }
+
+  if (size > MEM_SIZE_ALIGNED) {
+    return NULL;
+  }
+
+  /* protect the heap from concurrent access (no need to let mem_free run
+     in between as in the first-fit heap, this does not take long) */
+  sys_mutex_lock(&mem_mutex);
+  LWIP_MEM_ALLOC_PROTECT();
+
+  mem = tlsf_search(size);
+  if (mem == NULL) {
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("mem_malloc: could not allocate %"S16_F" bytes\n", (s16_t)size));
+    MEM_STATS_INC(err);
+    LWIP_MEM_ALLOC_UNPROTECT();
+    sys_mutex_unlock(&mem_mutex);
+    MEM_RECLAIM_SIGNAL();
+    return NULL;
+  }
+  tlsf_remove(mem);
+  ptr = TLSF_PTR(mem);
+
+  if (mem->next - (ptr + SIZEOF_STRUCT_MEM) >= (size + SIZEOF_STRUCT_MEM + MIN_SIZE_ALIGNED)) {
+    /* split large block, put the remainder back on the free lists
+       (mem->next is used, free neighbours are always combined) */
+    ptr2 = ptr + SIZEOF_STRUCT_MEM + size;
+    mem2 = TLSF_MEM(ptr2);
+    mem2->used = 0;
+    mem2->next = mem->next;
+    mem2->prev = ptr;
+    mem->next = ptr2;
+    if (mem2->next != MEM_SIZE_ALIGNED) {
+      TLSF_MEM(mem2->next)->prev = ptr2;
+    }
+    tlsf_insert(mem2);
+    MEM_USED_INC((size + SIZEOF_STRUCT_MEM));
+  } else {
+    /* near fit or exact fit: do not split */
+    MEM_USED_INC(mem->next - ptr);
+  }
+  mem->used = 1;
+
+  LWIP_MEM_ALLOC_UNPROTECT();
+  sys_mutex_unlock(&mem_mutex);
+  LWIP_ASSERT("mem_malloc: allocated memory not above ram_end.",
+   (mem_ptr_t)mem + SIZEOF_STRUCT_MEM + size <= (mem_ptr_t)ram_end);
+  LWIP_ASSERT("mem_malloc: allocated memory properly aligned.",
+   ((mem_ptr_t)mem + SIZEOF_STRUCT_MEM) % MEM_ALIGNMENT == 0);
+  MEM_RECLAIM_CHECK();
+
+  return (u8_t *)mem + SIZEOF_STRUCT_MEM;
+}
+
+#if MEM_STATS
+/** Size of the largest free block (including its struct mem) */
+static mem_size_t
+mem_largest_free(void)
+{
+  mem_size_t ptr, largest = 0;
+  u8_t fl, sl;
+
+  if (tlsf_fl_bitmap == 0) {
+    return 0;
+  }
+  /* it is on the highest non-empty list */
+  fl = tlsf_fls(tlsf_fl_bitmap);
+  sl = tlsf_fls(tlsf_sl_bitmap[fl]);
+  for (ptr = tlsf_heads[fl][sl]; ptr != TLSF_NIL; ptr = TLSF_LINK(TLSF_MEM(ptr))->next) {
+    if (TLSF_MEM(ptr)->next - ptr > largest) {
+      largest = TLSF_MEM(ptr)->next - ptr;
+    }
+  }
+  return largest;
+}
+#endif /* MEM_STATS */
+
+#else /* MEM_TLSF */
+
 
 /**
  * "Plug holes" by combining adjacent empty struct mems.
@@ -342,7 +872,7 @@ mem_free(void *rmem)
     lfree = mem;
   }
 
-  MEM_STATS_DEC_USED(used, mem->next - (mem_size_t)(((u8_t *)mem - ram)));
+  MEM_USED_DEC(mem->next - (mem_size_t)(((u8_t *)mem - ram)));
 
   /* finally, see if prev or next are free also */
   plug_holes(mem);
@@ -440,7 +970,7 @@ mem_trim(void *rmem, mem_size_t newsize)
     if (mem2->next != MEM_SIZE_ALIGNED) {
       ((struct mem *)(void *)&ram[mem2->next])->prev = ptr2;
     }
-    MEM_STATS_DEC_USED(used, (size - newsize));
+    MEM_USED_DEC((size - newsize));
     /* no need to plug holes, we've already done that */
   } else if (newsize + SIZEOF_STRUCT_MEM + MIN_SIZE_ALIGNED <= size) {
     /* Next struct is used but there's room for another struct mem with
@@ -462,7 +992,7 @@ mem_trim(void *rmem, mem_size_t newsize)
     if (mem2->next != MEM_SIZE_ALIGNED) {
       ((struct mem *)(void *)&ram[mem2->next])->prev = ptr2;
     }
-    MEM_STATS_DEC_USED(used, (size - newsize));
+    MEM_USED_DEC((size - newsize));
     /* the original mem->next is used, so no need to plug holes! */
   }
   /* else {
@@ -569,7 +1099,7 @@ mem_malloc(mem_size_t size)
           if (mem2->next != MEM_SIZE_ALIGNED) {
             ((struct mem *)(void *)&ram[mem2->next])->prev = ptr2;
           }
-          MEM_STATS_INC_USED(used, (size + SIZEOF_STRUCT_MEM));
+          MEM_USED_INC((size + SIZEOF_STRUCT_MEM));
         } else {
           /* (a mem2 struct does no fit into the user data space of mem and mem->next will always
            * be used at this point: if not we have 2 unused structs in a row, plug_holes should have
@@ -579,7 +1109,7 @@ mem_malloc(mem_size_t size)
            * will always be used at this point!
            */
           mem->used = 1;
-          MEM_STATS_INC_USED(used, mem->next - (mem_size_t)((u8_t *)mem - ram));
+          MEM_USED_INC(mem->next - (mem_size_t)((u8_t *)mem - ram));
         }
 
         if (mem == lfree) {
@@ -600,6 +1130,7 @@ mem_malloc(mem_size_t size)
          ((mem_ptr_t)mem + SIZEOF_STRUCT_MEM) % MEM_ALIGNMENT == 0);
         LWIP_ASSERT("mem_malloc: sanity check alignment",
           (((mem_ptr_t)mem) & (MEM_ALIGNMENT-1)) == 0);
+        MEM_RECLAIM_CHECK();
 
         return (u8_t *)mem + SIZEOF_STRUCT_MEM;
       }
@@ -612,9 +1143,68 @@ mem_malloc(mem_size_t size)
   MEM_STATS_INC(err);
   LWIP_MEM_ALLOC_UNPROTECT();
   sys_mutex_unlock(&mem_mutex);
+  MEM_RECLAIM_SIGNAL();
   return NULL;
 }
 
+#if MEM_STATS
+/** Size of the largest free block (including its struct mem) */
+static mem_size_t
+mem_largest_free(void)
+{
+  mem_size_t ptr, largest = 0;
+  struct mem *mem;
+
+  for (ptr = (mem_size_t)((u8_t *)lfree - ram); ptr < MEM_SIZE_ALIGNED; ptr = mem->next) {
+    mem = (struct mem *)(void *)&ram[ptr];
+    if (!mem->used && (mem->next - ptr > largest)) {
+      largest = mem->next - ptr;
+    }
+  }
+  return largest;
+}
+#endif /* MEM_STATS */
+
+#endif /* MEM_TLSF */
+
+#if LWIP_RECLAIM
+/**
+ * Get the number of free bytes on the heap (including the struct mems of
+ * free blocks).
+ */
+mem_size_t
+mem_avail(void)
+{
+  return MEM_SIZE_ALIGNED - mem_used;
+}
+#endif /* LWIP_RECLAIM */
+
+#if MEM_STATS
+/**
+ * Update the fragmentation figures of the heap statistics: lwip_stats.mem.largest
+ * is the largest free block (including its struct mem), lwip_stats.mem.frag
+ * the percentage of free memory outside of it (0: all free memory is one
+ * block). This is left to stats_display() or the application since the
+ * first-fit heap has to be walked for it.
+ */
+void
+mem_frag_update(void)
+{
+  mem_size_t largest, avail;
+  LWIP_MEM_ALLOC_DECL_PROTECT();
+
+  sys_mutex_lock(&mem_mutex);
+  LWIP_MEM_ALLOC_PROTECT();
+  largest = mem_largest_free();
+  avail = lwip_stats.mem.avail - lwip_stats.mem.used;
+  LWIP_MEM_ALLOC_UNPROTECT();
+  sys_mutex_unlock(&mem_mutex);
+
+  lwip_stats.mem.largest = largest;
+  lwip_stats.mem.frag = (avail > largest) ? (u8_t)(100 - ((u32_t)largest * 100) / avail) : 0;
+}
+#endif /* MEM_STATS */
+
 #endif /* MEM_USE_POOLS */
 /**
  * Contiguously allocates enough space for count objects that are size bytes
@@ -58,17 +58,27 @@
 #include "lwip/snmp_msg.h"
 #include "lwip/dns.h"
 #include "netif/ppp_oe.h"
+#include "lwip/reclaim.h"
 
 #include <string.h>
 
 #if !MEMP_MEM_MALLOC /* don't build if not configured for use in lwipopts.h */
 
 struct memp {
+#if MEMP_LOCKFREE
+  /** offset of the next free element, see memp_lf_head */
+  u16_t next;
+#else /* MEMP_LOCKFREE */
   struct memp *next;
+#endif /* MEMP_LOCKFREE */
 #if MEMP_OVERFLOW_CHECK
   const char *file;
   int line;
 #endif /* MEMP_OVERFLOW_CHECK */
+#if MEMP_STATS && MEMP_STATS_HIST_BUCKETS
+  /** sys_now() when the element was allocated */
+  u32_t time;
+#endif /* MEMP_STATS && MEMP_STATS_HIST_BUCKETS */
 };
 
 #if MEMP_OVERFLOW_CHECK
@@ -101,6 +111,13 @@ struct memp {
 #define MEMP_SIZE          (LWIP_MEM_ALIGN_SIZE(sizeof(struct memp)) + MEMP_SANITY_REGION_BEFORE_ALIGNED)
 #define MEMP_ALIGN_SIZE(x) (LWIP_MEM_ALIGN_SIZE(x) + MEMP_SANITY_REGION_AFTER_ALIGNED)
 
+#elif MEMP_STATS && MEMP_STATS_HIST_BUCKETS
+
+/* No sanity checks, but the struct memp is preserved while allocated for
+ * the allocation time. */
+#define MEMP_SIZE          LWIP_MEM_ALIGN_SIZE(sizeof(struct memp))
+#define MEMP_ALIGN_SIZE(x) (LWIP_MEM_ALIGN_SIZE(x))
+
 #else /* MEMP_OVERFLOW_CHECK */
 
 /* No sanity checks
@@ -112,10 +129,44 @@ struct memp {
 
 #endif /* MEMP_OVERFLOW_CHECK */
 
+#if MEMP_LOCKFREE
+#ifndef SYS_ARCH_CAS32
+#error "MEMP_LOCKFREE needs SYS_ARCH_CAS32() from the port (cc.h)"
+#endif
+#if MEMP_OVERFLOW_CHECK || MEMP_SANITY_CHECK
+#error "MEMP_LOCKFREE does not work with MEMP_OVERFLOW_CHECK or MEMP_SANITY_CHECK"
+#endif
+
+/** This array holds the head of the free list of each pool: the offset of
+ *  the first free element from memp_lf_base (in units of MEM_ALIGNMENT) in
+ *  the low 16 bits and a tag that changes with every push and pop in the
+ *  high 16 bits, so that a pop that raced with others fails its CAS (ABA). */
+static volatile u32_t memp_lf_head[MEMP_MAX];
+/** This array holds the start of each pool. */
+static u8_t *memp_lf_base[MEMP_MAX];
+
+#define MEMP_LF_NIL              0xffff
+#define MEMP_LF_HEAD(tag, off)   ((((u32_t)(tag) & 0xffff) << 16) | (off))
+#define MEMP_LF_PTR(type, off)   ((struct memp *)(void *)(memp_lf_base[type] + (mem_ptr_t)(off) * MEM_ALIGNMENT))
+#define MEMP_LF_OFF(type, memp)  ((u16_t)(((u8_t *)(memp) - memp_lf_base[type]) / MEM_ALIGNMENT))
+
+/* the free lists need no protection, the statistics are updated without */
+#define MEMP_DECL_PROTECT(lev)
+#define MEMP_PROTECT(lev)
+#define MEMP_UNPROTECT(lev)
+
+#else /* MEMP_LOCKFREE */
+
 /** This array holds the first free element of each pool.
  *  Elements form a linked list. */
 static struct memp *memp_tab[MEMP_MAX];
 
+#define MEMP_DECL_PROTECT(lev)   SYS_ARCH_DECL_PROTECT(lev)
+#define MEMP_PROTECT(lev)        SYS_ARCH_PROTECT(lev)
+#define MEMP_UNPROTECT(lev)      SYS_ARCH_UNPROTECT(lev)
+
+#endif /* MEMP_LOCKFREE */
+
 #else /* MEMP_MEM_MALLOC */
 
 #define MEMP_ALIGN_SIZE(x) (LWIP_MEM_ALIGN_SIZE(x))
@@ -174,6 +225,66 @@ static u8_t memp_memory[MEM_ALIGNMENT - 1
 
 #endif /* MEMP_SEPARATE_POOLS */
 
+#if LWIP_RECLAIM
+/** free elements per pool, for the reclaim watermarks */
+#if MEMP_LOCKFREE
+static volatile u32_t memp_navail[MEMP_MAX];
+
+/** Add to a counter without protection, returns the new value */
+static u16_t
+memp_lf_add(volatile u32_t *counter, s8_t n)
+{
+  u32_t old;
+  do {
+    old = *counter;
+  } while (!SYS_ARCH_CAS32(counter, old, old + n));
+  return (u16_t)(old + n);
+}
+#define MEMP_NAVAIL_ADD(type, n) memp_lf_add(&memp_navail[type], n)
+#else /* MEMP_LOCKFREE */
+static u16_t memp_navail[MEMP_MAX];
+#define MEMP_NAVAIL_ADD(type, n) (memp_navail[type] += (n))
+#endif /* MEMP_LOCKFREE */
+#endif /* LWIP_RECLAIM */
+
+#if MEMP_LOCKFREE
+/**
+ * Take the first element off the free list of a pool.
+ */
+static struct memp *
+memp_lf_pop(memp_t type)
+{
+  struct memp *memp;
+  u32_t head;
+
+  do {
+    head = memp_lf_head[type];
+    if ((head & 0xffff) == MEMP_LF_NIL) {
+      return NULL;
+    }
+    memp = MEMP_LF_PTR(type, head & 0xffff);
+    /* if another context took memp meanwhile, memp->next is garbage but
+       the tag has changed and the CAS fails */
+  } while (!SYS_ARCH_CAS32(&memp_lf_head[type], head, MEMP_LF_HEAD((head >> 16) + 1, memp->next)));
+  return memp;
+}
+
+/**
+ * Put an element at the front of the free list of a pool.
+ */
+static void
+memp_lf_push(memp_t type, struct memp *memp)
+{
+  u16_t off = MEMP_LF_OFF(type, memp);
+  u32_t head;
+
+  do {
+    head = memp_lf_head[type];
+    memp->next = (u16_t)(head & 0xffff);
+  } while (!SYS_ARCH_CAS32(&memp_lf_head[type], head, MEMP_LF_HEAD((head >> 16) + 1, off)));
+}
+#endif /* MEMP_LOCKFREE */
+
 #if MEMP_SANITY_CHECK
 /**
  * Check that memp-lists don't form a circle, modify by ives at 2014.4.23.
@@ -339,6 +450,9 @@ memp_init(void)
 {
   struct memp *memp;
   u16_t i, j;
+#if MEMP_LOCKFREE
+  u16_t off;
+#endif /* MEMP_LOCKFREE */
 
   for (i = 0; i < MEMP_MAX; ++i) {
     MEMP_STATS_AVAIL(used, i, 0);
@@ -352,20 +466,39 @@ memp_init(void)
 #endif /* !MEMP_SEPARATE_POOLS */
   /* for every pool: */
   for (i = 0; i < MEMP_MAX; ++i) {
+#if !MEMP_LOCKFREE
     memp_tab[i] = NULL;
+#endif /* !MEMP_LOCKFREE */
+#if LWIP_RECLAIM
+    memp_navail[i] = memp_num[i];
+#endif /* LWIP_RECLAIM */
 #if MEMP_SEPARATE_POOLS
     memp = (struct memp*)memp_bases[i];
 #endif /* MEMP_SEPARATE_POOLS */
+#if MEMP_LOCKFREE
+    LWIP_ASSERT("memp_init: pool too big for MEMP_LOCKFREE",
+      (u32_t)memp_num[i] * (MEMP_SIZE + memp_sizes[i]) / MEM_ALIGNMENT < MEMP_LF_NIL);
+    memp_lf_base[i] = (u8_t *)memp;
+    off = MEMP_LF_NIL;
+#endif /* MEMP_LOCKFREE */
     /* create a linked list of memp elements */
     for (j = 0; j < memp_num[i]; ++j) {
+#if MEMP_LOCKFREE
+      memp->next = off;
+      off = MEMP_LF_OFF(i, memp);
+#else /* MEMP_LOCKFREE */
       memp->next = memp_tab[i];
       memp_tab[i] = memp;
+#endif /* MEMP_LOCKFREE */
       memp = (struct memp *)(void *)((u8_t *)memp + MEMP_SIZE + memp_sizes[i]
 #if MEMP_OVERFLOW_CHECK
         + MEMP_SANITY_REGION_AFTER_ALIGNED
 #endif
       );
     }
+#if MEMP_LOCKFREE
+    memp_lf_head[i] = MEMP_LF_HEAD(0, off);
+#endif /* MEMP_LOCKFREE */
   }
 #if MEMP_OVERFLOW_CHECK
   memp_overflow_init();
@@ -374,6 +507,49 @@ memp_init(void)
 #endif /* MEMP_OVERFLOW_CHECK */
 }
 
+#if MEMP_STATS && MEMP_STATS_CALLERS
+/**
+ * Count an allocation failure of a call site (called with the pools
+ * protected).
+ */
+static void
+memp_stats_caller_err(memp_t type, const char *file, int line)
+{
+  struct stats_memp_caller *c = lwip_stats.memp_caller[type];
+  u16_t i;
+
+  for (i = 0; i < MEMP_STATS_CALLERS; i++, c++) {
+    if (c->file == NULL) {
+      c->file = file;
+      c->line = (u16_t)line;
+    }
+    if ((c->line == (u16_t)line) && (strcmp(c->file, file) == 0)) {
+      c->err++;
+      return;
+    }
+  }
+}
+#endif /* MEMP_STATS && MEMP_STATS_CALLERS */
+
+#if MEMP_STATS && MEMP_STATS_HIST_BUCKETS
+/**
+ * Account the time an element was allocated (called with the pools
+ * protected).
+ */
+static void
+memp_stats_hist(memp_t type, struct memp *memp)
+{
+  u32_t t;
+  u8_t bucket;
+
+  for (bucket = 0, t = (sys_now() - memp->time) >> 1;
+       (t != 0) && (bucket < MEMP_STATS_HIST_BUCKETS - 1); t >>= 1) {
+    bucket++;
+  }
+  lwip_stats.memp_hist[type][bucket]++;
+}
+#endif /* MEMP_STATS && MEMP_STATS_HIST_BUCKETS */
+
 /**
  * Get an element from a specific pool.
  *
@@ -386,41 +562,68 @@ memp_init(void)
  * @return a pointer to the allocated memory or a NULL pointer on error
  */
 void *
-#if !MEMP_OVERFLOW_CHECK
+#if !MEMP_OVERFLOW_CHECK && !(MEMP_STATS && MEMP_STATS_CALLERS)
 memp_malloc(memp_t type)
 #else
 memp_malloc_fn(memp_t type, const char* file, const int line)
 #endif
 {
   struct memp *memp;
-  SYS_ARCH_DECL_PROTECT(old_level);
+#if LWIP_RECLAIM
+  u16_t avail;
+#endif /* LWIP_RECLAIM */
+  MEMP_DECL_PROTECT(old_level);
  
   LWIP_ERROR("memp_malloc: type < MEMP_MAX", (type < MEMP_MAX), return NULL;);
 
-  SYS_ARCH_PROTECT(old_level);
+  MEMP_PROTECT(old_level);
 #if MEMP_OVERFLOW_CHECK >= 2
   memp_overflow_check_all();
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
+#if MEMP_LOCKFREE
+  memp = memp_lf_pop(type);
+#else /* MEMP_LOCKFREE */
   memp = memp_tab[type];
+#endif /* MEMP_LOCKFREE */
   
   if (memp != NULL) {
+#if !MEMP_LOCKFREE
     memp_tab[type] = memp->next;
+#endif /* !MEMP_LOCKFREE */
 #if MEMP_OVERFLOW_CHECK
     memp->next = NULL;
     memp->file = file;
     memp->line = line;
 #endif /* MEMP_OVERFLOW_CHECK */
+#if MEMP_STATS && MEMP_STATS_HIST_BUCKETS
+    memp->time = sys_now();
+#endif /* MEMP_STATS && MEMP_STATS_HIST_BUCKETS */
     MEMP_STATS_INC_USED(used, type);
+#if LWIP_RECLAIM
+    avail = MEMP_NAVAIL_ADD(type, -1);
+#endif /* LWIP_RECLAIM */
     LWIP_ASSERT("memp_malloc: memp properly aligned",
                 ((mem_ptr_t)memp % MEM_ALIGNMENT) == 0);
     memp = (struct memp*)(void *)((u8_t*)memp + MEMP_SIZE);
   } else {
     LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("memp_malloc: out of memory in pool %s\n", memp_desc[type]));
     MEMP_STATS_INC(err, type);
+#if MEMP_STATS && MEMP_STATS_CALLERS
+    memp_stats_caller_err(type, file, line);
+#endif /* MEMP_STATS && MEMP_STATS_CALLERS */
   }
 
-  SYS_ARCH_UNPROTECT(old_level);
+  MEMP_UNPROTECT(old_level);
+
+#if LWIP_RECLAIM
+  /* (outside of the protection: this may queue a message to tcpip_thread) */
+  if (memp == NULL) {
+    reclaim_signal((reclaim_src_t)type);
+  } else {
+    RECLAIM_CHECK((reclaim_src_t)type, avail);
+  }
+#endif /* LWIP_RECLAIM */
 
   return memp;
 }
@@ -435,7 +638,7 @@ void
 memp_free(memp_t type, void *mem)
 {
   struct memp *memp;
-  SYS_ARCH_DECL_PROTECT(old_level);
+  MEMP_DECL_PROTECT(old_level);
 
   if (mem == NULL) {
     return;
@@ -445,7 +648,7 @@ memp_free(memp_t type, void *mem)
 
   memp = (struct memp *)(void *)((u8_t*)mem - MEMP_SIZE);
 
-  SYS_ARCH_PROTECT(old_level);
+  MEMP_PROTECT(old_level);
 #if MEMP_OVERFLOW_CHECK
 #if MEMP_OVERFLOW_CHECK >= 2
   memp_overflow_check_all();
@@ -456,16 +659,41 @@ memp_free(memp_t type, void *mem)
 #endif /* MEMP_OVERFLOW_CHECK */
 
   MEMP_STATS_DEC(used, type); 
+#if MEMP_STATS && MEMP_STATS_HIST_BUCKETS
+  memp_stats_hist(type, memp);
+#endif /* MEMP_STATS && MEMP_STATS_HIST_BUCKETS */
+#if LWIP_RECLAIM
+  MEMP_NAVAIL_ADD(type, 1);
+#endif /* LWIP_RECLAIM */
   
+#if MEMP_LOCKFREE
+  memp_lf_push(type, memp);
+#else /* MEMP_LOCKFREE */
   memp->next = memp_tab[type]; 
   memp_tab[type] = memp;
+#endif /* MEMP_LOCKFREE */
 
 #if MEMP_SANITY_CHECK
   LWIP_ASSERT("memp sanity", memp_sanity());
 #endif /* MEMP_SANITY_CHECK */
 
-  SYS_ARCH_UNPROTECT(old_level);
+  MEMP_UNPROTECT(old_level);
+}
+
+#if LWIP_RECLAIM
+/**
+ * Get the number of free elements of a pool.
+ *
+ * @param type the pool
+ * @return free elements
+ */
+u16_t
+memp_avail(memp_t type)
+{
+  LWIP_ASSERT("memp_avail: type < MEMP_MAX", type < MEMP_MAX);
+  return (u16_t)memp_navail[type];
 }
+#endif /* LWIP_RECLAIM */
 
 #endif /* MEMP_MEM_MALLOC */
 #if 0
@@ -69,7 +69,7 @@
 #include "lwip/memp.h"
 #include "lwip/pbuf.h"
 #include "lwip/sys.h"
-#include "arch/perf.h"
+#include "lwip/perf.h"
 #if TCP_QUEUE_OOSEQ
 #include "lwip/tcp_impl.h"
 #endif
@@ -133,9 +133,10 @@ pbuf_free_ooseq_new(void* arg)
 }
 #endif
 
-#if !LWIP_TCP || !TCP_QUEUE_OOSEQ || NO_SYS
+#if !LWIP_TCP || !TCP_QUEUE_OOSEQ || NO_SYS || LWIP_RECLAIM
+/* with LWIP_RECLAIM, memp_malloc() signals the empty pool itself */
 #define PBUF_POOL_IS_EMPTY()
-#else /* !LWIP_TCP || !TCP_QUEUE_OOSEQ || NO_SYS */
+#else /* !LWIP_TCP || !TCP_QUEUE_OOSEQ || NO_SYS || LWIP_RECLAIM */
 /** Define this to 0 to prevent freeing ooseq pbufs when the PBUF_POOL is empty */
 #ifndef PBUF_POOL_FREE_OOSEQ
 #define PBUF_POOL_FREE_OOSEQ 1
@@ -197,7 +198,231 @@ pbuf_pool_is_empty(void)
   }
 }
 #endif /* PBUF_POOL_FREE_OOSEQ */
-#endif /* !LWIP_TCP || !TCP_QUEUE_OOSEQ || NO_SYS */
+#endif /* !LWIP_TCP || !TCP_QUEUE_OOSEQ || NO_SYS || LWIP_RECLAIM */
+
+#if PBUF_RAM_SLAB
+/* PBUF_RAM slabs: pages from MEMP_PBUF_RAM_SLAB carved into objects of one
+ * size class each. Requested sizes are counted in power-of-two buckets, the
+ * PBUF_RAM_SLAB_CLASSES classes follow the most requested buckets and are as
+ * big as the largest request seen in their bucket. A class only moves to
+ * another bucket or grows while it has no pages. */
+
+/** number of power-of-two buckets (sizes up to 64k) */
+#define PBUF_SLAB_BUCKETS         17
+/** every object starts with a pointer to its page */
+#define PBUF_SLAB_OBJ_HDR         LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf_slab_page *))
+#define PBUF_SLAB_PAGE_HDR        LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf_slab_page))
+/** the biggest object (including PBUF_SLAB_OBJ_HDR) fitting in a page */
+#define PBUF_SLAB_MAX_OBJ         (PBUF_RAM_SLAB_PAGE_SIZE - PBUF_SLAB_PAGE_HDR)
+
+struct pbuf_slab_page {
+  /** pages of a class with free objects are on a doubly linked list */
+  struct pbuf_slab_page *next;
+  struct pbuf_slab_page *prev;
+  /** freed objects, linked through their first word */
+  void *free;
+  /** objects carved from the page so far */
+  u16_t carved;
+  /** objects in use */
+  u16_t used;
+  /** index of the class in pbuf_slab_classes */
+  u8_t cls;
+};
+
+struct pbuf_slab_class {
+  /** pages with free objects */
+  struct pbuf_slab_page *pages;
+  /** object size (including PBUF_SLAB_OBJ_HDR), 0 if not bound to a bucket */
+  u16_t size;
+  /** objects per page */
+  u16_t per_page;
+  /** pages owned by the class */
+  u8_t npages;
+  /** bucket served */
+  u8_t bucket;
+};
+
+static struct pbuf_slab_class pbuf_slab_classes[PBUF_RAM_SLAB_CLASSES];
+/** class serving a bucket (index + 1, 0: none) */
+static u8_t pbuf_slab_bucket_class[PBUF_SLAB_BUCKETS];
+/** requests per bucket (halved when one of them overflows) */
+static u16_t pbuf_slab_hits[PBUF_SLAB_BUCKETS];
+/** largest request per bucket */
+static u16_t pbuf_slab_max[PBUF_SLAB_BUCKETS];
+
+#define PBUF_SLAB_CLASS_HITS(c)   (((c)->size != 0) ? pbuf_slab_hits[(c)->bucket] : 0)
+
+/** bucket b holds the sizes (2^(b-1), 2^b] */
+static u8_t
+pbuf_slab_bucket(u16_t size)
+{
+  u8_t b = 0;
+
+  for (size = (u16_t)(size - 1); size != 0; size >>= 1) {
+    b++;
+  }
+  return b;
+}
+
+/**
+ * Allocate the memory for a PBUF_RAM pbuf from the slab of its size class.
+ *
+ * @param size memory needed for the pbuf (struct pbuf, headers and data)
+ * @return memory for the pbuf or NULL if its size is not served from slabs
+ *         (yet) or the class has no free object and there is no free page:
+ *         take it from the heap then
+ */
+static struct pbuf *
+pbuf_slab_alloc(mem_size_t size)
+{
+  struct pbuf_slab_class *c;
+  struct pbuf_slab_page *page;
+  u8_t *obj;
+  u8_t b, i;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  size += PBUF_SLAB_OBJ_HDR;
+  if (size > PBUF_SLAB_MAX_OBJ) {
+    return NULL;
+  }
+  b = pbuf_slab_bucket((u16_t)size);
+
+  SYS_ARCH_PROTECT(old_level);
+  if (pbuf_slab_hits[b] == 0xffff) {
+    /* age the statistics */
+    for (i = 0; i < PBUF_SLAB_BUCKETS; i++) {
+      pbuf_slab_hits[i] >>= 1;
+    }
+  }
+  pbuf_slab_hits[b]++;
+  if (size > pbuf_slab_max[b]) {
+    pbuf_slab_max[b] = (u16_t)size;
+  }
+
+  if (pbuf_slab_bucket_class[b] == 0) {
+    /* not served yet: take over the idle class serving the least requested
+       bucket if this one is requested more often */
+    c = NULL;
+    for (i = 0; i < PBUF_RAM_SLAB_CLASSES; i++) {
+      struct pbuf_slab_class *ci = &pbuf_slab_classes[i];
+      if ((ci->npages == 0) &&
+          ((c == NULL) || (PBUF_SLAB_CLASS_HITS(ci) < PBUF_SLAB_CLASS_HITS(c)))) {
+        c = ci;
+      }
+    }
+    if ((c == NULL) || (pbuf_slab_hits[b] <= PBUF_SLAB_CLASS_HITS(c))) {
+      SYS_ARCH_UNPROTECT(old_level);
+      return NULL;
+    }
+    if (c->size != 0) {
+      pbuf_slab_bucket_class[c->bucket] = 0;
+    }
+    c->size = 0;
+    c->bucket = b;
+    pbuf_slab_bucket_class[b] = (u8_t)(c - pbuf_slab_classes + 1);
+  } else {
+    c = &pbuf_slab_classes[pbuf_slab_bucket_class[b] - 1];
+  }
+
+  if ((c->npages == 0) && (c->size < pbuf_slab_max[b])) {
+    /* idle class: grow it to the biggest size requested */
+    c->size = (u16_t)LWIP_MEM_ALIGN_SIZE(pbuf_slab_max[b]);
+    c->per_page = (u16_t)(PBUF_SLAB_MAX_OBJ / c->size);
+    LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_slab_alloc: class %d: %"U16_F" objects of %"U16_F" bytes per page\n",
+      (int)(c - pbuf_slab_classes), c->per_page, c->size));
+  }
+  if ((size > c->size) || (c->per_page == 0)) {
+    SYS_ARCH_UNPROTECT(old_level);
+    return NULL;
+  }
+
+  page = c->pages;
+  if (page == NULL) {
+    page = (struct pbuf_slab_page *)memp_malloc(MEMP_PBUF_RAM_SLAB);
+    if (page == NULL) {
+      SYS_ARCH_UNPROTECT(old_level);
+      return NULL;
+    }
+    page->next = NULL;
+    page->prev = NULL;
+    page->free = NULL;
+    page->carved = 0;
+    page->used = 0;
+    page->cls = (u8_t)(c - pbuf_slab_classes);
+    c->pages = page;
+    c->npages++;
+  }
+  if (page->free != NULL) {
+    obj = (u8_t *)page->free;
+    page->free = *(void **)(void *)obj;
+  } else {
+    obj = (u8_t *)page + PBUF_SLAB_PAGE_HDR + page->carved * c->size;
+    page->carved++;
+  }
+  page->used++;
+  if (page->used == c->per_page) {
+    /* full: take it off the list (it is the first one) */
+    c->pages = page->next;
+    if (page->next != NULL) {
+      page->next->prev = NULL;
+    }
+    page->next = NULL;
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+
+  *(struct pbuf_slab_page **)(void *)obj = page;
+  return (struct pbuf *)(void *)(obj + PBUF_SLAB_OBJ_HDR);
+}
+
+/**
+ * Put the memory of a PBUF_RAM pbuf back into its slab (PBUF_FLAG_SLAB set).
+ * Pages that become empty are given back to MEMP_PBUF_RAM_SLAB.
+ */
+static void
+pbuf_slab_free(struct pbuf *p)
+{
+  u8_t *obj = (u8_t *)p - PBUF_SLAB_OBJ_HDR;
+  struct pbuf_slab_page *page = *(struct pbuf_slab_page **)(void *)obj;
+  struct pbuf_slab_class *c;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  LWIP_ASSERT("pbuf_slab_free: sane class", page->cls < PBUF_RAM_SLAB_CLASSES);
+  c = &pbuf_slab_classes[page->cls];
+
+  SYS_ARCH_PROTECT(old_level);
+  LWIP_ASSERT("pbuf_slab_free: page->used > 0", page->used > 0);
+  if (page->used == c->per_page) {
+    /* was full: put it back on the list */
+    page->prev = NULL;
+    page->next = c->pages;
+    if (c->pages != NULL) {
+      c->pages->prev = page;
+    }
+    c->pages = page;
+  }
+  page->used--;
+  if (page->used == 0) {
+    if (page->prev != NULL) {
+      page->prev->next = page->next;
+    } else {
+      c->pages = page->next;
+    }
+    if (page->next != NULL) {
+      page->next->prev = page->prev;
+    }
+    c->npages--;
+    memp_free(MEMP_PBUF_RAM_SLAB, page);
+  } else {
+    *(void **)(void *)obj = page->free;
+    page->free = obj;
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+#define PBUF_IS_SLAB(p)           (((p)->flags & PBUF_FLAG_SLAB) != 0)
+#else /* PBUF_RAM_SLAB */
+#define PBUF_IS_SLAB(p)           0
+#endif /* PBUF_RAM_SLAB */
 
 /**
  * Allocates a pbuf of the given type (possibly a chain for PBUF_POOL type).
@@ -236,6 +461,10 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
   struct pbuf *p, *q, *r;
   u16_t offset;
   s32_t rem_len; /* remaining length */
+  u8_t flags = 0;
+
+  PERF_START;
+
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc(length=%"U16_F")\n", length));
 
   /* determine header offset */
@@ -297,6 +526,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     }
     p->type = type;
     p->next = NULL;
+    p->eb = NULL;
 
     /* make the payload pointer point 'offset' bytes into pbuf data memory */
     p->payload = LWIP_MEM_ALIGN((void *)((u8_t *)p + (SIZEOF_STRUCT_PBUF + offset)));
@@ -333,6 +563,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
       q->type = type;
       q->flags = 0;
       q->next = NULL;
+      q->eb = NULL;
       /* make previous pbuf point to this pbuf */
       r->next = q;
       /* set total length of this pbuf and next in chain */
@@ -358,7 +589,15 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     break;
   case PBUF_RAM:
     /* If pbuf is to be allocated in RAM, allocate memory for it. */
-    p = (struct pbuf*)mem_malloc(LWIP_MEM_ALIGN_SIZE(SIZEOF_STRUCT_PBUF + offset) + LWIP_MEM_ALIGN_SIZE(length));
+#if PBUF_RAM_SLAB
+    p = pbuf_slab_alloc(LWIP_MEM_ALIGN_SIZE(SIZEOF_STRUCT_PBUF + offset) + LWIP_MEM_ALIGN_SIZE(length));
+    if (p != NULL) {
+      flags = PBUF_FLAG_SLAB;
+    } else
+#endif /* PBUF_RAM_SLAB */
+    {
+      p = (struct pbuf*)mem_malloc(LWIP_MEM_ALIGN_SIZE(SIZEOF_STRUCT_PBUF + offset) + LWIP_MEM_ALIGN_SIZE(length));
+    }
     if (p == NULL) {
       return NULL;
     }
@@ -392,6 +631,8 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     p->len = p->tot_len = length;
     p->next = NULL;
     p->type = type;
+    /* PBUF_ESF_RX: the driver sets this after allocation */
+    p->eb = NULL;
     break;
   default:
     LWIP_ASSERT("pbuf_alloc: erroneous type", 0);
@@ -400,8 +641,9 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
   /* set reference count */
   p->ref = 1;
   /* set flags */
-  p->flags = 0;
+  p->flags = flags;
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc(length=%"U16_F") == %p\n", length, (void *)p));
+  PERF_STOP("pbuf_alloc");
   return p;
 }
 
@@ -524,7 +766,8 @@ pbuf_realloc(struct pbuf *p, u16_t new_len)
 
   /* shrink allocated memory for PBUF_RAM */
   /* (other types merely adjust their length fields */
-  if ((q->type == PBUF_RAM) && (rem_len != q->len)) {
+  /* (slab objects can't be shrinked) */
+  if ((q->type == PBUF_RAM) && (rem_len != q->len) && !PBUF_IS_SLAB(q)) {
     /* reallocate and adjust the length of the pbuf that will be split */
     q = (struct pbuf *)mem_trim(q, (u16_t)((u8_t *)q->payload - (u8_t *)q) + rem_len);
     LWIP_ASSERT("mem_trim returned q == NULL", q != NULL);
@@ -682,6 +925,8 @@ pbuf_free(struct pbuf *p)
   struct pbuf *q;
   u8_t count;
 
+  PERF_START;
+
   if (p == NULL) {
     LWIP_ASSERT("p != NULL", p != NULL);
     /* if assertions are disabled, proceed with debug output */
@@ -691,8 +936,6 @@ pbuf_free(struct pbuf *p)
   }
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free(%p)\n", (void *)p));
 
-  PERF_START;
-
   LWIP_ASSERT("pbuf_free: sane type",
     p->type == PBUF_RAM || p->type == PBUF_ROM ||
     p->type == PBUF_REF || p->type == PBUF_POOL
@@ -745,6 +988,10 @@ pbuf_free(struct pbuf *p)
           #endif
           memp_free(MEMP_PBUF, p);
         /* type == PBUF_RAM */
+#if PBUF_RAM_SLAB
+        } else if (PBUF_IS_SLAB(p)) {
+          pbuf_slab_free(p);
+#endif /* PBUF_RAM_SLAB */
         } else {
           mem_free(p);
         }
@@ -863,6 +1110,49 @@ pbuf_chain(struct pbuf *h, struct pbuf *t)
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_chain: %p references %p\n", (void *)h, (void *)t));
 }
 
+#if LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+/**
+ * Splits a pbuf chain whose tot_len has overflowed (TCP chains more than
+ * 64 KiB of out-of-sequence data when window scaling is used) so that the
+ * first part fits into an u16_t again. No pbufs are allocated or freed.
+ *
+ * @param p the chain to shorten
+ * @param rest receives the remainder of the chain or NULL if p was not
+ *        longer than 0xFFFF bytes; its tot_len fields may still overflow
+ * @note MAY NOT be called on a packet queue.
+ */
+void
+pbuf_split_64k(struct pbuf *p, struct pbuf **rest)
+{
+  struct pbuf *q, *r;
+  u16_t tot_len_front;
+
+  *rest = NULL;
+  if ((p == NULL) || (p->next == NULL)) {
+    return;
+  }
+  tot_len_front = p->len;
+  q = p;
+  r = p->next;
+  /* stop before the sum (as u16_t) overflows */
+  while ((r != NULL) && ((u16_t)(tot_len_front + r->len) >= tot_len_front)) {
+    tot_len_front += r->len;
+    q = r;
+    r = r->next;
+  }
+  if (r != NULL) {
+    q->next = NULL;
+    /* the tot_len fields are correct modulo 2^16 */
+    for (q = p; q != NULL; q = q->next) {
+      q->tot_len -= r->tot_len;
+      LWIP_ASSERT("tot_len/len mismatch in last pbuf",
+                  (q->next != NULL) || (q->tot_len == q->len));
+    }
+    *rest = r;
+  }
+}
+#endif /* LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+
 /**
  * Dechains the first pbuf from its succeeding pbufs in the chain.
  *
@@ -0,0 +1,154 @@
+/**
+ * @file
+ * Profiler behind the PERF_START/PERF_STOP probes (LWIP_PERF==1)
+ *
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_PERF /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/perf.h"
+#include "lwip/sys.h"
+#include "lwip/def.h"
+
+#include <string.h>
+
+struct perf_probe *perf_probes;
+
+/**
+ * Add a probe to perf_probes the first time it is hit and find the probe
+ * keeping its statistics.
+ */
+static void
+perf_register(struct perf_probe *probe)
+{
+  struct perf_probe *p;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  if (probe->stats == NULL) {
+    for (p = perf_probes; p != NULL; p = p->next) {
+      if (strcmp(p->name, probe->name) == 0) {
+        break;
+      }
+    }
+    probe->stats = (p != NULL) ? p->stats : probe;
+    probe->next = perf_probes;
+    perf_probes = probe;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Account one measurement to a probe (called by PERF_STOP).
+ *
+ * @param probe the probe of the PERF_STOP site
+ * @param ticks LWIP_PERF_CLOCK() ticks since PERF_START
+ */
+void
+perf_record(struct perf_probe *probe, u32_t ticks)
+{
+  struct perf_probe *st;
+  u8_t bucket;
+  u32_t t;
+
+  if (probe->stats == NULL) {
+    perf_register(probe);
+  }
+  st = probe->stats;
+
+  /* log2 histogram bucket */
+  for (bucket = 0, t = ticks >> 1; (t != 0) && (bucket < LWIP_PERF_HIST_BUCKETS - 1); t >>= 1) {
+    bucket++;
+  }
+
+  if ((st->count == 0) || (ticks < st->min)) {
+    st->min = ticks;
+  }
+  if (ticks > st->max) {
+    st->max = ticks;
+  }
+  st->count++;
+  st->sum += ticks;
+  st->hist[bucket]++;
+}
+
+/**
+ * Clear the statistics of all probes (they stay registered).
+ */
+void
+perf_reset(void)
+{
+  struct perf_probe *p;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  for (p = perf_probes; p != NULL; p = p->next) {
+    p->count = 0;
+    p->min = 0;
+    p->max = 0;
+    p->sum = 0;
+    memset(p->hist, 0, sizeof(p->hist));
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Print the statistics of all probes, like stats_display().
+ */
+void
+perf_display(void)
+{
+  struct perf_probe *p;
+  int i;
+
+  for (p = perf_probes; p != NULL; p = p->next) {
+    if ((p->stats != p) || (p->count == 0)) {
+      /* shares another probe's statistics or not hit since perf_reset() */
+      continue;
+    }
+    LWIP_PLATFORM_DIAG(("\nPERF %s\n\t", p->name));
+    LWIP_PLATFORM_DIAG(("count: %"U32_F"\n\t", p->count));
+    LWIP_PLATFORM_DIAG(("min: %"U32_F"\n\t", p->min));
+    LWIP_PLATFORM_DIAG(("avg: %"U32_F"\n\t", (u32_t)(p->sum / p->count)));
+    LWIP_PLATFORM_DIAG(("max: %"U32_F"\n\t", p->max));
+    LWIP_PLATFORM_DIAG(("hist:"));
+    for (i = 0; i < LWIP_PERF_HIST_BUCKETS; i++) {
+      if (p->hist[i] != 0) {
+        LWIP_PLATFORM_DIAG((" %s2^%d:%"U32_F, (i == LWIP_PERF_HIST_BUCKETS - 1) ? ">=" : "",
+          i, p->hist[i]));
+      }
+    }
+    LWIP_PLATFORM_DIAG(("\n"));
+  }
+}
+
+#endif /* LWIP_PERF */
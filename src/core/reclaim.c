@@ -0,0 +1,275 @@
+/**
+ * @file
+ * Memory pressure handling: watermarks and prioritized reclaim handlers
+ *
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_RECLAIM /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/reclaim.h"
+#include "lwip/sys.h"
+#include "lwip/def.h"
+#include "lwip/tcp_impl.h"
+#include "lwip/ip_frag.h"
+#include "netif/etharp.h"
+#if !NO_SYS
+#include "lwip/tcpip.h"
+#endif /* !NO_SYS */
+
+mem_size_t reclaim_lowat[RECLAIM_SOURCES];
+static mem_size_t reclaim_hiwat[RECLAIM_SOURCES];
+/** source is short of memory */
+static u8_t reclaim_pending[RECLAIM_SOURCES];
+/** reclaim_run() is due (queued to the tcpip_thread for NO_SYS==0) */
+static u8_t reclaim_queued;
+/** registered handlers, sorted by prio */
+static struct reclaim_handler *reclaim_handlers;
+
+#if LWIP_TCP
+static struct reclaim_handler reclaim_tcp_timewait;
+#if TCP_QUEUE_OOSEQ
+static struct reclaim_handler reclaim_tcp_ooseq;
+#endif /* TCP_QUEUE_OOSEQ */
+#endif /* LWIP_TCP */
+#if LWIP_ARP
+static struct reclaim_handler reclaim_arp_queue;
+#endif /* LWIP_ARP */
+#if IP_REASSEMBLY
+static struct reclaim_handler reclaim_ip_reass;
+#endif /* IP_REASSEMBLY */
+
+/**
+ * Set the default watermarks and register the built-in handlers.
+ * Called after memp_init() (all elements are free).
+ */
+void
+reclaim_init(void)
+{
+  reclaim_src_t src;
+
+  reclaim_handlers = NULL;
+  reclaim_queued = 0;
+  for (src = 0; src < RECLAIM_SOURCES; src++) {
+    reclaim_pending[src] = 0;
+    reclaim_lowat[src] = 0;
+    reclaim_hiwat[src] = 0;
+#if !MEMP_MEM_MALLOC
+    if (src < MEMP_MAX) {
+      reclaim_set_watermarks(src, MEMP_RECLAIM_LOWAT(memp_avail((memp_t)src)),
+        MEMP_RECLAIM_HIWAT(memp_avail((memp_t)src)));
+    }
+#endif /* !MEMP_MEM_MALLOC */
+  }
+#if !MEM_LIBC_MALLOC && !MEM_USE_POOLS
+  reclaim_set_watermarks(RECLAIM_HEAP, MEM_RECLAIM_LOWAT, MEM_RECLAIM_HIWAT);
+#endif /* !MEM_LIBC_MALLOC && !MEM_USE_POOLS */
+
+#if LWIP_TCP
+  reclaim_register(&reclaim_tcp_timewait, tcp_reclaim_timewait, NULL, RECLAIM_PRIO_TCP_TIMEWAIT);
+#if TCP_QUEUE_OOSEQ
+  reclaim_register(&reclaim_tcp_ooseq, tcp_reclaim_ooseq, NULL, RECLAIM_PRIO_TCP_OOSEQ);
+#endif /* TCP_QUEUE_OOSEQ */
+#endif /* LWIP_TCP */
+#if LWIP_ARP
+  reclaim_register(&reclaim_arp_queue, etharp_reclaim, NULL, RECLAIM_PRIO_ARP_QUEUE);
+#endif /* LWIP_ARP */
+#if IP_REASSEMBLY
+  reclaim_register(&reclaim_ip_reass, ip_reass_reclaim, NULL, RECLAIM_PRIO_IP_REASS);
+#endif /* IP_REASSEMBLY */
+}
+
+/**
+ * Register a reclaim handler. Handlers with the same prio run in the order
+ * they were registered.
+ *
+ * @param h the handler (memory provided by the caller, must stay valid until
+ *          reclaim_unregister())
+ * @param fn function freeing memory
+ * @param arg argument passed to fn
+ * @param prio handlers run in ascending order of prio, see RECLAIM_PRIO_*
+ */
+void
+reclaim_register(struct reclaim_handler *h, reclaim_fn fn, void *arg, u8_t prio)
+{
+  struct reclaim_handler **hp;
+
+  LWIP_ASSERT("reclaim_register: invalid handler", (h != NULL) && (fn != NULL));
+  h->fn = fn;
+  h->arg = arg;
+  h->prio = prio;
+  h->freed = 0;
+  for (hp = &reclaim_handlers; (*hp != NULL) && ((*hp)->prio <= prio); hp = &(*hp)->next);
+  h->next = *hp;
+  *hp = h;
+}
+
+/**
+ * Remove a handler registered with reclaim_register().
+ */
+void
+reclaim_unregister(struct reclaim_handler *h)
+{
+  struct reclaim_handler **hp;
+
+  for (hp = &reclaim_handlers; *hp != NULL; hp = &(*hp)->next) {
+    if (*hp == h) {
+      *hp = h->next;
+      return;
+    }
+  }
+}
+
+/**
+ * Change the watermarks of a source.
+ *
+ * @param src a memp pool (memp_t) or RECLAIM_HEAP
+ * @param lowat reclaiming starts when less than this is free (elements for
+ *        pools, bytes for the heap), 0: only when an allocation fails
+ * @param hiwat reclaiming stops when at least this is free
+ */
+void
+reclaim_set_watermarks(reclaim_src_t src, mem_size_t lowat, mem_size_t hiwat)
+{
+  LWIP_ASSERT("reclaim_set_watermarks: invalid source", src < RECLAIM_SOURCES);
+  if (hiwat < lowat) {
+    hiwat = lowat;
+  }
+  reclaim_lowat[src] = lowat;
+  reclaim_hiwat[src] = hiwat;
+}
+
+/** Still short of memory? (sources without accounting are relieved after
+    one handler freed something) */
+static u8_t
+reclaim_needed(reclaim_src_t src, u8_t freed)
+{
+#if !MEMP_MEM_MALLOC
+  if (src < MEMP_MAX) {
+    return memp_avail((memp_t)src) < reclaim_hiwat[src];
+  }
+#endif /* !MEMP_MEM_MALLOC */
+#if !MEM_LIBC_MALLOC && !MEM_USE_POOLS
+  if (src == RECLAIM_HEAP) {
+    return mem_avail() < reclaim_hiwat[src];
+  }
+#endif /* !MEM_LIBC_MALLOC && !MEM_USE_POOLS */
+  return !freed;
+}
+
+/**
+ * Run the handlers for every source that is short of memory.
+ * Called in the tcpip_thread (NO_SYS==0) or from reclaim_poll().
+ */
+static void
+reclaim_run(void *arg)
+{
+  reclaim_src_t src;
+  struct reclaim_handler *h;
+  u8_t freed;
+  SYS_ARCH_DECL_PROTECT(lev);
+  LWIP_UNUSED_ARG(arg);
+
+  SYS_ARCH_PROTECT(lev);
+  reclaim_queued = 0;
+  SYS_ARCH_UNPROTECT(lev);
+
+  for (src = 0; src < RECLAIM_SOURCES; src++) {
+    if (!reclaim_pending[src]) {
+      continue;
+    }
+    SYS_ARCH_PROTECT(lev);
+    reclaim_pending[src] = 0;
+    SYS_ARCH_UNPROTECT(lev);
+
+    LWIP_DEBUGF(RECLAIM_DEBUG | LWIP_DBG_TRACE, ("reclaim_run: source %"U16_F" short of memory\n", (u16_t)src));
+    freed = 0;
+    h = reclaim_handlers;
+    while ((h != NULL) && reclaim_needed(src, freed)) {
+      if (h->fn(src, h->arg)) {
+        /* call it again until it has nothing left or memory is back */
+        h->freed++;
+        freed = 1;
+      } else {
+        h = h->next;
+      }
+    }
+    LWIP_DEBUGF(RECLAIM_DEBUG | LWIP_DBG_TRACE, ("reclaim_run: source %"U16_F" %s\n", (u16_t)src,
+      reclaim_needed(src, freed) ? "still short of memory" : "recovered"));
+  }
+}
+
+/**
+ * Tell that 'src' is short of memory. The handlers are run later, in the
+ * tcpip_thread (NO_SYS==0) or by reclaim_poll() (NO_SYS==1).
+ * May be called from any context (e.g. by a driver running out of buffers).
+ */
+void
+reclaim_signal(reclaim_src_t src)
+{
+  u8_t queued;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ASSERT("reclaim_signal: invalid source", src < RECLAIM_SOURCES);
+  SYS_ARCH_PROTECT(lev);
+  reclaim_pending[src] = 1;
+  queued = reclaim_queued;
+  reclaim_queued = 1;
+  SYS_ARCH_UNPROTECT(lev);
+
+#if !NO_SYS
+  if (!queued) {
+    if (tcpip_callback_with_block(reclaim_run, NULL, 0) != ERR_OK) {
+      /* try again with the next signal */
+      SYS_ARCH_PROTECT(lev);
+      reclaim_queued = 0;
+      SYS_ARCH_UNPROTECT(lev);
+    }
+  }
+#else /* !NO_SYS */
+  LWIP_UNUSED_ARG(queued);
+#endif /* !NO_SYS */
+}
+
+/**
+ * Run the handlers now if a source is short of memory. Must only be called
+ * where freeing stack memory is safe: sys_check_timeouts() does this for
+ * NO_SYS==1.
+ */
+void
+reclaim_poll(void)
+{
+  if (reclaim_queued) {
+    reclaim_run(NULL);
+  }
+}
+
+#endif /* LWIP_RECLAIM */
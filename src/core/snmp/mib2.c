@@ -732,7 +732,7 @@ const struct mib_array_node mgmt = {
 };
 
 /* internet .1.3.6.1 */
-#if SNMP_PRIVATE_MIB
+#if SNMP_PRIVATE_MIB || SNMP_MEMP_MIB
 /* When using a private MIB, you have to create a file 'private_mib.h' that contains
  * a 'struct mib_array_node mib_private' which contains your MIB. */
 s32_t internet_ids[2] = { 2, 4 };
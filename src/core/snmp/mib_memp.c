@@ -0,0 +1,444 @@
+/**
+ * @file
+ * lwIP private MIB objects for the memp pool statistics (SNMP_MEMP_MIB).
+ *
+ * enterprises.lwip(26381).lwipMemp(1):
+ *  mempTable(1).mempEntry(1).column.pool
+ *    mempDescr(1) OCTET STRING, mempAvail(2), mempUsed(3), mempMax(4) Gauge32,
+ *    mempErr(5) Counter32
+ *  mempCallerTable(2).mempCallerEntry(1).column.pool.site (MEMP_STATS_CALLERS)
+ *    mempCallerFile(1) OCTET STRING, mempCallerLine(2) INTEGER,
+ *    mempCallerErr(3) Counter32
+ *  mempHistTable(3).mempHistEntry(1).mempHistCount(1).pool.bucket
+ *    (MEMP_STATS_HIST_BUCKETS) Counter32
+ * pool is the memp_t + 1, site and bucket count from 1.
+ *
+ * @note the object identifiers must be kept in sorted ascending order.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_SNMP && SNMP_MEMP_MIB /* don't build if not configured for use in lwipopts.h */
+
+#if !MEMP_STATS
+#error "SNMP_MEMP_MIB needs MEMP_STATS"
+#endif
+#if (MEMP_STATS_CALLERS > 16) || (MEMP_STATS_HIST_BUCKETS > 16)
+#error "SNMP_MEMP_MIB supports up to 16 MEMP_STATS_CALLERS and MEMP_STATS_HIST_BUCKETS"
+#endif
+
+#include "lwip/snmp.h"
+#include "lwip/snmp_asn1.h"
+#include "lwip/snmp_structs.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+
+#include <string.h>
+
+static const char *const memp_descr[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc)  (desc),
+#include "lwip/memp_std.h"
+};
+
+/** row index of the pools: memp_t + 1 */
+static const s32_t memp_pool_ids[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc)  MEMP_##name + 1,
+#include "lwip/memp_std.h"
+};
+/** second row index (site, bucket) */
+static const s32_t memp_sub_ids[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+/** children of the last index level: none, the array node is the leaf */
+static struct mib_node* const memp_leaf_nodes[MEMP_MAX > 16 ? MEMP_MAX : 16];
+
+static void mempentry_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
+static void mempentry_get_value(struct obj_def *od, u16_t len, void *value);
+#if MEMP_STATS_CALLERS
+static void mempcaller_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
+static void mempcaller_get_value(struct obj_def *od, u16_t len, void *value);
+#endif /* MEMP_STATS_CALLERS */
+#if MEMP_STATS_HIST_BUCKETS
+static void memphist_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
+static void memphist_get_value(struct obj_def *od, u16_t len, void *value);
+#endif /* MEMP_STATS_HIST_BUCKETS */
+
+/* mempEntry.column .1.3.6.1.4.1.26381.1.1.1.x */
+const struct mib_array_node mempentry_pool = {
+  &mempentry_get_object_def,
+  &mempentry_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  MEMP_MAX,
+  memp_pool_ids,
+  memp_leaf_nodes
+};
+const s32_t mempentry_ids[5] = { 1, 2, 3, 4, 5 };
+struct mib_node* const mempentry_nodes[5] = {
+  (struct mib_node*)&mempentry_pool, (struct mib_node*)&mempentry_pool,
+  (struct mib_node*)&mempentry_pool, (struct mib_node*)&mempentry_pool,
+  (struct mib_node*)&mempentry_pool
+};
+const struct mib_array_node mempentry = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  5,
+  mempentry_ids,
+  mempentry_nodes
+};
+
+/* mempTable .1.3.6.1.4.1.26381.1.1 */
+const s32_t memptable_id = 1;
+struct mib_node* const memptable_node = (struct mib_node*)&mempentry;
+const struct mib_array_node memptable = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  &memptable_id,
+  &memptable_node
+};
+
+#if MEMP_STATS_CALLERS
+/* mempCallerEntry.column.pool .1.3.6.1.4.1.26381.1.2.1.x.y */
+const struct mib_array_node mempcaller_site = {
+  &mempcaller_get_object_def,
+  &mempcaller_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  MEMP_STATS_CALLERS,
+  memp_sub_ids,
+  memp_leaf_nodes
+};
+struct mib_node* const mempcaller_pool_nodes[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc)  (struct mib_node*)&mempcaller_site,
+#include "lwip/memp_std.h"
+};
+const struct mib_array_node mempcaller_pool = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  MEMP_MAX,
+  memp_pool_ids,
+  mempcaller_pool_nodes
+};
+const s32_t mempcallerentry_ids[3] = { 1, 2, 3 };
+struct mib_node* const mempcallerentry_nodes[3] = {
+  (struct mib_node*)&mempcaller_pool, (struct mib_node*)&mempcaller_pool,
+  (struct mib_node*)&mempcaller_pool
+};
+const struct mib_array_node mempcallerentry = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  3,
+  mempcallerentry_ids,
+  mempcallerentry_nodes
+};
+
+/* mempCallerTable .1.3.6.1.4.1.26381.1.2 */
+const s32_t mempcallertable_id = 1;
+struct mib_node* const mempcallertable_node = (struct mib_node*)&mempcallerentry;
+const struct mib_array_node mempcallertable = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  &mempcallertable_id,
+  &mempcallertable_node
+};
+#endif /* MEMP_STATS_CALLERS */
+
+#if MEMP_STATS_HIST_BUCKETS
+/* mempHistEntry.mempHistCount.pool .1.3.6.1.4.1.26381.1.3.1.1.x */
+const struct mib_array_node memphist_bucket = {
+  &memphist_get_object_def,
+  &memphist_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  MEMP_STATS_HIST_BUCKETS,
+  memp_sub_ids,
+  memp_leaf_nodes
+};
+struct mib_node* const memphist_pool_nodes[MEMP_MAX] = {
+#define LWIP_MEMPOOL(name,num,size,desc)  (struct mib_node*)&memphist_bucket,
+#include "lwip/memp_std.h"
+};
+const struct mib_array_node memphist_pool = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  MEMP_MAX,
+  memp_pool_ids,
+  memphist_pool_nodes
+};
+const s32_t memphistentry_id = 1;
+struct mib_node* const memphistentry_node = (struct mib_node*)&memphist_pool;
+const struct mib_array_node memphistentry = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  &memphistentry_id,
+  &memphistentry_node
+};
+
+/* mempHistTable .1.3.6.1.4.1.26381.1.3 */
+const s32_t memphisttable_id = 1;
+struct mib_node* const memphisttable_node = (struct mib_node*)&memphistentry;
+const struct mib_array_node memphisttable = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  &memphisttable_id,
+  &memphisttable_node
+};
+#endif /* MEMP_STATS_HIST_BUCKETS */
+
+/* lwipMemp .1.3.6.1.4.1.26381.1 */
+const s32_t mib_memp_ids[] = {
+  1
+#if MEMP_STATS_CALLERS
+  , 2
+#endif /* MEMP_STATS_CALLERS */
+#if MEMP_STATS_HIST_BUCKETS
+  , 3
+#endif /* MEMP_STATS_HIST_BUCKETS */
+};
+struct mib_node* const mib_memp_nodes[] = {
+  (struct mib_node*)&memptable
+#if MEMP_STATS_CALLERS
+  , (struct mib_node*)&mempcallertable
+#endif /* MEMP_STATS_CALLERS */
+#if MEMP_STATS_HIST_BUCKETS
+  , (struct mib_node*)&memphisttable
+#endif /* MEMP_STATS_HIST_BUCKETS */
+};
+const struct mib_array_node mib_memp = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  sizeof(mib_memp_ids) / sizeof(s32_t),
+  mib_memp_ids,
+  mib_memp_nodes
+};
+
+#if !SNMP_PRIVATE_MIB
+/* lwip .1.3.6.1.4.1.26381 */
+const s32_t lwip_id = 1;
+struct mib_node* const lwip_node = (struct mib_node*)&mib_memp;
+const struct mib_array_node lwip_mib = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  &lwip_id,
+  &lwip_node
+};
+
+/* enterprises .1.3.6.1.4.1 */
+const s32_t enterprises_id = 26381;
+struct mib_node* const enterprises_node = (struct mib_node*)&lwip_mib;
+const struct mib_array_node enterprises = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  &enterprises_id,
+  &enterprises_node
+};
+
+/* private .1.3.6.1.4 */
+const s32_t private_id = 1;
+struct mib_node* const private_node = (struct mib_node*)&enterprises;
+const struct mib_array_node mib_private = {
+  &noleafs_get_object_def,
+  &noleafs_get_value,
+  &noleafs_set_test,
+  &noleafs_set_value,
+  MIB_NODE_AR,
+  1,
+  &private_id,
+  &private_node
+};
+#endif /* !SNMP_PRIVATE_MIB */
+
+/** Set the object definition, id_inst_ptr points to the column followed
+    by the 'depth' row indexes */
+static void
+memp_get_object_def(u8_t depth, u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+  od->instance = MIB_OBJECT_NONE;
+  if (ident_len != 1) {
+    LWIP_DEBUGF(SNMP_MIB_DEBUG,("memp_get_object_def: no such object\n"));
+    return;
+  }
+  /* return to the column (the search checked the indexes) */
+  od->id_inst_len = depth + 1;
+  od->id_inst_ptr = ident - depth;
+  od->instance = MIB_OBJECT_TAB;
+  od->access = MIB_OBJECT_READ_ONLY;
+  od->asn_type = (SNMP_ASN1_APPLIC | SNMP_ASN1_PRIMIT | SNMP_ASN1_COUNTER);
+  od->v_len = sizeof(u32_t);
+}
+
+static void
+mempentry_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+  memp_get_object_def(1, ident_len, ident, od);
+  if (od->instance != MIB_OBJECT_NONE) {
+    switch (od->id_inst_ptr[0]) {
+      case 1: /* mempDescr */
+        od->asn_type = (SNMP_ASN1_UNIV | SNMP_ASN1_PRIMIT | SNMP_ASN1_OC_STR);
+        od->v_len = (u16_t)strlen(memp_descr[od->id_inst_ptr[1] - 1]);
+        break;
+      case 2: /* mempAvail */
+      case 3: /* mempUsed */
+      case 4: /* mempMax */
+        od->asn_type = (SNMP_ASN1_APPLIC | SNMP_ASN1_PRIMIT | SNMP_ASN1_GAUGE);
+        break;
+      default: /* mempErr */
+        break;
+    }
+  }
+}
+
+static void
+mempentry_get_value(struct obj_def *od, u16_t len, void *value)
+{
+  u32_t *uint_ptr = (u32_t*)value;
+  struct stats_mem *mem = &lwip_stats.memp[od->id_inst_ptr[1] - 1];
+
+  switch (od->id_inst_ptr[0]) {
+    case 1: /* mempDescr */
+      MEMCPY(value, memp_descr[od->id_inst_ptr[1] - 1], len);
+      break;
+    case 2: /* mempAvail */
+      *uint_ptr = mem->avail;
+      break;
+    case 3: /* mempUsed */
+      *uint_ptr = mem->used;
+      break;
+    case 4: /* mempMax */
+      *uint_ptr = mem->max;
+      break;
+    case 5: /* mempErr */
+      *uint_ptr = mem->err;
+      break;
+  }
+}
+
+#if MEMP_STATS_CALLERS
+static void
+mempcaller_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+  struct stats_memp_caller *c;
+
+  memp_get_object_def(2, ident_len, ident, od);
+  if (od->instance != MIB_OBJECT_NONE) {
+    c = &lwip_stats.memp_caller[od->id_inst_ptr[1] - 1][od->id_inst_ptr[2] - 1];
+    switch (od->id_inst_ptr[0]) {
+      case 1: /* mempCallerFile */
+        od->asn_type = (SNMP_ASN1_UNIV | SNMP_ASN1_PRIMIT | SNMP_ASN1_OC_STR);
+        od->v_len = (c->file != NULL) ? (u16_t)strlen(c->file) : 0;
+        break;
+      case 2: /* mempCallerLine */
+        od->asn_type = (SNMP_ASN1_UNIV | SNMP_ASN1_PRIMIT | SNMP_ASN1_INTEG);
+        od->v_len = sizeof(s32_t);
+        break;
+      default: /* mempCallerErr */
+        break;
+    }
+  }
+}
+
+static void
+mempcaller_get_value(struct obj_def *od, u16_t len, void *value)
+{
+  struct stats_memp_caller *c;
+
+  c = &lwip_stats.memp_caller[od->id_inst_ptr[1] - 1][od->id_inst_ptr[2] - 1];
+  switch (od->id_inst_ptr[0]) {
+    case 1: /* mempCallerFile */
+      if (len > 0) {
+        MEMCPY(value, c->file, len);
+      }
+      break;
+    case 2: /* mempCallerLine */
+      *(s32_t*)value = c->line;
+      break;
+    case 3: /* mempCallerErr */
+      *(u32_t*)value = c->err;
+      break;
+  }
+}
+#endif /* MEMP_STATS_CALLERS */
+
+#if MEMP_STATS_HIST_BUCKETS
+static void
+memphist_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
+{
+  memp_get_object_def(2, ident_len, ident, od);
+}
+
+static void
+memphist_get_value(struct obj_def *od, u16_t len, void *value)
+{
+  LWIP_UNUSED_ARG(len);
+  *(u32_t*)value = lwip_stats.memp_hist[od->id_inst_ptr[1] - 1][od->id_inst_ptr[2] - 1];
+}
+#endif /* MEMP_STATS_HIST_BUCKETS */
+
+#endif /* LWIP_SNMP && SNMP_MEMP_MIB */
@@ -116,6 +116,10 @@ stats_display_mem(struct stats_mem *mem, char *name)
   LWIP_PLATFORM_DIAG(("avail: %"U32_F"\n\t", (u32_t)mem->avail)); 
   LWIP_PLATFORM_DIAG(("used: %"U32_F"\n\t", (u32_t)mem->used)); 
   LWIP_PLATFORM_DIAG(("max: %"U32_F"\n\t", (u32_t)mem->max)); 
+  if (mem->largest != 0) {
+    LWIP_PLATFORM_DIAG(("largest: %"U32_F"\n\t", (u32_t)mem->largest));
+    LWIP_PLATFORM_DIAG(("frag: %"U32_F"%%\n\t", (u32_t)mem->frag));
+  }
   LWIP_PLATFORM_DIAG(("err: %"U32_F"\n", (u32_t)mem->err));
 }
 
@@ -127,8 +131,31 @@ stats_display_memp(struct stats_mem *mem, int index)
 #define LWIP_MEMPOOL(name,num,size,desc) desc,
 #include "lwip/memp_std.h"
   };
+#if MEMP_STATS_CALLERS || MEMP_STATS_HIST_BUCKETS
+  int i;
+#endif
   if(index < MEMP_MAX) {
     stats_display_mem(mem, memp_names[index]);
+#if MEMP_STATS_CALLERS
+    for (i = 0; i < MEMP_STATS_CALLERS; i++) {
+      struct stats_memp_caller *c = &lwip_stats.memp_caller[index][i];
+      if (c->err != 0) {
+        LWIP_PLATFORM_DIAG(("\terr %s:%"U16_F": %"STAT_COUNTER_F"\n", c->file, c->line, c->err));
+      }
+    }
+#endif /* MEMP_STATS_CALLERS */
+#if MEMP_STATS_HIST_BUCKETS
+    if (mem->used != 0 || mem->max != 0) {
+      LWIP_PLATFORM_DIAG(("\tms in use:"));
+      for (i = 0; i < MEMP_STATS_HIST_BUCKETS; i++) {
+        if (lwip_stats.memp_hist[index][i] != 0) {
+          LWIP_PLATFORM_DIAG((" %s2^%d:%"STAT_COUNTER_F, (i == MEMP_STATS_HIST_BUCKETS - 1) ? ">=" : "",
+            i, lwip_stats.memp_hist[index][i]));
+        }
+      }
+      LWIP_PLATFORM_DIAG(("\n"));
+    }
+#endif /* MEMP_STATS_HIST_BUCKETS */
   }
 }
 #endif /* MEMP_STATS */
@@ -151,6 +178,22 @@ stats_display_sys(struct stats_sys *sys)
 }
 #endif /* SYS_STATS */
 
+#if TCP_STATS
+void
+stats_display_tcp_pcbs(struct stats_tcp_pcbs *pcbs)
+{
+  LWIP_PLATFORM_DIAG(("\nTCP PCBS\n\t"));
+  LWIP_PLATFORM_DIAG(("active.used:    %"U32_F"\n\t", (u32_t)pcbs->active.used));
+  LWIP_PLATFORM_DIAG(("active.max:     %"U32_F"\n\t", (u32_t)pcbs->active.max));
+  LWIP_PLATFORM_DIAG(("active.err:     %"U32_F"\n\t", (u32_t)pcbs->active.err));
+  LWIP_PLATFORM_DIAG(("syn_rcvd.used:  %"U32_F"\n\t", (u32_t)pcbs->syn_rcvd.used));
+  LWIP_PLATFORM_DIAG(("syn_rcvd.max:   %"U32_F"\n\t", (u32_t)pcbs->syn_rcvd.max));
+  LWIP_PLATFORM_DIAG(("syn_rcvd.err:   %"U32_F"\n\t", (u32_t)pcbs->syn_rcvd.err));
+  LWIP_PLATFORM_DIAG(("time_wait.used: %"U32_F"\n\t", (u32_t)pcbs->time_wait.used));
+  LWIP_PLATFORM_DIAG(("time_wait.max:  %"U32_F"\n", (u32_t)pcbs->time_wait.max));
+}
+#endif /* TCP_STATS */
+
 void
 stats_display(void)
 {
@@ -50,6 +50,7 @@
 #include "lwip/snmp.h"
 #include "lwip/tcp.h"
 #include "lwip/tcp_impl.h"
+#include "lwip/tcp_cc.h"
 #include "lwip/debug.h"
 #include "lwip/stats.h"
 
@@ -73,12 +74,19 @@ const char tcp_state_str_rodata[][12] ICACHE_RODATA_ATTR = {
 char tcp_state_str[12];
 #endif
 
+#if !LWIP_TCP_TIMERS_MS
 /* Incremented every coarse grained timer shot (typically every 500 ms). */
 u32_t tcp_ticks;
+#endif /* !LWIP_TCP_TIMERS_MS */
 const u8_t tcp_backoff[13] ICACHE_RODATA_ATTR =
     { 1, 2, 3, 4, 5, 6, 7, 7, 7, 7, 7, 7, 7};
  /* Times per slowtmr hits */
 const u8_t tcp_persist_backoff[7] ICACHE_RODATA_ATTR = { 3, 6, 12, 24, 48, 96, 120 };
+#if LWIP_TCP_TIMERS_MS
+/* Milliseconds until the next zero window probe */
+#define TCP_PERSIST_TMO(pcb) ((u32_t)TCP_SLOW_INTERVAL * \
+  system_get_data_of_array_8(tcp_persist_backoff, (pcb)->persist_backoff - 1))
+#endif /* LWIP_TCP_TIMERS_MS */
 
 /* The TCP PCB lists. */
 
@@ -101,8 +109,25 @@ struct tcp_pcb ** const tcp_pcb_lists[] ICACHE_RODATA_ATTR = {&tcp_listen_pcbs.p
 /** Only used for temporary storage. */
 struct tcp_pcb *tcp_tmp_pcb;
 
+/** Number of pcbs on the lists above, by state */
+struct tcp_pcb_num_t tcp_pcb_num;
+
+#if TCP_PCB_HASH
+/** Buckets of tcp_active_pcbs, hashed by 4-tuple */
+struct tcp_pcb *tcp_active_hash[TCP_PCB_HASH_SIZE];
+/** Buckets of tcp_tw_pcbs, hashed by 4-tuple */
+struct tcp_pcb *tcp_tw_hash[TCP_PCB_HASH_SIZE];
+/** Buckets of tcp_listen_pcbs, hashed by local port */
+struct tcp_pcb_listen *tcp_listen_hash[TCP_LISTEN_HASH_SIZE];
+#endif /* TCP_PCB_HASH */
+
+#if LWIP_TCP_TIMERS_MS
+/** tcp_ticks when tcp_slowtmr() last advanced the poll timers */
+static u32_t tcp_poll_time;
+#else /* LWIP_TCP_TIMERS_MS */
 /** Timer counter to handle calling slow-timer from tcp_tmr() */ 
 static u8_t tcp_timer;
+#endif /* LWIP_TCP_TIMERS_MS */
 static u16_t tcp_new_port(void);
 
 /**
@@ -112,6 +137,11 @@ static u16_t tcp_new_port(void);
 void
 tcp_tmr(void)
 {
+#if LWIP_TCP_TIMERS_MS
+  /* Called when the earliest deadline has passed: both check what expired */
+  tcp_fasttmr();
+  tcp_slowtmr();
+#else /* LWIP_TCP_TIMERS_MS */
   /* Call tcp_fasttmr() every 250 ms */
   tcp_fasttmr();
 
@@ -120,6 +150,7 @@ tcp_tmr(void)
        tcp_tmr() is called. */
     tcp_slowtmr();
   }
+#endif /* LWIP_TCP_TIMERS_MS */
 }
 
 /**
@@ -144,7 +175,7 @@ tcp_close_shutdown(struct tcp_pcb *pcb, u8_t rst_on_unacked_data)
   err_t err;
 
   if (rst_on_unacked_data && (pcb->state != LISTEN)) {
-    if ((pcb->refused_data != NULL) || (pcb->rcv_wnd != TCP_WND)) {
+    if ((pcb->refused_data != NULL) || (pcb->rcv_wnd != TCP_WND_MAX(pcb))) {
       /* Not all data received by application, send RST to tell the remote
          side about this. */
       LWIP_ASSERT("pcb->flags & TF_RXCLOSED", pcb->flags & TF_RXCLOSED);
@@ -200,6 +231,7 @@ tcp_close_shutdown(struct tcp_pcb *pcb, u8_t rst_on_unacked_data)
     err = tcp_send_fin(pcb);
     if (err == ERR_OK) {
       snmp_inc_tcpattemptfails();
+      TCP_PCB_NUM_DEC(syn_rcvd);
       pcb->state = FIN_WAIT_1;
     }
     break;
@@ -517,6 +549,9 @@ tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog)
   lpcb->local_port = pcb->local_port;
   lpcb->state = LISTEN;
   lpcb->prio = pcb->prio;
+#if LWIP_TCP_CC
+  lpcb->cc_ops = pcb->cc_ops;
+#endif /* LWIP_TCP_CC */
   lpcb->so_options = pcb->so_options;
   lpcb->so_options |= SOF_ACCEPTCONN;
   lpcb->ttl = pcb->ttl;
@@ -559,8 +594,10 @@ u32_t tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
     } else {
       /* keep the right edge of window constant */
       u32_t new_rcv_ann_wnd = pcb->rcv_ann_right_edge - pcb->rcv_nxt;
+#if !LWIP_WND_SCALE
       LWIP_ASSERT("new_rcv_ann_wnd <= 0xffff", new_rcv_ann_wnd <= 0xffff);
-      pcb->rcv_ann_wnd = (u16_t)new_rcv_ann_wnd;
+#endif /* !LWIP_WND_SCALE */
+      pcb->rcv_ann_wnd = (tcpwnd_size_t)new_rcv_ann_wnd;
     }
     return 0;
   }
@@ -578,14 +615,14 @@ void
 tcp_recved(struct tcp_pcb *pcb, u16_t len)
 {
   int wnd_inflation;
+  tcpwnd_size_t rcv_wnd;
 
-  LWIP_ASSERT("tcp_recved: len would wrap rcv_wnd\n",
-              len <= 0xffff - pcb->rcv_wnd );
-
-  pcb->rcv_wnd += len;
-  if (pcb->rcv_wnd > TCP_WND) {
-    pcb->rcv_wnd = TCP_WND;
+  rcv_wnd = (tcpwnd_size_t)(pcb->rcv_wnd + len);
+  LWIP_ASSERT("tcp_recved: len would wrap rcv_wnd\n", rcv_wnd >= pcb->rcv_wnd);
+  if (rcv_wnd > TCP_WND_MAX(pcb)) {
+    rcv_wnd = TCP_WND_MAX(pcb);
   }
+  pcb->rcv_wnd = rcv_wnd;
 
   wnd_inflation = tcp_update_rcv_ann_wnd(pcb);
 
@@ -598,8 +635,8 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
     tcp_output(pcb);
   }
 
-  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: recveived %"U16_F" bytes, wnd %"U16_F" (%"U16_F").\n",
-         len, pcb->rcv_wnd, TCP_WND - pcb->rcv_wnd));
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: recveived %"U16_F" bytes, wnd %"TCPWNDSIZE_F" (%"TCPWNDSIZE_F").\n",
+         len, pcb->rcv_wnd, (tcpwnd_size_t)(TCP_WND_MAX(pcb) - pcb->rcv_wnd)));
 }
 
 /**
@@ -713,8 +750,9 @@ tcp_connect(struct tcp_pcb *pcb, ip_addr_t *ipaddr, u16_t port,
   pcb->snd_nxt = iss;
   pcb->lastack = iss - 1;
   pcb->snd_lbb = iss - 1;
-  pcb->rcv_wnd = TCP_WND;
-  pcb->rcv_ann_wnd = TCP_WND;
+  /* the full TCP_WND is only used once the peer accepts window scaling */
+  pcb->rcv_wnd = TCPWND16(TCP_WND);
+  pcb->rcv_ann_wnd = TCPWND16(TCP_WND);
   pcb->rcv_ann_right_edge = pcb->rcv_nxt;
   pcb->snd_wnd = TCP_WND;
   /* As initial send MSS, we use TCP_MSS but limit it to 536.
@@ -751,6 +789,8 @@ tcp_connect(struct tcp_pcb *pcb, ip_addr_t *ipaddr, u16_t port,
  * Called every 500 ms and implements the retransmission timer and the timer that
  * removes PCBs that have been in TIME-WAIT for enough time. It also increments
  * various timers such as the inactivity timer in each PCB.
+ * With LWIP_TCP_TIMERS_MS, it is called whenever a deadline has passed and
+ * only the poll timers still advance in 500 ms steps.
  *
  * Automatically called from tcp_tmr().
  */
@@ -758,14 +798,25 @@ void
 tcp_slowtmr(void)
 {
   struct tcp_pcb *pcb, *prev;
-  u16_t eff_wnd;
+#if !LWIP_TCP_CC
+  tcpwnd_size_t eff_wnd;
+#endif /* !LWIP_TCP_CC */
   u8_t pcb_remove;      /* flag if a PCB should be removed */
   u8_t pcb_reset;       /* flag if a RST should be sent when removing */
+  u8_t poll_tick;       /* flag if the poll timers advance */
   err_t err;
 
   err = ERR_OK;
 
+#if LWIP_TCP_TIMERS_MS
+  poll_tick = ((u32_t)(tcp_ticks - tcp_poll_time) >= TCP_SLOW_INTERVAL);
+  if (poll_tick) {
+    tcp_poll_time = tcp_ticks;
+  }
+#else /* LWIP_TCP_TIMERS_MS */
+  poll_tick = 1;
   ++tcp_ticks;
+#endif /* LWIP_TCP_TIMERS_MS */
 
   /* Steps through all of the active PCBs. */
   prev = NULL;
@@ -793,43 +844,72 @@ tcp_slowtmr(void)
       if (pcb->persist_backoff > 0) {
         /* If snd_wnd is zero, use persist timer to send 1 byte probes
          * instead of using the standard retransmission mechanism. */
+#if LWIP_TCP_TIMERS_MS
+        if ((u32_t)(tcp_ticks - pcb->persist_cnt) >= TCP_PERSIST_TMO(pcb)) {
+          pcb->persist_cnt = tcp_ticks;
+#else /* LWIP_TCP_TIMERS_MS */
         pcb->persist_cnt++;
         if (pcb->persist_cnt >= system_get_data_of_array_8(tcp_persist_backoff, pcb->persist_backoff-1)) {
           pcb->persist_cnt = 0;
+#endif /* LWIP_TCP_TIMERS_MS */
           if (pcb->persist_backoff < sizeof(tcp_persist_backoff)) {
             pcb->persist_backoff++;
           }
           tcp_zero_window_probe(pcb);
         }
       } else {
+#if !LWIP_TCP_TIMERS_MS
         /* Increase the retransmission timer if it is running */
         if(pcb->rtime >= 0)
           ++pcb->rtime;
+#endif /* !LWIP_TCP_TIMERS_MS */
+
+#if LWIP_TCP_RACK
+        if ((pcb->unacked != NULL) && (pcb->flags & (TF_RACK_REO | TF_TLP_PTO)) &&
+            ((s32_t)(tcp_ticks - pcb->rack_tmr) >= 0)) {
+          /* reordering window passed or time for a tail loss probe */
+          tcp_rack_timeout(pcb);
+        }
+#endif /* LWIP_TCP_RACK */
 
-        if (pcb->unacked != NULL && pcb->rtime >= pcb->rto) {
+        if (pcb->unacked != NULL && TCP_RTIMER_EXPIRED(pcb)) {
           /* Time for a retransmission. */
           LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_slowtmr: rtime %"S16_F
-                                      " pcb->rto %"S16_F"\n",
+                                      " pcb->rto %"TCPTMR_F"\n",
                                       pcb->rtime, pcb->rto));
 
           /* Double retransmission time-out unless we are trying to
            * connect to somebody (i.e., we are in SYN_SENT). */
           if (pcb->state != SYN_SENT) {
-            pcb->rto = ((pcb->sa >> 3) + pcb->sv) << system_get_data_of_array_8(tcp_backoff, pcb->nrtx);
+            pcb->rto = TCP_RTO_CALC(pcb) << system_get_data_of_array_8(tcp_backoff, pcb->nrtx);
+#if LWIP_TCP_TIMERS_MS
+            pcb->rto = LWIP_MIN(pcb->rto, TCP_RTO_MAX);
+#endif /* LWIP_TCP_TIMERS_MS */
           }
 
           /* Reset the retransmission timer. */
-          pcb->rtime = 0;
+          TCP_RTIMER_START(pcb);
+#if LWIP_TCP_RACK
+          pcb->flags &= ~(TF_RACK_REO | TF_TLP_PTO | TF_TLP_SENT);
+#endif /* LWIP_TCP_RACK */
 
           /* Reduce congestion window and ssthresh. */
+#if LWIP_TCP_CC
+          pcb->cc_ops->on_rto(pcb);
+          /* fast recovery is over, don't enter it again for the data
+             that is resent now (RFC 6582, section 4) */
+          pcb->flags &= ~TF_INFR;
+          pcb->recover = pcb->snd_nxt;
+#else /* LWIP_TCP_CC */
           eff_wnd = LWIP_MIN(pcb->cwnd, pcb->snd_wnd);
           pcb->ssthresh = eff_wnd >> 1;
           if (pcb->ssthresh < (pcb->mss << 1)) {
             pcb->ssthresh = (pcb->mss << 1);
           }
           pcb->cwnd = pcb->mss;
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"U16_F
-                                       " ssthresh %"U16_F"\n",
+#endif /* LWIP_TCP_CC */
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"TCPWNDSIZE_F
+                                       " ssthresh %"TCPWNDSIZE_F"\n",
                                        pcb->cwnd, pcb->ssthresh));
  
           /* The following needs to be called AFTER cwnd is set to one
@@ -841,7 +921,7 @@ tcp_slowtmr(void)
     /* Check if this PCB has stayed too long in FIN-WAIT-2 */
     if (pcb->state == FIN_WAIT_2) {
       if ((u32_t)(tcp_ticks - pcb->tmr) >
-          TCP_FIN_WAIT_TIMEOUT / TCP_SLOW_INTERVAL) {
+          TCP_FIN_WAIT_TIMEOUT / TCP_TICK_MS) {
         ++pcb_remove;
         LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in FIN-WAIT-2\n"));
       }
@@ -854,10 +934,10 @@ tcp_slowtmr(void)
 #if LWIP_TCP_KEEPALIVE
       if((u32_t)(tcp_ticks - pcb->tmr) >
          (pcb->keep_idle + (pcb->keep_cnt*pcb->keep_intvl))
-         / TCP_SLOW_INTERVAL)
+         / TCP_TICK_MS)
 #else      
       if((u32_t)(tcp_ticks - pcb->tmr) >
-         (pcb->keep_idle + TCP_MAXIDLE) / TCP_SLOW_INTERVAL)
+         (pcb->keep_idle + TCP_MAXIDLE) / TCP_TICK_MS)
 #endif /* LWIP_TCP_KEEPALIVE */
       {
         LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: KEEPALIVE timeout. Aborting connection to %"U16_F".%"U16_F".%"U16_F".%"U16_F".\n",
@@ -870,11 +950,11 @@ tcp_slowtmr(void)
 #if LWIP_TCP_KEEPALIVE
       else if((u32_t)(tcp_ticks - pcb->tmr) > 
               (pcb->keep_idle + pcb->keep_cnt_sent * pcb->keep_intvl)
-              / TCP_SLOW_INTERVAL)
+              / TCP_TICK_MS)
 #else
       else if((u32_t)(tcp_ticks - pcb->tmr) > 
               (pcb->keep_idle + pcb->keep_cnt_sent * TCP_KEEPINTVL_DEFAULT) 
-              / TCP_SLOW_INTERVAL)
+              / TCP_TICK_MS)
 #endif /* LWIP_TCP_KEEPALIVE */
       {
         tcp_keepalive(pcb);
@@ -897,7 +977,7 @@ tcp_slowtmr(void)
     /* Check if this PCB has stayed too long in SYN-RCVD */
     if (pcb->state == SYN_RCVD) {
       if ((u32_t)(tcp_ticks - pcb->tmr) >
-          TCP_SYN_RCVD_TIMEOUT / TCP_SLOW_INTERVAL) {
+          TCP_SYN_RCVD_TIMEOUT / TCP_TICK_MS) {
         ++pcb_remove;
         LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in SYN-RCVD\n"));
       }
@@ -905,7 +985,7 @@ tcp_slowtmr(void)
 
     /* Check if this PCB has stayed too long in LAST-ACK */
     if (pcb->state == LAST_ACK) {
-      if ((u32_t)(tcp_ticks - pcb->tmr) > 2 * TCP_MSL / TCP_SLOW_INTERVAL) {
+      if ((u32_t)(tcp_ticks - pcb->tmr) > 2 * TCP_MSL / TCP_TICK_MS) {
         ++pcb_remove;
         LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: removing pcb stuck in LAST-ACK\n"));
       }
@@ -924,6 +1004,8 @@ tcp_slowtmr(void)
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_active_pcbs", tcp_active_pcbs == pcb);
         tcp_active_pcbs = pcb->next;
       }
+      TCP_HASH_RMV(&tcp_active_pcbs, pcb);
+      TCP_PCB_NUM_RMV(&tcp_active_pcbs, pcb);
 
       if (pcb_reset) {
         tcp_rst(pcb->snd_nxt, pcb->rcv_nxt, &pcb->local_ip, &pcb->remote_ip,
@@ -940,8 +1022,7 @@ tcp_slowtmr(void)
       pcb = pcb->next;
 
       /* We check if we should poll the connection. */
-      ++prev->polltmr;
-      if (prev->polltmr >= prev->pollinterval) {
+      if (poll_tick && (++prev->polltmr >= prev->pollinterval)) {
         prev->polltmr = 0;
         LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: polling application\n"));
         TCP_EVENT_POLL(prev, err);
@@ -962,7 +1043,7 @@ tcp_slowtmr(void)
     pcb_remove = 0;
 
     /* Check if this PCB has stayed long enough in TIME-WAIT */
-    if ((u32_t)(tcp_ticks - pcb->tmr) > 2 * TCP_MSL / TCP_SLOW_INTERVAL) {
+    if ((u32_t)(tcp_ticks - pcb->tmr) > 2 * TCP_MSL / TCP_TICK_MS) {
       ++pcb_remove;
     }
     
@@ -981,6 +1062,8 @@ tcp_slowtmr(void)
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_tw_pcbs", tcp_tw_pcbs == pcb);
         tcp_tw_pcbs = pcb->next;
       }
+      TCP_HASH_RMV(&tcp_tw_pcbs, pcb);
+      TCP_PCB_NUM_RMV(&tcp_tw_pcbs, pcb);
       pcb2 = pcb;
       pcb = pcb->next;
       memp_free(MEMP_TCP_PCB, pcb2);
@@ -1008,18 +1091,36 @@ tcp_fasttmr(void)
     if (pcb->refused_data != NULL) {
       /* Notify again application with data previously received. */
       err_t err;
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+      struct pbuf *rest;
+      pbuf_split_64k(pcb->refused_data, &rest);
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_fasttmr: notify kept packet\n"));
       TCP_EVENT_RECV(pcb, pcb->refused_data, ERR_OK, err);
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+      if (err == ERR_OK) {
+        /* the remainder follows on the next run */
+        pcb->refused_data = rest;
+      } else if (err == ERR_ABRT) {
+        if (rest != NULL) {
+          pbuf_free(rest);
+        }
+        pcb = NULL;
+      } else if (rest != NULL) {
+        pbuf_cat(pcb->refused_data, rest);
+      }
+#else /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
       if (err == ERR_OK) {
         pcb->refused_data = NULL;
       } else if (err == ERR_ABRT) {
         /* if err == ERR_ABRT, 'pcb' is already deallocated */
         pcb = NULL;
       }
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
     }
 
     /* send delayed ACKs */
-    if (pcb && (pcb->flags & TF_ACK_DELAY)) {
+    if (pcb && (pcb->flags & TF_ACK_DELAY) && TCP_ACK_DELAY_EXPIRED(pcb)) {
       LWIP_DEBUGF(TCP_DEBUG, ("tcp_fasttmr: delayed ACK\n"));
       tcp_ack_now(pcb);
       tcp_output(pcb);
@@ -1030,6 +1131,114 @@ tcp_fasttmr(void)
   }
 }
 
+#if LWIP_TCP_TIMERS_MS
+/** Earlier of 'timeout' and the milliseconds until 'deadline', at least 1 */
+static u32_t
+tcp_timeout_min(u32_t timeout, u32_t deadline)
+{
+  s32_t diff = (s32_t)(deadline - tcp_ticks);
+
+  if (diff < 1) {
+    /* expired: run right away, but don't spin on a deadline that stays */
+    diff = 1;
+  }
+  return LWIP_MIN(timeout, (u32_t)diff);
+}
+
+/**
+ * Calculates when tcp_tmr() next has work to do for a pcb: the earliest of
+ * its armed timers. Mirrors the conditions checked in tcp_slowtmr() and
+ * tcp_fasttmr().
+ *
+ * @param pcb the tcp_pcb on tcp_active_pcbs or tcp_tw_pcbs
+ * @return milliseconds from now, TCP_TMR_NONE if no timer is armed
+ */
+u32_t
+tcp_pcb_timeout(struct tcp_pcb *pcb)
+{
+  u32_t timeout = TCP_TMR_NONE;
+  u8_t polltmr;
+
+  if (pcb->state == TIME_WAIT) {
+    return tcp_timeout_min(timeout, pcb->tmr + 2 * TCP_MSL + 1);
+  }
+  if (pcb->state <= LISTEN) {
+    return timeout;
+  }
+
+  if (pcb->persist_backoff > 0) {
+    timeout = tcp_timeout_min(timeout, pcb->persist_cnt + TCP_PERSIST_TMO(pcb));
+  } else if (pcb->unacked != NULL && TCP_RTIMER_RUNNING(pcb)) {
+    timeout = tcp_timeout_min(timeout, pcb->rtime_start + (u32_t)pcb->rto);
+#if LWIP_TCP_RACK
+    if (pcb->flags & (TF_RACK_REO | TF_TLP_PTO)) {
+      timeout = tcp_timeout_min(timeout, pcb->rack_tmr);
+    }
+#endif /* LWIP_TCP_RACK */
+  }
+  if (pcb->flags & TF_ACK_DELAY) {
+    timeout = tcp_timeout_min(timeout, pcb->ack_time + TCP_ACK_DELAY);
+  }
+  if (pcb->refused_data != NULL) {
+    timeout = tcp_timeout_min(timeout, tcp_ticks + TCP_FAST_INTERVAL);
+  }
+  if ((pcb->so_options & SOF_KEEPALIVE) &&
+      ((pcb->state == ESTABLISHED) || (pcb->state == CLOSE_WAIT))) {
+#if LWIP_TCP_KEEPALIVE
+    timeout = tcp_timeout_min(timeout, pcb->tmr + pcb->keep_idle +
+      pcb->keep_cnt_sent * pcb->keep_intvl + 1);
+#else /* LWIP_TCP_KEEPALIVE */
+    timeout = tcp_timeout_min(timeout, pcb->tmr + pcb->keep_idle +
+      pcb->keep_cnt_sent * TCP_KEEPINTVL_DEFAULT + 1);
+#endif /* LWIP_TCP_KEEPALIVE */
+  }
+  if (pcb->state == FIN_WAIT_2) {
+    timeout = tcp_timeout_min(timeout, pcb->tmr + TCP_FIN_WAIT_TIMEOUT + 1);
+  } else if (pcb->state == SYN_RCVD) {
+    timeout = tcp_timeout_min(timeout, pcb->tmr + TCP_SYN_RCVD_TIMEOUT + 1);
+  } else if (pcb->state == LAST_ACK) {
+    timeout = tcp_timeout_min(timeout, pcb->tmr + 2 * TCP_MSL + 1);
+  }
+#if TCP_QUEUE_OOSEQ
+  if (pcb->ooseq != NULL) {
+    timeout = tcp_timeout_min(timeout, pcb->tmr + (u32_t)pcb->rto * TCP_OOSEQ_TIMEOUT);
+  }
+#endif /* TCP_QUEUE_OOSEQ */
+
+  /* The poll timer only matters if there is someone to poll or if data
+     waits to be sent: tcp_slowtmr() calls tcp_output() after polling */
+#if LWIP_CALLBACK_API
+  if ((pcb->poll != NULL) || (pcb->unsent != NULL) || (pcb->flags & TF_NAGLEMEMERR))
+#endif /* LWIP_CALLBACK_API */
+  {
+    polltmr = (pcb->pollinterval > pcb->polltmr) ? pcb->pollinterval - pcb->polltmr : 1;
+    timeout = tcp_timeout_min(timeout, tcp_poll_time + (u32_t)polltmr * TCP_SLOW_INTERVAL);
+  }
+  return timeout;
+}
+
+/**
+ * Calculates when tcp_tmr() next has work to do, for the TCP timer in
+ * timers.c to sleep until then.
+ *
+ * @return milliseconds from now, TCP_TMR_NONE if no timer is armed
+ */
+u32_t
+tcp_next_timeout(void)
+{
+  struct tcp_pcb *pcb;
+  u32_t timeout = TCP_TMR_NONE;
+
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    timeout = LWIP_MIN(timeout, tcp_pcb_timeout(pcb));
+  }
+  for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+    timeout = LWIP_MIN(timeout, tcp_pcb_timeout(pcb));
+  }
+  return timeout;
+}
+#endif /* LWIP_TCP_TIMERS_MS */
+
 /**
  * Deallocates a list of TCP segments (tcp_seg structures).
  *
@@ -1178,6 +1387,70 @@ tcp_kill_timewait(void)
   }
 }
 
+#if LWIP_RECLAIM
+/**
+ * Reclaim handler: kills the oldest connection in TIME_WAIT state when
+ * tcp_pcbs are short.
+ */
+u8_t
+tcp_reclaim_timewait(reclaim_src_t src, void *arg)
+{
+  LWIP_UNUSED_ARG(arg);
+  if ((src != MEMP_TCP_PCB) || (tcp_tw_pcbs == NULL)) {
+    return 0;
+  }
+  tcp_kill_timewait();
+  return 1;
+}
+
+#if TCP_QUEUE_OOSEQ
+/**
+ * Reclaim handler: drops the last out-of-sequence segment of the connection
+ * with the longest ooseq queue (the sender retransmits it).
+ */
+u8_t
+tcp_reclaim_ooseq(reclaim_src_t src, void *arg)
+{
+  struct tcp_pcb *pcb, *victim;
+  struct tcp_seg *seg, *prev;
+  u32_t len, victim_len;
+
+  LWIP_UNUSED_ARG(arg);
+  if (!RECLAIM_SRC_IS_PBUF(src) && (src != MEMP_TCP_SEG)) {
+    return 0;
+  }
+  victim = NULL;
+  victim_len = 0;
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    len = 0;
+    for (seg = pcb->ooseq; seg != NULL; seg = seg->next) {
+      len += seg->len;
+    }
+    if ((pcb->ooseq != NULL) && (len >= victim_len)) {
+      victim = pcb;
+      victim_len = len;
+    }
+  }
+  if (victim == NULL) {
+    return 0;
+  }
+  prev = NULL;
+  for (seg = victim->ooseq; seg->next != NULL; seg = seg->next) {
+    prev = seg;
+  }
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_reclaim_ooseq: dropping ooseq segment %"U32_F" of PCB %p\n",
+    ntohl(seg->tcphdr->seqno), (void *)victim));
+  if (prev == NULL) {
+    victim->ooseq = NULL;
+  } else {
+    prev->next = NULL;
+  }
+  tcp_seg_free(seg);
+  return 1;
+}
+#endif /* TCP_QUEUE_OOSEQ */
+#endif /* LWIP_RECLAIM */
+
 /**
  * Allocate a new tcp_pcb structure.
  *
@@ -1218,24 +1491,40 @@ tcp_alloc(u8_t prio)
     pcb->prio = prio;
     pcb->snd_buf = TCP_SND_BUF;
     pcb->snd_queuelen = 0;
-    pcb->rcv_wnd = TCP_WND;
-    pcb->rcv_ann_wnd = TCP_WND;
+    pcb->rcv_wnd = TCPWND16(TCP_WND);
+    pcb->rcv_ann_wnd = TCPWND16(TCP_WND);
     pcb->tos = 0;
     pcb->ttl = TCP_TTL;
     /* As initial send MSS, we use TCP_MSS but limit it to 536.
        The send MSS is updated when an MSS option is received. */
     pcb->mss = (TCP_MSS > 536) ? 536 : TCP_MSS;
-    pcb->rto = 3000 / TCP_SLOW_INTERVAL;
+    pcb->rto = 3000 / TCP_TICK_MS;
     pcb->sa = 0;
-    pcb->sv = 3000 / TCP_SLOW_INTERVAL;
-    pcb->rtime = -1;
+    /* TCP_RTO_CALC() gives the same 3 s until the first measurement; with
+       slow timer ticks, it adds one tick for the timer phase */
+#if LWIP_TCP_TIMERS_MS
+    pcb->sv = 3000;
+#else /* LWIP_TCP_TIMERS_MS */
+    pcb->sv = 3000 - TCP_SLOW_INTERVAL;
+#endif /* LWIP_TCP_TIMERS_MS */
+    TCP_RTIMER_STOP(pcb);
     pcb->cwnd = 1;
+#if LWIP_TCP_CC
+    pcb->cc_ops = TCP_CC_DEFAULT;
+#endif /* LWIP_TCP_CC */
     iss = tcp_next_iss();
     pcb->snd_wl2 = iss;
     pcb->snd_nxt = iss;
     pcb->lastack = iss;
     pcb->snd_lbb = iss;   
+#if LWIP_TCP_CC
+    /* TCP_FR_ALLOWED() compares it with lastack: start out there */
+    pcb->recover = iss;
+#endif /* LWIP_TCP_CC */
     pcb->tmr = tcp_ticks;
+#if LWIP_TCP_RACK
+    pcb->rack_xmit_time = tcp_ticks;
+#endif /* LWIP_TCP_RACK */
 
     pcb->polltmr = 0;
 
@@ -1359,6 +1648,7 @@ tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval)
   LWIP_UNUSED_ARG(poll);
 #endif /* LWIP_CALLBACK_API */  
   pcb->pollinterval = interval;
+  TCP_TIMER_PCB(pcb);
 }
 
 /**
@@ -1418,7 +1708,7 @@ tcp_pcb_purge(struct tcp_pcb *pcb)
 
     /* Stop the retransmission timer as it will expect data on unacked
        queue if it fires */
-    pcb->rtime = -1;
+    TCP_RTIMER_STOP(pcb);
 
     tcp_segs_free(pcb->unsent);
     tcp_segs_free(pcb->unacked);
@@ -1463,6 +1753,91 @@ tcp_pcb_remove(struct tcp_pcb **pcblist, struct tcp_pcb *pcb)
   LWIP_ASSERT("tcp_pcb_remove: tcp_pcbs_sane()", tcp_pcbs_sane());
 }
 
+#if TCP_PCB_HASH
+/**
+ * Calculates the bucket of a connection in tcp_active_hash/tcp_tw_hash.
+ *
+ * @param local_ip local IP address of the connection
+ * @param local_port local port (host byte order)
+ * @param remote_ip remote IP address of the connection
+ * @param remote_port remote port (host byte order)
+ * @return bucket index (0..TCP_PCB_HASH_SIZE-1)
+ */
+u16_t
+tcp_pcb_hash(ip_addr_t *local_ip, u16_t local_port,
+             ip_addr_t *remote_ip, u16_t remote_port)
+{
+  u32_t h;
+
+  h = ip4_addr_get_u32(local_ip) ^ ip4_addr_get_u32(remote_ip) ^
+      (((u32_t)local_port << 16) | remote_port);
+  /* fold all bits into the low ones used as index: connections from one
+     host usually only differ in a few bits of the remote port */
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return (u16_t)(h & (TCP_PCB_HASH_SIZE - 1));
+}
+
+/** Returns the hash bucket a pcb registered in pcbs belongs to or NULL
+ * if pcbs is not a hashed list (tcp_bound_pcbs). */
+static struct tcp_pcb **
+tcp_hash_bucket(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_active_pcbs) {
+    return &tcp_active_hash[tcp_pcb_hash(&pcb->local_ip, pcb->local_port,
+                                         &pcb->remote_ip, pcb->remote_port)];
+  } else if (pcbs == &tcp_tw_pcbs) {
+    return &tcp_tw_hash[tcp_pcb_hash(&pcb->local_ip, pcb->local_port,
+                                     &pcb->remote_ip, pcb->remote_port)];
+  } else if (pcbs == &tcp_listen_pcbs.pcbs) {
+    return (struct tcp_pcb **)&tcp_listen_hash[TCP_LISTEN_HASH(pcb->local_port)];
+  }
+  return NULL;
+}
+
+/**
+ * Adds a pcb that has just been registered in a pcb list to the hash table
+ * of that list (called by TCP_REG).
+ *
+ * @param pcbs the pcb list npcb was added to
+ * @param npcb the pcb to add
+ */
+void
+tcp_hash_reg(struct tcp_pcb **pcbs, struct tcp_pcb *npcb)
+{
+  struct tcp_pcb **bucket = tcp_hash_bucket(pcbs, npcb);
+
+  if (bucket != NULL) {
+    npcb->hash_next = *bucket;
+    *bucket = npcb;
+  }
+}
+
+/**
+ * Removes a pcb that has just been removed from a pcb list from the hash
+ * table of that list (called by TCP_RMV).
+ *
+ * @param pcbs the pcb list npcb was removed from
+ * @param npcb the pcb to remove
+ */
+void
+tcp_hash_rmv(struct tcp_pcb **pcbs, struct tcp_pcb *npcb)
+{
+  struct tcp_pcb **bucket = tcp_hash_bucket(pcbs, npcb);
+
+  if (bucket != NULL) {
+    for (; *bucket != NULL; bucket = &(*bucket)->hash_next) {
+      if (*bucket == npcb) {
+        *bucket = npcb->hash_next;
+        break;
+      }
+    }
+    npcb->hash_next = NULL;
+  }
+}
+#endif /* TCP_PCB_HASH */
+
 /**
  * Calculates a new initial sequence number for new connections.
  *
@@ -1477,6 +1852,124 @@ tcp_next_iss(void)
   return iss;
 }
 
+#if TCP_SYNCOOKIES
+/** A cookie ISS is laid out as 5 bits of timestamp, 25 bits of hash and
+ * 2 bits of MSS index. The timestamp counts periods of 64 seconds and a
+ * cookie is accepted in the period it was issued in and the next one. */
+#define TCP_SYNCOOKIE_PERIOD     (64000 / TCP_TICK_MS)
+#define TCP_SYNCOOKIE_MAX_AGE    1
+#define TCP_SYNCOOKIE_HASH_MASK  0x07fffffcUL
+
+/** The MSS values a cookie can encode */
+static const u16_t tcp_syncookie_mss[] = { 536, 1300, 1440, 1460 };
+#define TCP_SYNCOOKIE_NUM_MSS    (sizeof(tcp_syncookie_mss) / sizeof(tcp_syncookie_mss[0]))
+
+static u32_t tcp_syncookie_secret;
+
+/**
+ * Keyed hash over a connection's 4-tuple, the peer's ISS and the cookie's
+ * timestamp and MSS index. This is no cryptographic MAC, but the key is
+ * random so an off-path attacker has to guess the 25 bits that are used.
+ */
+static u32_t
+tcp_syncookie_hash(ip_addr_t *local_ip, u16_t local_port,
+                   ip_addr_t *remote_ip, u16_t remote_port,
+                   u32_t peer_iss, u32_t count_idx)
+{
+  u32_t w[5];
+  u32_t h = tcp_syncookie_secret;
+  u8_t i;
+
+  w[0] = ip4_addr_get_u32(local_ip);
+  w[1] = ip4_addr_get_u32(remote_ip);
+  w[2] = ((u32_t)local_port << 16) | remote_port;
+  w[3] = peer_iss;
+  w[4] = count_idx;
+  for (i = 0; i < 5; i++) {
+    h ^= w[i];
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+  }
+  h ^= h >> 16;
+  return h;
+}
+
+/**
+ * Calculates the ISS of a SYN|ACK that answers a SYN without creating a pcb
+ * for it. tcp_syncookie_check() recovers the MSS from the ISS when the final
+ * ACK of the handshake comes back.
+ *
+ * @param local_ip local address the SYN was sent to
+ * @param local_port local port the SYN was sent to
+ * @param remote_ip address the SYN came from
+ * @param remote_port port the SYN came from
+ * @param peer_iss sequence number of the SYN
+ * @param mss MSS announced in the SYN
+ * @return the ISS to send in the SYN|ACK
+ */
+u32_t
+tcp_syncookie_iss(ip_addr_t *local_ip, u16_t local_port,
+                  ip_addr_t *remote_ip, u16_t remote_port,
+                  u32_t peer_iss, u16_t mss)
+{
+  u32_t count;
+  u8_t idx;
+
+  if (tcp_syncookie_secret == 0) {
+    tcp_syncookie_secret = os_random();
+  }
+  /* encode the largest MSS that does not exceed the peer's */
+  for (idx = TCP_SYNCOOKIE_NUM_MSS - 1; idx > 0; idx--) {
+    if (tcp_syncookie_mss[idx] <= mss) {
+      break;
+    }
+  }
+  count = tcp_ticks / TCP_SYNCOOKIE_PERIOD;
+  return (count << 27) |
+    (tcp_syncookie_hash(local_ip, local_port, remote_ip, remote_port,
+                        peer_iss, (count << 2) | idx) & TCP_SYNCOOKIE_HASH_MASK) |
+    idx;
+}
+
+/**
+ * Checks whether the ACK of a handshake acknowledges a SYN|ACK sent with a
+ * SYN cookie (see tcp_syncookie_iss()).
+ *
+ * @param local_ip local address the ACK was sent to
+ * @param local_port local port the ACK was sent to
+ * @param remote_ip address the ACK came from
+ * @param remote_port port the ACK came from
+ * @param peer_iss sequence number of the ACK minus one
+ * @param iss acknowledgement number of the ACK minus one
+ * @return the MSS encoded in the cookie, 0 if the cookie is invalid or expired
+ */
+u16_t
+tcp_syncookie_check(ip_addr_t *local_ip, u16_t local_port,
+                    ip_addr_t *remote_ip, u16_t remote_port,
+                    u32_t peer_iss, u32_t iss)
+{
+  u32_t count, age;
+  u8_t idx = (u8_t)(iss & 3);
+
+  if (tcp_syncookie_secret == 0) {
+    /* no cookie has been sent yet */
+    return 0;
+  }
+  count = tcp_ticks / TCP_SYNCOOKIE_PERIOD;
+  age = (count - (iss >> 27)) & 0x1f;
+  if (age > TCP_SYNCOOKIE_MAX_AGE) {
+    return 0;
+  }
+  count -= age;
+  if ((tcp_syncookie_hash(local_ip, local_port, remote_ip, remote_port,
+                          peer_iss, (count << 2) | idx) & TCP_SYNCOOKIE_HASH_MASK) !=
+      (iss & TCP_SYNCOOKIE_HASH_MASK)) {
+    return 0;
+  }
+  return tcp_syncookie_mss[idx];
+}
+#endif /* TCP_SYNCOOKIES */
+
 #if TCP_CALCULATE_EFF_SEND_MSS
 /**
  * Calcluates the effective send mss that can be used for a specific IP address
@@ -1631,14 +2124,23 @@ s16_t
 tcp_pcbs_sane(void)
 {
   struct tcp_pcb *pcb;
+  u16_t active = 0, syn_rcvd = 0, time_wait = 0;
   for(pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
     LWIP_ASSERT("tcp_pcbs_sane: active pcb->state != CLOSED", pcb->state != CLOSED);
     LWIP_ASSERT("tcp_pcbs_sane: active pcb->state != LISTEN", pcb->state != LISTEN);
     LWIP_ASSERT("tcp_pcbs_sane: active pcb->state != TIME-WAIT", pcb->state != TIME_WAIT);
+    active++;
+    if (pcb->state == SYN_RCVD) {
+      syn_rcvd++;
+    }
   }
   for(pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
     LWIP_ASSERT("tcp_pcbs_sane: tw pcb->state == TIME-WAIT", pcb->state == TIME_WAIT);
+    time_wait++;
   }
+  LWIP_ASSERT("tcp_pcbs_sane: tcp_pcb_num.active", tcp_pcb_num.active == active);
+  LWIP_ASSERT("tcp_pcbs_sane: tcp_pcb_num.syn_rcvd", tcp_pcb_num.syn_rcvd == syn_rcvd);
+  LWIP_ASSERT("tcp_pcbs_sane: tcp_pcb_num.time_wait", tcp_pcb_num.time_wait == time_wait);
   return 1;
 }
 #endif /* TCP_DEBUG */
@@ -0,0 +1,433 @@
+/**
+ * @file
+ * TCP congestion control modules: NewReno, CUBIC and a profile for tiny
+ * send buffers
+ *
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP && LWIP_TCP_CC /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/tcp_cc.h"
+#include "lwip/tcp_impl.h"
+#include "lwip/sys.h"
+#include "lwip/def.h"
+
+#include <string.h>
+
+/** Initial window of RFC 3390, also the restart window after idle */
+#define TCP_CC_IW(pcb)      ((tcpwnd_size_t)LWIP_MIN(4 * (pcb)->mss, LWIP_MAX(2 * (pcb)->mss, 4380)))
+/** Data sent but not yet acknowledged (FlightSize of RFC 5681) */
+#define TCP_CC_FLIGHT(pcb)  ((tcpwnd_size_t)((pcb)->snd_nxt - (pcb)->lastack))
+
+/** Index in pcb->cc_priv of the bytes acked in congestion avoidance */
+#define TCP_CC_BYTES_ACKED  0
+
+#if TCP_CC_NEWRENO || TCP_CC_LOWMEM
+/** ssthresh after a loss: half of 'wnd', but at least 2 segments */
+static tcpwnd_size_t
+tcp_cc_half(struct tcp_pcb *pcb, tcpwnd_size_t wnd)
+{
+  return LWIP_MAX(wnd >> 1, (tcpwnd_size_t)(2 * pcb->mss));
+}
+#endif /* TCP_CC_NEWRENO || TCP_CC_LOWMEM */
+
+/**
+ * Reno window growth (RFC 5681, section 3.1): slow start below ssthresh,
+ * then one segment per window of data acknowledged (byte counting).
+ */
+static void
+tcp_cc_reno_ack(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  tcpwnd_size_t new_cwnd;
+
+  if (pcb->cwnd < pcb->ssthresh) {
+    new_cwnd = (tcpwnd_size_t)(pcb->cwnd + LWIP_MIN(acked, pcb->mss));
+    pcb->cc_priv[TCP_CC_BYTES_ACKED] = 0;
+  } else {
+    new_cwnd = pcb->cwnd;
+    pcb->cc_priv[TCP_CC_BYTES_ACKED] += acked;
+    if (pcb->cc_priv[TCP_CC_BYTES_ACKED] >= pcb->cwnd) {
+      pcb->cc_priv[TCP_CC_BYTES_ACKED] -= pcb->cwnd;
+      new_cwnd = (tcpwnd_size_t)(pcb->cwnd + pcb->mss);
+    }
+  }
+  /* don't let the value overflow */
+  if (new_cwnd > pcb->cwnd) {
+    pcb->cwnd = new_cwnd;
+  }
+}
+
+#if TCP_CC_NEWRENO
+static void
+newreno_init(struct tcp_pcb *pcb)
+{
+  pcb->cc_priv[TCP_CC_BYTES_ACKED] = 0;
+}
+
+static void
+newreno_on_loss(struct tcp_pcb *pcb)
+{
+  pcb->ssthresh = tcp_cc_half(pcb, TCP_CC_FLIGHT(pcb));
+  pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
+  pcb->cc_priv[TCP_CC_BYTES_ACKED] = 0;
+}
+
+static void
+newreno_on_rto(struct tcp_pcb *pcb)
+{
+  pcb->ssthresh = tcp_cc_half(pcb, TCP_CC_FLIGHT(pcb));
+  pcb->cwnd = pcb->mss;
+  pcb->cc_priv[TCP_CC_BYTES_ACKED] = 0;
+}
+
+static void
+newreno_on_idle(struct tcp_pcb *pcb)
+{
+  pcb->cwnd = LWIP_MIN(pcb->cwnd, TCP_CC_IW(pcb));
+}
+
+/** RFC 5681 Reno with the RFC 6582 recovery of the core */
+const struct tcp_cc_ops tcp_cc_newreno = {
+  "newreno",
+  newreno_init,
+  tcp_cc_reno_ack,
+  newreno_on_loss,
+  newreno_on_rto,
+  newreno_on_idle
+};
+#endif /* TCP_CC_NEWRENO */
+
+#if TCP_CC_CUBIC
+/* RFC 8312 with beta 0.7 and C 0.4. Time is counted in 1/64 s so that
+   the cubic term fits into 32 bits. */
+#define CUBIC_HZ            64
+/** |t - K| is limited to 16 s, W(t) saturates long before */
+#define CUBIC_MAX_DELTA     (16 * CUBIC_HZ)
+/** limit of the epoch age in ms, beyond K + CUBIC_MAX_DELTA */
+#define CUBIC_MAX_T_MS      60000
+
+struct cubic_state {
+  /** bytes acked since cwnd was last increased, same slot as in Reno */
+  u32_t bytes_acked;
+  /** sys_now() when the current epoch started, 0 if none */
+  u32_t epoch;
+  /** cwnd before the last reduction */
+  u32_t w_max;
+  /** time to get back to w_max, in 1/CUBIC_HZ s */
+  u32_t k;
+  /** cwnd at the plateau of the current curve */
+  u32_t origin;
+  /** cwnd standard TCP would have reached in this epoch */
+  u32_t w_est;
+};
+#define CUBIC(pcb)  ((struct cubic_state *)(void *)(pcb)->cc_priv)
+
+/* compile-time check that the state fits into pcb->cc_priv */
+typedef char cubic_state_size_check[(sizeof(struct cubic_state) <=
+  TCP_CC_PRIV_WORDS * sizeof(u32_t)) ? 1 : -1];
+
+/** Integer cube root (Hacker's Delight, icbrt) */
+static u32_t
+cubic_cbrt(u32_t x)
+{
+  u32_t y = 0, b;
+  s8_t s;
+
+  for (s = 30; s >= 0; s -= 3) {
+    y <<= 1;
+    b = 3 * y * (y + 1) + 1;
+    if ((x >> s) >= b) {
+      x -= b << s;
+      y++;
+    }
+  }
+  return y;
+}
+
+static void
+cubic_init(struct tcp_pcb *pcb)
+{
+  memset(pcb->cc_priv, 0, sizeof(pcb->cc_priv));
+}
+
+/** Start a new epoch at the first ACK after a reduction */
+static void
+cubic_epoch_start(struct tcp_pcb *pcb, struct cubic_state *c)
+{
+  c->epoch = sys_now();
+  if (c->epoch == 0) {
+    c->epoch = 1;
+  }
+  c->bytes_acked = 0;
+  c->w_est = pcb->cwnd;
+  if (pcb->cwnd < c->w_max) {
+    /* K = cbrt((w_max - cwnd) / C), in 1/CUBIC_HZ s */
+    u32_t scale = (CUBIC_HZ * CUBIC_HZ * CUBIC_HZ * 10 / 4) / pcb->mss;
+    u32_t diff = LWIP_MIN(c->w_max - pcb->cwnd, 0xFFFFFFFFUL / scale);
+    c->k = cubic_cbrt(scale * diff);
+    c->origin = c->w_max;
+  } else {
+    c->k = 0;
+    c->origin = pcb->cwnd;
+  }
+}
+
+static void
+cubic_on_ack(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  struct cubic_state *c = CUBIC(pcb);
+  u32_t t, d, delta, target, thresh;
+
+  if (pcb->cwnd < pcb->ssthresh) {
+    tcp_cc_reno_ack(pcb, acked);
+    return;
+  }
+  if (c->epoch == 0) {
+    cubic_epoch_start(pcb, c);
+  }
+
+  /* the curve is evaluated one RTT ahead (RFC 8312, section 4.1) */
+  t = sys_now() - c->epoch;
+  if (pcb->sa > 0) {
+    t += tcp_srtt(pcb);
+  }
+  t = LWIP_MIN(t, CUBIC_MAX_T_MS) * CUBIC_HZ / 1000;
+  d = (t > c->k) ? (t - c->k) : (c->k - t);
+  d = LWIP_MIN(d, CUBIC_MAX_DELTA);
+  /* C * d^3 segments, in 1/1024 segments */
+  delta = d * d * d / (CUBIC_HZ * CUBIC_HZ * CUBIC_HZ * 10 / 4 / 1024);
+  if (delta > 0xFFFFFFFFUL / pcb->mss) {
+    delta = 0xFFFFFFFFUL;
+  } else {
+    delta = (delta * pcb->mss) >> 10;
+  }
+  if (t > c->k) {
+    target = (c->origin + delta >= c->origin) ? (c->origin + delta) : 0xFFFFFFFFUL;
+  } else {
+    target = (c->origin > delta) ? (c->origin - delta) : 0;
+  }
+
+  /* TCP-friendly region: standard TCP grows by 3(1-b)/(1+b) = 9/17 of a
+     segment per window (RFC 8312, section 4.2) */
+  acked = LWIP_MIN(acked, 0xFFFF);
+  c->w_est += ((u32_t)pcb->mss * 9 / 17) * acked / pcb->cwnd;
+  target = LWIP_MAX(target, c->w_est);
+
+  /* grow by (target - cwnd) / cwnd segments per segment acked, at most
+     by half a window per RTT */
+  if (target > pcb->cwnd) {
+    target = LWIP_MIN(target, pcb->cwnd + (pcb->cwnd >> 1));
+    thresh = (pcb->cwnd / (target - pcb->cwnd)) * pcb->mss;
+    c->bytes_acked += acked;
+    while (c->bytes_acked >= thresh) {
+      tcpwnd_size_t new_cwnd = (tcpwnd_size_t)(pcb->cwnd + pcb->mss);
+      if (new_cwnd < pcb->cwnd) {
+        break;
+      }
+      c->bytes_acked -= thresh;
+      pcb->cwnd = new_cwnd;
+    }
+  }
+}
+
+/** Multiplicative decrease with fast convergence (RFC 8312, 4.5 and 4.6) */
+static void
+cubic_reduce(struct tcp_pcb *pcb)
+{
+  struct cubic_state *c = CUBIC(pcb);
+  tcpwnd_size_t wnd = LWIP_MIN(pcb->cwnd, pcb->snd_wnd);
+
+  c->epoch = 0;
+  if (wnd < c->w_max) {
+    /* released bandwidth to newer flows: don't aim as high */
+    c->w_max = wnd / 20 * 17;
+  } else {
+    c->w_max = wnd;
+  }
+  pcb->ssthresh = LWIP_MAX(wnd / 10 * 7, (tcpwnd_size_t)(2 * pcb->mss));
+}
+
+static void
+cubic_on_loss(struct tcp_pcb *pcb)
+{
+  cubic_reduce(pcb);
+  pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
+}
+
+static void
+cubic_on_rto(struct tcp_pcb *pcb)
+{
+  cubic_reduce(pcb);
+  pcb->cwnd = pcb->mss;
+}
+
+static void
+cubic_on_idle(struct tcp_pcb *pcb)
+{
+  CUBIC(pcb)->epoch = 0;
+  pcb->cwnd = LWIP_MIN(pcb->cwnd, TCP_CC_IW(pcb));
+}
+
+/** RFC 8312 CUBIC */
+const struct tcp_cc_ops tcp_cc_cubic = {
+  "cubic",
+  cubic_init,
+  cubic_on_ack,
+  cubic_on_loss,
+  cubic_on_rto,
+  cubic_on_idle
+};
+#endif /* TCP_CC_CUBIC */
+
+#if TCP_CC_LOWMEM
+/* With only a few segments of TCP_SND_BUF, a larger cwnd can never be
+   used and would only delay the reaction to the next loss. */
+#define LOWMEM_IW(pcb)  ((tcpwnd_size_t)LWIP_MIN(2 * (pcb)->mss, TCP_SND_BUF))
+
+static void
+lowmem_init(struct tcp_pcb *pcb)
+{
+  pcb->cc_priv[TCP_CC_BYTES_ACKED] = 0;
+  pcb->cwnd = LWIP_MIN(pcb->cwnd, LOWMEM_IW(pcb));
+  pcb->ssthresh = LWIP_MIN(pcb->ssthresh, TCP_SND_BUF);
+}
+
+static void
+lowmem_on_ack(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  tcp_cc_reno_ack(pcb, acked);
+  pcb->cwnd = LWIP_MIN(pcb->cwnd, TCP_SND_BUF);
+}
+
+static void
+lowmem_on_loss(struct tcp_pcb *pcb)
+{
+  pcb->ssthresh = tcp_cc_half(pcb, TCP_CC_FLIGHT(pcb));
+  /* inflate by one segment only: the dupacks hardly free any buffer */
+  pcb->cwnd = pcb->ssthresh + pcb->mss;
+  pcb->cc_priv[TCP_CC_BYTES_ACKED] = 0;
+}
+
+static void
+lowmem_on_rto(struct tcp_pcb *pcb)
+{
+  pcb->ssthresh = tcp_cc_half(pcb, TCP_CC_FLIGHT(pcb));
+  pcb->cwnd = pcb->mss;
+  pcb->cc_priv[TCP_CC_BYTES_ACKED] = 0;
+}
+
+static void
+lowmem_on_idle(struct tcp_pcb *pcb)
+{
+  pcb->cwnd = LWIP_MIN(pcb->cwnd, LOWMEM_IW(pcb));
+}
+
+/** Conservative Reno for devices with a TCP_SND_BUF of a few segments */
+const struct tcp_cc_ops tcp_cc_lowmem = {
+  "lowmem",
+  lowmem_init,
+  lowmem_on_ack,
+  lowmem_on_loss,
+  lowmem_on_rto,
+  lowmem_on_idle
+};
+#endif /* TCP_CC_LOWMEM */
+
+/** The modules that can be found by name */
+static const struct tcp_cc_ops *const tcp_cc_modules[] = {
+#if TCP_CC_NEWRENO
+  &tcp_cc_newreno,
+#endif /* TCP_CC_NEWRENO */
+#if TCP_CC_CUBIC
+  &tcp_cc_cubic,
+#endif /* TCP_CC_CUBIC */
+#if TCP_CC_LOWMEM
+  &tcp_cc_lowmem,
+#endif /* TCP_CC_LOWMEM */
+};
+
+/**
+ * Select the congestion control of a pcb. On a listening pcb, it is
+ * inherited by the accepted connections; on an established connection,
+ * the new algorithm starts from the current cwnd and ssthresh.
+ *
+ * @param pcb the tcp_pcb to change
+ * @param ops the algorithm, e.g. &tcp_cc_newreno or from tcp_cc_find()
+ * @return ERR_OK or ERR_ARG if ops is NULL
+ */
+err_t
+tcp_set_cc(struct tcp_pcb *pcb, const struct tcp_cc_ops *ops)
+{
+  LWIP_ERROR("tcp_set_cc: invalid ops", ops != NULL, return ERR_ARG;);
+
+  pcb->cc_ops = ops;
+  if (pcb->state >= ESTABLISHED) {
+    ops->init(pcb);
+  }
+  return ERR_OK;
+}
+
+/**
+ * Find a congestion control algorithm that is compiled in by its name.
+ *
+ * @param name "newreno", "cubic" or "lowmem"
+ * @return the algorithm or NULL if it is not available
+ */
+const struct tcp_cc_ops *
+tcp_cc_find(const char *name)
+{
+  u8_t i;
+
+  for (i = 0; i < sizeof(tcp_cc_modules) / sizeof(tcp_cc_modules[0]); i++) {
+    if (strcmp(tcp_cc_modules[i]->name, name) == 0) {
+      return tcp_cc_modules[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Called by the core when a connection becomes established, after the
+ * initial cwnd is set.
+ */
+void
+tcp_cc_established(struct tcp_pcb *pcb)
+{
+  /* no recovery before the first loss */
+  pcb->recover = pcb->lastack;
+  /* slow start until the first loss (RFC 5681, section 3.1: ssthresh
+     starts arbitrarily high) */
+  pcb->ssthresh = (tcpwnd_size_t)~0;
+  pcb->cc_ops->init(pcb);
+}
+
+#endif /* LWIP_TCP && LWIP_TCP_CC */
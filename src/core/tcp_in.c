@@ -46,6 +46,7 @@
 #if LWIP_TCP /* don't build if not configured for use in lwipopts.h */
 
 #include "lwip/tcp_impl.h"
+#include "lwip/tcp_cc.h"
 #include "lwip/def.h"
 #include "lwip/ip_addr.h"
 #include "lwip/netif.h"
@@ -54,7 +55,7 @@
 #include "lwip/inet_chksum.h"
 #include "lwip/stats.h"
 #include "lwip/snmp.h"
-#include "arch/perf.h"
+#include "lwip/perf.h"
 
 /* These variables are global to all functions involved in the input
    processing of TCP segments. They are set by the tcp_input()
@@ -69,14 +70,39 @@ static u16_t tcplen;
 static u8_t recv_flags;
 static struct pbuf *recv_data;
 
+#if LWIP_TCP_TIMESTAMPS
+/* The timestamp option of the current segment, valid if ts_seen is set */
+static u8_t ts_seen;
+static u32_t ts_val, ts_ecr;
+#endif /* LWIP_TCP_TIMESTAMPS */
+
+#if LWIP_TCP_SACK
+/* The SACK option of the current segment, if sack_opt != NULL. Its blocks
+   are only applied by tcp_sack_input() once the segment passed PAWS. */
+static u8_t *sack_opt;
+#endif /* LWIP_TCP_SACK */
+
 struct tcp_pcb *tcp_input_pcb;
 
 /* Forward declarations. */
 static err_t tcp_process(struct tcp_pcb *pcb);
 static void tcp_receive(struct tcp_pcb *pcb);
-static void tcp_parseopt(struct tcp_pcb *pcb);
+static u16_t tcp_parseopt(struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK
+static void tcp_sack_input(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK */
+static void tcp_rtt_update(struct tcp_pcb *pcb, u32_t m, u32_t samples);
+#if LWIP_TCP_TIMESTAMPS
+static u8_t tcp_rtt_ts_sample(struct tcp_pcb *pcb, u32_t samples);
+#endif /* LWIP_TCP_TIMESTAMPS */
+#if LWIP_TCP_RACK
+static void tcp_rack_update(struct tcp_pcb *pcb, struct tcp_seg *seg);
+#endif /* LWIP_TCP_RACK */
 
 static err_t tcp_listen_input(struct tcp_pcb_listen *pcb);
+#if TCP_SYNCOOKIES
+static u8_t tcp_syncookie_input(struct tcp_pcb_listen *lpcb, struct tcp_pcb **npcb);
+#endif /* TCP_SYNCOOKIES */
 static err_t tcp_timewait_input(struct tcp_pcb *pcb);
 
 /**
@@ -134,20 +160,22 @@ tcp_input(struct pbuf *p, struct netif *inp)
   }
 
 #if CHECKSUM_CHECK_TCP
-  /* Verify TCP checksum. */
-  if (inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
-      IP_PROTO_TCP, p->tot_len) != 0) {
-      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packet discarded due to failing checksum 0x%04"X16_F"\n",
-        inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
-      IP_PROTO_TCP, p->tot_len)));
+  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
+    /* Verify TCP checksum. */
+    if (inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
+        IP_PROTO_TCP, p->tot_len) != 0) {
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packet discarded due to failing checksum 0x%04"X16_F"\n",
+          inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
+        IP_PROTO_TCP, p->tot_len)));
 #if TCP_DEBUG
-    tcp_debug_print(tcphdr);
+      tcp_debug_print(tcphdr);
 #endif /* TCP_DEBUG */
-    TCP_STATS_INC(tcp.chkerr);
-    TCP_STATS_INC(tcp.drop);
-    snmp_inc_tcpinerrs();
-    pbuf_free(p);
-    return;
+      TCP_STATS_INC(tcp.chkerr);
+      TCP_STATS_INC(tcp.drop);
+      snmp_inc_tcpinerrs();
+      pbuf_free(p);
+      return;
+    }
   }
 #endif
 
@@ -178,8 +206,13 @@ tcp_input(struct pbuf *p, struct netif *inp)
      for an active connection. */
   prev = NULL;
 
-  
+#if TCP_PCB_HASH
+  for(pcb = tcp_active_hash[tcp_pcb_hash(&current_iphdr_dest, tcphdr->dest,
+                                         &current_iphdr_src, tcphdr->src)];
+      pcb != NULL; pcb = pcb->hash_next) {
+#else /* TCP_PCB_HASH */
   for(pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+#endif /* TCP_PCB_HASH */
     LWIP_ASSERT("tcp_input: active pcb->state != CLOSED", pcb->state != CLOSED);
     LWIP_ASSERT("tcp_input: active pcb->state != TIME-WAIT", pcb->state != TIME_WAIT);
     LWIP_ASSERT("tcp_input: active pcb->state != LISTEN", pcb->state != LISTEN);
@@ -188,6 +221,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
        ip_addr_cmp(&(pcb->remote_ip), &current_iphdr_src) &&
        ip_addr_cmp(&(pcb->local_ip), &current_iphdr_dest)) {
 
+#if !TCP_PCB_HASH
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
          arrivals). */
@@ -198,6 +232,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
         tcp_active_pcbs = pcb;
       }
       LWIP_ASSERT("tcp_input: pcb->next != pcb (after cache)", pcb->next != pcb);
+#endif /* !TCP_PCB_HASH */
       break;
     }
     prev = pcb;
@@ -206,7 +241,13 @@ tcp_input(struct pbuf *p, struct netif *inp)
   if (pcb == NULL) {
     /* If it did not go to an active connection, we check the connections
        in the TIME-WAIT state. */
+#if TCP_PCB_HASH
+    for(pcb = tcp_tw_hash[tcp_pcb_hash(&current_iphdr_dest, tcphdr->dest,
+                                       &current_iphdr_src, tcphdr->src)];
+        pcb != NULL; pcb = pcb->hash_next) {
+#else /* TCP_PCB_HASH */
     for(pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+#endif /* TCP_PCB_HASH */
       LWIP_ASSERT("tcp_input: TIME-WAIT pcb->state == TIME-WAIT", pcb->state == TIME_WAIT);
       if (pcb->remote_port == tcphdr->src &&
          pcb->local_port == tcphdr->dest &&
@@ -225,7 +266,11 @@ tcp_input(struct pbuf *p, struct netif *inp)
     /* Finally, if we still did not get a match, we check all PCBs that
        are LISTENing for incoming connections. */
     prev = NULL;
+#if TCP_PCB_HASH
+    for(lpcb = tcp_listen_hash[TCP_LISTEN_HASH(tcphdr->dest)]; lpcb != NULL; lpcb = lpcb->hash_next) {
+#else /* TCP_PCB_HASH */
     for(lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
+#endif /* TCP_PCB_HASH */
       if (lpcb->local_port == tcphdr->dest) {
 #if SO_REUSE
         if (ip_addr_cmp(&(lpcb->local_ip), &current_iphdr_dest)) {
@@ -255,6 +300,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
     }
 #endif /* SO_REUSE */
     if (lpcb != NULL) {
+#if !TCP_PCB_HASH
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
          arrivals). */
@@ -265,11 +311,26 @@ tcp_input(struct pbuf *p, struct netif *inp)
               /* put this listening pcb at the head of the listening list */
         tcp_listen_pcbs.listen_pcbs = lpcb;
       }
+#else /* !TCP_PCB_HASH */
+      LWIP_UNUSED_ARG(prev);
+#endif /* !TCP_PCB_HASH */
     
-      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
-      tcp_listen_input(lpcb);
-      pbuf_free(p);
-      return;
+#if TCP_SYNCOOKIES
+      if (tcp_syncookie_input(lpcb, &pcb)) {
+        /* The final ACK of a handshake answered with a SYN cookie: if it
+           got a pcb, process it below as if the pcb had been in SYN_RCVD. */
+        if (pcb == NULL) {
+          pbuf_free(p);
+          return;
+        }
+      } else
+#endif /* TCP_SYNCOOKIES */
+      {
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
+        tcp_listen_input(lpcb);
+        pbuf_free(p);
+        return;
+      }
     }
   }
 
@@ -299,9 +360,29 @@ tcp_input(struct pbuf *p, struct netif *inp)
 
     /* If there is data which was previously "refused" by upper layer */
     if (pcb->refused_data != NULL) {
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+      struct pbuf *rest;
+      /* more than 64 KiB may have been refused, see below */
+      pbuf_split_64k(pcb->refused_data, &rest);
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
       /* Notify again application with data previously received. */
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: notify kept packet\n"));
       TCP_EVENT_RECV(pcb, pcb->refused_data, ERR_OK, err);
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+      if (err == ERR_ABRT) {
+        if (rest != NULL) {
+          pbuf_free(rest);
+        }
+      } else if (rest != NULL) {
+        if (err == ERR_OK) {
+          pcb->refused_data = rest;
+          /* not all of it was taken: same as refused */
+          err = ERR_WOULDBLOCK;
+        } else {
+          pbuf_cat(pcb->refused_data, rest);
+        }
+      }
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
       if (err == ERR_OK) {
         pcb->refused_data = NULL;
       } else if ((err == ERR_ABRT) || (tcplen > 0)) {
@@ -345,13 +426,30 @@ tcp_input(struct pbuf *p, struct netif *inp)
            called when new send buffer space is available, we call it
            now. */
         if (pcb->acked > 0) {
+#if LWIP_WND_SCALE
+          /* pcb->acked is u32_t but the sent callback only takes a u16_t,
+             so we might have to call it multiple times. */
+          tcpwnd_size_t acked = pcb->acked;
+          while (acked > 0) {
+            u16_t acked16 = (u16_t)LWIP_MIN(acked, 0xffffu);
+            acked -= acked16;
+            TCP_EVENT_SENT(pcb, acked16, err);
+            if (err == ERR_ABRT) {
+              goto aborted;
+            }
+          }
+#else /* LWIP_WND_SCALE */
           TCP_EVENT_SENT(pcb, pcb->acked, err);
           if (err == ERR_ABRT) {
             goto aborted;
           }
+#endif /* LWIP_WND_SCALE */
         }
 
         if (recv_data != NULL) {
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+          struct pbuf *rest = NULL;
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
           LWIP_ASSERT("pcb->refused_data == NULL", pcb->refused_data == NULL);
           if (pcb->flags & TF_RXCLOSED) {
             /* received data although already closed -> abort (send RST) to
@@ -364,17 +462,40 @@ tcp_input(struct pbuf *p, struct netif *inp)
             recv_data->flags |= PBUF_FLAG_PUSH;
           }
 
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+          /* with the ooseq data appended, recv_data may hold more than
+             tot_len can count: pass it up in pieces below 64 KiB */
+          do {
+            pbuf_split_64k(recv_data, &rest);
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
           /* Notify application that data has been received. */
           TCP_EVENT_RECV(pcb, recv_data, ERR_OK, err);
           if (err == ERR_ABRT) {
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+            if (rest != NULL) {
+              pbuf_free(rest);
+            }
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
             goto aborted;
           }
 
           /* If the upper layer can't receive this data, store it */
           if (err != ERR_OK) {
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+            if (rest != NULL) {
+              pbuf_cat(recv_data, rest);
+            }
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
             pcb->refused_data = recv_data;
             LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: keep incoming packet, because pcb is \"full\"\n"));
+#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+            break;
           }
+          recv_data = rest;
+          } while (recv_data != NULL);
+#else /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+          }
+#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
         }
 
         /* If a FIN segment was received, we call the callback
@@ -382,7 +503,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
         if (recv_flags & TF_GOT_FIN) {
           /* correct rcv_wnd as the application won't call tcp_recved()
              for the FIN's seqno */
-          if (pcb->rcv_wnd != TCP_WND) {
+          if (pcb->rcv_wnd != TCP_WND_MAX(pcb)) {
             pcb->rcv_wnd++;
           }
           TCP_EVENT_CLOSED(pcb, err);
@@ -394,6 +515,8 @@ tcp_input(struct pbuf *p, struct netif *inp)
         tcp_input_pcb = NULL;
         /* Try to send something out. */
         tcp_output(pcb);
+        /* Schedule what this segment armed (delayed ACK, RTO, state timeouts) */
+        TCP_TIMER_PCB(pcb);
 #if TCP_INPUT_DEBUG
 #if TCP_DEBUG
         tcp_debug_print_state(pcb->state);
@@ -418,9 +541,15 @@ aborted:
     #if TCP_QUEUE_OOSEQ
     extern char RxNodeNum(void);
     if (RxNodeNum() < 2) {
+#if LWIP_RECLAIM
+      /* the driver is short of rx buffers: run the handlers now */
+      reclaim_signal(RECLAIM_DRIVER);
+      reclaim_poll();
+#else /* LWIP_RECLAIM */
       extern void pbuf_free_ooseq_new(void* arg);
       //os_printf("reclaim some memory from queued\n");
       pbuf_free_ooseq_new(NULL);
+#endif /* LWIP_RECLAIM */
     }
     #endif
   } else {
@@ -442,6 +571,143 @@ aborted:
   PERF_STOP("tcp_input");
 }
 
+/**
+ * Allocates and registers the pcb for a connection request to a listening
+ * pcb, in state SYN_RCVD. The caller sets up the send sequence numbers.
+ *
+ * @param pcb the tcp_pcb_listen the connection request arrived for
+ * @param rcv_nxt the next sequence number expected from the peer
+ * @return the new pcb or NULL if none could be allocated
+ */
+static struct tcp_pcb *
+tcp_listen_pcb_new(struct tcp_pcb_listen *pcb, u32_t rcv_nxt)
+{
+  struct tcp_pcb *npcb;
+
+  if (tcp_pcb_num.active >= MEMP_NUM_TCP_PCB) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: exceed the number of active TCP connections\n"));
+    TCP_STATS_INC(tcp.memerr);
+    TCP_STATS_INC(tcp_pcbs.active.err);
+    return NULL;
+  }
+
+  npcb = tcp_alloc(pcb->prio);
+  /* If a new PCB could not be created (probably due to lack of memory),
+     we don't do anything, but rely on the sender will retransmit the
+     SYN at a time when we have more memory available. */
+  if (npcb == NULL) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: could not allocate PCB\n"));
+    TCP_STATS_INC(tcp.memerr);
+    return NULL;
+  }
+#if TCP_LISTEN_BACKLOG
+  pcb->accepts_pending++;
+#endif /* TCP_LISTEN_BACKLOG */
+  /* Set up the new PCB. */
+  ip_addr_copy(npcb->local_ip, current_iphdr_dest);
+  npcb->local_port = pcb->local_port;
+  ip_addr_copy(npcb->remote_ip, current_iphdr_src);
+  npcb->remote_port = tcphdr->src;
+  npcb->state = SYN_RCVD;
+  npcb->rcv_nxt = rcv_nxt;
+  npcb->rcv_ann_right_edge = npcb->rcv_nxt;
+  npcb->snd_wnd = tcphdr->wnd;
+  npcb->ssthresh = npcb->snd_wnd;
+  npcb->snd_wl1 = seqno - 1;/* initialise to seqno-1 to force window update */
+  npcb->callback_arg = pcb->callback_arg;
+#if LWIP_TCP_CC
+  npcb->cc_ops = pcb->cc_ops;
+#endif /* LWIP_TCP_CC */
+#if LWIP_CALLBACK_API
+  npcb->accept = pcb->accept;
+#endif /* LWIP_CALLBACK_API */
+  /* inherit socket options */
+  npcb->so_options = pcb->so_options & SOF_INHERITED;
+  /* Register the new PCB so that we can begin receiving segments
+     for it. */
+  TCP_REG(&tcp_active_pcbs, npcb);
+
+  snmp_inc_tcppassiveopens();
+  return npcb;
+}
+
+#if TCP_SYNCOOKIES
+/**
+ * Answers the SYN being processed with a SYN|ACK whose ISS is a SYN cookie,
+ * without allocating a pcb. Called by tcp_listen_input() when too many
+ * connections are half-open or no pcb is available.
+ */
+static void
+tcp_syncookie_reply(void)
+{
+  u16_t mss;
+  u32_t iss;
+
+  mss = tcp_parseopt(NULL);
+  if (mss == 0) {
+    /* RFC 1122: the default MSS if the peer did not announce one */
+    mss = 536;
+  }
+  iss = tcp_syncookie_iss(ip_current_dest_addr(), tcphdr->dest,
+    ip_current_src_addr(), tcphdr->src, seqno, mss);
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: answering SYN with cookie %"U32_F"\n", iss));
+  TCP_STATS_INC(tcp_pcbs.syn_rcvd.err);
+  tcp_synack(iss, seqno + 1, ip_current_dest_addr(), ip_current_src_addr(),
+    tcphdr->dest, tcphdr->src);
+}
+
+/**
+ * Called by tcp_input() for a segment to a listening pcb before
+ * tcp_listen_input(): checks whether the segment is the ACK that completes
+ * a handshake answered with a SYN cookie and if so creates its pcb.
+ *
+ * @param lpcb the tcp_pcb_listen for which a segment arrived
+ * @param npcb receives the new pcb (in SYN_RCVD, with the SYN|ACK
+ *        outstanding) or NULL if the cookie is valid but no pcb could be
+ *        created; the segment should then be dropped, the peer retransmits
+ * @return 1 if the segment carries a valid cookie, 0 if it has to be passed
+ *         to tcp_listen_input()
+ */
+static u8_t
+tcp_syncookie_input(struct tcp_pcb_listen *lpcb, struct tcp_pcb **npcb)
+{
+  u16_t mss;
+
+  if ((flags & (TCP_SYN | TCP_RST | TCP_ACK)) != TCP_ACK) {
+    return 0;
+  }
+  mss = tcp_syncookie_check(ip_current_dest_addr(), tcphdr->dest,
+    ip_current_src_addr(), tcphdr->src, seqno - 1, ackno - 1);
+  if (mss == 0) {
+    return 0;
+  }
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_input: valid SYN cookie %"U32_F"\n", ackno - 1));
+
+  *npcb = NULL;
+#if TCP_LISTEN_BACKLOG
+  if (lpcb->accepts_pending >= lpcb->backlog) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: listen backlog exceeded for port %"U16_F"\n", tcphdr->dest));
+    return 1;
+  }
+#endif /* TCP_LISTEN_BACKLOG */
+  *npcb = tcp_listen_pcb_new(lpcb, seqno);
+  if (*npcb == NULL) {
+    return 1;
+  }
+  /* Recreate the state the SYN|ACK would have left behind */
+  (*npcb)->lastack = ackno - 1;
+  (*npcb)->snd_wl2 = ackno - 1;
+  (*npcb)->snd_nxt = ackno;
+  (*npcb)->snd_lbb = ackno;
+  (*npcb)->snd_buf--;
+  (*npcb)->mss = (mss > TCP_MSS) ? TCP_MSS : mss;
+#if TCP_CALCULATE_EFF_SEND_MSS
+  (*npcb)->mss = tcp_eff_send_mss((*npcb)->mss, &((*npcb)->remote_ip));
+#endif /* TCP_CALCULATE_EFF_SEND_MSS */
+  return 1;
+}
+#endif /* TCP_SYNCOOKIES */
+
 /**
  * Called by tcp_input() when a segment arrives for a listening
  * connection (from tcp_input()).
@@ -458,8 +724,6 @@ static err_t
 tcp_listen_input(struct tcp_pcb_listen *pcb)
 {
   struct tcp_pcb *npcb;
-  struct tcp_pcb *pactive_pcb;
-  u8_t active_pcb_num = 0;
   err_t rc;
 
   /* In the LISTEN state, we check for incoming SYN segments,
@@ -480,46 +744,20 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     }
 #endif /* TCP_LISTEN_BACKLOG */
 
-    for (pactive_pcb = tcp_active_pcbs; pactive_pcb != NULL; pactive_pcb = pactive_pcb->next)
-      active_pcb_num++;
-    if (active_pcb_num >= MEMP_NUM_TCP_PCB) {
-      LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: exceed the number of active TCP connections\n"));
-      TCP_STATS_INC(tcp.memerr);
-      return ERR_MEM;
+#if TCP_SYNCOOKIES
+    if (tcp_pcb_num.syn_rcvd >= TCP_SYNCOOKIE_THRESHOLD) {
+      tcp_syncookie_reply();
+      return ERR_OK;
     }
+#endif /* TCP_SYNCOOKIES */
 
-    npcb = tcp_alloc(pcb->prio);
-    /* If a new PCB could not be created (probably due to lack of memory),
-       we don't do anything, but rely on the sender will retransmit the
-       SYN at a time when we have more memory available. */
+    npcb = tcp_listen_pcb_new(pcb, seqno + 1);
     if (npcb == NULL) {
-      LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: could not allocate PCB\n"));
-      TCP_STATS_INC(tcp.memerr);
+#if TCP_SYNCOOKIES
+      tcp_syncookie_reply();
+#endif /* TCP_SYNCOOKIES */
       return ERR_MEM;
     }
-#if TCP_LISTEN_BACKLOG
-    pcb->accepts_pending++;
-#endif /* TCP_LISTEN_BACKLOG */
-    /* Set up the new PCB. */
-    ip_addr_copy(npcb->local_ip, current_iphdr_dest);
-    npcb->local_port = pcb->local_port;
-    ip_addr_copy(npcb->remote_ip, current_iphdr_src);
-    npcb->remote_port = tcphdr->src;
-    npcb->state = SYN_RCVD;
-    npcb->rcv_nxt = seqno + 1;
-    npcb->rcv_ann_right_edge = npcb->rcv_nxt;
-    npcb->snd_wnd = tcphdr->wnd;
-    npcb->ssthresh = npcb->snd_wnd;
-    npcb->snd_wl1 = seqno - 1;/* initialise to seqno-1 to force window update */
-    npcb->callback_arg = pcb->callback_arg;
-#if LWIP_CALLBACK_API
-    npcb->accept = pcb->accept;
-#endif /* LWIP_CALLBACK_API */
-    /* inherit socket options */
-    npcb->so_options = pcb->so_options & SOF_INHERITED;
-    /* Register the new PCB so that we can begin receiving segments
-       for it. */
-    TCP_REG(&tcp_active_pcbs, npcb);
 
     /* Parse any options in the SYN. */
     tcp_parseopt(npcb);
@@ -527,8 +765,6 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     npcb->mss = tcp_eff_send_mss(npcb->mss, &(npcb->remote_ip));
 #endif /* TCP_CALCULATE_EFF_SEND_MSS */
 
-    snmp_inc_tcppassiveopens();
-
     /* Send a SYN|ACK together with the MSS option. */
     rc = tcp_enqueue_flags(npcb, TCP_SYN | TCP_ACK);
     if (rc != ERR_OK) {
@@ -639,14 +875,44 @@ tcp_process(struct tcp_pcb *pcb)
     return ERR_OK;
   }
   
+  tcp_parseopt(pcb);
+
+#if LWIP_TCP_TIMESTAMPS
+  if ((pcb->flags & TF_TIMESTAMP) && ts_seen && (pcb->state != SYN_SENT)) {
+    /* PAWS (RFC 7323, section 5.3): a timestamp older than the last one
+       seen belongs to an old duplicate, unless that one is stale */
+    if (TCP_SEQ_LT(ts_val, pcb->ts_recent) &&
+        ((u32_t)(sys_now() - pcb->ts_recent_time) < TCP_PAWS_IDLE)) {
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_process: PAWS drop tsval %"U32_F" ts_recent %"U32_F"\n",
+        ts_val, pcb->ts_recent));
+      TCP_STATS_INC(tcp.drop);
+      tcp_ack_now(pcb);
+      return ERR_OK;
+    }
+    /* Only a segment that covers the left edge of the window we last
+       acked may update the timestamp to echo (RFC 7323, 4.3); an old
+       duplicate ending before it must not. An empty segment covers it
+       by starting there. */
+    if (TCP_SEQ_LEQ(seqno, pcb->ts_lastacksent) &&
+        (TCP_SEQ_LT(pcb->ts_lastacksent, seqno + tcplen) ||
+         ((tcplen == 0) && (seqno == pcb->ts_lastacksent)))) {
+      pcb->ts_recent = ts_val;
+      pcb->ts_recent_time = sys_now();
+    }
+  }
+#endif /* LWIP_TCP_TIMESTAMPS */
+
+#if LWIP_TCP_SACK
+  /* only now that the segment is accepted may its SACK blocks count */
+  tcp_sack_input(pcb);
+#endif /* LWIP_TCP_SACK */
+
   if ((pcb->flags & TF_RXCLOSED) == 0) {
     /* Update the PCB (in)activity timer unless rx is closed (see tcp_shutdown) */
     pcb->tmr = tcp_ticks;
   }
   pcb->keep_cnt_sent = 0;
 
-  tcp_parseopt(pcb);
-
   /* Do different things depending on the TCP state. */
   switch (pcb->state) {
   case SYN_SENT:
@@ -672,6 +938,13 @@ tcp_process(struct tcp_pcb *pcb)
       pcb->ssthresh = pcb->mss * 10;
 
       pcb->cwnd = ((pcb->cwnd == 1) ? (pcb->mss * 2) : pcb->mss);
+#if LWIP_TCP_CC
+      tcp_cc_established(pcb);
+#endif /* LWIP_TCP_CC */
+#if LWIP_TCP_TIMESTAMPS
+      /* the SYN|ACK echoes the timestamp of our (last) SYN */
+      tcp_rtt_ts_sample(pcb, 1);
+#endif /* LWIP_TCP_TIMESTAMPS */
       LWIP_ASSERT("pcb->snd_queuelen > 0", (pcb->snd_queuelen > 0));
       --pcb->snd_queuelen;
       LWIP_DEBUGF(TCP_QLEN_DEBUG, ("tcp_process: SYN-SENT --queuelen %"U16_F"\n", (u16_t)pcb->snd_queuelen));
@@ -681,9 +954,9 @@ tcp_process(struct tcp_pcb *pcb)
       /* If there's nothing left to acknowledge, stop the retransmit
          timer, otherwise reset it to start again */
       if(pcb->unacked == NULL)
-        pcb->rtime = -1;
+        TCP_RTIMER_STOP(pcb);
       else {
-        pcb->rtime = 0;
+        TCP_RTIMER_START(pcb);
         pcb->nrtx = 0;
       }
 
@@ -708,7 +981,8 @@ tcp_process(struct tcp_pcb *pcb)
     if (flags & TCP_ACK) {
       /* expected ACK number? */
       if (TCP_SEQ_BETWEEN(ackno, pcb->lastack+1, pcb->snd_nxt)) {
-        u16_t old_cwnd;
+        tcpwnd_size_t old_cwnd;
+        TCP_PCB_NUM_DEC(syn_rcvd);
         pcb->state = ESTABLISHED;
         LWIP_DEBUGF(TCP_DEBUG, ("TCP connection established %"U16_F" -> %"U16_F".\n", inseg.tcphdr->src, inseg.tcphdr->dest));
 #if LWIP_CALLBACK_API
@@ -736,6 +1010,9 @@ tcp_process(struct tcp_pcb *pcb)
         }
 
         pcb->cwnd = ((old_cwnd == 1) ? (pcb->mss * 2) : pcb->mss);
+#if LWIP_TCP_CC
+        tcp_cc_established(pcb);
+#endif /* LWIP_TCP_CC */
 
         if (recv_flags & TF_GOT_FIN) {
           tcp_ack_now(pcb);
@@ -876,10 +1153,17 @@ tcp_receive(struct tcp_pcb *pcb)
 #endif /* TCP_QUEUE_OOSEQ */
   struct pbuf *p;
   s32_t off;
+#if LWIP_TCP_TIMERS_MS
+  s32_t m;
+#else /* LWIP_TCP_TIMERS_MS */
   s16_t m;
+#endif /* LWIP_TCP_TIMERS_MS */
   u32_t right_wnd_edge;
   u16_t new_tot_len;
   int found_dupack = 0;
+#if LWIP_TCP_TIMESTAMPS
+  u8_t ts_sampled = 0;
+#endif /* LWIP_TCP_TIMESTAMPS */
 
   if (flags & TCP_ACK) {
     right_wnd_edge = pcb->snd_wnd + pcb->snd_wl2;
@@ -887,17 +1171,17 @@ tcp_receive(struct tcp_pcb *pcb)
     /* Update window. */
     if (TCP_SEQ_LT(pcb->snd_wl1, seqno) ||
        (pcb->snd_wl1 == seqno && TCP_SEQ_LT(pcb->snd_wl2, ackno)) ||
-       (pcb->snd_wl2 == ackno && tcphdr->wnd > pcb->snd_wnd)) {
-      pcb->snd_wnd = tcphdr->wnd;
+       (pcb->snd_wl2 == ackno && (tcpwnd_size_t)SND_WND_SCALE(pcb, tcphdr->wnd) > pcb->snd_wnd)) {
+      pcb->snd_wnd = SND_WND_SCALE(pcb, tcphdr->wnd);
       pcb->snd_wl1 = seqno;
       pcb->snd_wl2 = ackno;
       if (pcb->snd_wnd > 0 && pcb->persist_backoff > 0) {
           pcb->persist_backoff = 0;
       }
-      LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"U16_F"\n", pcb->snd_wnd));
+      LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"TCPWNDSIZE_F"\n", pcb->snd_wnd));
 #if TCP_WND_DEBUG
     } else {
-      if (pcb->snd_wnd != tcphdr->wnd) {
+      if (pcb->snd_wnd != (tcpwnd_size_t)SND_WND_SCALE(pcb, tcphdr->wnd)) {
         LWIP_DEBUGF(TCP_WND_DEBUG, 
                     ("tcp_receive: no window update lastack %"U32_F" ackno %"
                      U32_F" wl1 %"U32_F" seqno %"U32_F" wl2 %"U32_F"\n",
@@ -934,7 +1218,7 @@ tcp_receive(struct tcp_pcb *pcb)
         /* Clause 3 */
         if (pcb->snd_wl2 + pcb->snd_wnd == right_wnd_edge){
           /* Clause 4 */
-          if (pcb->rtime >= 0) {
+          if (TCP_RTIMER_RUNNING(pcb)) {
             /* Clause 5 */
             if (pcb->lastack == ackno) {
               found_dupack = 1;
@@ -943,9 +1227,21 @@ tcp_receive(struct tcp_pcb *pcb)
               if (pcb->dupacks > 3) {
                 /* Inflate the congestion window, but not if it means that
                    the value overflows. */
-                if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
+#if LWIP_TCP_CC
+                /* (only in fast recovery, which RFC 6582 may not have entered) */
+                if ((pcb->flags & TF_INFR) &&
+                    ((tcpwnd_size_t)(pcb->cwnd + pcb->mss) > pcb->cwnd)) {
+#else /* LWIP_TCP_CC */
+                if ((tcpwnd_size_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
+#endif /* LWIP_TCP_CC */
                   pcb->cwnd += pcb->mss;
                 }
+#if LWIP_TCP_SACK
+                if ((pcb->flags & (TF_SACK | TF_INFR)) == (TF_SACK | TF_INFR)) {
+                  /* new SACK blocks may have uncovered more holes */
+                  tcp_rexmit_holes(pcb);
+                }
+#endif /* LWIP_TCP_SACK */
               } else if (pcb->dupacks == 3) {
                 /* Do fast retransmit */
                 tcp_rexmit_fast(pcb);
@@ -961,6 +1257,33 @@ tcp_receive(struct tcp_pcb *pcb)
       }
     } else if (TCP_SEQ_BETWEEN(ackno, pcb->lastack+1, pcb->snd_nxt)){
       /* We come here when the ACK acknowledges new data. */
+#if LWIP_TCP_CC
+      u8_t partial_ack = 0;
+      u8_t cc_ack = 1;
+
+      if (pcb->flags & TF_INFR) {
+        tcpwnd_size_t newly_acked = (tcpwnd_size_t)(ackno - pcb->lastack);
+        cc_ack = 0;
+        if (TCP_SEQ_LT(ackno, pcb->recover)) {
+          /* Partial ACK (RFC 6582, section 3.2 step 5): the next hole is
+             lost, too. Stay in fast recovery, resend it and deflate the
+             congestion window by the amount of new data acknowledged. */
+          partial_ack = 1;
+          pcb->cwnd = (pcb->cwnd > newly_acked) ? (pcb->cwnd - newly_acked) : 0;
+          if (newly_acked >= pcb->mss) {
+            pcb->cwnd += pcb->mss;
+          }
+          LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_receive: partial ACK %"U32_F", recover %"U32_F"\n",
+                                     ackno, pcb->recover));
+        } else {
+          /* Full ACK: leave fast recovery without sending a burst
+             (RFC 6582, section 3.2 step 3, option 2). */
+          tcpwnd_size_t flight = (tcpwnd_size_t)(pcb->snd_nxt - ackno);
+          pcb->flags &= ~TF_INFR;
+          pcb->cwnd = LWIP_MIN(pcb->ssthresh, LWIP_MAX(flight, pcb->mss) + pcb->mss);
+        }
+      }
+#else /* LWIP_TCP_CC */
 
       /* Reset the "IN Fast Retransmit" flag, since we are no longer
          in fast retransmit. Also reset the congestion window to the
@@ -969,15 +1292,26 @@ tcp_receive(struct tcp_pcb *pcb)
         pcb->flags &= ~TF_INFR;
         pcb->cwnd = pcb->ssthresh;
       }
+#endif /* LWIP_TCP_CC */
 
       /* Reset the number of retransmissions. */
       pcb->nrtx = 0;
 
+#if LWIP_TCP_TIMESTAMPS
+      /* With timestamps, every ACK of new data is a measurement, also
+         for retransmitted data. With delayed ACKs, there is one per two
+         segments in flight; each is weighted accordingly (RFC 7323,
+         appendix G). */
+      ts_sampled = tcp_rtt_ts_sample(pcb,
+        ((pcb->snd_nxt - pcb->lastack) + 2 * pcb->mss - 1) / (2 * pcb->mss));
+#endif /* LWIP_TCP_TIMESTAMPS */
+
       /* Reset the retransmission time-out. */
-      pcb->rto = (pcb->sa >> 3) + pcb->sv;
+      pcb->rto = TCP_RTO_CALC(pcb);
 
-      /* Update the send buffer space. Diff between the two can never exceed 64K? */
-      pcb->acked = (u16_t)(ackno - pcb->lastack);
+      /* Update the send buffer space. Diff between the two can never exceed
+         TCP_SND_BUF, which fits in a tcpwnd_size_t. */
+      pcb->acked = (tcpwnd_size_t)(ackno - pcb->lastack);
 
       pcb->snd_buf += pcb->acked;
 
@@ -987,20 +1321,28 @@ tcp_receive(struct tcp_pcb *pcb)
 
       /* Update the congestion control variables (cwnd and
          ssthresh). */
+#if LWIP_TCP_CC
+      if ((pcb->state >= ESTABLISHED) && cc_ack) {
+        pcb->cc_ops->on_ack(pcb, pcb->acked);
+        LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: %s cwnd %"TCPWNDSIZE_F"\n",
+                                     pcb->cc_ops->name, pcb->cwnd));
+      }
+#else /* LWIP_TCP_CC */
       if (pcb->state >= ESTABLISHED) {
         if (pcb->cwnd < pcb->ssthresh) {
-          if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
+          if ((tcpwnd_size_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
             pcb->cwnd += pcb->mss;
           }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"U16_F"\n", pcb->cwnd));
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
         } else {
-          u16_t new_cwnd = (pcb->cwnd + pcb->mss * pcb->mss / pcb->cwnd);
+          tcpwnd_size_t new_cwnd = (tcpwnd_size_t)(pcb->cwnd + pcb->mss * pcb->mss / pcb->cwnd);
           if (new_cwnd > pcb->cwnd) {
             pcb->cwnd = new_cwnd;
           }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"U16_F"\n", pcb->cwnd));
+          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
         }
       }
+#endif /* LWIP_TCP_CC */
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_receive: ACK for %"U32_F", unacked->seqno %"U32_F":%"U32_F"\n",
                                     ackno,
                                     pcb->unacked != NULL?
@@ -1029,6 +1371,9 @@ tcp_receive(struct tcp_pcb *pcb)
         }
 
         pcb->snd_queuelen -= pbuf_clen(next->p);
+#if LWIP_TCP_RACK
+        tcp_rack_update(pcb, next);
+#endif /* LWIP_TCP_RACK */
         tcp_seg_free(next);
 
         LWIP_DEBUGF(TCP_QLEN_DEBUG, ("%"U16_F" (after freeing unacked)\n", (u16_t)pcb->snd_queuelen));
@@ -1041,9 +1386,32 @@ tcp_receive(struct tcp_pcb *pcb)
       /* If there's nothing left to acknowledge, stop the retransmit
          timer, otherwise reset it to start again */
       if(pcb->unacked == NULL)
-        pcb->rtime = -1;
+        TCP_RTIMER_STOP(pcb);
       else
-        pcb->rtime = 0;
+        TCP_RTIMER_START(pcb);
+
+#if LWIP_TCP_RACK
+      if ((pcb->flags & TF_TLP_SENT) && TCP_SEQ_GEQ(ackno, pcb->tlp_end_seq)) {
+        /* everything up to the probe has arrived */
+        pcb->flags &= ~TF_TLP_SENT;
+      }
+#endif /* LWIP_TCP_RACK */
+#if LWIP_TCP_CC
+#if LWIP_TCP_SACK
+      if (partial_ack && (pcb->flags & TF_SACK)) {
+        /* a partial ACK in fast recovery (TF_INFR and below recover):
+           resend the holes that are still reported. Outside of it, only
+           duplicate ACKs start a retransmission. */
+        tcp_rexmit_holes(pcb);
+      }
+#endif /* LWIP_TCP_SACK */
+      if (partial_ack && (pcb->unacked != NULL) &&
+          (ntohl(pcb->unacked->tcphdr->seqno) == ackno)) {
+        /* resend the segment at the new left edge unless it is already
+           queued as a SACK hole */
+        tcp_rexmit(pcb);
+      }
+#endif /* LWIP_TCP_CC */
 
       pcb->polltmr = 0;
     } else {
@@ -1082,33 +1450,45 @@ tcp_receive(struct tcp_pcb *pcb)
     }
     /* End of ACK for new data processing. */
 
+#if LWIP_TCP_RACK
+    if (pcb->flags & TF_SACK) {
+      /* segments sent after the holes may have been SACKed or acked */
+      tcp_rack_detect_loss(pcb);
+      if (pcb->acked > 0) {
+        tcp_tlp_arm(pcb);
+      }
+    }
+#endif /* LWIP_TCP_RACK */
+
     LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: pcb->rttest %"U32_F" rtseq %"U32_F" ackno %"U32_F"\n",
                                 pcb->rttest, pcb->rtseq, ackno));
 
+#if LWIP_TCP_TIMESTAMPS
+    if (ts_sampled) {
+      /* the timed segment is superseded by the timestamp measurement */
+      pcb->rttest = 0;
+    }
+#endif /* LWIP_TCP_TIMESTAMPS */
+
     /* RTT estimation calculations. This is done by checking if the
        incoming segment acknowledges the segment we use to take a
        round-trip time measurement. */
     if (pcb->rttest && TCP_SEQ_LT(pcb->rtseq, ackno)) {
+#if LWIP_TCP_TIMERS_MS
+      /* tcp_ticks count milliseconds, so 32K of them is only 32 seconds;
+         anything longer than the largest RTO is as good as that */
+      m = (s32_t)(tcp_ticks - pcb->rttest);
+      m = LWIP_MIN(m, TCP_RTO_MAX);
+#else /* LWIP_TCP_TIMERS_MS */
       /* diff between this shouldn't exceed 32K since this are tcp timer ticks
          and a round-trip shouldn't be that long... */
       m = (s16_t)(tcp_ticks - pcb->rttest);
+#endif /* LWIP_TCP_TIMERS_MS */
 
-      LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: experienced rtt %"U16_F" ticks (%"U16_F" msec).\n",
-                                  m, m * TCP_SLOW_INTERVAL));
-
-      /* This is taken directly from VJs original code in his paper */
-      m = m - (pcb->sa >> 3);
-      pcb->sa += m;
-      if (m < 0) {
-        m = -m;
-      }
-      m = m - (pcb->sv >> 2);
-      pcb->sv += m;
-      pcb->rto = (pcb->sa >> 3) + pcb->sv;
-
-      LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: RTO %"U16_F" (%"U16_F" milliseconds)\n",
-                                  pcb->rto, pcb->rto * TCP_SLOW_INTERVAL));
+      LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: experienced rtt %"S32_F" ticks (%"S32_F" msec).\n",
+                                  (s32_t)m, (s32_t)m * TCP_TICK_MS));
 
+      tcp_rtt_update(pcb, (u32_t)m * TCP_TICK_MS, 1);
       pcb->rttest = 0;
     }
   }
@@ -1228,7 +1608,7 @@ tcp_receive(struct tcp_pcb *pcb)
             TCPH_FLAGS_SET(inseg.tcphdr, TCPH_FLAGS(inseg.tcphdr) &~ TCP_FIN);
           }
           /* Adjust length of segment to fit in the window. */
-          inseg.len = pcb->rcv_wnd;
+          inseg.len = (u16_t)pcb->rcv_wnd;
           if (TCPH_FLAGS(inseg.tcphdr) & TCP_SYN) {
             inseg.len -= 1;
           }
@@ -1365,8 +1745,10 @@ tcp_receive(struct tcp_pcb *pcb)
 
       } else {
         /* We get here if the incoming segment is out-of-sequence. */
-        tcp_send_empty_ack(pcb);
 #if TCP_QUEUE_OOSEQ
+#if LWIP_TCP_SACK
+        pcb->sack_seqno = seqno;
+#endif /* LWIP_TCP_SACK */
         /* We queue the segment on the ->ooseq queue. */
         if (pcb->ooseq == NULL) {
           pcb->ooseq = tcp_seg_copy(&inseg);
@@ -1474,7 +1856,7 @@ tcp_receive(struct tcp_pcb *pcb)
                       TCPH_FLAGS_SET(next->next->tcphdr, TCPH_FLAGS(next->next->tcphdr) &~ TCP_FIN);
                     }
                     /* Adjust length of segment to fit in the window. */
-                    next->next->len = pcb->rcv_nxt + pcb->rcv_wnd - seqno;
+                    next->next->len = (u16_t)(pcb->rcv_nxt + pcb->rcv_wnd - seqno);
                     pbuf_realloc(next->next->p, next->next->len);
                     tcplen = TCP_TCPLEN(next->next);
                     LWIP_ASSERT("tcp_receive: segment not trimmed correctly to rcv_wnd\n",
@@ -1489,6 +1871,9 @@ tcp_receive(struct tcp_pcb *pcb)
         }
 #endif /* TCP_QUEUE_OOSEQ */
 
+        /* Send the duplicate ACK after queueing so that its SACK blocks
+           include this segment. */
+        tcp_send_empty_ack(pcb);
       }
     } else {
       /* The incoming segment is not withing the window. */
@@ -1505,24 +1890,234 @@ tcp_receive(struct tcp_pcb *pcb)
   }
 }
 
+#if LWIP_TCP_SACK || LWIP_TCP_TIMESTAMPS
+/** Read an unaligned 32 bit value in network byte order from the options */
+static u32_t
+tcp_opt_u32(const u8_t *p)
+{
+  return ((u32_t)p[0] << 24) | ((u32_t)p[1] << 16) | ((u32_t)p[2] << 8) | p[3];
+}
+#endif /* LWIP_TCP_SACK || LWIP_TCP_TIMESTAMPS */
+
+#if LWIP_TCP_SACK
+
+/**
+ * Record a SACK block received from the peer on the scoreboard: mark the
+ * unacked segments it covers entirely so that they are not retransmitted.
+ * Blocks outside of lastack..snd_nxt (D-SACK, bogus) are ignored.
+ *
+ * @param pcb the tcp_pcb the SACK block was received for
+ * @param left first sequence number of the block
+ * @param right sequence number following the block
+ */
+static void
+tcp_sack_mark(struct tcp_pcb *pcb, u32_t left, u32_t right)
+{
+  struct tcp_seg *seg;
+
+  if (!TCP_SEQ_LT(left, right) || TCP_SEQ_LEQ(left, pcb->lastack) ||
+      TCP_SEQ_GT(right, pcb->snd_nxt)) {
+    LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_sack_mark: ignoring %"U32_F":%"U32_F"\n", left, right));
+    return;
+  }
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    u32_t seg_seqno = ntohl(seg->tcphdr->seqno);
+    if (TCP_SEQ_GEQ(seg_seqno, right)) {
+      break;
+    }
+    if (TCP_SEQ_GEQ(seg_seqno, left) &&
+        TCP_SEQ_LEQ(seg_seqno + TCP_TCPLEN(seg), right) &&
+        !(seg->flags & TF_SEG_SACKED)) {
+      seg->flags |= TF_SEG_SACKED;
+#if LWIP_TCP_RACK
+      tcp_rack_update(pcb, seg);
+#endif /* LWIP_TCP_RACK */
+    }
+  }
+}
+
+/**
+ * Record the SACK blocks of the current segment (see tcp_parseopt()) on
+ * the scoreboard, if the connection uses SACK and the segment is an ACK.
+ *
+ * @param pcb the tcp_pcb the segment was received for
+ */
+static void
+tcp_sack_input(struct tcp_pcb *pcb)
+{
+  u8_t i;
+
+  if ((sack_opt == NULL) || !(pcb->flags & TF_SACK) || !(flags & TCP_ACK)) {
+    return;
+  }
+  for (i = 2; i < sack_opt[1]; i += 8) {
+    tcp_sack_mark(pcb, tcp_opt_u32(&sack_opt[i]), tcp_opt_u32(&sack_opt[i + 4]));
+  }
+}
+#endif /* LWIP_TCP_SACK */
+
+#if LWIP_TCP_RACK
+/**
+ * Take note of a segment the peer has acked or SACKed (RFC 8985, section
+ * 6.2 steps 1 and 2): the most recently sent one delivered is the RACK
+ * segment that tcp_rack_detect_loss() compares against.
+ * RTTs of retransmitted segments shorter than the minimum RTT likely stem
+ * from the ACK of an earlier transmission and are ignored.
+ *
+ * @param pcb the tcp_pcb the segment belongs to
+ * @param seg the segment delivered
+ */
+static void
+tcp_rack_update(struct tcp_pcb *pcb, struct tcp_seg *seg)
+{
+  u32_t rtt, end_seq;
+
+  if (seg->xmit_cnt == 0) {
+    return;
+  }
+  rtt = (u32_t)(tcp_ticks - seg->xmit_time);
+  if (seg->xmit_cnt > 1) {
+    if (rtt < pcb->rack_min_rtt) {
+      return;
+    }
+  } else if ((pcb->rack_min_rtt == 0) || (rtt < pcb->rack_min_rtt)) {
+    pcb->rack_min_rtt = rtt;
+  }
+  end_seq = ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
+  if (((s32_t)(seg->xmit_time - pcb->rack_xmit_time) > 0) ||
+      ((seg->xmit_time == pcb->rack_xmit_time) && TCP_SEQ_GT(end_seq, pcb->rack_end_seq))) {
+    pcb->rack_xmit_time = seg->xmit_time;
+    pcb->rack_end_seq = end_seq;
+    pcb->rack_rtt = rtt;
+  }
+}
+#endif /* LWIP_TCP_RACK */
+
+#if LWIP_TCP_TIMESTAMPS
+/**
+ * Divide an update of sa or sv by the number of samples per round-trip
+ * without dropping the remainder: its fraction is carried in 1/256ths, so
+ * that errors smaller than 'samples' still move the estimate.
+ *
+ * @param err the update for a single measurement per round-trip
+ * @param samples the divisor, > 0
+ * @param frac the fraction carried over, updated
+ * @return the whole part of err / samples plus the carried fraction
+ */
+static s32_t
+tcp_rtt_gain(s32_t err, u32_t samples, u8_t *frac)
+{
+  s32_t d, q;
+
+  if (samples == 1) {
+    return err;
+  }
+  d = (err / (s32_t)samples) * 256 +
+      ((err % (s32_t)samples) * 256) / (s32_t)samples + *frac;
+  q = d / 256;
+  d -= q * 256;
+  if (d < 0) {
+    /* round towards minus infinity to keep the fraction positive */
+    q--;
+    d += 256;
+  }
+  *frac = (u8_t)d;
+  return q;
+}
+#define TCP_RTT_GAIN(pcb, err, samples, x) tcp_rtt_gain(err, samples, &(pcb)->x##_frac)
+#else /* LWIP_TCP_TIMESTAMPS */
+#define TCP_RTT_GAIN(pcb, err, samples, x) ((err) / (s32_t)(samples))
+#endif /* LWIP_TCP_TIMESTAMPS */
+
+/**
+ * Update the RTT estimate with a measurement and recompute the RTO from it
+ * (RFC 6298, section 2).
+ *
+ * @param pcb the tcp_pcb the measurement was taken for
+ * @param m the measured round-trip time in milliseconds
+ * @param samples the number of measurements expected per round-trip, the
+ *        gains are divided by it (RFC 7323, appendix G)
+ */
+static void
+tcp_rtt_update(struct tcp_pcb *pcb, u32_t m, u32_t samples)
+{
+  s32_t err;
+
+  if (pcb->sa == 0) {
+    /* first measurement: SRTT = R, RTTVAR = R/2 */
+    pcb->sa = (s32_t)m << 3;
+    pcb->sv = (s32_t)m << 1;
+#if LWIP_TCP_TIMESTAMPS
+    pcb->sa_frac = 0;
+    pcb->sv_frac = 0;
+#endif /* LWIP_TCP_TIMESTAMPS */
+  } else {
+    /* This is taken directly from VJs original code in his paper */
+    err = (s32_t)m - (pcb->sa >> 3);
+    pcb->sa += TCP_RTT_GAIN(pcb, err, samples, sa);
+    if (err < 0) {
+      err = -err;
+    }
+    err = err - (pcb->sv >> 2);
+    pcb->sv += TCP_RTT_GAIN(pcb, err, samples, sv);
+  }
+  pcb->rto = TCP_RTO_CALC(pcb);
+
+  LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_rtt_update: rtt %"U32_F" srtt %"U32_F" rttvar %"U32_F" RTO %"TCPTMR_F" (%"U32_F" milliseconds)\n",
+                              m, tcp_srtt(pcb), tcp_rttvar(pcb), pcb->rto, (u32_t)pcb->rto * TCP_TICK_MS));
+}
+
+#if LWIP_TCP_TIMESTAMPS
+/**
+ * Take an RTT measurement from the timestamp echoed in the current segment
+ * (RFC 7323, section 4). Unlike a timed segment, it is not ambiguous after
+ * a retransmission: the echo is that of the copy that arrived.
+ *
+ * @param pcb the tcp_pcb for which a segment arrived
+ * @param samples passed to tcp_rtt_update()
+ * @return 1 if a measurement was taken, 0 if not
+ */
+static u8_t
+tcp_rtt_ts_sample(struct tcp_pcb *pcb, u32_t samples)
+{
+  u32_t m;
+
+  if (!(pcb->flags & TF_TIMESTAMP) || !ts_seen || !(flags & TCP_ACK)) {
+    return 0;
+  }
+  m = sys_now() - ts_ecr;
+  if (m > 2 * TCP_MSL) {
+    /* not an echo of anything we sent recently */
+    return 0;
+  }
+  tcp_rtt_update(pcb, m, LWIP_MAX(samples, 1));
+  return 1;
+}
+#endif /* LWIP_TCP_TIMESTAMPS */
+
 /**
  * Parses the options contained in the incoming segment. 
  *
  * Called from tcp_listen_input() and tcp_process().
- * Currently, only the MSS option is supported!
+ * Currently, the MSS, window scale, SACK and timestamp options are supported.
  *
- * @param pcb the tcp_pcb for which a segment arrived
+ * @param pcb the tcp_pcb for which a segment arrived, NULL to only
+ *        return the MSS (for a SYN answered with a SYN cookie)
+ * @return the MSS option received, limited to TCP_MSS, or 0 if none
  */
-static void
+static u16_t
 tcp_parseopt(struct tcp_pcb *pcb)
 {
   u16_t c, max_c;
-  u16_t mss;
+  u16_t mss = 0;
   u8_t *opts, opt;
-#if LWIP_TCP_TIMESTAMPS
-  u32_t tsval;
-#endif
 
+#if LWIP_TCP_TIMESTAMPS
+  ts_seen = 0;
+#endif /* LWIP_TCP_TIMESTAMPS */
+#if LWIP_TCP_SACK
+  sack_opt = NULL;
+#endif /* LWIP_TCP_SACK */
   opts = (u8_t *)tcphdr + TCP_HLEN;
 
   /* Parse the TCP MSS option, if present. */
@@ -1534,7 +2129,7 @@ tcp_parseopt(struct tcp_pcb *pcb)
       case 0x00:
         /* End of options. */
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: EOL\n"));
-        return;
+        return mss;
       case 0x01:
         /* NOP option. */
         ++c;
@@ -1545,31 +2140,91 @@ tcp_parseopt(struct tcp_pcb *pcb)
         if (opts[c + 1] != 0x04 || c + 0x04 > max_c) {
           /* Bad length */
           LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
-          return;
+          return mss;
         }
         /* An MSS option with the right option length. */
         mss = (opts[c + 2] << 8) | opts[c + 3];
         /* Limit the mss to the configured TCP_MSS and prevent division by zero */
-        pcb->mss = ((mss > TCP_MSS) || (mss == 0)) ? TCP_MSS : mss;
+        mss = ((mss > TCP_MSS) || (mss == 0)) ? TCP_MSS : mss;
+        if (pcb != NULL) {
+          pcb->mss = mss;
+        }
         /* Advance to next option */
         c += 0x04;
         break;
+#if LWIP_WND_SCALE
+      case 0x03:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: WND_SCALE\n"));
+        if (opts[c + 1] != 0x03 || c + 0x03 > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return mss;
+        }
+        /* The option is only valid in a SYN, and a retransmitted SYN must
+           not change the shift counts. Without a pcb (SYN cookie) it is
+           not kept. */
+        if ((pcb != NULL) && (flags & TCP_SYN) && !(pcb->flags & TF_WND_SCALE)) {
+          pcb->snd_scale = LWIP_MIN(opts[c + 2], 14);
+          pcb->rcv_scale = TCP_RCV_SCALE;
+          pcb->flags |= TF_WND_SCALE;
+          /* both sides scale: we can use the full receive window */
+          LWIP_ASSERT("window not at default value", pcb->rcv_wnd == TCPWND16(TCP_WND));
+          pcb->rcv_wnd = TCP_WND;
+          pcb->rcv_ann_wnd = TCP_WND;
+        }
+        /* Advance to next option */
+        c += 0x03;
+        break;
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+      case 0x04:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK_PERM\n"));
+        if (opts[c + 1] != 0x02 || c + 0x02 > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return mss;
+        }
+        /* Only valid in a SYN, a connection opened with a cookie has no SACK */
+        if ((pcb != NULL) && (flags & TCP_SYN)) {
+          pcb->flags |= TF_SACK;
+        }
+        /* Advance to next option */
+        c += 0x02;
+        break;
+      case 0x05:
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK\n"));
+        if (opts[c + 1] < 0x0A || ((opts[c + 1] - 2) & 7) != 0 ||
+            c + opts[c + 1] > max_c) {
+          /* Bad length */
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+          return mss;
+        }
+        /* the blocks are left to tcp_sack_input() */
+        sack_opt = &opts[c];
+        /* Advance to next option */
+        c += opts[c + 1];
+        break;
+#endif /* LWIP_TCP_SACK */
 #if LWIP_TCP_TIMESTAMPS
       case 0x08:
         LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: TS\n"));
         if (opts[c + 1] != 0x0A || c + 0x0A > max_c) {
           /* Bad length */
           LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
-          return;
+          return mss;
         }
-        /* TCP timestamp option with valid length */
-        tsval = (opts[c+2]) | (opts[c+3] << 8) | 
-          (opts[c+4] << 16) | (opts[c+5] << 24);
-        if (flags & TCP_SYN) {
-          pcb->ts_recent = ntohl(tsval);
+        /* TCP timestamp option with valid length. PAWS and updating
+           ts_recent are left to tcp_process(). */
+        ts_seen = 1;
+        ts_val = tcp_opt_u32(&opts[c + 2]);
+        ts_ecr = tcp_opt_u32(&opts[c + 6]);
+        if (pcb == NULL) {
+          /* SYN answered with a cookie: timestamps are not kept */
+        } else if (flags & TCP_SYN) {
+          /* our SYN always offers timestamps, the peer's SYN enables them */
+          pcb->ts_recent = ts_val;
+          pcb->ts_recent_time = sys_now();
           pcb->flags |= TF_TIMESTAMP;
-        } else if (TCP_SEQ_BETWEEN(pcb->ts_lastacksent, seqno, seqno+tcplen)) {
-          pcb->ts_recent = ntohl(tsval);
         }
         /* Advance to next option */
         c += 0x0A;
@@ -1581,7 +2236,7 @@ tcp_parseopt(struct tcp_pcb *pcb)
           LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
           /* If the length field is zero, the options are malformed
              and we don't process them further. */
-          return;
+          return mss;
         }
         /* All other options have a length field, so that we easily
            can skip past them. */
@@ -1589,6 +2244,7 @@ tcp_parseopt(struct tcp_pcb *pcb)
       }
     }
   }
+  return mss;
 }
 
 #endif /* LWIP_TCP */
@@ -43,6 +43,7 @@
 #if LWIP_TCP /* don't build if not configured for use in lwipopts.h */
 
 #include "lwip/tcp_impl.h"
+#include "lwip/tcp_cc.h"
 #include "lwip/def.h"
 #include "lwip/mem.h"
 #include "lwip/memp.h"
@@ -53,6 +54,7 @@
 #include "lwip/stats.h"
 #include "lwip/snmp.h"
 #include "netif/etharp.h"
+#include "lwip/perf.h"
 
 #include <string.h>
 
@@ -78,6 +80,27 @@
 
 /* Forward declarations.*/
 static void tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb);
+#if !LWIP_TCP_WRITEV
+/* only ever NULL for tcp_pbuf_ref() and tcp_write_ref() then */
+struct tcp_iovec;
+#endif /* !LWIP_TCP_WRITEV */
+
+#if CHECKSUM_GEN_TCP && LWIP_CHECKSUM_CTRL_PER_NETIF
+/** @return 1 if segments to dest need their checksum computed in software
+ *          (their netif has NETIF_CHECKSUM_GEN_TCP set) */
+static u8_t
+tcp_chksum_needed(ip_addr_t *dest)
+{
+  struct netif *netif = ip_route(dest);
+  IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
+    return 1;
+  }
+  return 0;
+}
+#define TCP_CHKSUM_NEEDED(dest) tcp_chksum_needed(dest)
+#else /* CHECKSUM_GEN_TCP && LWIP_CHECKSUM_CTRL_PER_NETIF */
+#define TCP_CHKSUM_NEEDED(dest) 1
+#endif /* CHECKSUM_GEN_TCP && LWIP_CHECKSUM_CTRL_PER_NETIF */
 
 /** Allocate a pbuf and create a tcphdr at p->payload, used for output
  * functions other than the default tcp_output -> tcp_output_segment
@@ -104,7 +127,7 @@ tcp_output_alloc_header(struct tcp_pcb *pcb, u16_t optlen, u16_t datalen,
     tcphdr->seqno = seqno_be;
     tcphdr->ackno = htonl(pcb->rcv_nxt);
     TCPH_HDRLEN_FLAGS_SET(tcphdr, (5 + optlen / 4), TCP_ACK);
-    tcphdr->wnd = htons(pcb->rcv_ann_wnd);
+    tcphdr->wnd = htons(TCPWND16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
     tcphdr->chksum = 0;
     tcphdr->urgp = 0;
 
@@ -132,6 +155,7 @@ tcp_send_fin(struct tcp_pcb *pcb)
     if ((TCPH_FLAGS(last_unsent->tcphdr) & (TCP_SYN | TCP_FIN | TCP_RST)) == 0) {
       /* no SYN/FIN/RST flag in the header, we can add the FIN flag */
       TCPH_SET_FLAG(last_unsent->tcphdr, TCP_FIN);
+      last_unsent->flags &= ~TF_SEG_HDR_CHECKSUMMED;
       return ERR_OK;
     }
   }
@@ -168,6 +192,10 @@ tcp_create_segment(struct tcp_pcb *pcb, struct pbuf *p, u8_t flags, u32_t seqno,
   seg->next = NULL;
   seg->p = p;
   seg->len = p->tot_len - optlen;
+#if LWIP_TCP_RACK
+  seg->xmit_cnt = 0;
+  seg->xmit_time = 0;
+#endif /* LWIP_TCP_RACK */
 #if TCP_OVERSIZE_DBGCHECK
   seg->oversize_left = 0;
 #endif /* TCP_OVERSIZE_DBGCHECK */
@@ -304,7 +332,7 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
 
   /* fail on too much data */
   if (len > pcb->snd_buf) {
-    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | 3, ("tcp_write: too much data (len=%"U16_F" > snd_buf=%"U16_F")\n",
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | 3, ("tcp_write: too much data (len=%"U16_F" > snd_buf=%"TCPWNDSIZE_F")\n",
       len, pcb->snd_buf));
     pcb->flags |= TF_NAGLEMEMERR;
     return ERR_MEM;
@@ -332,24 +360,87 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
   return ERR_OK;
 }
 
+#if LWIP_TCP_WRITEV
+/** Drop one reference to the buffer of a tcp_iovec, calling its completion
+ * callback when it was the last one. */
+static void
+tcp_iov_unref(struct tcp_iovec *iov)
+{
+  u16_t refs;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  /* pbufs may be freed by a netif driver outside the tcpip thread */
+  SYS_ARCH_PROTECT(old_level);
+  LWIP_ASSERT("tcp_iov_unref: iov->refs > 0", iov->refs > 0);
+  refs = --iov->refs;
+  SYS_ARCH_UNPROTECT(old_level);
+  if ((refs == 0) && (iov->done != NULL)) {
+    iov->done(iov->arg, iov);
+  }
+}
+
+/** Free function of the pbufs referencing a tcp_iovec */
+static void
+tcp_iov_pbuf_free(struct pbuf *p)
+{
+  struct tcp_iov_pbuf *ipb = (struct tcp_iov_pbuf *)p;
+  struct tcp_iovec *iov = ipb->iov;
+
+  memp_free(MEMP_TCP_IOV_PBUF, ipb);
+  tcp_iov_unref(iov);
+}
+#endif /* LWIP_TCP_WRITEV */
+
 /**
- * Write data for sending (but does not send it immediately).
- *
- * It waits in the expectation of more data being sent soon (as
- * it can send them more efficiently by combining them together).
- * To prompt the system to send data now, call tcp_output() after
- * calling tcp_write().
+ * Allocate a pbuf referencing (not copying) 'len' bytes at 'payload'.
  *
- * @param pcb Protocol control block for the TCP connection to enqueue data for.
- * @param arg Pointer to the data to be enqueued for sending.
- * @param len Data length in bytes
- * @param apiflags combination of following flags :
- * - TCP_WRITE_FLAG_COPY (0x01) data will be copied into memory belonging to the stack
- * - TCP_WRITE_FLAG_MORE (0x02) for TCP connection, PSH flag will be set on last segment sent,
- * @return ERR_OK if enqueued, another err_t on error
+ * Without a tcp_iovec this is a PBUF_ROM, since the referenced data is
+ * available at least until it is sent out on the link (as it has to be
+ * ACKed by the remote party). With a tcp_iovec, it is a custom PBUF_REF
+ * that drops its reference to the iovec when freed.
  */
-err_t
-tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
+static struct pbuf *
+tcp_pbuf_ref(pbuf_layer layer, u16_t len, const void *payload, struct tcp_iovec *iov)
+{
+  struct pbuf *p;
+
+#if LWIP_TCP_WRITEV
+  if (iov != NULL) {
+    struct tcp_iov_pbuf *ipb;
+    SYS_ARCH_DECL_PROTECT(old_level);
+
+    ipb = (struct tcp_iov_pbuf *)memp_malloc(MEMP_TCP_IOV_PBUF);
+    if (ipb == NULL) {
+      return NULL;
+    }
+    /* no header space is needed: the TCP header is in a pbuf of its own */
+    p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &ipb->pc, NULL, 0);
+    ipb->pc.custom_free_function = tcp_iov_pbuf_free;
+    ipb->iov = iov;
+    p->eb = NULL;
+    p->payload = (void *)payload;
+    SYS_ARCH_PROTECT(old_level);
+    iov->refs++;
+    SYS_ARCH_UNPROTECT(old_level);
+    return p;
+  }
+#else /* LWIP_TCP_WRITEV */
+  LWIP_UNUSED_ARG(iov);
+#endif /* LWIP_TCP_WRITEV */
+  p = pbuf_alloc(layer, len, PBUF_ROM);
+  if (p != NULL) {
+    p->payload = (void *)payload;
+  }
+  return p;
+}
+
+/**
+ * Enqueue data for tcp_write() and tcp_writev(). Without
+ * TCP_WRITE_FLAG_COPY, the data pbufs reference 'iov' if it is != NULL.
+ */
+static err_t
+tcp_write_ref(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags,
+              struct tcp_iovec *iov)
 {
   struct pbuf *concat_p = NULL;
   struct tcp_seg *last_unsent = NULL, *seg = NULL, *prev_seg = NULL, *queue = NULL;
@@ -457,10 +548,12 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
      * Phase 2: Chain a new pbuf to the end of pcb->unsent.
      *
      * We don't extend segments containing SYN/FIN flags or options
-     * (len==0). The new pbuf is kept in concat_p and pbuf_cat'ed at
-     * the end.
+     * (len==0), nor a retransmitted segment that does not end at
+     * snd_lbb (requeued by tcp_rexmit()). The new pbuf is kept in
+     * concat_p and pbuf_cat'ed at the end.
      */
-    if ((pos < len) && (space > 0) && (last_unsent->len > 0)) {
+    if ((pos < len) && (space > 0) && (last_unsent->len > 0) &&
+        (ntohl(last_unsent->tcphdr->seqno) + last_unsent->len == pcb->snd_lbb)) {
       u16_t seglen = space < len - pos ? space : len - pos;
       seg = last_unsent;
 
@@ -484,7 +577,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
 #endif /* TCP_CHECKSUM_ON_COPY */
       } else {
         /* Data is not copied */
-        if ((concat_p = pbuf_alloc(PBUF_RAW, seglen, PBUF_ROM)) == NULL) {
+        if ((concat_p = tcp_pbuf_ref(PBUF_RAW, seglen, (u8_t*)arg + pos, iov)) == NULL) {
           LWIP_DEBUGF(TCP_OUTPUT_DEBUG | 2,
                       ("tcp_write: could not allocate memory for zero-copy pbuf\n"));
           goto memerr;
@@ -495,8 +588,6 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
           &concat_chksum, &concat_chksum_swapped);
         concat_chksummed += seglen;
 #endif /* TCP_CHECKSUM_ON_COPY */
-        /* reference the non-volatile payload data */
-        concat_p->payload = (u8_t*)arg + pos;
       }
 
       pos += seglen;
@@ -536,16 +627,12 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
                   (p->len >= seglen));
       TCP_DATA_COPY2((char *)p->payload + optlen, (u8_t*)arg + pos, seglen, &chksum, &chksum_swapped);
     } else {
-      /* Copy is not set: First allocate a pbuf for holding the data.
-       * Since the referenced data is available at least until it is
-       * sent out on the link (as it has to be ACKed by the remote
-       * party) we can safely use PBUF_ROM instead of PBUF_REF here.
-       */
+      /* Copy is not set: First allocate a pbuf referencing the data. */
       struct pbuf *p2;
 #if TCP_OVERSIZE
       LWIP_ASSERT("oversize == 0", oversize == 0);
 #endif /* TCP_OVERSIZE */
-      if ((p2 = pbuf_alloc(PBUF_TRANSPORT, seglen, PBUF_ROM)) == NULL) {
+      if ((p2 = tcp_pbuf_ref(PBUF_TRANSPORT, seglen, (u8_t*)arg + pos, iov)) == NULL) {
         LWIP_DEBUGF(TCP_OUTPUT_DEBUG | 2, ("tcp_write: could not allocate memory for zero-copy pbuf\n"));
         goto memerr;
       }
@@ -553,8 +640,6 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
       /* calculate the checksum of nocopy-data */
       chksum = ~inet_chksum((u8_t*)arg + pos, seglen);
 #endif /* TCP_CHECKSUM_ON_COPY */
-      /* reference the non-volatile payload data */
-      p2->payload = (u8_t*)arg + pos;
 
       /* Second, allocate a pbuf for the headers. */
       if ((p = pbuf_alloc(PBUF_TRANSPORT, optlen, PBUF_RAM)) == NULL) {
@@ -630,6 +715,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
       }
     }
     last_unsent->len += oversize_used;
+    last_unsent->flags &= ~TF_SEG_HDR_CHECKSUMMED;
 #if TCP_OVERSIZE_DBGCHECK
     last_unsent->oversize_left -= oversize_used;
 #endif /* TCP_OVERSIZE_DBGCHECK */
@@ -645,6 +731,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
       (last_unsent != NULL));
     pbuf_cat(last_unsent->p, concat_p);
     last_unsent->len += concat_p->tot_len;
+    last_unsent->flags &= ~TF_SEG_HDR_CHECKSUMMED;
 #if TCP_CHECKSUM_ON_COPY
     if (concat_chksummed) {
       tcp_seg_add_chksum(concat_chksum, concat_chksummed, &last_unsent->chksum,
@@ -681,6 +768,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
   /* Set the PSH flag in the last segment that we enqueued. */
   if (seg != NULL && seg->tcphdr != NULL && ((apiflags & TCP_WRITE_FLAG_MORE)==0)) {
     TCPH_SET_FLAG(seg->tcphdr, TCP_PSH);
+    seg->flags &= ~TF_SEG_HDR_CHECKSUMMED;
   }
 
   return ERR_OK;
@@ -702,6 +790,83 @@ memerr:
   return ERR_MEM;
 }
 
+/**
+ * Write data for sending (but does not send it immediately).
+ *
+ * It waits in the expectation of more data being sent soon (as
+ * it can send them more efficiently by combining them together).
+ * To prompt the system to send data now, call tcp_output() after
+ * calling tcp_write().
+ *
+ * @param pcb Protocol control block for the TCP connection to enqueue data for.
+ * @param arg Pointer to the data to be enqueued for sending.
+ * @param len Data length in bytes
+ * @param apiflags combination of following flags :
+ * - TCP_WRITE_FLAG_COPY (0x01) data will be copied into memory belonging to the stack
+ * - TCP_WRITE_FLAG_MORE (0x02) for TCP connection, PSH flag will be set on last segment sent,
+ * @return ERR_OK if enqueued, another err_t on error
+ */
+err_t
+tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
+{
+  return tcp_write_ref(pcb, arg, len, apiflags, NULL);
+}
+
+#if LWIP_TCP_WRITEV
+/**
+ * Write a list of buffers for sending without copying them (unless
+ * TCP_WRITE_FLAG_COPY is given). Like tcp_write(), this does not send
+ * anything; call tcp_output() afterwards.
+ *
+ * The buffers are enqueued in order, each one either completely or not at
+ * all; enqueueing stops at the first one that does not fit. The 'done'
+ * callback of an enqueued tcp_iovec is called once lwIP no longer references
+ * its buffer: after its last byte has been acknowledged and the segments
+ * holding it were freed, when the connection is aborted, or right away if
+ * the data was copied. It is not called for buffers that were not enqueued.
+ *
+ * @param pcb Protocol control block for the TCP connection to enqueue data for.
+ * @param iov array of buffers; the segments point into it, so the array
+ *            must stay valid (not on the stack of a returning function)
+ *            until the 'done' callbacks of all enqueued entries were called
+ * @param iovcnt number of entries in 'iov'
+ * @param apiflags TCP_WRITE_FLAG_COPY and TCP_WRITE_FLAG_MORE as for
+ *        tcp_write(), PSH is set after the last buffer only
+ * @param queued receives the number of buffers enqueued (may be NULL)
+ * @return ERR_OK if all buffers were enqueued, the error of the first
+ *         buffer that was not, otherwise
+ */
+err_t
+tcp_writev(struct tcp_pcb *pcb, struct tcp_iovec *iov, u8_t iovcnt, u8_t apiflags,
+           u8_t *queued)
+{
+  err_t err = ERR_OK;
+  u8_t i;
+
+  LWIP_ERROR("tcp_writev: iov == NULL (programmer violates API)",
+             (iov != NULL) || (iovcnt == 0), return ERR_ARG;);
+
+  for (i = 0; i < iovcnt; i++) {
+    /* hold a reference of our own, so that 'done' is not called while the
+       pbufs of this buffer are created (or freed again on error) */
+    iov[i].refs = 1;
+    err = tcp_write_ref(pcb, iov[i].base, iov[i].len,
+                        (u8_t)((i + 1 < iovcnt) ? (apiflags | TCP_WRITE_FLAG_MORE) : apiflags),
+                        &iov[i]);
+    if (err != ERR_OK) {
+      LWIP_ASSERT("tcp_writev: no references left", iov[i].refs == 1);
+      iov[i].refs = 0;
+      break;
+    }
+    tcp_iov_unref(&iov[i]);
+  }
+  if (queued != NULL) {
+    *queued = i;
+  }
+  return err;
+}
+#endif /* LWIP_TCP_WRITEV */
+
 /**
  * Enqueue TCP options for transmission.
  *
@@ -736,9 +901,23 @@ tcp_enqueue_flags(struct tcp_pcb *pcb, u8_t flags)
 
   if (flags & TCP_SYN) {
     optflags = TF_SEG_OPTS_MSS;
+#if LWIP_WND_SCALE
+    if ((pcb->state != SYN_RCVD) || (pcb->flags & TF_WND_SCALE)) {
+      /* In a SYN|ACK (sent in state SYN_RCVD), the window scale option may
+         only be sent if the peer sent one in its SYN. */
+      optflags |= TF_SEG_OPTS_WND_SCALE;
+    }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+    if ((pcb->state != SYN_RCVD) || (pcb->flags & TF_SACK)) {
+      /* same for SACK-permitted */
+      optflags |= TF_SEG_OPTS_SACK_PERM;
+    }
+#endif /* LWIP_TCP_SACK */
   }
 #if LWIP_TCP_TIMESTAMPS
-  if ((pcb->flags & TF_TIMESTAMP)) {
+  if ((pcb->flags & TF_TIMESTAMP) || ((flags & TCP_SYN) && (pcb->state != SYN_RCVD))) {
+    /* a SYN always offers timestamps, a SYN|ACK only answers the offer */
     optflags |= TF_SEG_OPTS_TS;
   }
 #endif /* LWIP_TCP_TIMESTAMPS */
@@ -829,6 +1008,72 @@ tcp_build_timestamp_option(struct tcp_pcb *pcb, u32_t *opts)
 }
 #endif
 
+#if LWIP_WND_SCALE
+/* Build a window scale option (3 bytes long, 4 with padding) at the
+ * specified options pointer
+ *
+ * @param opts option pointer where to store the window scale option
+ */
+static void
+tcp_build_wnd_scale_option(u32_t *opts)
+{
+  /* Pad with one NOP option to make everything nicely aligned */
+  opts[0] = PP_HTONL(0x01030300 | TCP_RCV_SCALE);
+}
+#endif /* LWIP_WND_SCALE */
+
+#if LWIP_TCP_SACK
+/** Maximum number of SACK blocks in 40 bytes of options (3 with timestamps) */
+#define TCP_SACK_MAX_BLOCKS 4
+
+/* Collect the SACK blocks to report from pcb->ooseq. Adjacent segments are
+ * merged into one block. The block holding the segment received last comes
+ * first, the others follow in sequence order (RFC 2018, section 4).
+ *
+ * @param pcb the tcp_pcb whose ooseq queue is reported
+ * @param blocks array of max_blocks left/right edge pairs (host order)
+ * @param max_blocks number of blocks that fit into the option space
+ * @return number of blocks stored in 'blocks'
+ */
+static u8_t
+tcp_sack_blocks(struct tcp_pcb *pcb, u32_t *blocks, u8_t max_blocks)
+{
+  struct tcp_seg *seg = pcb->ooseq;
+  u8_t n = 0;
+  u8_t i;
+
+  while (seg != NULL) {
+    /* ooseq segments already have their header in host byte order */
+    u32_t left = seg->tcphdr->seqno;
+    u32_t right = left + TCP_TCPLEN(seg);
+    for (seg = seg->next; seg != NULL && TCP_SEQ_LEQ(seg->tcphdr->seqno, right);
+         seg = seg->next) {
+      if (TCP_SEQ_GT(seg->tcphdr->seqno + TCP_TCPLEN(seg), right)) {
+        right = seg->tcphdr->seqno + TCP_TCPLEN(seg);
+      }
+    }
+    if (TCP_SEQ_GEQ(pcb->sack_seqno, left) && TCP_SEQ_LT(pcb->sack_seqno, right)) {
+      /* the most recent block goes first, pushing out the last one */
+      if (n == max_blocks) {
+        n--;
+      }
+      for (i = n; i > 0; i--) {
+        blocks[2 * i] = blocks[2 * (i - 1)];
+        blocks[2 * i + 1] = blocks[2 * (i - 1) + 1];
+      }
+      blocks[0] = left;
+      blocks[1] = right;
+      n++;
+    } else if (n < max_blocks) {
+      blocks[2 * n] = left;
+      blocks[2 * n + 1] = right;
+      n++;
+    }
+  }
+  return n;
+}
+#endif /* LWIP_TCP_SACK */
+
 /** Send an ACK without data.
  *
  * @param pcb Protocol control block for the TCP connection to send the ACK
@@ -839,12 +1084,23 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
   struct pbuf *p;
   struct tcp_hdr *tcphdr;
   u8_t optlen = 0;
+#if LWIP_TCP_SACK
+  u32_t sack[2 * TCP_SACK_MAX_BLOCKS];
+  u8_t sack_blocks = 0;
+#endif /* LWIP_TCP_SACK */
 
 #if LWIP_TCP_TIMESTAMPS
   if (pcb->flags & TF_TIMESTAMP) {
     optlen = LWIP_TCP_OPT_LENGTH(TF_SEG_OPTS_TS);
   }
 #endif
+#if LWIP_TCP_SACK
+  if ((pcb->flags & TF_SACK) && (pcb->ooseq != NULL)) {
+    /* 2 NOPs, kind and length, then 8 bytes per block */
+    sack_blocks = tcp_sack_blocks(pcb, sack, (u8_t)((40 - optlen - 4) / 8));
+    optlen += 4 + 8 * sack_blocks;
+  }
+#endif /* LWIP_TCP_SACK */
 
   p = tcp_output_alloc_header(pcb, optlen, 0, htonl(pcb->snd_nxt));
   if (p == NULL) {
@@ -865,10 +1121,27 @@ tcp_send_empty_ack(struct tcp_pcb *pcb)
     tcp_build_timestamp_option(pcb, (u32_t *)(tcphdr + 1));
   }
 #endif 
+#if LWIP_TCP_SACK
+  if (sack_blocks > 0) {
+    u32_t *opts = (u32_t *)(void *)(tcphdr + 1);
+    u8_t i;
+#if LWIP_TCP_TIMESTAMPS
+    if (pcb->flags & TF_TIMESTAMP) {
+      opts += 3;
+    }
+#endif /* LWIP_TCP_TIMESTAMPS */
+    opts[0] = htonl(0x01010500UL | (u32_t)(2 + 8 * sack_blocks));
+    for (i = 0; i < 2 * sack_blocks; i++) {
+      opts[1 + i] = htonl(sack[i]);
+    }
+  }
+#endif /* LWIP_TCP_SACK */
 
 #if CHECKSUM_GEN_TCP
-  tcphdr->chksum = inet_chksum_pseudo(p, &(pcb->local_ip), &(pcb->remote_ip),
-        IP_PROTO_TCP, p->tot_len);
+  if (TCP_CHKSUM_NEEDED(&(pcb->remote_ip))) {
+    tcphdr->chksum = inet_chksum_pseudo(p, &(pcb->local_ip), &(pcb->remote_ip),
+          IP_PROTO_TCP, p->tot_len);
+  }
 #endif
 #if LWIP_NETIF_HWADDRHINT
   ip_output_hinted(p, &(pcb->local_ip), &(pcb->remote_ip), pcb->ttl, pcb->tos,
@@ -894,10 +1167,15 @@ tcp_output(struct tcp_pcb *pcb)
 {
   struct tcp_seg *seg, *useg;
   u32_t wnd, snd_nxt;
+#if LWIP_TCP_RACK
+  u32_t prev_nxt = pcb->snd_nxt;
+#endif /* LWIP_TCP_RACK */
 #if TCP_CWND_DEBUG
   s16_t i = 0;
 #endif /* TCP_CWND_DEBUG */
 
+  PERF_START;
+
   /* First, check if we are invoked by the TCP input processing
      code. If so, we do not output anything. Instead, we rely on the
      input processing code to call us when input processing is done
@@ -906,6 +1184,15 @@ tcp_output(struct tcp_pcb *pcb)
     return ERR_OK;
   }
 
+#if LWIP_TCP_CC
+  if ((pcb->unacked == NULL) && (pcb->unsent != NULL) && (pcb->state >= ESTABLISHED) &&
+      ((u32_t)(tcp_ticks - pcb->tmr) > (u32_t)pcb->rto)) {
+    /* nothing received for more than an RTO since all data was acked:
+       cwnd no longer reflects the path */
+    pcb->cc_ops->on_idle(pcb);
+  }
+#endif /* LWIP_TCP_CC */
+
   wnd = LWIP_MIN(pcb->snd_wnd, pcb->cwnd);
 
   seg = pcb->unsent;
@@ -919,7 +1206,9 @@ tcp_output(struct tcp_pcb *pcb)
   if (pcb->flags & TF_ACK_NOW &&
      (seg == NULL ||
       ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len > wnd)) {
-     return tcp_send_empty_ack(pcb);
+     err_t err = tcp_send_empty_ack(pcb);
+     PERF_STOP("tcp_output");
+     return err;
   }
 
   /* useg should point to last segment on unacked queue */
@@ -936,13 +1225,13 @@ tcp_output(struct tcp_pcb *pcb)
 #endif /* TCP_OUTPUT_DEBUG */
 #if TCP_CWND_DEBUG
   if (seg == NULL) {
-    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"U16_F
-                                 ", cwnd %"U16_F", wnd %"U32_F
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F
+                                 ", cwnd %"TCPWNDSIZE_F", wnd %"U32_F
                                  ", seg == NULL, ack %"U32_F"\n",
                                  pcb->snd_wnd, pcb->cwnd, wnd, pcb->lastack));
   } else {
     LWIP_DEBUGF(TCP_CWND_DEBUG, 
-                ("tcp_output: snd_wnd %"U16_F", cwnd %"U16_F", wnd %"U32_F
+                ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F
                  ", effwnd %"U32_F", seq %"U32_F", ack %"U32_F"\n",
                  pcb->snd_wnd, pcb->cwnd, wnd,
                  ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len,
@@ -966,7 +1255,7 @@ tcp_output(struct tcp_pcb *pcb)
       break;
     }
 #if TCP_CWND_DEBUG
-    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"U16_F", cwnd %"U16_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_output: snd_wnd %"TCPWNDSIZE_F", cwnd %"TCPWNDSIZE_F", wnd %"U32_F", effwnd %"U32_F", seq %"U32_F", ack %"U32_F", i %"S16_F"\n",
                             pcb->snd_wnd, pcb->cwnd, wnd,
                             ntohl(seg->tcphdr->seqno) + seg->len -
                             pcb->lastack,
@@ -977,6 +1266,9 @@ tcp_output(struct tcp_pcb *pcb)
     pcb->unsent = seg->next;
 
     if (pcb->state != SYN_SENT) {
+      if (!(TCPH_FLAGS(seg->tcphdr) & TCP_ACK)) {
+        seg->flags &= ~TF_SEG_HDR_CHECKSUMMED;
+      }
       TCPH_SET_FLAG(seg->tcphdr, TCP_ACK);
       pcb->flags &= ~(TF_ACK_DELAY | TF_ACK_NOW);
     }
@@ -1029,11 +1321,23 @@ tcp_output(struct tcp_pcb *pcb)
   if (seg != NULL && pcb->persist_backoff == 0 && 
       ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len > pcb->snd_wnd) {
     /* prepare for persist timer */
+#if LWIP_TCP_TIMERS_MS
+    pcb->persist_cnt = tcp_ticks;
+#else /* LWIP_TCP_TIMERS_MS */
     pcb->persist_cnt = 0;
+#endif /* LWIP_TCP_TIMERS_MS */
     pcb->persist_backoff = 1;
   }
 
   pcb->flags &= ~TF_NAGLEMEMERR;
+#if LWIP_TCP_RACK
+  if (pcb->snd_nxt != prev_nxt) {
+    /* new data is in flight: (re)start the probe timeout */
+    tcp_tlp_arm(pcb);
+  }
+#endif /* LWIP_TCP_RACK */
+  TCP_TIMER_PCB(pcb);
+  PERF_STOP("tcp_output");
   return ERR_OK;
 }
 
@@ -1049,16 +1353,41 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   u16_t len;
   struct netif *netif;
   u32_t *opts;
+#if CHECKSUM_GEN_TCP
+  u32_t old_ackno;
+  u16_t old_wnd;
+#if LWIP_TCP_TIMESTAMPS
+  u32_t old_ts[2];
+#endif /* LWIP_TCP_TIMESTAMPS */
+#endif /* CHECKSUM_GEN_TCP */
 
   /** @bug Exclude retransmitted segments from this count. */
   snmp_inc_tcpoutsegs();
 
   /* The TCP header has already been constructed, but the ackno and
    wnd fields remain. */
+#if CHECKSUM_GEN_TCP
+  /* remember what the checksum covered when this segment was last sent */
+  old_ackno = seg->tcphdr->ackno;
+  old_wnd = seg->tcphdr->wnd;
+#if LWIP_TCP_TIMESTAMPS
+  /* only read for TF_SEG_OPTS_TS, set below */
+  old_ts[0] = old_ts[1] = 0;
+#endif /* LWIP_TCP_TIMESTAMPS */
+#endif /* CHECKSUM_GEN_TCP */
   seg->tcphdr->ackno = htonl(pcb->rcv_nxt);
 
   /* advertise our receive window size in this TCP segment */
-  seg->tcphdr->wnd = htons(pcb->rcv_ann_wnd);
+#if LWIP_WND_SCALE
+  if (seg->flags & TF_SEG_OPTS_WND_SCALE) {
+    /* The window field of a SYN (the only segment carrying the window
+       scale option) is never scaled. */
+    seg->tcphdr->wnd = htons(TCPWND16(pcb->rcv_ann_wnd));
+  } else
+#endif /* LWIP_WND_SCALE */
+  {
+    seg->tcphdr->wnd = htons(TCPWND16(RCV_WND_SCALE(pcb, pcb->rcv_ann_wnd)));
+  }
 
   pcb->rcv_ann_right_edge = pcb->rcv_nxt + pcb->rcv_ann_wnd;
 
@@ -1074,25 +1403,53 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   pcb->ts_lastacksent = pcb->rcv_nxt;
 
   if (seg->flags & TF_SEG_OPTS_TS) {
+#if CHECKSUM_GEN_TCP
+    old_ts[0] = opts[1];
+    old_ts[1] = opts[2];
+#endif /* CHECKSUM_GEN_TCP */
     tcp_build_timestamp_option(pcb, opts);
     opts += 3;
   }
 #endif
+#if LWIP_WND_SCALE
+  if (seg->flags & TF_SEG_OPTS_WND_SCALE) {
+    tcp_build_wnd_scale_option(opts);
+    opts += 1;
+  }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+  if (seg->flags & TF_SEG_OPTS_SACK_PERM) {
+    /* Pad with two NOP options to make everything nicely aligned */
+    opts[0] = PP_HTONL(0x01010402);
+    opts += 1;
+  }
+#endif /* LWIP_TCP_SACK */
 
   /* Set retransmission timer running if it is not currently enabled 
      This must be set before checking the route. */
-  if (pcb->rtime == -1) {
-    pcb->rtime = 0;
+  if (!TCP_RTIMER_RUNNING(pcb)) {
+    TCP_RTIMER_START(pcb);
   }
+#if LWIP_TCP_RACK
+  seg->xmit_time = tcp_ticks;
+  if (seg->xmit_cnt < 0xff) {
+    seg->xmit_cnt++;
+  }
+#endif /* LWIP_TCP_RACK */
 
   /* If we don't have a local IP address, we get one by
      calling ip_route(). */
   if (ip_addr_isany(&(pcb->local_ip))) {
     netif = ip_route(&(pcb->remote_ip));
     if (netif == NULL) {
+      /* the header has been changed, the checksum has not */
+      seg->flags &= ~TF_SEG_HDR_CHECKSUMMED;
       return;
     }
+    /* the local IP is part of the demultiplexing hash key */
+    TCP_HASH_RMV(&tcp_active_pcbs, pcb);
     ip_addr_copy(pcb->local_ip, netif->ip_addr);
+    TCP_HASH_REG(&tcp_active_pcbs, pcb);
   }
 
   if (pcb->rttest == 0) {
@@ -1112,46 +1469,69 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
 
   seg->p->payload = seg->tcphdr;
 
-  seg->tcphdr->chksum = 0;
 #if CHECKSUM_GEN_TCP
+  if (!TCP_CHKSUM_NEEDED(&(pcb->remote_ip))) {
+    /* the netif computes the checksum */
+    seg->tcphdr->chksum = 0;
+    seg->flags &= ~TF_SEG_HDR_CHECKSUMMED;
+  } else if (seg->flags & TF_SEG_HDR_CHECKSUMMED) {
+    /* retransmission: only ackno, wnd and the timestamps can have changed,
+       update the checksum instead of summing the whole segment again */
+    u16_t chksum = seg->tcphdr->chksum;
+    chksum = inet_chksum_adjust32(chksum, old_ackno, seg->tcphdr->ackno);
+    chksum = inet_chksum_adjust16(chksum, old_wnd, seg->tcphdr->wnd);
+#if LWIP_TCP_TIMESTAMPS
+    if (seg->flags & TF_SEG_OPTS_TS) {
+      opts = (u32_t *)(void *)(seg->tcphdr + 1) + ((seg->flags & TF_SEG_OPTS_MSS) ? 1 : 0);
+      chksum = inet_chksum_adjust32(chksum, old_ts[0], opts[1]);
+      chksum = inet_chksum_adjust32(chksum, old_ts[1], opts[2]);
+    }
+#endif /* LWIP_TCP_TIMESTAMPS */
+    seg->tcphdr->chksum = chksum;
+  } else {
+    seg->tcphdr->chksum = 0;
 #if TCP_CHECKSUM_ON_COPY
-  {
-    u32_t acc;
+    {
+      u32_t acc;
 #if TCP_CHECKSUM_ON_COPY_SANITY_CHECK
-    u16_t chksum_slow = inet_chksum_pseudo(seg->p, &(pcb->local_ip),
-           &(pcb->remote_ip),
-           IP_PROTO_TCP, seg->p->tot_len);
+      u16_t chksum_slow = inet_chksum_pseudo(seg->p, &(pcb->local_ip),
+             &(pcb->remote_ip),
+             IP_PROTO_TCP, seg->p->tot_len);
 #endif /* TCP_CHECKSUM_ON_COPY_SANITY_CHECK */
-    if ((seg->flags & TF_SEG_DATA_CHECKSUMMED) == 0) {
-      LWIP_ASSERT("data included but not checksummed",
-        seg->p->tot_len == (TCPH_HDRLEN(seg->tcphdr) * 4));
-    }
+      if ((seg->flags & TF_SEG_DATA_CHECKSUMMED) == 0) {
+        LWIP_ASSERT("data included but not checksummed",
+          seg->p->tot_len == (TCPH_HDRLEN(seg->tcphdr) * 4));
+      }
 
-    /* rebuild TCP header checksum (TCP header changes for retransmissions!) */
-    acc = inet_chksum_pseudo_partial(seg->p, &(pcb->local_ip),
-             &(pcb->remote_ip),
-             IP_PROTO_TCP, seg->p->tot_len, TCPH_HDRLEN(seg->tcphdr) * 4);
-    /* add payload checksum */
-    if (seg->chksum_swapped) {
-      seg->chksum = SWAP_BYTES_IN_WORD(seg->chksum);
-      seg->chksum_swapped = 0;
-    }
-    acc += (u16_t)~(seg->chksum);
-    seg->tcphdr->chksum = FOLD_U32T(acc);
+      /* rebuild TCP header checksum (TCP header changes for retransmissions!) */
+      acc = inet_chksum_pseudo_partial(seg->p, &(pcb->local_ip),
+               &(pcb->remote_ip),
+               IP_PROTO_TCP, seg->p->tot_len, TCPH_HDRLEN(seg->tcphdr) * 4);
+      /* add payload checksum */
+      if (seg->chksum_swapped) {
+        seg->chksum = SWAP_BYTES_IN_WORD(seg->chksum);
+        seg->chksum_swapped = 0;
+      }
+      acc += (u16_t)~(seg->chksum);
+      seg->tcphdr->chksum = FOLD_U32T(acc);
 #if TCP_CHECKSUM_ON_COPY_SANITY_CHECK
-    if (chksum_slow != seg->tcphdr->chksum) {
-      LWIP_DEBUGF(TCP_DEBUG | LWIP_DBG_LEVEL_WARNING,
-                  ("tcp_output_segment: calculated checksum is %"X16_F" instead of %"X16_F"\n",
-                  seg->tcphdr->chksum, chksum_slow));
-      seg->tcphdr->chksum = chksum_slow;
-    }
+      if (chksum_slow != seg->tcphdr->chksum) {
+        LWIP_DEBUGF(TCP_DEBUG | LWIP_DBG_LEVEL_WARNING,
+                    ("tcp_output_segment: calculated checksum is %"X16_F" instead of %"X16_F"\n",
+                    seg->tcphdr->chksum, chksum_slow));
+        seg->tcphdr->chksum = chksum_slow;
+      }
 #endif /* TCP_CHECKSUM_ON_COPY_SANITY_CHECK */
-  }
+    }
 #else /* TCP_CHECKSUM_ON_COPY */
-  seg->tcphdr->chksum = inet_chksum_pseudo(seg->p, &(pcb->local_ip),
-         &(pcb->remote_ip),
-         IP_PROTO_TCP, seg->p->tot_len);
+    seg->tcphdr->chksum = inet_chksum_pseudo(seg->p, &(pcb->local_ip),
+           &(pcb->remote_ip),
+           IP_PROTO_TCP, seg->p->tot_len);
 #endif /* TCP_CHECKSUM_ON_COPY */
+    seg->flags |= TF_SEG_HDR_CHECKSUMMED;
+  }
+#else /* CHECKSUM_GEN_TCP */
+  seg->tcphdr->chksum = 0;
 #endif /* CHECKSUM_GEN_TCP */
   TCP_STATS_INC(tcp.xmit);
 
@@ -1205,13 +1585,15 @@ tcp_rst(u32_t seqno, u32_t ackno,
   tcphdr->seqno = htonl(seqno);
   tcphdr->ackno = htonl(ackno);
   TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN/4, TCP_RST | TCP_ACK);
-  tcphdr->wnd = PP_HTONS(TCP_WND);
+  tcphdr->wnd = PP_HTONS(TCPWND16(TCP_WND));
   tcphdr->chksum = 0;
   tcphdr->urgp = 0;
 
 #if CHECKSUM_GEN_TCP
-  tcphdr->chksum = inet_chksum_pseudo(p, local_ip, remote_ip,
-              IP_PROTO_TCP, p->tot_len);
+  if (TCP_CHKSUM_NEEDED(remote_ip)) {
+    tcphdr->chksum = inet_chksum_pseudo(p, local_ip, remote_ip,
+                IP_PROTO_TCP, p->tot_len);
+  }
 #endif
   TCP_STATS_INC(tcp.xmit);
   snmp_inc_tcpoutrsts();
@@ -1221,6 +1603,60 @@ tcp_rst(u32_t seqno, u32_t ackno,
   LWIP_DEBUGF(TCP_RST_DEBUG, ("tcp_rst: seqno %"U32_F" ackno %"U32_F".\n", seqno, ackno));
 }
 
+#if TCP_SYNCOOKIES
+/**
+ * Send a SYN|ACK with the MSS option without a pcb, used to answer a SYN
+ * with a SYN cookie. Like tcp_rst(), this is a one-shot segment that is
+ * never retransmitted: if it is lost, the peer retransmits its SYN.
+ *
+ * @param seqno the cookie to send as ISS
+ * @param ackno the sequence number of the SYN plus one
+ * @param local_ip the local ip address to send the SYN|ACK from
+ * @param remote_ip the remote ip address to send the SYN|ACK to
+ * @param local_port the local TCP port to send the SYN|ACK from
+ * @param remote_port the remote TCP port to send the SYN|ACK to
+ */
+void
+tcp_synack(u32_t seqno, u32_t ackno,
+  ip_addr_t *local_ip, ip_addr_t *remote_ip,
+  u16_t local_port, u16_t remote_port)
+{
+  struct pbuf *p;
+  struct tcp_hdr *tcphdr;
+  p = pbuf_alloc(PBUF_IP, TCP_HLEN + 4, PBUF_RAM);
+  if (p == NULL) {
+      LWIP_DEBUGF(TCP_DEBUG, ("tcp_synack: could not allocate memory for pbuf\n"));
+      return;
+  }
+  LWIP_ASSERT("check that first pbuf can hold struct tcp_hdr",
+              (p->len >= sizeof(struct tcp_hdr) + 4));
+
+  tcphdr = (struct tcp_hdr *)p->payload;
+  tcphdr->src = htons(local_port);
+  tcphdr->dest = htons(remote_port);
+  tcphdr->seqno = htonl(seqno);
+  tcphdr->ackno = htonl(ackno);
+  TCPH_HDRLEN_FLAGS_SET(tcphdr, (TCP_HLEN + 4)/4, TCP_SYN | TCP_ACK);
+  /* no window scale option: the window is announced unscaled */
+  tcphdr->wnd = PP_HTONS(TCPWND16(TCP_WND));
+  tcphdr->chksum = 0;
+  tcphdr->urgp = 0;
+  TCP_BUILD_MSS_OPTION(*(u32_t *)(void *)(tcphdr + 1));
+
+#if CHECKSUM_GEN_TCP
+  if (TCP_CHKSUM_NEEDED(remote_ip)) {
+    tcphdr->chksum = inet_chksum_pseudo(p, local_ip, remote_ip,
+                IP_PROTO_TCP, p->tot_len);
+  }
+#endif
+  TCP_STATS_INC(tcp.xmit);
+  /* Send output with hardcoded TTL since we have no access to the pcb */
+  ip_output(p, local_ip, remote_ip, TCP_TTL, 0, IP_PROTO_TCP);
+  pbuf_free(p);
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_synack: seqno %"U32_F" ackno %"U32_F".\n", seqno, ackno));
+}
+#endif /* TCP_SYNCOOKIES */
+
 /**
  * Requeue all unacked segments for retransmission
  *
@@ -1242,8 +1678,19 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
 
 #if 1 /* by Snake: resolve the bug of pbuf reuse */
   seg = pcb->unacked;
+#if LWIP_TCP_SACK
+  /* SACK blocks never cover the first unacked segment unless the peer
+     has dropped (reneged) data it reported, so retransmit that one
+     anyway; the hole marks are reset as everything is resent */
+  seg->flags &= ~TF_SEG_SACKED;
+#endif /* LWIP_TCP_SACK */
   while (seg != NULL) {
+#if LWIP_TCP_SACK
+	seg->flags &= ~TF_SEG_REXMIT_HOLE;
+	if (seg->p->eb || (seg->flags & TF_SEG_SACKED)) {
+#else /* LWIP_TCP_SACK */
 	if (seg->p->eb) {
+#endif /* LWIP_TCP_SACK */
 		if (t0_1st) {
 			t0_head = t0_tail = seg;
 			t0_1st = false;
@@ -1293,8 +1740,86 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
   tcp_output(pcb);
 }
 
+/**
+ * Insert a segment taken off pcb->unacked into pcb->unsent,
+ * keeping the unsent queue sorted.
+ *
+ * @param pcb the tcp_pcb the segment belongs to
+ * @param seg the segment to retransmit
+ */
+static void
+tcp_rexmit_enqueue(struct tcp_pcb *pcb, struct tcp_seg *seg)
+{
+  struct tcp_seg **cur_seg;
+
+  cur_seg = &(pcb->unsent);
+  while (*cur_seg &&
+    TCP_SEQ_LT(ntohl((*cur_seg)->tcphdr->seqno), ntohl(seg->tcphdr->seqno))) {
+      cur_seg = &((*cur_seg)->next );
+  }
+  seg->next = *cur_seg;
+  *cur_seg = seg;
+}
+
+#if LWIP_TCP_SACK
+/** Number of SACKed segments above a hole before it is considered lost
+ * (DupThresh of RFC 6675), so that mere reordering does not trigger it */
+#define TCP_SACK_DUPTHRESH 3
+
+/**
+ * Requeue the holes of the SACK scoreboard for retransmission: unacked
+ * segments the peer has not SACKed, with at least TCP_SACK_DUPTHRESH
+ * SACKed segments above them. Each hole is resent once until the next
+ * RTO; segments still referenced by the driver (p->eb) are left alone.
+ *
+ * Called by tcp_rexmit() and by tcp_receive() on ACKs carrying SACK
+ * blocks.
+ *
+ * @param pcb the tcp_pcb for which to retransmit the holes
+ * @return number of segments requeued
+ */
+u8_t
+tcp_rexmit_holes(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg, **cur_seg;
+  u16_t sacked = 0;
+  u8_t n = 0;
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked++;
+    }
+  }
+  cur_seg = &(pcb->unacked);
+  while ((*cur_seg != NULL) && (sacked >= TCP_SACK_DUPTHRESH)) {
+    seg = *cur_seg;
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked--;
+      cur_seg = &(seg->next);
+    } else if ((seg->flags & TF_SEG_REXMIT_HOLE) || (seg->p->eb != NULL)) {
+      cur_seg = &(seg->next);
+    } else {
+      LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_rexmit_holes: %"U32_F":%"U32_F"\n",
+                                 ntohl(seg->tcphdr->seqno),
+                                 ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg)));
+      *cur_seg = seg->next;
+      seg->flags |= TF_SEG_REXMIT_HOLE;
+      tcp_rexmit_enqueue(pcb, seg);
+      snmp_inc_tcpretranssegs();
+      n++;
+    }
+  }
+  if (n > 0) {
+    /* Don't take any rtt measurements after retransmitting. */
+    pcb->rttest = 0;
+  }
+  return n;
+}
+#endif /* LWIP_TCP_SACK */
+
 /**
  * Requeue the first unacked segment for retransmission
+ * (and, with SACK, the holes reported by the peer)
  *
  * Called by tcp_receive() for fast retramsmit.
  *
@@ -1304,24 +1829,22 @@ void
 tcp_rexmit(struct tcp_pcb *pcb)
 {
   struct tcp_seg *seg;
-  struct tcp_seg **cur_seg;
 
   if (pcb->unacked == NULL) {
     return;
   }
 
   /* Move the first unacked segment to the unsent queue */
-  /* Keep the unsent queue sorted. */
   seg = pcb->unacked;
   pcb->unacked = seg->next;
-
-  cur_seg = &(pcb->unsent);
-  while (*cur_seg &&
-    TCP_SEQ_LT(ntohl((*cur_seg)->tcphdr->seqno), ntohl(seg->tcphdr->seqno))) {
-      cur_seg = &((*cur_seg)->next );
+  tcp_rexmit_enqueue(pcb, seg);
+#if LWIP_TCP_SACK
+  if (pcb->flags & TF_SACK) {
+    /* with SACK, also resend the holes the peer has reported */
+    seg->flags |= TF_SEG_REXMIT_HOLE;
+    tcp_rexmit_holes(pcb);
   }
-  seg->next = *cur_seg;
-  *cur_seg = seg;
+#endif /* LWIP_TCP_SACK */
 
   ++pcb->nrtx;
 
@@ -1335,6 +1858,51 @@ tcp_rexmit(struct tcp_pcb *pcb)
 }
 
 
+/** Fast recovery may be entered: not yet in it and, with LWIP_TCP_CC,
+ * not for losses from the window of the last one (RFC 6582) */
+#if LWIP_TCP_CC
+#define TCP_FR_ALLOWED(pcb) (!((pcb)->flags & TF_INFR) && \
+                             TCP_SEQ_GEQ((pcb)->lastack, (pcb)->recover))
+#else /* LWIP_TCP_CC */
+#define TCP_FR_ALLOWED(pcb) (!((pcb)->flags & TF_INFR))
+#endif /* LWIP_TCP_CC */
+
+/**
+ * Reduce the congestion window for a loss and enter fast recovery.
+ *
+ * @param pcb the tcp_pcb that detected the loss
+ */
+static void
+tcp_enter_fast_recovery(struct tcp_pcb *pcb)
+{
+#if LWIP_TCP_CC
+  pcb->recover = pcb->snd_nxt;
+  pcb->cc_ops->on_loss(pcb);
+  LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_receive: %s ssthresh %"TCPWNDSIZE_F" cwnd %"TCPWNDSIZE_F"\n",
+                             pcb->cc_ops->name, pcb->ssthresh, pcb->cwnd));
+#else /* LWIP_TCP_CC */
+  /* Set ssthresh to half of the minimum of the current
+   * cwnd and the advertised window */
+  if (pcb->cwnd > pcb->snd_wnd) {
+    pcb->ssthresh = pcb->snd_wnd / 2;
+  } else {
+    pcb->ssthresh = pcb->cwnd / 2;
+  }
+  
+  /* The minimum value for ssthresh should be 2 MSS */
+  if (pcb->ssthresh < 2*pcb->mss) {
+    LWIP_DEBUGF(TCP_FR_DEBUG, 
+                ("tcp_receive: The minimum value for ssthresh %"TCPWNDSIZE_F
+                 " should be min 2 mss %"U16_F"...\n",
+                 pcb->ssthresh, 2*pcb->mss));
+    pcb->ssthresh = 2*pcb->mss;
+  }
+  
+  pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
+#endif /* LWIP_TCP_CC */
+  pcb->flags |= TF_INFR;
+}
+
 /**
  * Handle retransmission after three dupacks received
  *
@@ -1343,7 +1911,7 @@ tcp_rexmit(struct tcp_pcb *pcb)
 void 
 tcp_rexmit_fast(struct tcp_pcb *pcb)
 {
-  if (pcb->unacked != NULL && !(pcb->flags & TF_INFR)) {
+  if (pcb->unacked != NULL && TCP_FR_ALLOWED(pcb)) {
     /* This is fast retransmit. Retransmit the first unacked segment. */
     LWIP_DEBUGF(TCP_FR_DEBUG, 
                 ("tcp_receive: dupacks %"U16_F" (%"U32_F
@@ -1351,29 +1919,180 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
                  (u16_t)pcb->dupacks, pcb->lastack,
                  ntohl(pcb->unacked->tcphdr->seqno)));
     tcp_rexmit(pcb);
+    tcp_enter_fast_recovery(pcb);
+  } 
+}
 
-    /* Set ssthresh to half of the minimum of the current
-     * cwnd and the advertised window */
-    if (pcb->cwnd > pcb->snd_wnd) {
-      pcb->ssthresh = pcb->snd_wnd / 2;
-    } else {
-      pcb->ssthresh = pcb->cwnd / 2;
+#if LWIP_TCP_RACK
+/** Lower bound of the probe timeout in milliseconds, so that sub-millisecond
+ * round-trips on a LAN don't send a probe after every burst */
+#define TCP_TLP_PTO_MIN    10
+/** Worst case delayed ACK time of the peer, added to the probe timeout if
+ * only one segment is in flight (WCDelAckT of RFC 8985) */
+#define TCP_TLP_WCDELACK   200
+
+/** 'xmit_time'/'end_seq' was sent before the RACK segment of 'pcb' */
+#define TCP_RACK_SENT_BEFORE(pcb, xmit_time, end_seq) \
+  (((s32_t)((xmit_time) - (pcb)->rack_xmit_time) < 0) || \
+   (((xmit_time) == (pcb)->rack_xmit_time) && TCP_SEQ_LT((end_seq), (pcb)->rack_end_seq)))
+
+/**
+ * Mark unacked segments lost by time (RFC 8985, section 6.2): a segment
+ * not SACKed although one sent after it has been delivered is requeued
+ * for retransmission once it has been outstanding for the RTT of that
+ * segment plus a reordering window. If that time has not come for all of
+ * them, the reordering timer is armed for the rest. The first loss found
+ * enters fast recovery.
+ *
+ * Called by tcp_receive() on ACKs on connections using SACK and when the
+ * reordering timer expires.
+ *
+ * @param pcb the tcp_pcb to check the unacked segments of
+ */
+void
+tcp_rack_detect_loss(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg, **cur_seg;
+  u32_t reo_wnd, end_seq, wait = 0;
+  s32_t remaining;
+  u8_t n = 0;
+
+  /* a quarter of the minimum RTT, but not more than SRTT, and at least
+     one tick of the clock the send times are taken with */
+  reo_wnd = LWIP_MIN(pcb->rack_min_rtt / 4, (u32_t)(pcb->sa >> 3));
+  reo_wnd = LWIP_MAX(reo_wnd, 1);
+  pcb->flags &= ~TF_RACK_REO;
+
+  cur_seg = &(pcb->unacked);
+  while (*cur_seg != NULL) {
+    seg = *cur_seg;
+    end_seq = ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
+    if ((seg->flags & TF_SEG_SACKED) || (seg->p->eb != NULL) || (seg->xmit_cnt == 0) ||
+        !TCP_RACK_SENT_BEFORE(pcb, seg->xmit_time, end_seq)) {
+      cur_seg = &(seg->next);
+      continue;
     }
-    
-    /* The minimum value for ssthresh should be 2 MSS */
-    if (pcb->ssthresh < 2*pcb->mss) {
-      LWIP_DEBUGF(TCP_FR_DEBUG, 
-                  ("tcp_receive: The minimum value for ssthresh %"U16_F
-                   " should be min 2 mss %"U16_F"...\n",
-                   pcb->ssthresh, 2*pcb->mss));
-      pcb->ssthresh = 2*pcb->mss;
+    remaining = (s32_t)(seg->xmit_time + pcb->rack_rtt + reo_wnd - tcp_ticks);
+    if (remaining > 0) {
+      wait = LWIP_MAX(wait, (u32_t)remaining);
+      cur_seg = &(seg->next);
+      continue;
     }
-    
-    pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
-    pcb->flags |= TF_INFR;
-  } 
+    LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_rack_detect_loss: %"U32_F":%"U32_F" lost\n",
+                               ntohl(seg->tcphdr->seqno), end_seq));
+    *cur_seg = seg->next;
+    seg->flags |= TF_SEG_REXMIT_HOLE;
+    tcp_rexmit_enqueue(pcb, seg);
+    snmp_inc_tcpretranssegs();
+    n++;
+  }
+
+  if (wait > 0) {
+    /* check the others again when their reordering window has passed */
+    pcb->rack_tmr = tcp_ticks + wait;
+    pcb->flags = (tcpflags_t)((pcb->flags & ~TF_TLP_PTO) | TF_RACK_REO);
+  }
+  if (n > 0) {
+    /* Don't take any rtt measurements after retransmitting. */
+    pcb->rttest = 0;
+    pcb->flags &= ~TF_TLP_PTO;
+    if (TCP_FR_ALLOWED(pcb)) {
+      tcp_enter_fast_recovery(pcb);
+    }
+  }
 }
 
+/**
+ * Start or restart the tail loss probe timeout (RFC 8985, section 7.2)
+ * while data is in flight, unless the connection is recovering from a
+ * loss already or the RTO would expire first.
+ *
+ * Called by tcp_output() after sending new data and by tcp_receive() on
+ * ACKs for new data.
+ *
+ * @param pcb the tcp_pcb to arm the probe timeout for
+ */
+void
+tcp_tlp_arm(struct tcp_pcb *pcb)
+{
+  u32_t srtt, pto;
+
+  pcb->flags &= ~TF_TLP_PTO;
+  if (!(pcb->flags & TF_SACK) || (pcb->flags & (TF_INFR | TF_RACK_REO | TF_TLP_SENT)) ||
+      (pcb->state < ESTABLISHED) || (pcb->unacked == NULL) || (pcb->nrtx != 0) ||
+      (pcb->persist_backoff != 0) || (pcb->sa == 0) || !TCP_RTIMER_RUNNING(pcb)) {
+    return;
+  }
+  srtt = (u32_t)(pcb->sa >> 3);
+  pto = LWIP_MAX(2 * srtt, TCP_TLP_PTO_MIN);
+  if (pcb->unacked->next == NULL) {
+    /* the ACK for a single segment may be delayed by the peer */
+    pto = LWIP_MAX(pto, srtt + srtt / 2 + TCP_TLP_WCDELACK);
+  }
+  if ((s32_t)(pcb->rtime_start + (u32_t)pcb->rto - (tcp_ticks + pto)) <= 0) {
+    /* the RTO comes first anyway */
+    return;
+  }
+  pcb->rack_tmr = tcp_ticks + pto;
+  pcb->flags |= TF_TLP_PTO;
+}
+
+/**
+ * Send a tail loss probe (RFC 8985, section 7.3): the last segment in
+ * flight once more, so that the peer answers with an ACK whose SACK
+ * blocks reveal the loss of the segments before it. The segment stays on
+ * pcb->unacked as the Nagle algorithm could hold it back on pcb->unsent.
+ *
+ * @param pcb the tcp_pcb to send the probe for
+ */
+static void
+tcp_tlp_send(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+
+  if (pcb->unacked == NULL) {
+    return;
+  }
+  for (seg = pcb->unacked; seg->next != NULL; seg = seg->next);
+  if (seg->p->eb != NULL) {
+    /* still referenced by the driver, leave it to the RTO */
+    return;
+  }
+  LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_tlp_send: probe %"U32_F":%"U32_F"\n",
+                             ntohl(seg->tcphdr->seqno),
+                             ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg)));
+  pcb->flags |= TF_TLP_SENT;
+  pcb->tlp_end_seq = pcb->snd_nxt;
+  tcp_output_segment(seg, pcb);
+  pcb->flags &= ~(TF_ACK_DELAY | TF_ACK_NOW);
+  /* the ACK may be for the original: don't time the probe, and give it
+     a full RTO before the retransmission timer strikes */
+  pcb->rttest = 0;
+  TCP_RTIMER_START(pcb);
+  snmp_inc_tcpretranssegs();
+}
+
+/**
+ * Handle the expiry of the RACK reordering timer or of the tail loss
+ * probe timeout, whichever pcb->rack_tmr was armed for.
+ *
+ * Called by tcp_slowtmr()
+ *
+ * @param pcb the tcp_pcb whose timer expired
+ */
+void
+tcp_rack_timeout(struct tcp_pcb *pcb)
+{
+  if (pcb->flags & TF_RACK_REO) {
+    tcp_rack_detect_loss(pcb);
+    tcp_output(pcb);
+  } else {
+    pcb->flags &= ~TF_TLP_PTO;
+    tcp_tlp_send(pcb);
+  }
+}
+#endif /* LWIP_TCP_RACK */
+
 
 /**
  * Send keepalive packets to keep a connection active although
@@ -1405,8 +2124,10 @@ tcp_keepalive(struct tcp_pcb *pcb)
   tcphdr = (struct tcp_hdr *)p->payload;
 
 #if CHECKSUM_GEN_TCP
-  tcphdr->chksum = inet_chksum_pseudo(p, &pcb->local_ip, &pcb->remote_ip,
-                                      IP_PROTO_TCP, p->tot_len);
+  if (TCP_CHKSUM_NEEDED(&pcb->remote_ip)) {
+    tcphdr->chksum = inet_chksum_pseudo(p, &pcb->local_ip, &pcb->remote_ip,
+                                        IP_PROTO_TCP, p->tot_len);
+  }
 #endif
   TCP_STATS_INC(tcp.xmit);
 
@@ -1495,8 +2216,10 @@ tcp_zero_window_probe(struct tcp_pcb *pcb)
   }
 
 #if CHECKSUM_GEN_TCP
-  tcphdr->chksum = inet_chksum_pseudo(p, &pcb->local_ip, &pcb->remote_ip,
-                                      IP_PROTO_TCP, p->tot_len);
+  if (TCP_CHKSUM_NEEDED(&pcb->remote_ip)) {
+    tcphdr->chksum = inet_chksum_pseudo(p, &pcb->local_ip, &pcb->remote_ip,
+                                        IP_PROTO_TCP, p->tot_len);
+  }
 #endif
   TCP_STATS_INC(tcp.xmit);
 
@@ -70,6 +70,10 @@ static u32_t timeouts_last_time;
 #if LWIP_TCP
 /** global variable that shows if the tcp timer is currently scheduled or not */
 static int tcpip_tcp_timer_active;
+#if LWIP_TCP_TIMERS_MS
+/** sys_now() the tcp timer is scheduled for, if active */
+static u32_t tcpip_tcp_timer_time;
+#endif /* LWIP_TCP_TIMERS_MS */
 
 /**
  * Timer callback function that calls tcp_tmr() and reschedules itself.
@@ -81,6 +85,13 @@ tcpip_tcp_timer(void *arg)
 {
   LWIP_UNUSED_ARG(arg);
 
+#if LWIP_TCP_TIMERS_MS
+  tcpip_tcp_timer_active = 0;
+  /* call TCP timer handler */
+  tcp_tmr();
+  /* sleep until the next deadline, if any */
+  tcp_timer_needed_ms(tcp_next_timeout());
+#else /* LWIP_TCP_TIMERS_MS */
   /* call TCP timer handler */
   tcp_tmr();
   /* timer still needed? */
@@ -91,6 +102,7 @@ tcpip_tcp_timer(void *arg)
     /* disable timer */
     tcpip_tcp_timer_active = 0;
   }
+#endif /* LWIP_TCP_TIMERS_MS */
 }
 
 /**
@@ -101,13 +113,50 @@ tcpip_tcp_timer(void *arg)
 void
 tcp_timer_needed(void)
 {
+#if LWIP_TCP_TIMERS_MS
+  /* let the next run look at the new pcb */
+  if (tcp_active_pcbs || tcp_tw_pcbs) {
+    tcp_timer_needed_ms(TCP_SLOW_INTERVAL);
+  }
+#else /* LWIP_TCP_TIMERS_MS */
   /* timer is off but needed again? */
   if (!tcpip_tcp_timer_active && (tcp_active_pcbs || tcp_tw_pcbs)) {
     /* enable and start timer */
     tcpip_tcp_timer_active = 1;
     sys_timeout(TCP_TMR_INTERVAL, tcpip_tcp_timer, NULL);
   }
+#endif /* LWIP_TCP_TIMERS_MS */
 }
+
+#if LWIP_TCP_TIMERS_MS
+/**
+ * Called when TCP arms a timer (LWIP_TCP_TIMERS_MS): (re)schedule the tcp
+ * timer unless it already runs in time.
+ *
+ * @param msecs run tcp_tmr() after at most this many milliseconds,
+ *              TCP_TMR_NONE for nothing to do
+ */
+void
+tcp_timer_needed_ms(u32_t msecs)
+{
+  u32_t time;
+
+  if (msecs == TCP_TMR_NONE) {
+    return;
+  }
+  time = sys_now() + msecs;
+  if (tcpip_tcp_timer_active) {
+    if ((s32_t)(time - tcpip_tcp_timer_time) >= 0) {
+      /* runs early enough */
+      return;
+    }
+    sys_untimeout(tcpip_tcp_timer, NULL);
+  }
+  tcpip_tcp_timer_active = 1;
+  tcpip_tcp_timer_time = time;
+  sys_timeout(msecs, tcpip_tcp_timer, NULL);
+}
+#endif /* LWIP_TCP_TIMERS_MS */
 #endif /* LWIP_TCP */
 
 #if IP_REASSEMBLY
@@ -367,6 +416,11 @@ sys_check_timeouts(void)
   int had_one;
   u32_t now;
 
+#if LWIP_RECLAIM
+  /* run the reclaim handlers if memory got short since the last call */
+  reclaim_poll();
+#endif /* LWIP_RECLAIM */
+
   now = sys_now();
   if (next_timeout) {
     /* this cares for wraparounds */
@@ -484,4 +538,11 @@ void
 tcp_timer_needed(void)
 {
 }
+#if LWIP_TCP_TIMERS_MS
+void
+tcp_timer_needed_ms(u32_t msecs)
+{
+  LWIP_UNUSED_ARG(msecs);
+}
+#endif /* LWIP_TCP_TIMERS_MS */
 #endif /* LWIP_TIMERS */
@@ -59,7 +59,7 @@
 #include "lwip/icmp.h"
 #include "lwip/stats.h"
 #include "lwip/snmp.h"
-#include "arch/perf.h"
+#include "lwip/perf.h"
 #include "lwip/dhcp.h"
 
 #include <string.h>
@@ -68,6 +68,100 @@
 /* exported in udp.h (was static) */
 struct udp_pcb *udp_pcbs;
 
+#if UDP_PCB_HASH
+/* The pcbs of udp_pcbs are also chained (through hash_next) into one of two
+   hash tables: pcbs connected to a remote IP address are hashed by local
+   port and remote address/port, all others by local port. The key fields
+   are only changed in this file, with the pcb unhashed meanwhile. */
+static struct udp_pcb *udp_conn_hash[UDP_PCB_HASH_SIZE];
+static struct udp_pcb *udp_port_hash[UDP_PCB_HASH_SIZE];
+
+#define UDP_PORT_HASH(port) (((port) ^ ((port) >> 8)) & (UDP_PCB_HASH_SIZE - 1))
+#define UDP_PCB_IS_CONN(pcb) ((((pcb)->flags & UDP_FLAGS_CONNECTED) != 0) && \
+                              !ip_addr_isany(&(pcb)->remote_ip))
+
+/** Bucket index in udp_conn_hash */
+static u16_t
+udp_conn_hash_idx(u16_t local_port, ip_addr_t *remote_ip, u16_t remote_port)
+{
+  u32_t h = ip4_addr_get_u32(remote_ip) ^ (((u32_t)local_port << 16) | remote_port);
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return (u16_t)(h & (UDP_PCB_HASH_SIZE - 1));
+}
+
+/** Returns the hash bucket pcb belongs to with its current key fields */
+static struct udp_pcb **
+udp_hash_bucket(struct udp_pcb *pcb)
+{
+  if (UDP_PCB_IS_CONN(pcb)) {
+    return &udp_conn_hash[udp_conn_hash_idx(pcb->local_port, &pcb->remote_ip, pcb->remote_port)];
+  }
+  return &udp_port_hash[UDP_PORT_HASH(pcb->local_port)];
+}
+
+/** Add a pcb on udp_pcbs to its hash bucket */
+static void
+udp_hash_reg(struct udp_pcb *pcb)
+{
+  struct udp_pcb **bucket = udp_hash_bucket(pcb);
+  pcb->hash_next = *bucket;
+  *bucket = pcb;
+}
+
+/**
+ * Remove a pcb from its hash bucket (before changing its key fields).
+ *
+ * @return 1 if pcb was hashed, 0 if not (not on udp_pcbs)
+ */
+static u8_t
+udp_hash_rmv(struct udp_pcb *pcb)
+{
+  struct udp_pcb **bucket;
+
+  for (bucket = udp_hash_bucket(pcb); *bucket != NULL; bucket = &(*bucket)->hash_next) {
+    if (*bucket == pcb) {
+      *bucket = pcb->hash_next;
+      pcb->hash_next = NULL;
+      return 1;
+    }
+  }
+  return 0;
+}
+#define UDP_HASH_REG(pcb) udp_hash_reg(pcb)
+#define UDP_HASH_RMV(pcb) udp_hash_rmv(pcb)
+#else /* UDP_PCB_HASH */
+#define UDP_HASH_REG(pcb)
+#define UDP_HASH_RMV(pcb)
+#endif /* UDP_PCB_HASH */
+
+/**
+ * Check whether a pcb's local address and port match the destination of the
+ * datagram being processed.
+ *
+ * @param pcb the pcb to check
+ * @param dest destination port of the datagram (host byte order)
+ * @param broadcast whether the datagram was sent to a broadcast address
+ * @return 1 if the pcb may receive the datagram, 0 otherwise
+ */
+static u8_t
+udp_input_local_match(struct udp_pcb *pcb, u16_t dest, u8_t broadcast)
+{
+  /* compare PCB local addr+port to UDP destination addr+port */
+  return ((pcb->local_port == dest) &&
+          ((!broadcast && ip_addr_isany(&pcb->local_ip)) ||
+           ip_addr_cmp(&(pcb->local_ip), &current_iphdr_dest) ||
+#if LWIP_IGMP
+           ip_addr_ismulticast(&current_iphdr_dest) ||
+#endif /* LWIP_IGMP */
+#if IP_SOF_BROADCAST_RECV
+           (broadcast && (pcb->so_options & SOF_BROADCAST))));
+#else  /* IP_SOF_BROADCAST_RECV */
+           (broadcast)));
+#endif /* IP_SOF_BROADCAST_RECV */
+}
+
 /**
  * Process an incoming UDP datagram.
  *
@@ -159,6 +253,37 @@ udp_input(struct pbuf *p, struct netif *inp)
      * 'Perfect match' pcbs (connected to the remote port & ip address) are
      * preferred. If no perfect match is found, the first unconnected pcb that
      * matches the local port and ip address gets the datagram. */
+#if UDP_PCB_HASH
+    /* a pcb connected to the source is a perfect match */
+    for (pcb = udp_conn_hash[udp_conn_hash_idx(dest, &current_iphdr_src, src)];
+         pcb != NULL; pcb = pcb->hash_next) {
+      if ((pcb->remote_port == src) &&
+          ip_addr_cmp(&(pcb->remote_ip), &current_iphdr_src) &&
+          udp_input_local_match(pcb, dest, broadcast)) {
+        break;
+      }
+    }
+    if (pcb == NULL) {
+      /* the others are found by local port */
+      for (pcb = udp_port_hash[UDP_PORT_HASH(dest)]; pcb != NULL; pcb = pcb->hash_next) {
+        if (udp_input_local_match(pcb, dest, broadcast)) {
+          if ((uncon_pcb == NULL) &&
+              ((pcb->flags & UDP_FLAGS_CONNECTED) == 0)) {
+            /* the first unconnected matching PCB */
+            uncon_pcb = pcb;
+          }
+          if ((pcb->remote_port == src) &&
+              (ip_addr_isany(&pcb->remote_ip) ||
+               ip_addr_cmp(&(pcb->remote_ip), &current_iphdr_src))) {
+            /* the first fully matching PCB */
+            break;
+          }
+        }
+      }
+    }
+    LWIP_UNUSED_ARG(prev);
+    LWIP_UNUSED_ARG(local_match);
+#else /* UDP_PCB_HASH */
     for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
       local_match = 0;
       /* print the PCB local and remote address */
@@ -170,18 +295,7 @@ udp_input(struct pbuf *p, struct netif *inp)
                    ip4_addr1_16(&pcb->remote_ip), ip4_addr2_16(&pcb->remote_ip),
                    ip4_addr3_16(&pcb->remote_ip), ip4_addr4_16(&pcb->remote_ip), pcb->remote_port));
 
-      /* compare PCB local addr+port to UDP destination addr+port */
-      if ((pcb->local_port == dest) &&
-          ((!broadcast && ip_addr_isany(&pcb->local_ip)) ||
-           ip_addr_cmp(&(pcb->local_ip), &current_iphdr_dest) ||
-#if LWIP_IGMP
-           ip_addr_ismulticast(&current_iphdr_dest) ||
-#endif /* LWIP_IGMP */
-#if IP_SOF_BROADCAST_RECV
-           (broadcast && (pcb->so_options & SOF_BROADCAST)))) {
-#else  /* IP_SOF_BROADCAST_RECV */
-           (broadcast))) {
-#endif /* IP_SOF_BROADCAST_RECV */
+      if (udp_input_local_match(pcb, dest, broadcast)) {
         local_match = 1;
         if ((uncon_pcb == NULL) && 
             ((pcb->flags & UDP_FLAGS_CONNECTED) == 0)) {
@@ -208,6 +322,7 @@ udp_input(struct pbuf *p, struct netif *inp)
       }
       prev = pcb;
     }
+#endif /* UDP_PCB_HASH */
     /* no fully matching pcb found? then look for an unconnected pcb */
     if (pcb == NULL) {
       pcb = uncon_pcb;
@@ -221,15 +336,27 @@ udp_input(struct pbuf *p, struct netif *inp)
     if (IPH_PROTO(iphdr) == IP_PROTO_UDPLITE) {
       /* Do the UDP Lite checksum */
 #if CHECKSUM_CHECK_UDP
-      u16_t chklen = ntohs(udphdr->len);
-      if (chklen < sizeof(struct udp_hdr)) {
-        if (chklen == 0) {
-          /* For UDP-Lite, checksum length of 0 means checksum
-             over the complete packet (See RFC 3828 chap. 3.1) */
-          chklen = p->tot_len;
-        } else {
-          /* At least the UDP-Lite header must be covered by the
-             checksum! (Again, see RFC 3828 chap. 3.1) */
+      IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_UDP) {
+        u16_t chklen = ntohs(udphdr->len);
+        if (chklen < sizeof(struct udp_hdr)) {
+          if (chklen == 0) {
+            /* For UDP-Lite, checksum length of 0 means checksum
+               over the complete packet (See RFC 3828 chap. 3.1) */
+            chklen = p->tot_len;
+          } else {
+            /* At least the UDP-Lite header must be covered by the
+               checksum! (Again, see RFC 3828 chap. 3.1) */
+            UDP_STATS_INC(udp.chkerr);
+            UDP_STATS_INC(udp.drop);
+            snmp_inc_udpinerrors();
+            pbuf_free(p);
+            goto end;
+          }
+        }
+        if (inet_chksum_pseudo_partial(p, &current_iphdr_src, &current_iphdr_dest,
+                               IP_PROTO_UDPLITE, p->tot_len, chklen) != 0) {
+         LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
+                     ("udp_input: UDP Lite datagram discarded due to failing checksum\n"));
           UDP_STATS_INC(udp.chkerr);
           UDP_STATS_INC(udp.drop);
           snmp_inc_udpinerrors();
@@ -237,31 +364,23 @@ udp_input(struct pbuf *p, struct netif *inp)
           goto end;
         }
       }
-      if (inet_chksum_pseudo_partial(p, &current_iphdr_src, &current_iphdr_dest,
-                             IP_PROTO_UDPLITE, p->tot_len, chklen) != 0) {
-       LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-                   ("udp_input: UDP Lite datagram discarded due to failing checksum\n"));
-        UDP_STATS_INC(udp.chkerr);
-        UDP_STATS_INC(udp.drop);
-        snmp_inc_udpinerrors();
-        pbuf_free(p);
-        goto end;
-      }
 #endif /* CHECKSUM_CHECK_UDP */
     } else
 #endif /* LWIP_UDPLITE */
     {
 #if CHECKSUM_CHECK_UDP
-      if (udphdr->chksum != 0) {
-        if (inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
-                               IP_PROTO_UDP, p->tot_len) != 0) {
-          LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-                      ("udp_input: UDP datagram discarded due to failing checksum\n"));
-          UDP_STATS_INC(udp.chkerr);
-          UDP_STATS_INC(udp.drop);
-          snmp_inc_udpinerrors();
-          pbuf_free(p);
-          goto end;
+      IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_UDP) {
+        if (udphdr->chksum != 0) {
+          if (inet_chksum_pseudo(p, ip_current_src_addr(), ip_current_dest_addr(),
+                                 IP_PROTO_UDP, p->tot_len) != 0) {
+            LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
+                        ("udp_input: UDP datagram discarded due to failing checksum\n"));
+            UDP_STATS_INC(udp.chkerr);
+            UDP_STATS_INC(udp.drop);
+            snmp_inc_udpinerrors();
+            pbuf_free(p);
+            goto end;
+          }
         }
       }
 #endif /* CHECKSUM_CHECK_UDP */
@@ -285,18 +404,7 @@ udp_input(struct pbuf *p, struct netif *inp)
         u8_t p_header_changed = 0;
         for (mpcb = udp_pcbs; mpcb != NULL; mpcb = mpcb->next) {
           if (mpcb != pcb) {
-            /* compare PCB local addr+port to UDP destination addr+port */
-            if ((mpcb->local_port == dest) &&
-                ((!broadcast && ip_addr_isany(&mpcb->local_ip)) ||
-                 ip_addr_cmp(&(mpcb->local_ip), &current_iphdr_dest) ||
-#if LWIP_IGMP
-                 ip_addr_ismulticast(&current_iphdr_dest) ||
-#endif /* LWIP_IGMP */
-#if IP_SOF_BROADCAST_RECV
-                 (broadcast && (mpcb->so_options & SOF_BROADCAST)))) {
-#else  /* IP_SOF_BROADCAST_RECV */
-                 (broadcast))) {
-#endif /* IP_SOF_BROADCAST_RECV */
+            if (udp_input_local_match(mpcb, dest, broadcast)) {
               /* pass a copy of the packet to all local matches */
               if (mpcb->recv != NULL) {
                 struct pbuf *q;
@@ -596,22 +704,24 @@ udp_sendto_if_chksum(struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *dst_ip,
     udphdr->len = htons(chklen_hdr);
     /* calculate checksum */
 #if CHECKSUM_GEN_UDP
-    udphdr->chksum = inet_chksum_pseudo_partial(q, src_ip, dst_ip,
-      IP_PROTO_UDPLITE, q->tot_len,
+    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP) {
+      udphdr->chksum = inet_chksum_pseudo_partial(q, src_ip, dst_ip,
+        IP_PROTO_UDPLITE, q->tot_len,
 #if !LWIP_CHECKSUM_ON_COPY
-      chklen);
+        chklen);
 #else /* !LWIP_CHECKSUM_ON_COPY */
-      (have_chksum ? UDP_HLEN : chklen));
-    if (have_chksum) {
-      u32_t acc;
-      acc = udphdr->chksum + (u16_t)~(chksum);
-      udphdr->chksum = FOLD_U32T(acc);
-    }
+        (have_chksum ? UDP_HLEN : chklen));
+      if (have_chksum) {
+        u32_t acc;
+        acc = udphdr->chksum + (u16_t)~(chksum);
+        udphdr->chksum = FOLD_U32T(acc);
+      }
 #endif /* !LWIP_CHECKSUM_ON_COPY */
 
-    /* chksum zero must become 0xffff, as zero means 'no checksum' */
-    if (udphdr->chksum == 0x0000) {
-      udphdr->chksum = 0xffff;
+      /* chksum zero must become 0xffff, as zero means 'no checksum' */
+      if (udphdr->chksum == 0x0000) {
+        udphdr->chksum = 0xffff;
+      }
     }
 #endif /* CHECKSUM_GEN_UDP */
     /* output to IP */
@@ -630,26 +740,28 @@ udp_sendto_if_chksum(struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *dst_ip,
     udphdr->len = htons(q->tot_len);
     /* calculate checksum */
 #if CHECKSUM_GEN_UDP
-    if ((pcb->flags & UDP_FLAGS_NOCHKSUM) == 0) {
-      u16_t udpchksum;
+    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP) {
+      if ((pcb->flags & UDP_FLAGS_NOCHKSUM) == 0) {
+        u16_t udpchksum;
 #if LWIP_CHECKSUM_ON_COPY
-      if (have_chksum) {
-        u32_t acc;
-        udpchksum = inet_chksum_pseudo_partial(q, src_ip, dst_ip, IP_PROTO_UDP,
-          q->tot_len, UDP_HLEN);
-        acc = udpchksum + (u16_t)~(chksum);
-        udpchksum = FOLD_U32T(acc);
-      } else
+        if (have_chksum) {
+          u32_t acc;
+          udpchksum = inet_chksum_pseudo_partial(q, src_ip, dst_ip, IP_PROTO_UDP,
+            q->tot_len, UDP_HLEN);
+          acc = udpchksum + (u16_t)~(chksum);
+          udpchksum = FOLD_U32T(acc);
+        } else
 #endif /* LWIP_CHECKSUM_ON_COPY */
-      {
-        udpchksum = inet_chksum_pseudo(q, src_ip, dst_ip, IP_PROTO_UDP, q->tot_len);
-      }
+        {
+          udpchksum = inet_chksum_pseudo(q, src_ip, dst_ip, IP_PROTO_UDP, q->tot_len);
+        }
 
-      /* chksum zero must become 0xffff, as zero means 'no checksum' */
-      if (udpchksum == 0x0000) {
-        udpchksum = 0xffff;
+        /* chksum zero must become 0xffff, as zero means 'no checksum' */
+        if (udpchksum == 0x0000) {
+          udpchksum = 0xffff;
+        }
+        udphdr->chksum = udpchksum;
       }
-      udphdr->chksum = udpchksum;
     }
 #endif /* CHECKSUM_GEN_UDP */
     LWIP_DEBUGF(UDP_DEBUG, ("udp_send: UDP checksum 0x%04"X16_F"\n", udphdr->chksum));
@@ -768,6 +880,9 @@ udp_bind(struct udp_pcb *pcb, ip_addr_t *ipaddr, u16_t port)
       return ERR_USE;
     }
   }
+  if (rebind != 0) {
+    UDP_HASH_RMV(pcb);
+  }
   pcb->local_port = port;
   snmp_insert_udpidx_tree(pcb);
   /* pcb not active yet? */
@@ -776,6 +891,7 @@ udp_bind(struct udp_pcb *pcb, ip_addr_t *ipaddr, u16_t port)
     pcb->next = udp_pcbs;
     udp_pcbs = pcb;
   }
+  UDP_HASH_REG(pcb);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE,
               ("udp_bind: bound to %"U16_F".%"U16_F".%"U16_F".%"U16_F", port %"U16_F"\n",
                ip4_addr1_16(&pcb->local_ip), ip4_addr2_16(&pcb->local_ip),
@@ -812,9 +928,13 @@ udp_connect(struct udp_pcb *pcb, ip_addr_t *ipaddr, u16_t port)
     }
   }
 
+  /* (no-op if the pcb is not on the list, yet) */
+  UDP_HASH_RMV(pcb);
   ip_addr_set(&pcb->remote_ip, ipaddr);
   pcb->remote_port = port;
   pcb->flags |= UDP_FLAGS_CONNECTED;
+  /* it is added to the list below if not yet there */
+  UDP_HASH_REG(pcb);
 /** TODO: this functionality belongs in upper layers */
 #ifdef LWIP_UDP_TODO
   /* Nail down local IP for netconn_addr()/getsockname() */
@@ -861,11 +981,20 @@ udp_connect(struct udp_pcb *pcb, ip_addr_t *ipaddr, u16_t port)
 void
 udp_disconnect(struct udp_pcb *pcb)
 {
+#if UDP_PCB_HASH
+  u8_t hashed = udp_hash_rmv(pcb);
+#endif /* UDP_PCB_HASH */
+
   /* reset remote address association */
   ip_addr_set_any(&pcb->remote_ip);
   pcb->remote_port = 0;
   /* mark PCB as unconnected */
   pcb->flags &= ~UDP_FLAGS_CONNECTED;
+#if UDP_PCB_HASH
+  if (hashed) {
+    udp_hash_reg(pcb);
+  }
+#endif /* UDP_PCB_HASH */
 }
 
 /**
@@ -899,6 +1028,7 @@ udp_remove(struct udp_pcb *pcb)
   struct udp_pcb *pcb2;
 
   snmp_delete_udpidx_tree(pcb);
+  UDP_HASH_RMV(pcb);
   /* pcb to be removed is first in list? */
   if (udp_pcbs == pcb) {
     /* make list start at 2nd pcb */
@@ -36,6 +36,7 @@
 
 #include "lwip/pbuf.h"
 #include "lwip/ip_addr.h"
+#include "lwip/err.h"
 
 /** Swap the bytes in an u16_t: much like htons() for little-endian */
 #ifndef SWAP_BYTES_IN_WORD
@@ -55,7 +56,8 @@
 
 #if LWIP_CHECKSUM_ON_COPY
 /** Function-like macro: same as MEMCPY but returns the checksum of copied data
-    as u16_t */
+    as u16_t. LWIP_CHKSUM_COPY_ALGORITHM 1 copies and then sums the copy,
+    2 sums the words while copying them (one pass over the data). */
 #ifndef LWIP_CHKSUM_COPY
 #define LWIP_CHKSUM_COPY(dst, src, len) lwip_chksum_copy(dst, src, len)
 #ifndef LWIP_CHKSUM_COPY_ALGORITHM
@@ -70,6 +72,26 @@
 extern "C" {
 #endif
 
+#if LWIP_CHKSUM_SELECT
+/** A checksum kernel: returns the host order (!) lwip checksum
+ * (non-inverted Internet sum) of len bytes at dataptr */
+typedef u16_t (*lwip_chksum_fn)(void *dataptr, int len);
+
+struct lwip_chksum_kernel {
+  const char *name;
+  lwip_chksum_fn fn;
+  /** returns nonzero if the CPU can run fn (NULL: always) */
+  int (*supported)(void);
+};
+
+/** All kernels compiled in, ordered by preference, ends with name == NULL */
+extern const struct lwip_chksum_kernel lwip_chksum_kernels[];
+
+void inet_chksum_init(void);
+err_t inet_chksum_select(const char *name);
+const char *inet_chksum_selected(void);
+#endif /* LWIP_CHKSUM_SELECT */
+
 u16_t inet_chksum(void *dataptr, u16_t len);
 u16_t inet_chksum_pbuf(struct pbuf *p);
 u16_t inet_chksum_pseudo(struct pbuf *p,
@@ -82,6 +104,15 @@ u16_t inet_chksum_pseudo_partial(struct pbuf *p,
 u16_t lwip_chksum_copy(void *dst, const void *src, u16_t len);
 #endif /* LWIP_CHKSUM_COPY_ALGORITHM */
 
+/* Incremental update (RFC 1624) of a checksum stored in a header after
+   a field covered by it changed. All values are in network byte order,
+   as read from and written to the headers. */
+u16_t inet_chksum_adjust16(u16_t chksum, u16_t oldval, u16_t newval);
+u16_t inet_chksum_adjust32(u16_t chksum, u32_t oldval, u32_t newval);
+/** Update a TCP/UDP checksum after an address of the pseudo header changed */
+#define inet_chksum_adjust_addr(chksum, oldaddr, newaddr) \
+  inet_chksum_adjust32(chksum, ip4_addr_get_u32(oldaddr), ip4_addr_get_u32(newaddr))
+
 #ifdef __cplusplus
 }
 #endif
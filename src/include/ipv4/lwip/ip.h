@@ -149,6 +149,8 @@ PACK_STRUCT_END
 #define IPH_OFFSET(hdr) ((hdr)->_offset)
 #define IPH_TTL(hdr) ((hdr)->_ttl)
 #define IPH_PROTO(hdr) ((hdr)->_proto)
+/** The 16-bit word holding TTL and protocol, as stored (for checksum updates) */
+#define IPH_TTLPROTO(hdr) htons((u16_t)((IPH_TTL(hdr) << 8) | IPH_PROTO(hdr)))
 #define IPH_CHKSUM(hdr) ((hdr)->_chksum)
 
 #define IPH_VHLTOS_SET(hdr, v, hl, tos) (hdr)->_v_hl_tos = (htons(((v) << 12) | ((hl) << 8) | (tos)))
@@ -39,6 +39,7 @@
 #include "lwip/netif.h"
 #include "lwip/ip_addr.h"
 #include "lwip/ip.h"
+#include "lwip/reclaim.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -63,6 +64,9 @@ struct ip_reassdata {
 void ip_reass_init(void);
 void ip_reass_tmr(void);
 struct pbuf * ip_reass(struct pbuf *p);
+#if LWIP_RECLAIM
+u8_t ip_reass_reclaim(reclaim_src_t src, void *arg);
+#endif /* LWIP_RECLAIM */
 #endif /* IP_REASSEMBLY */
 
 #if IP_FRAG
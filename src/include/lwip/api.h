@@ -173,6 +173,11 @@ struct netconn {
       for UDP and RAW, used for FIONREAD */
   s16_t recv_avail;
 #endif /* LWIP_SO_RCVBUF */
+#if LWIP_NETCONN_RECV_ZC
+  /** number of driver buffers held by the application through
+      netconn_recv_zc(), limited to LWIP_NETCONN_RECV_ZC_ESF_MAX */
+  s16_t zc_esf;
+#endif /* LWIP_NETCONN_RECV_ZC */
   /** flags holding more netconn-internal state, see NETCONN_FLAG_* defines */
   u8_t flags;
 #if LWIP_TCP
@@ -227,11 +232,22 @@ err_t   netconn_accept(struct netconn *conn, struct netconn **new_conn);
 err_t   netconn_recv(struct netconn *conn, struct netbuf **new_buf);
 err_t   netconn_recv_tcp_pbuf(struct netconn *conn, struct pbuf **new_buf);
 void    netconn_recved(struct netconn *conn, u32_t length);
+#if LWIP_NETCONN_RECV_ZC
+err_t   netconn_recv_zc(struct netconn *conn, struct pbuf **new_buf,
+                        ip_addr_t *addr, u16_t *port);
+void    netconn_recv_zc_release(struct netconn *conn, struct pbuf *p);
+void    netconn_recv_zc_take(struct netconn *conn, struct pbuf **p);
+#endif /* LWIP_NETCONN_RECV_ZC */
 err_t   netconn_sendto(struct netconn *conn, struct netbuf *buf,
                        ip_addr_t *addr, u16_t port);
 err_t   netconn_send(struct netconn *conn, struct netbuf *buf);
 err_t   netconn_write(struct netconn *conn, const void *dataptr, size_t size,
                       u8_t apiflags);
+#if LWIP_TCP && LWIP_TCP_WRITEV
+struct tcp_iovec;
+err_t   netconn_writev(struct netconn *conn, struct tcp_iovec *iov, u8_t iovcnt,
+                       u8_t apiflags, u8_t *queued);
+#endif /* LWIP_TCP && LWIP_TCP_WRITEV */
 err_t   netconn_close(struct netconn *conn);
 err_t   netconn_shutdown(struct netconn *conn, u8_t shut_rx, u8_t shut_tx);
 
@@ -89,6 +89,12 @@ struct api_msg_msg {
       const void *dataptr;
       size_t len;
       u8_t apiflags;
+#if LWIP_TCP && LWIP_TCP_WRITEV
+      /** if != NULL: write 'len' tcp_iovecs instead of 'dataptr' */
+      struct tcp_iovec *iov;
+      /** number of tcp_iovecs queued so far */
+      u8_t queued;
+#endif /* LWIP_TCP && LWIP_TCP_WRITEV */
     } w;
     /** used for do_recv */
     struct {
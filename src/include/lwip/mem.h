@@ -106,6 +106,8 @@ do{\
 #ifndef mem_trim
 #define mem_trim(mem, size) (mem)
 #endif
+/* the C library heap is not inspected */
+#define mem_frag_update()
 #else /* MEM_LIBC_MALLOC */
 
 /* MEM_SIZE would have to be aligned, but using 64000 here instead of
@@ -125,10 +127,20 @@ typedef u16_t mem_size_t;
 /** mem_trim is not used when using pools instead of a heap:
     we can't free part of a pool element and don't want to copy the rest */
 #define mem_trim(mem, size) (mem)
+/** pools don't fragment */
+#define mem_frag_update()
 #else /* MEM_USE_POOLS */
 /* lwIP alternative malloc */
 void  mem_init(void);
 void *mem_trim(void *mem, mem_size_t size);
+#if LWIP_RECLAIM
+mem_size_t mem_avail(void);
+#endif /* LWIP_RECLAIM */
+#if MEM_STATS
+void  mem_frag_update(void);
+#else /* MEM_STATS */
+#define mem_frag_update()
+#endif /* MEM_STATS */
 #endif /* MEM_USE_POOLS */
 void *mem_malloc(mem_size_t size);
 void *mem_calloc(mem_size_t count, mem_size_t size);
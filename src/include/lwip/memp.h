@@ -99,13 +99,16 @@ struct memp_malloc_helper
 
 void  memp_init(void);
 
-#if MEMP_OVERFLOW_CHECK
+#if MEMP_OVERFLOW_CHECK || (MEMP_STATS && MEMP_STATS_CALLERS)
 void *memp_malloc_fn(memp_t type, const char* file, const int line);
 #define memp_malloc(t) memp_malloc_fn((t), __FILE__, __LINE__)
 #else
 void *memp_malloc(memp_t type);
 #endif
 void  memp_free(memp_t type, void *mem);
+#if LWIP_RECLAIM
+u16_t memp_avail(memp_t type);
+#endif /* LWIP_RECLAIM */
 
 #endif /* MEMP_MEM_MALLOC */
 
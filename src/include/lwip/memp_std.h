@@ -42,6 +42,9 @@ LWIP_MEMPOOL(UDP_PCB,        MEMP_NUM_UDP_PCB,         sizeof(struct udp_pcb),
 LWIP_MEMPOOL(TCP_PCB,        MEMP_NUM_TCP_PCB,         sizeof(struct tcp_pcb),        "TCP_PCB")
 LWIP_MEMPOOL(TCP_PCB_LISTEN, MEMP_NUM_TCP_PCB_LISTEN,  sizeof(struct tcp_pcb_listen), "TCP_PCB_LISTEN")
 LWIP_MEMPOOL(TCP_SEG,        MEMP_NUM_TCP_SEG,         sizeof(struct tcp_seg),        "TCP_SEG")
+#if LWIP_TCP_WRITEV
+LWIP_MEMPOOL(TCP_IOV_PBUF,   MEMP_NUM_TCP_IOV_PBUF,    sizeof(struct tcp_iov_pbuf),   "TCP_IOV_PBUF")
+#endif /* LWIP_TCP_WRITEV */
 #endif /* LWIP_TCP */
 
 #if IP_REASSEMBLY
@@ -102,6 +105,11 @@ LWIP_MEMPOOL(PPPOE_IF,      MEMP_NUM_PPPOE_INTERFACES, sizeof(struct pppoe_softc
 LWIP_PBUF_MEMPOOL(PBUF,      MEMP_NUM_PBUF,            0,                             "PBUF_REF/ROM")
 LWIP_PBUF_MEMPOOL(PBUF_POOL, PBUF_POOL_SIZE,           PBUF_POOL_BUFSIZE,             "PBUF_POOL")
 
+#if PBUF_RAM_SLAB
+/* pages carved into PBUF_RAM pbufs by pbuf.c */
+LWIP_MEMPOOL(PBUF_RAM_SLAB,  PBUF_RAM_SLAB_PAGES,      PBUF_RAM_SLAB_PAGE_SIZE,       "PBUF_RAM_SLAB")
+#endif /* PBUF_RAM_SLAB */
+
 
 /*
  * Allow for user-defined pools; this must be explicitly set in lwipopts.h
@@ -67,6 +67,10 @@ void *            netbuf_alloc    (struct netbuf *buf, u16_t size);
 void              netbuf_free     (struct netbuf *buf);
 err_t             netbuf_ref      (struct netbuf *buf,
                                    const void *dataptr, u16_t size);
+#if LWIP_CHECKSUM_ON_COPY
+err_t             netbuf_take_chksum(struct netbuf *buf,
+                                   const void *dataptr, u16_t len);
+#endif /* LWIP_CHECKSUM_ON_COPY */
 void              netbuf_chain    (struct netbuf *head,
            struct netbuf *tail);
 
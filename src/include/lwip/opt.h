@@ -76,6 +76,16 @@
 #define NO_SYS_NO_TIMERS                0
 #endif
 
+/**
+ * LWIP_SDK_TUNABLES==1: MEMP_NUM_TCP_PCB, TCP_WND, TCP_MAXRTX, TCP_SYNMAXRTX
+ * and DHCP_MAXRTX are variables provided by the ESP8266 SDK (see the SDK's
+ * lwipopts.h) and are reset to their defaults by lwip_init(). Ports that
+ * define these as constants (e.g. the unix host port) must set this to 0.
+ */
+#ifndef LWIP_SDK_TUNABLES
+#define LWIP_SDK_TUNABLES               1
+#endif
+
 /**
  * MEMCPY: override this if you have a faster implementation at hand than the
  * one included in your C library
@@ -162,6 +172,20 @@
 #define MEMP_SANITY_CHECK               0
 #endif
 
+/**
+ * MEMP_LOCKFREE==1: take memp elements off and put them back on the pool
+ * free lists with compare-and-swap instead of SYS_ARCH_PROTECT, so that
+ * drivers can allocate and free pbufs from interrupt context without masking
+ * interrupts. The port must provide SYS_ARCH_CAS32(ptr, oldval, newval)
+ * (returns nonzero if *ptr was oldval and has been set to newval), each pool
+ * must be smaller than 64k * MEM_ALIGNMENT bytes and the memp statistics are
+ * updated without protection (approximate under contention).
+ * Not compatible with MEMP_OVERFLOW_CHECK and MEMP_SANITY_CHECK.
+ */
+#ifndef MEMP_LOCKFREE
+#define MEMP_LOCKFREE                   0
+#endif
+
 /**
  * MEM_USE_POOLS==1: Use an alternative to malloc() by allocating from a set
  * of memory pools of various sizes. When mem_malloc is called, an element of
@@ -180,6 +204,17 @@
 #define MEM_USE_POOLS_TRY_BIGGER_POOL   0
 #endif
 
+/**
+ * MEM_TLSF==1: Manage the heap (MEM_SIZE) with a two-level segregated fit
+ * allocator instead of the first-fit list. mem_malloc(), mem_free() and
+ * mem_trim() then run in constant time (no walk over the heap) at the cost
+ * of a few hundred bytes of free list heads. Only used if MEM_LIBC_MALLOC
+ * and MEM_USE_POOLS are 0.
+ */
+#ifndef MEM_TLSF
+#define MEM_TLSF                        0
+#endif
+
 /**
  * MEMP_USE_CUSTOM_POOLS==1: whether to include a user file lwippools.h
  * that defines additional pools beyond the "standard" ones required
@@ -212,6 +247,43 @@
 #define LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT 0
 #endif
 
+/**
+ * LWIP_RECLAIM==1: Enable the memory pressure handling in reclaim.c: when
+ * the free memory of the heap or of a memp pool drops below its low
+ * watermark (or an allocation fails), the reclaim handlers registered with
+ * reclaim_register() are run in the order of their priority until it is
+ * back at the high watermark. The built-in handlers drop TIME-WAIT pcbs,
+ * queued ARP packets, incomplete IP datagrams and out-of-sequence TCP data.
+ * Handlers run in the tcpip_thread (NO_SYS==0) or from sys_check_timeouts()
+ * (NO_SYS==1), not from within mem_malloc()/memp_malloc().
+ */
+#ifndef LWIP_RECLAIM
+#define LWIP_RECLAIM                    0
+#endif
+
+/**
+ * MEM_RECLAIM_LOWAT/MEM_RECLAIM_HIWAT: free heap bytes below which reclaiming
+ * starts and up to which it continues (see reclaim_set_watermarks()).
+ */
+#ifndef MEM_RECLAIM_LOWAT
+#define MEM_RECLAIM_LOWAT               (MEM_SIZE / 8)
+#endif
+#ifndef MEM_RECLAIM_HIWAT
+#define MEM_RECLAIM_HIWAT               (MEM_SIZE / 4)
+#endif
+
+/**
+ * MEMP_RECLAIM_LOWAT(num)/MEMP_RECLAIM_HIWAT(num): the same for a memp pool
+ * of 'num' elements, in elements. A low watermark of 0 means reclaiming only
+ * starts when the pool is empty.
+ */
+#ifndef MEMP_RECLAIM_LOWAT
+#define MEMP_RECLAIM_LOWAT(num)         ((num) / 8)
+#endif
+#ifndef MEMP_RECLAIM_HIWAT
+#define MEMP_RECLAIM_HIWAT(num)         (((num) + 3) / 4)
+#endif
+
 /*
    ------------------------------------------------
    ---------- Internal Memory Pool Sizes ----------
@@ -286,6 +358,16 @@
 #define MEMP_NUM_FRAG_PBUF              15
 #endif
 
+/**
+ * MEMP_NUM_TCP_IOV_PBUF: the number of pbufs referencing application
+ * buffers queued with tcp_writev() at the same time (roughly one per
+ * segment of unacknowledged data, plus one per buffer).
+ * (requires the LWIP_TCP_WRITEV option)
+ */
+#ifndef MEMP_NUM_TCP_IOV_PBUF
+#define MEMP_NUM_TCP_IOV_PBUF           16
+#endif
+
 /**
  * MEMP_NUM_ARP_QUEUE: the number of simulateously queued outgoing
  * packets (pbufs) that are waiting for an ARP request (to resolve
@@ -743,6 +825,15 @@
 #define SNMP_PRIVATE_MIB                0
 #endif
 
+/**
+ * SNMP_MEMP_MIB==1: Export the memp pool statistics (MEMP_STATS) as
+ * enterprises.lwip(26381).lwipMemp(1), see mib_memp.c. Without
+ * SNMP_PRIVATE_MIB, this is the private MIB; with it, add mib_memp to yours.
+ */
+#ifndef SNMP_MEMP_MIB
+#define SNMP_MEMP_MIB                   0
+#endif
+
 /**
  * Only allow SNMP write actions that are 'safe' (e.g. disabeling netifs is not
  * a safe action and disabled when SNMP_SAFE_REQUESTS = 1).
@@ -880,6 +971,26 @@
 #define LWIP_NETBUF_RECVINFO            0
 #endif
 
+/**
+ * UDP_PCB_HASH==1: Demultiplex incoming datagrams through hash tables
+ * instead of walking udp_pcbs: connected pcbs are hashed by local port and
+ * remote address/port, all others by local port. Costs one pointer per pcb
+ * plus two bucket arrays; worth it with more than a few bound pcbs.
+ * UDP_FLAGS_CONNECTED must then only be changed through udp_connect() and
+ * udp_disconnect(), not with udp_setflags().
+ */
+#ifndef UDP_PCB_HASH
+#define UDP_PCB_HASH                    0
+#endif
+
+/**
+ * UDP_PCB_HASH_SIZE: Number of buckets of each of the two UDP hash tables.
+ * Must be a power of 2.
+ */
+#ifndef UDP_PCB_HASH_SIZE
+#define UDP_PCB_HASH_SIZE               8
+#endif
+
 /*
    ---------------------------------
    ---------- TCP options ----------
@@ -901,7 +1012,8 @@
 
 /**
  * TCP_WND: The size of a TCP window.  This must be at least 
- * (2 * TCP_MSS) for things to work well
+ * (2 * TCP_MSS) for things to work well. Without LWIP_WND_SCALE it must
+ * fit in an u16_t.
  */
 #ifndef TCP_WND
 #define TCP_WND                         (4 * TCP_MSS)
@@ -1002,6 +1114,26 @@
 #define TCP_DEFAULT_LISTEN_BACKLOG      0xff
 #endif
 
+/**
+ * TCP_SYNCOOKIES==1: Answer SYNs statelessly when too many connections are
+ * half-open. The SYN|ACK then carries an ISS that encodes the peer's MSS and
+ * a coarse timestamp, and the tcp_pcb is only allocated when the handshake's
+ * final ACK returns a valid cookie. TCP options other than MSS that were
+ * sent in the SYN are lost for such connections.
+ */
+#ifndef TCP_SYNCOOKIES
+#define TCP_SYNCOOKIES                  0
+#endif
+
+/**
+ * TCP_SYNCOOKIE_THRESHOLD: Number of pcbs in SYN_RCVD above which incoming
+ * SYNs are answered with a cookie instead of a new pcb. Cookies are also
+ * used when no pcb can be allocated.
+ */
+#ifndef TCP_SYNCOOKIE_THRESHOLD
+#define TCP_SYNCOOKIE_THRESHOLD         ((MEMP_NUM_TCP_PCB + 1) / 2)
+#endif
+
 /**
  * TCP_OVERSIZE: The maximum number of bytes that tcp_write may
  * allocate ahead of time in an attempt to create shorter pbuf chains
@@ -1021,18 +1153,194 @@
 #endif
 
 /**
- * LWIP_TCP_TIMESTAMPS==1: support the TCP timestamp option.
+ * LWIP_TCP_TIMESTAMPS==1: support the TCP timestamp option (RFC 7323). It is
+ * offered in every SYN. When both sides use it, every ACK of new data gives
+ * an RTT measurement, also for retransmitted segments, and segments carrying
+ * an old timestamp are dropped (PAWS).
  */
 #ifndef LWIP_TCP_TIMESTAMPS
 #define LWIP_TCP_TIMESTAMPS             0
 #endif
 
+/**
+ * LWIP_WND_SCALE==1: support the TCP window scale option (RFC 7323). The
+ * window variables of the tcp_pcb become 32 bits wide and TCP_WND and
+ * TCP_SND_BUF may exceed 64 KiB. Connections whose peer does not send
+ * the option keep a receive window of at most 0xffff.
+ */
+#ifndef LWIP_WND_SCALE
+#define LWIP_WND_SCALE                  0
+#endif
+
+/**
+ * TCP_RCV_SCALE: The shift count announced in the window scale option
+ * (0..14). TCP_WND must not exceed (0xffff << TCP_RCV_SCALE).
+ */
+#ifndef TCP_RCV_SCALE
+#define TCP_RCV_SCALE                   0
+#endif
+
+/**
+ * LWIP_TCP_SACK==1: support selective acknowledgments (RFC 2018). The
+ * SACK-permitted option is sent on SYNs, pure ACKs report the blocks held
+ * on pcb->ooseq, and SACK blocks received from the peer are recorded on
+ * pcb->unacked so that retransmissions only cover the holes. Needs
+ * TCP_QUEUE_OOSEQ to generate SACK blocks.
+ */
+#ifndef LWIP_TCP_SACK
+#define LWIP_TCP_SACK                   0
+#endif
+
+/**
+ * LWIP_TCP_CC==1: run congestion control through the struct tcp_cc_ops
+ * interface of lwip/tcp_cc.h, selectable per pcb with tcp_set_cc(), and use
+ * RFC 6582 (NewReno) partial ACK handling in fast recovery.
+ * LWIP_TCP_CC==0 keeps the built-in Reno code.
+ */
+#ifndef LWIP_TCP_CC
+#define LWIP_TCP_CC                     0
+#endif
+
+/**
+ * TCP_CC_NEWRENO==1: build the RFC 5681/6582 NewReno module (tcp_cc_newreno).
+ */
+#ifndef TCP_CC_NEWRENO
+#define TCP_CC_NEWRENO                  1
+#endif
+
+/**
+ * TCP_CC_CUBIC==1: build the RFC 8312 CUBIC module (tcp_cc_cubic), which
+ * grows cwnd faster on paths with a large bandwidth-delay product. Only
+ * worth it with a TCP_SND_BUF of many segments (host builds).
+ */
+#ifndef TCP_CC_CUBIC
+#define TCP_CC_CUBIC                    0
+#endif
+
+/**
+ * TCP_CC_LOWMEM==1: build the conservative module for devices with a tiny
+ * TCP_SND_BUF (tcp_cc_lowmem): cwnd never grows past TCP_SND_BUF and
+ * reductions are based on the data in flight instead of cwnd.
+ */
+#ifndef TCP_CC_LOWMEM
+#define TCP_CC_LOWMEM                   0
+#endif
+
+/**
+ * TCP_CC_DEFAULT: the struct tcp_cc_ops new pcbs start with. Defaults to
+ * the first module built of NewReno, CUBIC and lowmem.
+ */
+#ifndef TCP_CC_DEFAULT
+#if TCP_CC_NEWRENO
+#define TCP_CC_DEFAULT                  (&tcp_cc_newreno)
+#elif TCP_CC_CUBIC
+#define TCP_CC_DEFAULT                  (&tcp_cc_cubic)
+#else
+#define TCP_CC_DEFAULT                  (&tcp_cc_lowmem)
+#endif
+#endif
+
+/**
+ * LWIP_TCP_TIMERS_MS==1: run the TCP timers on sys_now() with millisecond
+ * resolution. The retransmission, delayed ACK, persist and TIME-WAIT timers
+ * are deadlines per pcb and the TCP timer is only scheduled for the earliest
+ * one that is armed, instead of every TCP_TMR_INTERVAL while any pcb exists.
+ * LWIP_TCP_TIMERS_MS==0 keeps the 500 ms slow timer ticks (RTO and delayed
+ * ACK in steps of 500 and 250 ms), which costs less code and RAM.
+ */
+#ifndef LWIP_TCP_TIMERS_MS
+#define LWIP_TCP_TIMERS_MS              0
+#endif
+
+/**
+ * TCP_RTO_MIN: lower bound of the retransmission time-out in milliseconds.
+ * RFC 6298 asks for 1 s, which is meant for coarse clocks like the slow
+ * timer; 200 ms is the common choice with LWIP_TCP_TIMERS_MS.
+ */
+#ifndef TCP_RTO_MIN
+#if LWIP_TCP_TIMERS_MS
+#define TCP_RTO_MIN                     200
+#else
+#define TCP_RTO_MIN                     1000
+#endif
+#endif
+
+/**
+ * TCP_RTO_MAX: upper bound of the retransmission time-out in milliseconds,
+ * backoff included, with LWIP_TCP_TIMERS_MS.
+ */
+#ifndef TCP_RTO_MAX
+#define TCP_RTO_MAX                     60000
+#endif
+
+/**
+ * TCP_ACK_DELAY: how long an ACK is delayed in milliseconds with
+ * LWIP_TCP_TIMERS_MS (RFC 1122 allows up to 500 ms). Every second
+ * segment is still acknowledged at once.
+ */
+#ifndef TCP_ACK_DELAY
+#define TCP_ACK_DELAY                   40
+#endif
+
+/**
+ * LWIP_TCP_RACK==1: time-based loss detection (RACK) and tail loss probes
+ * (TLP) of RFC 8985, for connections that negotiated SACK. An unacked
+ * segment is resent once a segment sent after it has been delivered and
+ * a reordering window has passed, without waiting for three duplicate
+ * ACKs. When the last segments of a burst are lost, a probe after about
+ * two round-trips draws the SACK blocks that reveal the loss instead of
+ * waiting for the RTO. Needs LWIP_TCP_SACK and LWIP_TCP_TIMERS_MS.
+ */
+#ifndef LWIP_TCP_RACK
+#define LWIP_TCP_RACK                   0
+#endif
+
+/**
+ * LWIP_TCP_WRITEV==1: Enable tcp_writev(), netconn_writev() and
+ * lwip_writev_zc(), which queue a list of application buffers without
+ * copying them. Each buffer carries a completion callback that is called
+ * once lwIP holds no more references to it (the data was acknowledged and
+ * freed from the unacked queue, or the connection was aborted), after
+ * which the application may reuse it.
+ */
+#ifndef LWIP_TCP_WRITEV
+#define LWIP_TCP_WRITEV                 0
+#endif
+
 /**
  * TCP_WND_UPDATE_THRESHOLD: difference in window to trigger an
- * explicit window update
+ * explicit window update. Limited to 4 * TCP_MSS so that connections
+ * without window scaling still send updates when TCP_WND exceeds 64 KiB.
  */
 #ifndef TCP_WND_UPDATE_THRESHOLD
-#define TCP_WND_UPDATE_THRESHOLD   (TCP_WND / 4)
+#define TCP_WND_UPDATE_THRESHOLD   LWIP_MIN((TCP_WND / 4), (TCP_MSS * 4))
+#endif
+
+/**
+ * TCP_PCB_HASH==1: Demultiplex incoming segments through hash tables
+ * instead of walking the pcb lists: active and TIME-WAIT pcbs are hashed
+ * by their 4-tuple, listening pcbs by their local port. Costs one pointer
+ * per pcb plus the bucket arrays; worth it once MEMP_NUM_TCP_PCB goes
+ * beyond a handful of connections.
+ */
+#ifndef TCP_PCB_HASH
+#define TCP_PCB_HASH                    0
+#endif
+
+/**
+ * TCP_PCB_HASH_SIZE: Number of buckets of the active and of the TIME-WAIT
+ * hash table (each). Must be a power of 2.
+ */
+#ifndef TCP_PCB_HASH_SIZE
+#define TCP_PCB_HASH_SIZE               16
+#endif
+
+/**
+ * TCP_LISTEN_HASH_SIZE: Number of buckets of the listen hash table.
+ * Must be a power of 2.
+ */
+#ifndef TCP_LISTEN_HASH_SIZE
+#define TCP_LISTEN_HASH_SIZE            8
 #endif
 
 /**
@@ -1074,6 +1382,41 @@
 #define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN)
 #endif
 
+/**
+ * PBUF_RAM_SLAB==1: Allocate PBUF_RAM pbufs from slabs instead of the heap:
+ * pages from the MEMP_PBUF_RAM_SLAB pool are carved into objects of one
+ * size class each. The PBUF_RAM_SLAB_CLASSES classes are sized automatically
+ * after the sizes pbuf_alloc() is asked for most; other sizes (and all
+ * PBUF_RAM pbufs when there is no free page) still come from mem_malloc().
+ */
+#ifndef PBUF_RAM_SLAB
+#define PBUF_RAM_SLAB                   0
+#endif
+
+/**
+ * PBUF_RAM_SLAB_PAGES: the number of slab pages.
+ */
+#ifndef PBUF_RAM_SLAB_PAGES
+#define PBUF_RAM_SLAB_PAGES             8
+#endif
+
+/**
+ * PBUF_RAM_SLAB_PAGE_SIZE: the size of a slab page. The default holds two
+ * full size TCP segments (pbuf struct and all headers included); bigger
+ * pbufs always come from the heap.
+ */
+#ifndef PBUF_RAM_SLAB_PAGE_SIZE
+#define PBUF_RAM_SLAB_PAGE_SIZE         (2 * (TCP_MSS + 160))
+#endif
+
+/**
+ * PBUF_RAM_SLAB_CLASSES: the number of size classes, i.e. how many different
+ * PBUF_RAM sizes are served from slabs at the same time.
+ */
+#ifndef PBUF_RAM_SLAB_CLASSES
+#define PBUF_RAM_SLAB_CLASSES           4
+#endif
+
 /*
    ------------------------------------------------
    ---------- Network Interfaces options ----------
@@ -1369,6 +1712,28 @@
 #define LWIP_NETCONN                    1
 #endif
 
+/**
+ * LWIP_NETCONN_RECV_ZC==1: Enable netconn_recv_zc() and lwip_recvfrom_zc(),
+ * which hand received pbuf chains (including the WLAN buffers of
+ * PBUF_ESF_RX pbufs) to the application without copying. The application
+ * gives them back with netconn_recv_zc_release()/lwip_recv_zc_release();
+ * for TCP, the receive window is only opened then.
+ */
+#ifndef LWIP_NETCONN_RECV_ZC
+#define LWIP_NETCONN_RECV_ZC            0
+#endif
+
+/**
+ * LWIP_NETCONN_RECV_ZC_ESF_MAX: maximum number of driver buffers (pbufs with
+ * an esf_buf in pbuf->eb) the application may hold per netconn through
+ * netconn_recv_zc(). Beyond that, data is copied into PBUF_RAM and the driver
+ * buffer is recycled at once, so that a slow reader cannot starve the WLAN
+ * receive path.
+ */
+#ifndef LWIP_NETCONN_RECV_ZC_ESF_MAX
+#define LWIP_NETCONN_RECV_ZC_ESF_MAX    4
+#endif
+
 /** LWIP_TCPIP_TIMEOUT==1: Enable tcpip_timeout/tcpip_untimeout tod create
  * timers running in tcpip_thread from another thread.
  */
@@ -1545,6 +1910,25 @@
 #define MEMP_STATS                      (MEMP_MEM_MALLOC == 0)
 #endif
 
+/**
+ * MEMP_STATS_CALLERS: Number of memp_malloc() call sites (file/line) per
+ * pool whose allocation failures are counted separately in
+ * lwip_stats.memp_caller (failures of further sites are only counted in
+ * err). 0 disables this.
+ */
+#ifndef MEMP_STATS_CALLERS
+#define MEMP_STATS_CALLERS              0
+#endif
+
+/**
+ * MEMP_STATS_HIST_BUCKETS: Number of log2 buckets of the per-pool
+ * histogram of the time elements stay allocated (sys_now() milliseconds)
+ * in lwip_stats.memp_hist. Costs a timestamp per element. 0 disables this.
+ */
+#ifndef MEMP_STATS_HIST_BUCKETS
+#define MEMP_STATS_HIST_BUCKETS         0
+#endif
+
 /**
  * SYS_STATS==1: Enable system stats (sem and mbox counts, etc).
  */
@@ -1563,11 +1947,38 @@
 #define TCP_STATS                       0
 #define MEM_STATS                       0
 #define MEMP_STATS                      0
+#define MEMP_STATS_CALLERS              0
+#define MEMP_STATS_HIST_BUCKETS         0
 #define SYS_STATS                       0
 #define LWIP_STATS_DISPLAY              0
 
 #endif /* LWIP_STATS */
 
+/*
+   -----------------------------------------
+   ---------- Performance options ----------
+   -----------------------------------------
+*/
+/**
+ * LWIP_PERF==1: Turn the PERF_START/PERF_STOP probes in the core into a
+ * profiler that keeps count, min/avg/max and a histogram of the time spent
+ * per probe (see lwip/perf.h, perf_display()). The port must provide a
+ * free-running counter as LWIP_PERF_CLOCK() (in arch/perf.h or lwipopts.h),
+ * e.g. the CPU cycle counter.
+ */
+#ifndef LWIP_PERF
+#define LWIP_PERF                       0
+#endif
+
+/**
+ * LWIP_PERF_HIST_BUCKETS: Number of histogram buckets per probe. Bucket n
+ * counts the measurements in [2^n, 2^(n+1)) clock ticks, the last bucket
+ * everything above.
+ */
+#ifndef LWIP_PERF_HIST_BUCKETS
+#define LWIP_PERF_HIST_BUCKETS          20
+#endif
+
 /*
    ---------------------------------
    ---------- PPP options ----------
@@ -1779,14 +2190,40 @@
 #define CHECKSUM_CHECK_TCP              1
 #endif
 
+/**
+ * LWIP_CHECKSUM_CTRL_PER_NETIF==1: Checksum generation and checking can be
+ * turned off per netif at run time (netif->chksum_flags, see
+ * NETIF_SET_CHECKSUM_CTRL()), e.g. for the loopback netif or hardware that
+ * computes/validates checksums. The CHECKSUM_GEN_* and CHECKSUM_CHECK_*
+ * options still decide whether the code is compiled in at all.
+ */
+#ifndef LWIP_CHECKSUM_CTRL_PER_NETIF
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    0
+#endif
+
 /**
  * LWIP_CHECKSUM_ON_COPY==1: Calculate checksum when copying data from
- * application buffers to pbufs.
+ * application buffers to pbufs: tcp_write() with TCP_WRITE_FLAG_COPY,
+ * lwip_sendto() on UDP sockets and netconn_send() of netbufs filled with
+ * netbuf_take_chksum(). LWIP_CHKSUM_COPY_ALGORITHM (see inet_chksum.h)
+ * selects the copy routine.
  */
 #ifndef LWIP_CHECKSUM_ON_COPY
 #define LWIP_CHECKSUM_ON_COPY           0
 #endif
 
+/**
+ * LWIP_CHKSUM_SELECT==1: Select the checksum routine at run time from
+ * lwip_chksum_kernels[] (see inet_chksum.c): lwip_init() picks the last
+ * kernel in the table the CPU supports, inet_chksum_select() overrides
+ * that. Besides the portable kernels, the port can add its own (e.g. SIMD)
+ * by defining LWIP_CHKSUM_ARCH_KERNELS in cc.h.
+ * Replaces LWIP_CHKSUM, LWIP_CHKSUM_ALGORITHM must be 2 or 3.
+ */
+#ifndef LWIP_CHKSUM_SELECT
+#define LWIP_CHKSUM_SELECT              0
+#endif
+
 /*
    ---------------------------------------
    ---------- Debugging options ----------
@@ -1914,6 +2351,13 @@
 #define SYS_DEBUG                       LWIP_DBG_OFF
 #endif
 
+/**
+ * RECLAIM_DEBUG: Enable debugging in reclaim.c.
+ */
+#ifndef RECLAIM_DEBUG
+#define RECLAIM_DEBUG                   LWIP_DBG_OFF
+#endif
+
 /**
  * TIMERS_DEBUG: Enable debugging in timers.c.
  */
@@ -0,0 +1,92 @@
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef __LWIP_PERF_H__
+#define __LWIP_PERF_H__
+
+#include "lwip/opt.h"
+
+/* the port's perf.h provides the null PERF_START/PERF_STOP definitions used
+   when LWIP_PERF==0 and may provide LWIP_PERF_CLOCK() */
+#include "arch/perf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if LWIP_PERF
+
+#ifndef LWIP_PERF_CLOCK
+#error "LWIP_PERF needs a free-running counter: define LWIP_PERF_CLOCK() in arch/perf.h or lwipopts.h"
+#endif
+
+/** One probe point. Every PERF_STOP() site has its own (static) probe;
+ * sites using the same name share the statistics of the first one
+ * registered. Times are inclusive: a probe around ip_input() also counts
+ * the tcp_input() it calls. */
+struct perf_probe {
+  const char *name;
+  /** next registered probe */
+  struct perf_probe *next;
+  /** probe holding the statistics (this one or an earlier one with the same name) */
+  struct perf_probe *stats;
+  u32_t count;
+  u32_t min;
+  u32_t max;
+  unsigned long long sum;
+  u32_t hist[LWIP_PERF_HIST_BUCKETS];
+};
+
+/** List of all probes that have been hit at least once */
+extern struct perf_probe *perf_probes;
+
+void perf_record(struct perf_probe *probe, u32_t ticks);
+void perf_reset(void);
+void perf_display(void);
+
+/* PERF_START must come after the declarations of a function, PERF_STOP
+   on the exit path(s) to be measured (exits without PERF_STOP are not
+   counted). */
+#undef PERF_START
+#undef PERF_STOP
+#define PERF_START    u32_t perf_start_ = LWIP_PERF_CLOCK()
+#define PERF_STOP(x)  do { \
+  static struct perf_probe perf_probe_ = { x }; \
+  perf_record(&perf_probe_, (u32_t)(LWIP_PERF_CLOCK() - perf_start_)); \
+} while(0)
+
+#else /* LWIP_PERF */
+
+#define perf_reset()
+#define perf_display()
+
+#endif /* LWIP_PERF */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LWIP_PERF_H__ */
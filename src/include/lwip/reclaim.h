@@ -0,0 +1,108 @@
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef __LWIP_RECLAIM_H__
+#define __LWIP_RECLAIM_H__
+
+#include "lwip/opt.h"
+
+#if LWIP_RECLAIM /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** What is short of memory: a memp pool (memp_t), the heap or the buffers of
+ * a netif driver (which the driver knows best, it calls reclaim_signal()). */
+typedef u8_t reclaim_src_t;
+#define RECLAIM_HEAP        ((reclaim_src_t)MEMP_MAX)
+#define RECLAIM_DRIVER      ((reclaim_src_t)(MEMP_MAX + 1))
+#define RECLAIM_SOURCES     (MEMP_MAX + 2)
+
+#if PBUF_RAM_SLAB
+#define RECLAIM_SRC_IS_SLAB(src)  ((src) == MEMP_PBUF_RAM_SLAB)
+#else /* PBUF_RAM_SLAB */
+#define RECLAIM_SRC_IS_SLAB(src)  0
+#endif /* PBUF_RAM_SLAB */
+/** Freeing pbufs helps a source that pbufs (or their data) come from */
+#define RECLAIM_SRC_IS_PBUF(src)  (((src) == RECLAIM_HEAP) || ((src) == RECLAIM_DRIVER) || \
+                                   ((src) == MEMP_PBUF) || ((src) == MEMP_PBUF_POOL) || \
+                                   RECLAIM_SRC_IS_SLAB(src))
+
+/** Priorities of the built-in handlers: the cheapest losses first */
+#define RECLAIM_PRIO_TCP_TIMEWAIT   10
+#define RECLAIM_PRIO_ARP_QUEUE      20
+#define RECLAIM_PRIO_IP_REASS       30
+#define RECLAIM_PRIO_TCP_OOSEQ      40
+
+/** Function prototype for reclaim handlers.
+ * A handler frees one unit of memory (one pcb, one datagram...) that helps
+ * 'src' per call and is called again as long as 'src' is short of memory.
+ *
+ * @param src what is short of memory
+ * @param arg argument passed to reclaim_register()
+ * @return 1 if something was freed, 0 if there is nothing to free for 'src'
+ */
+typedef u8_t (*reclaim_fn)(reclaim_src_t src, void *arg);
+
+/** A registered reclaim handler, the memory is provided by the caller
+ * (memory is short when it is needed) */
+struct reclaim_handler {
+  struct reclaim_handler *next;
+  reclaim_fn fn;
+  void *arg;
+  /** handlers are run in ascending order of prio */
+  u8_t prio;
+  /** number of times the handler freed something */
+  u32_t freed;
+};
+
+/** low watermark per source, read by RECLAIM_CHECK() */
+extern mem_size_t reclaim_lowat[RECLAIM_SOURCES];
+
+/** Called by the allocators after an allocation left 'avail' free */
+#define RECLAIM_CHECK(src, avail) do { \
+  if ((avail) < reclaim_lowat[src]) { \
+    reclaim_signal(src); \
+  } } while(0)
+
+void reclaim_init(void);
+void reclaim_register(struct reclaim_handler *h, reclaim_fn fn, void *arg, u8_t prio);
+void reclaim_unregister(struct reclaim_handler *h);
+void reclaim_set_watermarks(reclaim_src_t src, mem_size_t lowat, mem_size_t hiwat);
+void reclaim_signal(reclaim_src_t src);
+void reclaim_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_RECLAIM */
+
+#endif /* __LWIP_RECLAIM_H__ */
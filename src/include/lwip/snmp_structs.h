@@ -234,6 +234,14 @@ struct mib_external_node
 /** export MIB tree from mib2.c */
 extern const struct mib_array_node internet;
 
+#if SNMP_MEMP_MIB
+/** export lwipMemp subtree from mib_memp.c */
+extern const struct mib_array_node mib_memp;
+#if !SNMP_PRIVATE_MIB
+extern const struct mib_array_node mib_private;
+#endif /* !SNMP_PRIVATE_MIB */
+#endif /* SNMP_MEMP_MIB */
+
 /** dummy function pointers for non-leaf MIB nodes from mib2.c */
 void noleafs_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od);
 void noleafs_get_value(struct obj_def *od, u16_t len, void *value);
@@ -42,6 +42,7 @@
 
 #include "lwip/ip_addr.h"
 #include "lwip/inet.h"
+#include "lwip/pbuf.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -330,7 +331,16 @@ int lwip_recv(int s, void *mem, size_t len, int flags);
 int lwip_read(int s, void *mem, size_t len);
 int lwip_recvfrom(int s, void *mem, size_t len, int flags,
       struct sockaddr *from, socklen_t *fromlen);
+#if LWIP_NETCONN_RECV_ZC
+int lwip_recvfrom_zc(int s, struct pbuf **p, int flags,
+      struct sockaddr *from, socklen_t *fromlen);
+int lwip_recv_zc_release(int s, struct pbuf *p);
+#endif /* LWIP_NETCONN_RECV_ZC */
 int lwip_send(int s, const void *dataptr, size_t size, int flags);
+#if LWIP_TCP && LWIP_TCP_WRITEV
+struct tcp_iovec;
+int lwip_writev_zc(int s, struct tcp_iovec *iov, int iovcnt, int flags);
+#endif /* LWIP_TCP && LWIP_TCP_WRITEV */
 int lwip_sendto(int s, const void *dataptr, size_t size, int flags,
     const struct sockaddr *to, socklen_t tolen);
 int lwip_socket(int domain, int type, int protocol);
@@ -96,8 +96,20 @@ struct stats_mem {
   mem_size_t max;
   STAT_COUNTER err;
   STAT_COUNTER illegal;
+  /* heap only, see mem_frag_update() */
+  mem_size_t largest;
+  u8_t frag;
 };
 
+#if MEMP_STATS && MEMP_STATS_CALLERS
+/** Allocation failures of one memp_malloc() call site */
+struct stats_memp_caller {
+  const char *file;
+  u16_t line;
+  STAT_COUNTER err;
+};
+#endif /* MEMP_STATS && MEMP_STATS_CALLERS */
+
 struct stats_syselem {
   STAT_COUNTER used;
   STAT_COUNTER max;
@@ -110,6 +122,13 @@ struct stats_sys {
   struct stats_syselem mbox;
 };
 
+/** TCP pcbs per state (see tcp_pcb_num) */
+struct stats_tcp_pcbs {
+  struct stats_syselem active;     /* on tcp_active_pcbs, err: SYNs refused */
+  struct stats_syselem syn_rcvd;   /* active pcbs in SYN_RCVD, err: SYN cookies sent */
+  struct stats_syselem time_wait;  /* on tcp_tw_pcbs */
+};
+
 struct stats_ {
 #if LINK_STATS
   struct stats_proto link;
@@ -134,12 +153,21 @@ struct stats_ {
 #endif
 #if TCP_STATS
   struct stats_proto tcp;
+  struct stats_tcp_pcbs tcp_pcbs;
 #endif
 #if MEM_STATS
   struct stats_mem mem;
 #endif
 #if MEMP_STATS
   struct stats_mem memp[MEMP_MAX];
+#if MEMP_STATS_CALLERS
+  struct stats_memp_caller memp_caller[MEMP_MAX][MEMP_STATS_CALLERS];
+#endif
+#if MEMP_STATS_HIST_BUCKETS
+  /* time elements stayed allocated: bucket i counts 2^i..2^(i+1)-1 ms
+     (bucket 0 includes 0) */
+  STAT_COUNTER memp_hist[MEMP_MAX][MEMP_STATS_HIST_BUCKETS];
+#endif
 #endif
 #if SYS_STATS
   struct stats_sys sys;
@@ -166,9 +194,14 @@ void stats_init(void);
 
 #if TCP_STATS
 #define TCP_STATS_INC(x) STATS_INC(x)
-#define TCP_STATS_DISPLAY() stats_display_proto(&lwip_stats.tcp, "TCP")
+#define TCP_PCBS_STATS_INC_USED(x) STATS_INC_USED(tcp_pcbs.x, 1)
+#define TCP_PCBS_STATS_DEC_USED(x) STATS_DEC(tcp_pcbs.x.used)
+#define TCP_STATS_DISPLAY() do { stats_display_proto(&lwip_stats.tcp, "TCP"); \
+                                 stats_display_tcp_pcbs(&lwip_stats.tcp_pcbs); } while(0)
 #else
 #define TCP_STATS_INC(x)
+#define TCP_PCBS_STATS_INC_USED(x)
+#define TCP_PCBS_STATS_DEC_USED(x)
 #define TCP_STATS_DISPLAY()
 #endif
 
@@ -233,7 +266,7 @@ void stats_init(void);
 #define MEM_STATS_INC(x) STATS_INC(mem.x)
 #define MEM_STATS_INC_USED(x, y) STATS_INC_USED(mem, y)
 #define MEM_STATS_DEC_USED(x, y) lwip_stats.mem.x -= y
-#define MEM_STATS_DISPLAY() stats_display_mem(&lwip_stats.mem, "HEAP")
+#define MEM_STATS_DISPLAY() do { mem_frag_update(); stats_display_mem(&lwip_stats.mem, "HEAP"); } while(0)
 #else
 #define MEM_STATS_AVAIL(x, y)
 #define MEM_STATS_INC(x)
@@ -276,6 +309,7 @@ void stats_display_igmp(struct stats_igmp *igmp);
 void stats_display_mem(struct stats_mem *mem, char *name);
 void stats_display_memp(struct stats_mem *mem, int index);
 void stats_display_sys(struct stats_sys *sys);
+void stats_display_tcp_pcbs(struct stats_tcp_pcbs *pcbs);
 #else /* LWIP_STATS_DISPLAY */
 #define stats_display()
 #define stats_display_proto(proto, name)
@@ -283,6 +317,7 @@ void stats_display_sys(struct stats_sys *sys);
 #define stats_display_mem(mem, name)
 #define stats_display_memp(mem, index)
 #define stats_display_sys(sys)
+#define stats_display_tcp_pcbs(pcbs)
 #endif /* LWIP_STATS_DISPLAY */
 
 #ifdef __cplusplus
@@ -227,12 +227,18 @@ void sys_init(void);
 u32_t sys_jiffies(void);
 #endif
 
+#ifdef NOW
 /** Returns the current time in milliseconds,
  * may be the same as sys_jiffies or at least based on it. */
 ICACHE_FLASH_ATTR static inline u32_t sys_now(void)
 {
   return NOW()/(TIMER_CLK_FREQ/1000);
 }
+#else /* NOW */
+/** Returns the current time in milliseconds (implemented in sys_arch.c
+ * on ports that don't have the SDK's NOW() timer) */
+u32_t sys_now(void);
+#endif /* NOW */
 
 /* Critical Region Protection */
 /* These functions must be implemented in the sys_arch.c file.
@@ -151,6 +151,55 @@ enum tcp_state {
 #define DEF_ACCEPT_CALLBACK
 #endif /* LWIP_CALLBACK_API */
 
+#if LWIP_WND_SCALE
+#define RCV_WND_SCALE(pcb, wnd) (((wnd) >> (pcb)->rcv_scale))
+#define SND_WND_SCALE(pcb, wnd) (((wnd) << (pcb)->snd_scale))
+#define TCPWND16(x)             ((u16_t)LWIP_MIN((x), 0xFFFF))
+#define TCP_WND_MAX(pcb)        ((tcpwnd_size_t)(((pcb)->flags & TF_WND_SCALE) ? TCP_WND : TCPWND16(TCP_WND)))
+typedef u32_t tcpwnd_size_t;
+#define TCPWNDSIZE_F            U32_F
+#else /* LWIP_WND_SCALE */
+#define RCV_WND_SCALE(pcb, wnd) (wnd)
+#define SND_WND_SCALE(pcb, wnd) (wnd)
+#define TCPWND16(x)             (x)
+#define TCP_WND_MAX(pcb)        TCP_WND
+typedef u16_t tcpwnd_size_t;
+#define TCPWNDSIZE_F            U16_F
+#endif /* LWIP_WND_SCALE */
+
+#if LWIP_WND_SCALE || LWIP_TCP_SACK
+typedef u16_t tcpflags_t;
+#else /* LWIP_WND_SCALE || LWIP_TCP_SACK */
+typedef u8_t tcpflags_t;
+#endif /* LWIP_WND_SCALE || LWIP_TCP_SACK */
+
+#if LWIP_TCP_TIMERS_MS
+/* RTO in milliseconds */
+typedef s32_t tcptmr_t;
+#define TCPTMR_F                S32_F
+#else /* LWIP_TCP_TIMERS_MS */
+/* RTO in slow timer ticks */
+typedef s16_t tcptmr_t;
+#define TCPTMR_F                S16_F
+#endif /* LWIP_TCP_TIMERS_MS */
+
+#if TCP_PCB_HASH
+  /* chains the pcbs of one bucket of the demultiplexing hash tables */
+#define DEF_HASH_NEXT(type)  type *hash_next;
+#else /* TCP_PCB_HASH */
+#define DEF_HASH_NEXT(type)
+#endif /* TCP_PCB_HASH */
+
+#if LWIP_TCP_CC
+struct tcp_cc_ops;
+  /* congestion control of the pcb, inherited from the listening pcb */
+#define DEF_CC_OPS  const struct tcp_cc_ops *cc_ops;
+/** u32_t words of congestion control module state in each pcb */
+#define TCP_CC_PRIV_WORDS  6
+#else /* LWIP_TCP_CC */
+#define DEF_CC_OPS
+#endif /* LWIP_TCP_CC */
+
 /**
  * members common to struct tcp_pcb and struct tcp_listen_pcb
  */
@@ -161,6 +210,8 @@ enum tcp_state {
   void *callback_arg; \
   /* the accept callback for listen- and normal pcbs, if LWIP_CALLBACK_API */ \
   DEF_ACCEPT_CALLBACK \
+  DEF_HASH_NEXT(type) \
+  DEF_CC_OPS \
   /* ports are in host byte order */ \
   u16_t local_port
 
@@ -175,39 +226,60 @@ struct tcp_pcb {
   /* ports are in host byte order */
   u16_t remote_port;
   
-  u8_t flags;
-#define TF_ACK_DELAY   ((u8_t)0x01U)   /* Delayed ACK. */
-#define TF_ACK_NOW     ((u8_t)0x02U)   /* Immediate ACK. */
-#define TF_INFR        ((u8_t)0x04U)   /* In fast recovery. */
-#define TF_TIMESTAMP   ((u8_t)0x08U)   /* Timestamp option enabled */
-#define TF_RXCLOSED    ((u8_t)0x10U)   /* rx closed by tcp_shutdown */
-#define TF_FIN         ((u8_t)0x20U)   /* Connection was closed locally (FIN segment enqueued). */
-#define TF_NODELAY     ((u8_t)0x40U)   /* Disable Nagle algorithm */
-#define TF_NAGLEMEMERR ((u8_t)0x80U)   /* nagle enabled, memerr, try to output to prevent delayed ACK to happen */
+  tcpflags_t flags;
+#define TF_ACK_DELAY   ((tcpflags_t)0x01U)   /* Delayed ACK. */
+#define TF_ACK_NOW     ((tcpflags_t)0x02U)   /* Immediate ACK. */
+#define TF_INFR        ((tcpflags_t)0x04U)   /* In fast recovery. */
+#define TF_TIMESTAMP   ((tcpflags_t)0x08U)   /* Timestamp option enabled */
+#define TF_RXCLOSED    ((tcpflags_t)0x10U)   /* rx closed by tcp_shutdown */
+#define TF_FIN         ((tcpflags_t)0x20U)   /* Connection was closed locally (FIN segment enqueued). */
+#define TF_NODELAY     ((tcpflags_t)0x40U)   /* Disable Nagle algorithm */
+#define TF_NAGLEMEMERR ((tcpflags_t)0x80U)   /* nagle enabled, memerr, try to output to prevent delayed ACK to happen */
+#if LWIP_WND_SCALE
+#define TF_WND_SCALE   ((tcpflags_t)0x0100U) /* Window scale option enabled */
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+#define TF_SACK        ((tcpflags_t)0x0200U) /* Selective acknowledgments enabled */
+#endif /* LWIP_TCP_SACK */
+#if LWIP_TCP_RACK
+#define TF_RACK_REO    ((tcpflags_t)0x0400U) /* rack_tmr is the RACK reordering timer */
+#define TF_TLP_PTO     ((tcpflags_t)0x0800U) /* rack_tmr is the tail loss probe timeout */
+#define TF_TLP_SENT    ((tcpflags_t)0x1000U) /* A tail loss probe is outstanding */
+#endif /* LWIP_TCP_RACK */
 
   /* the rest of the fields are in host byte order
      as we have to do some math with them */
   /* receiver variables */
   u32_t rcv_nxt;   /* next seqno expected */
-  u16_t rcv_wnd;   /* receiver window available */
-  u16_t rcv_ann_wnd; /* receiver window to announce */
+  tcpwnd_size_t rcv_wnd;   /* receiver window available */
+  tcpwnd_size_t rcv_ann_wnd; /* receiver window to announce */
   u32_t rcv_ann_right_edge; /* announced right edge of window */
 
   /* Timers */
   u32_t tmr;
   u8_t polltmr, pollinterval;
   
-  /* Retransmission timer. */
+  /* Retransmission timer: slow timer ticks since it was started, -1 if
+     stopped. With LWIP_TCP_TIMERS_MS only 0 (running) or -1. */
   s16_t rtime;
+#if LWIP_TCP_TIMERS_MS
+  u32_t rtime_start; /* tcp_ticks when the retransmission timer was started */
+  u32_t ack_time;    /* tcp_ticks when TF_ACK_DELAY was set */
+#endif /* LWIP_TCP_TIMERS_MS */
   
   u16_t mss;   /* maximum segment size */
   
   /* RTT (round trip time) estimation variables */
-  u32_t rttest; /* RTT estimate in 500ms ticks */
+  u32_t rttest; /* tcp_ticks when the timed segment was sent */
   u32_t rtseq;  /* sequence number being timed */
-  s16_t sa, sv; /* @todo document this */
+  s32_t sa;     /* smoothed RTT in milliseconds, scaled by 8 */
+  s32_t sv;     /* RTT variation in milliseconds, scaled by 4 */
+#if LWIP_TCP_TIMESTAMPS
+  u8_t sa_frac; /* 1/256ths of sa and sv carried over between the */
+  u8_t sv_frac; /*   divided gains of per-ACK measurements */
+#endif /* LWIP_TCP_TIMESTAMPS */
 
-  s16_t rto;    /* retransmission time-out */
+  tcptmr_t rto; /* retransmission time-out */
   u8_t nrtx;    /* number of retransmissions */
 
   /* fast retransmit/recovery */
@@ -215,19 +287,19 @@ struct tcp_pcb {
   u8_t dupacks;
   
   /* congestion avoidance/control variables */
-  u16_t cwnd;  
-  u16_t ssthresh;
+  tcpwnd_size_t cwnd;
+  tcpwnd_size_t ssthresh;
 
   /* sender variables */
   u32_t snd_nxt;   /* next new seqno to be sent */
-  u16_t snd_wnd;   /* sender window */
+  tcpwnd_size_t snd_wnd;   /* sender window */
   u32_t snd_wl1, snd_wl2; /* Sequence and acknowledgement numbers of last
                              window update. */
   u32_t snd_lbb;       /* Sequence number of next byte to be buffered. */
 
-  u16_t acked;
+  tcpwnd_size_t acked;
   
-  u16_t snd_buf;   /* Available buffer space for sending (in bytes). */
+  tcpwnd_size_t snd_buf;   /* Available buffer space for sending (in bytes). */
 #define TCP_SNDQUEUELEN_OVERFLOW (0xffff-3)
   u16_t snd_queuelen; /* Available buffer space for sending (in tcp_segs). */
 
@@ -261,6 +333,7 @@ struct tcp_pcb {
 #if LWIP_TCP_TIMESTAMPS
   u32_t ts_lastacksent;
   u32_t ts_recent;
+  u32_t ts_recent_time; /* sys_now() when ts_recent was last updated */
 #endif /* LWIP_TCP_TIMESTAMPS */
 
   /* idle time before KEEPALIVE is sent */
@@ -270,13 +343,45 @@ struct tcp_pcb {
   u32_t keep_cnt;
 #endif /* LWIP_TCP_KEEPALIVE */
   
-  /* Persist timer counter */
+  /* Persist timer counter (LWIP_TCP_TIMERS_MS: tcp_ticks when started) */
   u32_t persist_cnt;
   /* Persist timer back-off */
   u8_t persist_backoff;
 
   /* KEEPALIVE counter */
   u8_t keep_cnt_sent;
+
+#if LWIP_WND_SCALE
+  /* shift counts of the window scale option, 0 unless TF_WND_SCALE */
+  u8_t snd_scale;
+  u8_t rcv_scale;
+#endif /* LWIP_WND_SCALE */
+
+#if LWIP_TCP_SACK
+  /* start of the out-of-sequence segment received last, its block is
+     reported first (RFC 2018, section 4) */
+  u32_t sack_seqno;
+#endif /* LWIP_TCP_SACK */
+
+#if LWIP_TCP_RACK
+  /* RACK (RFC 8985): send time and end of the most recently sent segment
+     known to be delivered, and the RTT measured with it */
+  u32_t rack_xmit_time;
+  u32_t rack_end_seq;
+  u32_t rack_rtt;
+  u32_t rack_min_rtt; /* lowest RTT measured, 0 if none yet */
+  /* tcp_ticks when the reordering timer or the probe timeout expires */
+  u32_t rack_tmr;
+  /* snd_nxt when the tail loss probe was sent */
+  u32_t tlp_end_seq;
+#endif /* LWIP_TCP_RACK */
+
+#if LWIP_TCP_CC
+  /* highest seqno sent when fast recovery was entered (RFC 6582) */
+  u32_t recover;
+  /* private state of cc_ops */
+  u32_t cc_priv[TCP_CC_PRIV_WORDS];
+#endif /* LWIP_TCP_CC */
 };
 
 struct tcp_pcb_listen {  
@@ -321,11 +426,15 @@ void             tcp_poll    (struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interv
 void             tcp_err     (struct tcp_pcb *pcb, tcp_err_fn err);
 
 #define          tcp_mss(pcb)             (((pcb)->flags & TF_TIMESTAMP) ? ((pcb)->mss - 12)  : (pcb)->mss)
-#define          tcp_sndbuf(pcb)          ((pcb)->snd_buf)
+#define          tcp_sndbuf(pcb)          (TCPWND16((pcb)->snd_buf))
 #define          tcp_sndqueuelen(pcb)     ((pcb)->snd_queuelen)
 #define          tcp_nagle_disable(pcb)   ((pcb)->flags |= TF_NODELAY)
 #define          tcp_nagle_enable(pcb)    ((pcb)->flags &= ~TF_NODELAY)
 #define          tcp_nagle_disabled(pcb)  (((pcb)->flags & TF_NODELAY) != 0)
+/** Smoothed round-trip time and its variation in milliseconds, 0 before the
+    first measurement */
+#define          tcp_srtt(pcb)            ((u32_t)((pcb)->sa >> 3))
+#define          tcp_rttvar(pcb)          ((u32_t)((pcb)->sv >> 2))
 
 #if TCP_LISTEN_BACKLOG
 #define          tcp_accepted(pcb) do { \
@@ -356,6 +465,34 @@ err_t            tcp_shutdown(struct tcp_pcb *pcb, int shut_rx, int shut_tx);
 err_t            tcp_write   (struct tcp_pcb *pcb, const void *dataptr, u16_t len,
                               u8_t apiflags);
 
+#if LWIP_TCP_WRITEV
+struct tcp_iovec;
+
+/** Function prototype for the completion callback of a tcp_iovec.
+ *
+ * @param arg the 'arg' member of the tcp_iovec
+ * @param iov the tcp_iovec whose buffer lwIP no longer references; the
+ *            buffer and the tcp_iovec itself may be reused from now on
+ */
+typedef void (*tcp_iov_done_fn)(void *arg, struct tcp_iovec *iov);
+
+/** One application buffer for tcp_writev(). The tcp_iovec must stay valid
+ * (not on the stack of a returning function) until 'done' was called. */
+struct tcp_iovec {
+  /** the data to send, referenced (not copied) until 'done' is called */
+  const void *base;
+  u16_t len;
+  /** called once all bytes were acknowledged or dropped, may be NULL */
+  tcp_iov_done_fn done;
+  void *arg;
+  /* private: references held by lwIP */
+  u16_t refs;
+};
+
+err_t            tcp_writev  (struct tcp_pcb *pcb, struct tcp_iovec *iov, u8_t iovcnt,
+                              u8_t apiflags, u8_t *queued);
+#endif /* LWIP_TCP_WRITEV */
+
 void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
 
 #define TCP_PRIO_MIN    1
@@ -0,0 +1,87 @@
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef __LWIP_TCP_CC_H__
+#define __LWIP_TCP_CC_H__
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP && LWIP_TCP_CC /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/tcp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A congestion control algorithm.
+ *
+ * The core keeps the RFC 6582 recovery logic (dupack counting, cwnd
+ * inflation during fast recovery, partial ACKs) and asks the algorithm how
+ * to move pcb->cwnd and pcb->ssthresh. Private state belongs in
+ * pcb->cc_priv. All hooks are called from the tcpip thread.
+ */
+struct tcp_cc_ops {
+  /** name for tcp_cc_find() */
+  const char *name;
+  /** (re)start on an established connection: reset cc_priv, may adjust the
+   * initial cwnd set by the core */
+  void (*init)(struct tcp_pcb *pcb);
+  /** new data was acknowledged outside of fast recovery */
+  void (*on_ack)(struct tcp_pcb *pcb, tcpwnd_size_t acked);
+  /** fast retransmit: set ssthresh and the inflated cwnd for fast recovery
+   * (cwnd is set to ssthresh when recovery is left) */
+  void (*on_loss)(struct tcp_pcb *pcb);
+  /** retransmission time-out: set ssthresh and cwnd */
+  void (*on_rto)(struct tcp_pcb *pcb);
+  /** sending is resumed after the connection was idle for more than
+   * an RTO (RFC 5681, section 4.1) */
+  void (*on_idle)(struct tcp_pcb *pcb);
+};
+
+#if TCP_CC_NEWRENO
+extern const struct tcp_cc_ops tcp_cc_newreno;
+#endif /* TCP_CC_NEWRENO */
+#if TCP_CC_CUBIC
+extern const struct tcp_cc_ops tcp_cc_cubic;
+#endif /* TCP_CC_CUBIC */
+#if TCP_CC_LOWMEM
+extern const struct tcp_cc_ops tcp_cc_lowmem;
+#endif /* TCP_CC_LOWMEM */
+
+err_t tcp_set_cc(struct tcp_pcb *pcb, const struct tcp_cc_ops *ops);
+const struct tcp_cc_ops *tcp_cc_find(const char *name);
+
+/* Only used by the TCP core */
+void tcp_cc_established(struct tcp_pcb *pcb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_TCP && LWIP_TCP_CC */
+
+#endif /* __LWIP_TCP_CC_H__ */
@@ -43,6 +43,8 @@
 #include "lwip/ip.h"
 #include "lwip/icmp.h"
 #include "lwip/err.h"
+#include "lwip/stats.h"
+#include "lwip/reclaim.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -59,6 +61,12 @@ void             tcp_tmr     (void);  /* Must be called every
    intervals (instead of calling tcp_tmr()). */
 void             tcp_slowtmr (void);
 void             tcp_fasttmr (void);
+#if LWIP_RECLAIM
+u8_t             tcp_reclaim_timewait(reclaim_src_t src, void *arg);
+#if TCP_QUEUE_OOSEQ
+u8_t             tcp_reclaim_ooseq(reclaim_src_t src, void *arg);
+#endif /* TCP_QUEUE_OOSEQ */
+#endif /* LWIP_RECLAIM */
 
 
 /* Only used by IP to pass a TCP segment to TCP: */
@@ -70,6 +78,14 @@ err_t            tcp_send_empty_ack(struct tcp_pcb *pcb);
 void             tcp_rexmit  (struct tcp_pcb *pcb);
 void             tcp_rexmit_rto  (struct tcp_pcb *pcb);
 void             tcp_rexmit_fast (struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK
+u8_t             tcp_rexmit_holes(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK */
+#if LWIP_TCP_RACK
+void             tcp_rack_detect_loss(struct tcp_pcb *pcb);
+void             tcp_rack_timeout(struct tcp_pcb *pcb);
+void             tcp_tlp_arm (struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_RACK */
 u32_t            tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb);
 
 /**
@@ -124,6 +140,12 @@ u32_t            tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb);
 #define TCP_SLOW_INTERVAL      (2*TCP_TMR_INTERVAL)  /* the coarse grained timeout in milliseconds */
 #endif /* TCP_SLOW_INTERVAL */
 
+#if LWIP_TCP_TIMERS_MS
+#define TCP_TICK_MS            1  /* tcp_ticks, pcb->tmr and pcb->rto count milliseconds */
+#else /* LWIP_TCP_TIMERS_MS */
+#define TCP_TICK_MS            TCP_SLOW_INTERVAL  /* ... or slow timer ticks */
+#endif /* LWIP_TCP_TIMERS_MS */
+
 #define TCP_FIN_WAIT_TIMEOUT 20000 /* milliseconds */
 #define TCP_SYN_RCVD_TIMEOUT 20000 /* milliseconds */
 
@@ -133,6 +155,24 @@ u32_t            tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb);
 #define TCP_MSL 60000UL /* The maximum segment lifetime in milliseconds */
 #endif
 
+/* A timestamp older than this is no longer used by PAWS (RFC 7323, 5.5) */
+#define TCP_PAWS_IDLE (24UL * 24 * 60 * 60 * 1000) /* milliseconds */
+
+#if LWIP_TCP_TIMERS_MS
+/* RTO in milliseconds from the RTT estimate: SRTT + max(G, 4 * RTTVAR)
+   with G = 1 ms (RFC 6298, 2.3), within TCP_RTO_MIN and TCP_RTO_MAX */
+#define TCP_RTO_CALC(pcb) ((tcptmr_t)LWIP_MIN(LWIP_MAX(((pcb)->sa >> 3) + \
+  LWIP_MAX((pcb)->sv, 1), TCP_RTO_MIN), TCP_RTO_MAX))
+#else /* LWIP_TCP_TIMERS_MS */
+/* RTO in slow timer ticks from the RTT estimate: SRTT + max(G, 4 * RTTVAR)
+   with the timer granularity G (RFC 6298, 2.3), at least TCP_RTO_MIN and
+   rounded up. One more tick because the first one may pass right after
+   the segment was sent, so the time-out is never shorter than that. */
+#define TCP_RTO_CALC(pcb) ((tcptmr_t)((LWIP_MAX(((pcb)->sa >> 3) + \
+  LWIP_MAX((pcb)->sv, TCP_SLOW_INTERVAL), TCP_RTO_MIN) + TCP_SLOW_INTERVAL - 1) / \
+  TCP_SLOW_INTERVAL + 1))
+#endif /* LWIP_TCP_TIMERS_MS */
+
 /* Keepalive values, compliant with RFC 1122. Don't change this unless you know what you're doing */
 #ifndef  TCP_KEEPIDLE_DEFAULT
 #define  TCP_KEEPIDLE_DEFAULT     7200000UL /* Default KEEPALIVE timer in milliseconds */
@@ -294,12 +334,34 @@ struct tcp_seg {
 #define TF_SEG_OPTS_TS          (u8_t)0x02U /* Include timestamp option. */
 #define TF_SEG_DATA_CHECKSUMMED (u8_t)0x04U /* ALL data (not the header) is
                                                checksummed into 'chksum' */
+#define TF_SEG_HDR_CHECKSUMMED  (u8_t)0x08U /* tcphdr->chksum is valid for the
+                                               segment as last sent, so a
+                                               retransmission only updates it */
+#define TF_SEG_OPTS_WND_SCALE   (u8_t)0x10U /* Include window scale option. */
+#define TF_SEG_OPTS_SACK_PERM   (u8_t)0x20U /* Include SACK-permitted option. */
+#define TF_SEG_SACKED           (u8_t)0x40U /* covered by a SACK block of the peer */
+#define TF_SEG_REXMIT_HOLE      (u8_t)0x80U /* already retransmitted as a hole,
+                                               cleared by the RTO */
+#if LWIP_TCP_RACK
+  u8_t  xmit_cnt;          /* number of times sent */
+  u32_t xmit_time;         /* tcp_ticks when last sent */
+#endif /* LWIP_TCP_RACK */
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
+#if LWIP_TCP_WRITEV
+/** A PBUF_REF pbuf referencing (part of) the buffer of a tcp_iovec */
+struct tcp_iov_pbuf {
+  struct pbuf_custom pc;
+  struct tcp_iovec *iov;
+};
+#endif /* LWIP_TCP_WRITEV */
+
 #define LWIP_TCP_OPT_LENGTH(flags)              \
   (flags & TF_SEG_OPTS_MSS ? 4  : 0) +          \
-  (flags & TF_SEG_OPTS_TS  ? 12 : 0)
+  (flags & TF_SEG_OPTS_TS  ? 12 : 0) +          \
+  (flags & TF_SEG_OPTS_WND_SCALE ? 4 : 0) +     \
+  (flags & TF_SEG_OPTS_SACK_PERM ? 4 : 0)
 
 /** This returns a TCP header option for MSS in an u32_t */
 #define TCP_BUILD_MSS_OPTION(x) (x) = PP_HTONL(((u32_t)2 << 24) |          \
@@ -309,7 +371,12 @@ struct tcp_seg {
 
 /* Global variables: */
 extern struct tcp_pcb *tcp_input_pcb;
+#if LWIP_TCP_TIMERS_MS
+/* the TCP timers run on the system clock */
+#define tcp_ticks (sys_now())
+#else /* LWIP_TCP_TIMERS_MS */
 extern u32_t tcp_ticks;
+#endif /* LWIP_TCP_TIMERS_MS */
 
 /* The TCP PCB lists. */
 union tcp_listen_pcbs_t { /* List of all TCP PCBs in LISTEN state. */
@@ -331,6 +398,68 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
    3) All PCBs in the tcp_listen_pcbs list is in LISTEN state.
    4) All PCBs in the tcp_tw_pcbs list is in TIME-WAIT state.
 */
+/** Number of pcbs on tcp_active_pcbs (syn_rcvd: of those in SYN_RCVD) and
+   on tcp_tw_pcbs, so that admission decisions don't have to walk the lists.
+   Maintained by TCP_REG/TCP_RMV; tcp_slowtmr, which unlinks pcbs by hand,
+   and the transitions out of SYN_RCVD update them directly. */
+struct tcp_pcb_num_t {
+  u16_t active;
+  u16_t syn_rcvd;
+  u16_t time_wait;
+};
+extern struct tcp_pcb_num_t tcp_pcb_num;
+
+#define TCP_PCB_NUM_INC(x) do { tcp_pcb_num.x++; TCP_PCBS_STATS_INC_USED(x); } while(0)
+#define TCP_PCB_NUM_DEC(x) do { tcp_pcb_num.x--; TCP_PCBS_STATS_DEC_USED(x); } while(0)
+#define TCP_PCB_NUM_REG(pcbs, npcb) do { \
+    if ((pcbs) == &tcp_active_pcbs) { \
+      TCP_PCB_NUM_INC(active); \
+      if ((npcb)->state == SYN_RCVD) { \
+        TCP_PCB_NUM_INC(syn_rcvd); \
+      } \
+    } else if ((pcbs) == &tcp_tw_pcbs) { \
+      TCP_PCB_NUM_INC(time_wait); \
+    } \
+  } while(0)
+/* tcp_abandon() removes CLOSED pcbs that are on no list from
+   tcp_active_pcbs, but active pcbs are never CLOSED (axiom 1) */
+#define TCP_PCB_NUM_RMV(pcbs, npcb) do { \
+    if ((pcbs) == &tcp_active_pcbs) { \
+      if ((npcb)->state != CLOSED) { \
+        TCP_PCB_NUM_DEC(active); \
+        if ((npcb)->state == SYN_RCVD) { \
+          TCP_PCB_NUM_DEC(syn_rcvd); \
+        } \
+      } \
+    } else if ((pcbs) == &tcp_tw_pcbs) { \
+      TCP_PCB_NUM_DEC(time_wait); \
+    } \
+  } while(0)
+
+#if TCP_PCB_HASH
+/* With TCP_PCB_HASH, the pcbs of tcp_active_pcbs and tcp_tw_pcbs are
+   additionally chained (through hash_next) into the buckets of a hash table
+   indexed by their 4-tuple, those of tcp_listen_pcbs into a table indexed by
+   their local port. TCP_REG and TCP_RMV maintain the tables, so the key
+   fields must be set before registering a pcb and must not change while it
+   is registered. */
+extern struct tcp_pcb *tcp_active_hash[TCP_PCB_HASH_SIZE];
+extern struct tcp_pcb *tcp_tw_hash[TCP_PCB_HASH_SIZE];
+extern struct tcp_pcb_listen *tcp_listen_hash[TCP_LISTEN_HASH_SIZE];
+
+u16_t tcp_pcb_hash(ip_addr_t *local_ip, u16_t local_port,
+                   ip_addr_t *remote_ip, u16_t remote_port);
+#define TCP_LISTEN_HASH(port) (((port) ^ ((port) >> 8)) & (TCP_LISTEN_HASH_SIZE - 1))
+
+void tcp_hash_reg(struct tcp_pcb **pcbs, struct tcp_pcb *npcb);
+void tcp_hash_rmv(struct tcp_pcb **pcbs, struct tcp_pcb *npcb);
+#define TCP_HASH_REG(pcbs, npcb) tcp_hash_reg(pcbs, npcb)
+#define TCP_HASH_RMV(pcbs, npcb) tcp_hash_rmv(pcbs, npcb)
+#else /* TCP_PCB_HASH */
+#define TCP_HASH_REG(pcbs, npcb)
+#define TCP_HASH_RMV(pcbs, npcb)
+#endif /* TCP_PCB_HASH */
+
 /* Define two macros, TCP_REG and TCP_RMV that registers a TCP PCB
    with a PCB list or removes a PCB from a list, respectively. */
 #ifndef TCP_DEBUG_PCB_LISTS
@@ -348,6 +477,8 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
                             (npcb)->next = *(pcbs); \
                             LWIP_ASSERT("TCP_REG: npcb->next != npcb", (npcb)->next != (npcb)); \
                             *(pcbs) = (npcb); \
+                            TCP_HASH_REG(pcbs, npcb); \
+                            TCP_PCB_NUM_REG(pcbs, npcb); \
                             LWIP_ASSERT("TCP_RMV: tcp_pcbs sane", tcp_pcbs_sane()); \
               tcp_timer_needed(); \
                             } while(0)
@@ -363,6 +494,8 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
                                } \
                             } \
                             (npcb)->next = NULL; \
+                            TCP_HASH_RMV(pcbs, npcb); \
+                            TCP_PCB_NUM_RMV(pcbs, npcb); \
                             LWIP_ASSERT("TCP_RMV: tcp_pcbs sane", tcp_pcbs_sane()); \
                             LWIP_DEBUGF(TCP_DEBUG, ("TCP_RMV: removed %p from %p\n", (npcb), *(pcbs))); \
                             } while(0)
@@ -373,6 +506,8 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
   do {                                             \
     (npcb)->next = *pcbs;                          \
     *(pcbs) = (npcb);                              \
+    TCP_HASH_REG(pcbs, npcb);                      \
+    TCP_PCB_NUM_REG(pcbs, npcb);                   \
     tcp_timer_needed();                            \
   } while (0)
 
@@ -392,6 +527,8 @@ extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
       }                                            \
     }                                              \
     (npcb)->next = NULL;                           \
+    TCP_HASH_RMV(pcbs, npcb);                      \
+    TCP_PCB_NUM_RMV(pcbs, npcb);                   \
   } while(0)
 
 #endif /* LWIP_DEBUG */
@@ -406,6 +543,15 @@ void tcp_segs_free(struct tcp_seg *seg);
 void tcp_seg_free(struct tcp_seg *seg);
 struct tcp_seg *tcp_seg_copy(struct tcp_seg *seg);
 
+#if LWIP_TCP_TIMERS_MS
+#define TCP_ACK_DELAY_START(pcb)   ((pcb)->ack_time = tcp_ticks)
+#define TCP_ACK_DELAY_EXPIRED(pcb) ((u32_t)(tcp_ticks - (pcb)->ack_time) >= TCP_ACK_DELAY)
+#else /* LWIP_TCP_TIMERS_MS */
+/* delayed ACKs are sent on the next tcp_fasttmr() */
+#define TCP_ACK_DELAY_START(pcb)
+#define TCP_ACK_DELAY_EXPIRED(pcb) 1
+#endif /* LWIP_TCP_TIMERS_MS */
+
 #define tcp_ack(pcb)                               \
   do {                                             \
     if((pcb)->flags & TF_ACK_DELAY) {              \
@@ -414,6 +560,7 @@ struct tcp_seg *tcp_seg_copy(struct tcp_seg *seg);
     }                                              \
     else {                                         \
       (pcb)->flags |= TF_ACK_DELAY;                \
+      TCP_ACK_DELAY_START(pcb);                    \
     }                                              \
   } while (0)
 
@@ -433,6 +580,18 @@ void tcp_rst(u32_t seqno, u32_t ackno,
 
 u32_t tcp_next_iss(void);
 
+#if TCP_SYNCOOKIES
+void tcp_synack(u32_t seqno, u32_t ackno,
+       ip_addr_t *local_ip, ip_addr_t *remote_ip,
+       u16_t local_port, u16_t remote_port);
+u32_t tcp_syncookie_iss(ip_addr_t *local_ip, u16_t local_port,
+       ip_addr_t *remote_ip, u16_t remote_port,
+       u32_t peer_iss, u16_t mss);
+u16_t tcp_syncookie_check(ip_addr_t *local_ip, u16_t local_port,
+       ip_addr_t *remote_ip, u16_t remote_port,
+       u32_t peer_iss, u32_t iss);
+#endif /* TCP_SYNCOOKIES */
+
 void tcp_keepalive(struct tcp_pcb *pcb);
 void tcp_zero_window_probe(struct tcp_pcb *pcb);
 
@@ -462,6 +621,33 @@ s16_t tcp_pcbs_sane(void);
  * that a timer is needed (i.e. active- or time-wait-pcb found). */
 void tcp_timer_needed(void);
 
+/* The retransmission timer */
+#define TCP_RTIMER_STOP(pcb)    ((pcb)->rtime = -1)
+#define TCP_RTIMER_RUNNING(pcb) ((pcb)->rtime >= 0)
+#if LWIP_TCP_TIMERS_MS
+#define TCP_RTIMER_START(pcb)   do { (pcb)->rtime = 0; \
+                                     (pcb)->rtime_start = tcp_ticks; } while(0)
+#define TCP_RTIMER_EXPIRED(pcb) (TCP_RTIMER_RUNNING(pcb) && \
+  (u32_t)(tcp_ticks - (pcb)->rtime_start) >= (u32_t)(pcb)->rto)
+#else /* LWIP_TCP_TIMERS_MS */
+#define TCP_RTIMER_START(pcb)   ((pcb)->rtime = 0)
+#define TCP_RTIMER_EXPIRED(pcb) ((pcb)->rtime >= (pcb)->rto)
+#endif /* LWIP_TCP_TIMERS_MS */
+
+#if LWIP_TCP_TIMERS_MS
+/** tcp_pcb_timeout() and tcp_next_timeout() value if no timer is armed */
+#define TCP_TMR_NONE 0xffffffffUL
+u32_t tcp_pcb_timeout(struct tcp_pcb *pcb);
+u32_t tcp_next_timeout(void);
+/** External function (implemented in timers.c): run tcp_tmr() after at
+ * most 'msecs' milliseconds, nothing for TCP_TMR_NONE */
+void tcp_timer_needed_ms(u32_t msecs);
+/** Schedule the TCP timer for the timers of 'pcb' after arming one */
+#define TCP_TIMER_PCB(pcb) tcp_timer_needed_ms(tcp_pcb_timeout(pcb))
+#else /* LWIP_TCP_TIMERS_MS */
+#define TCP_TIMER_PCB(pcb)
+#endif /* LWIP_TCP_TIMERS_MS */
+
 
 #ifdef __cplusplus
 }
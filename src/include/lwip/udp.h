@@ -95,6 +95,10 @@ struct udp_pcb {
 /* Protocol specific PCB members */
 
   struct udp_pcb *next;
+#if UDP_PCB_HASH
+  /** chains the pcbs of one bucket of the demultiplexing hash tables */
+  struct udp_pcb *hash_next;
+#endif /* UDP_PCB_HASH */
 
   u8_t flags;
   /** ports are in host byte order */
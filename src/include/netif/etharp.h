@@ -43,6 +43,7 @@
 #include "lwip/ip_addr.h"
 #include "lwip/netif.h"
 #include "lwip/ip.h"
+#include "lwip/reclaim.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -183,6 +184,9 @@ struct etharp_q_entry {
 
 #define etharp_init() /* Compatibility define, not init needed. */
 void etharp_tmr(void);
+#if LWIP_RECLAIM
+u8_t etharp_reclaim(reclaim_src_t src, void *arg);
+#endif /* LWIP_RECLAIM */
 s8_t etharp_find_addr(struct netif *netif, ip_addr_t *ipaddr,
          struct eth_addr **eth_ret, ip_addr_t **ip_ret);
 err_t etharp_output(struct netif *netif, struct pbuf *q, ip_addr_t *ipaddr);
@@ -55,6 +55,7 @@
 #include "lwip/dhcp.h"
 #include "lwip/autoip.h"
 #include "netif/etharp.h"
+#include "lwip/perf.h"
 
 #if PPPOE_SUPPORT
 #include "netif/ppp_oe.h"
@@ -199,6 +200,41 @@ free_entry(int i)
 #endif /* LWIP_DEBUG */
 }
 
+#if LWIP_RECLAIM
+/**
+ * Reclaim handler: drops the packets queued on the oldest pending entry
+ * (the entry stays and may still be resolved).
+ */
+u8_t
+etharp_reclaim(reclaim_src_t src, void *arg)
+{
+  s8_t i, oldest;
+
+  LWIP_UNUSED_ARG(arg);
+  if (!RECLAIM_SRC_IS_PBUF(src)
+#if ARP_QUEUEING
+      && (src != MEMP_ARP_QUEUE)
+#endif /* ARP_QUEUEING */
+     ) {
+    return 0;
+  }
+  oldest = ARP_TABLE_SIZE;
+  for (i = 0; i < ARP_TABLE_SIZE; i++) {
+    if ((arp_table[i].q != NULL) &&
+        ((oldest == ARP_TABLE_SIZE) || (arp_table[i].ctime >= arp_table[oldest].ctime))) {
+      oldest = i;
+    }
+  }
+  if (oldest == ARP_TABLE_SIZE) {
+    return 0;
+  }
+  LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_reclaim: freeing packet queue of entry %"U16_F"\n", (u16_t)oldest));
+  free_etharp_q(arp_table[oldest].q);
+  arp_table[oldest].q = NULL;
+  return 1;
+}
+#endif /* LWIP_RECLAIM */
+
 /**
  * Clears expired entries in the ARP table.
  *
@@ -909,6 +945,9 @@ err_t
 etharp_output(struct netif *netif, struct pbuf *q, ip_addr_t *ipaddr)
 {
   struct eth_addr *dest, mcastaddr;
+  err_t err;
+
+  PERF_START;
 
   /* make room for Ethernet header - should not fail */
   if (pbuf_header(q, sizeof(struct eth_hdr)) != 0) {
@@ -977,7 +1016,9 @@ etharp_output(struct netif *netif, struct pbuf *q, ip_addr_t *ipaddr)
             (ip_addr_cmp(ipaddr, &arp_table[etharp_cached_entry].ipaddr))) {
           /* the per-pcb-cached entry is stable and the right one! */
           ETHARP_STATS_INC(etharp.cachehit);
-          return etharp_output_to_arp_index(netif, q, etharp_cached_entry);
+          err = etharp_output_to_arp_index(netif, q, etharp_cached_entry);
+          PERF_STOP("etharp_output");
+          return err;
         }
 #if LWIP_NETIF_HWADDRHINT
       }
@@ -990,17 +1031,23 @@ etharp_output(struct netif *netif, struct pbuf *q, ip_addr_t *ipaddr)
           (ip_addr_cmp(ipaddr, &arp_table[i].ipaddr))) {
         /* found an existing, stable entry */
         ETHARP_SET_HINT(netif, i);
-        return etharp_output_to_arp_index(netif, q, i);
+        err = etharp_output_to_arp_index(netif, q, i);
+        PERF_STOP("etharp_output");
+        return err;
       }
     }
     /* queue on destination Ethernet address belonging to ipaddr */
-    return etharp_query(netif, ipaddr, q);
+    err = etharp_query(netif, ipaddr, q);
+    PERF_STOP("etharp_output");
+    return err;
   }
 
   /* continuation for multicast/broadcast destinations */
   /* obtain source Ethernet address of the given interface */
   /* send packet directly on the link */
-  return etharp_send_ip(netif, q, (struct eth_addr*)(netif->hwaddr), dest);
+  err = etharp_send_ip(netif, q, (struct eth_addr*)(netif->hwaddr), dest);
+  PERF_STOP("etharp_output");
+  return err;
 }
 
 /**
@@ -0,0 +1,1039 @@
+/**
+ * @file
+ * End-to-end benchmarks over the loopback interface.
+ *
+ * Client and server run against the same stack: every segment goes down
+ * through tcp_output()/ip_output(), is copied by netif_loop_output() and
+ * comes back up through ip_input()/tcp_input() when netif_poll() drains the
+ * queue. The stack is built with the host profile (ports/unix/include/lwipopts.h),
+ * so the benchmarks run under the same MEM_SIZE, PBUF_POOL_SIZE and
+ * MEMP_NUM_TCP_PCB limits as the device.
+ *
+ * Each benchmark prints one JSON object per line on stdout, e.g.
+ *   {"bench":"tcp_bulk","value":812.4,"unit":"Mbit/s","count":203100000,...}
+ * so that results can be collected per commit and compared.
+ *
+ * Usage: lwip_bench [-t seconds] [-s rr_size] [-u udp_pcbs] [-l loss%] [-d delay_ms]
+ *                   [-c cc] [-r revision] [benchmark...]
+ *
+ * -u spreads the udp_pps datagrams round-robin over that many bound server
+ * pcbs (ports BENCH_UDP_PORT and up) to measure the demultiplexing cost;
+ * more than 3 need a larger MEMP_NUM_UDP_PCB, e.g.
+ *   make -f Makefile.host lwip_bench CFLAGS_EXTRA=-DMEMP_NUM_UDP_PCB=40
+ *
+ * -l drops that percentage of the looped packets (data and ACKs, picked
+ * by a fixed-seed PRNG) while tcp_bulk measures, to compare loss recovery
+ * with and without LWIP_TCP_SACK. The host profile only keeps two segments
+ * in flight, too few for fast retransmit, so use a larger window, e.g.
+ *   make -f Makefile.host lwip_bench CFLAGS_EXTRA="-DLWIP_TCP_SACK=1 \
+ *     -DTCP_WND=16*TCP_MSS -DTCP_SND_BUF=16*TCP_MSS -DMEM_SIZE=64000 \
+ *     -DMEMP_NUM_TCP_SEG=64 -DPBUF_POOL_SIZE=32"
+ *   ./lwip_bench -t 10 -l 1 tcp_bulk; ./lwip_bench -t 10 -l 5 tcp_bulk
+ * The packets are dropped in a wrapper around ip_input() (the bench is
+ * linked with -Wl,--wrap=ip_input).
+ *
+ * -d holds every looped packet for that many milliseconds while tcp_bulk
+ * measures (the round-trip time is twice that), -c selects the congestion
+ * control of both ends with LWIP_TCP_CC, e.g. to compare the modules over
+ * a lossy long-delay link:
+ *   make -f Makefile.host lwip_bench CFLAGS_EXTRA="-DLWIP_TCP_CC=1 \
+ *     -DTCP_CC_CUBIC=1 -DTCP_CC_LOWMEM=1 -DLWIP_WND_SCALE=1 -DTCP_RCV_SCALE=4 \
+ *     -DTCP_WND=256*TCP_MSS -DTCP_SND_BUF=256*TCP_MSS -DTCP_SND_QUEUELEN=512 \
+ *     -DMEM_SIZE=1000000 -DMEMP_NUM_TCP_SEG=512 -DPBUF_POOL_SIZE=32"
+ *   for cc in newreno cubic lowmem; do ./lwip_bench -t 20 -d 20 -l 0.1 -c $cc tcp_bulk; done
+ * The delayed packets are kept outside of the stack's memory.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#include "lwip/init.h"
+#include "lwip/memp.h"
+#include "lwip/netif.h"
+#include "lwip/ip.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/tcp_cc.h"
+#include "lwip/udp.h"
+#include "lwip/stats.h"
+#include "lwip/timers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if !NO_SYS || !LWIP_HAVE_LOOPIF || !LWIP_TCP || !LWIP_UDP
+#error "lwip_bench needs NO_SYS, LWIP_HAVE_LOOPIF, LWIP_TCP and LWIP_UDP"
+#endif
+
+#define BENCH_TCP_PORT   5001
+#define BENCH_UDP_PORT   5002
+/** UDP payload size for udp_pps (a typical small datagram) */
+#define BENCH_UDP_SIZE   64
+/** Datagrams sent before each netif_poll() in udp_pps */
+#define BENCH_UDP_BURST  4
+/** Elements each thread holds at a time in memp_pool */
+#define BENCH_MEMP_BURST 2
+/** How long to wait for a connection to come up or go away */
+#define BENCH_SETTLE_SECS 2.0
+
+/** Result of one benchmark run */
+struct bench_result {
+  const char *name;
+  double value;
+  const char *unit;
+  /** raw count (bytes, transactions, datagrams, connections) */
+  unsigned long count;
+  /** measured duration */
+  double secs;
+  /** number of failed operations (allocation failures, timeouts...) */
+  unsigned long errors;
+  /** packet loss applied while measuring, in percent */
+  double loss;
+  /** one-way delay applied while measuring, in ms */
+  double delay;
+};
+
+/** A listening server: accepted connections get 'recv' as receive callback */
+struct bench_server {
+  struct tcp_pcb *lpcb;
+  struct tcp_pcb *conn;
+  tcp_recv_fn recv;
+  /** set once the accepted connection has seen FIN and been closed */
+  int closed;
+};
+
+static double bench_duration = 2.0;
+static u16_t bench_rr_size = 1;
+static int bench_udp_pcbs = 1;
+static const char *bench_rev = "";
+/** percentage of looped packets dropped while bench_link_on is set */
+static double bench_loss = 0;
+/** ms each looped packet is held while bench_link_on is set */
+static double bench_delay = 0;
+/** the lossy/delayed link is emulated for the benchmark measuring */
+static int bench_link_on;
+static u32_t bench_loss_rand = 0x2545f491;
+#if LWIP_TCP_CC
+/** congestion control for both ends, NULL for TCP_CC_DEFAULT */
+static const struct tcp_cc_ops *bench_cc;
+#endif /* LWIP_TCP_CC */
+
+/** A looped packet held by the delay emulation */
+struct bench_pkt {
+  struct bench_pkt *next;
+  double due;
+  struct netif *inp;
+  u16_t len;
+  u8_t data[1];
+};
+/** Delayed packets in order of delivery */
+static struct bench_pkt *bench_delayed, *bench_delayed_tail;
+static ip_addr_t bench_addr;
+/* the payload source for all writes */
+static u8_t bench_data[TCP_MSS];
+
+static double
+bench_time(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+err_t __real_ip_input(struct pbuf *p, struct netif *inp);
+
+/** Every looped packet passes here on its way up: drop bench_loss percent
+ * of them and delay the others by bench_delay while a benchmark has
+ * enabled it */
+err_t
+__wrap_ip_input(struct pbuf *p, struct netif *inp)
+{
+  struct bench_pkt *pkt;
+
+  if (!bench_link_on) {
+    return __real_ip_input(p, inp);
+  }
+  if (bench_loss > 0) {
+    /* xorshift32: cheap and the same sequence on every run */
+    bench_loss_rand ^= bench_loss_rand << 13;
+    bench_loss_rand ^= bench_loss_rand >> 17;
+    bench_loss_rand ^= bench_loss_rand << 5;
+    if ((double)bench_loss_rand < bench_loss / 100.0 * 4294967296.0) {
+      pbuf_free(p);
+      return ERR_OK;
+    }
+  }
+  if (bench_delay <= 0) {
+    return __real_ip_input(p, inp);
+  }
+  /* copy it out of the stack: the link, not the stack, holds the data */
+  pkt = (struct bench_pkt *)malloc(sizeof(struct bench_pkt) + p->tot_len);
+  if (pkt != NULL) {
+    pkt->next = NULL;
+    pkt->due = bench_time() + bench_delay / 1000.0;
+    pkt->inp = inp;
+    pkt->len = pbuf_copy_partial(p, pkt->data, p->tot_len, 0);
+    if (bench_delayed_tail != NULL) {
+      bench_delayed_tail->next = pkt;
+    } else {
+      bench_delayed = pkt;
+    }
+    bench_delayed_tail = pkt;
+  }
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+/** Pass the delayed packets that are due up the stack */
+static void
+bench_deliver_delayed(void)
+{
+  struct bench_pkt *pkt;
+  struct pbuf *p;
+  double now;
+
+  if (bench_delayed == NULL) {
+    return;
+  }
+  now = bench_time();
+  while ((pkt = bench_delayed) != NULL && pkt->due <= now) {
+    bench_delayed = pkt->next;
+    if (bench_delayed == NULL) {
+      bench_delayed_tail = NULL;
+    }
+    /* a driver that is out of buffers drops the frame */
+    p = pbuf_alloc(PBUF_LINK, pkt->len, PBUF_RAM);
+    if (p != NULL) {
+      pbuf_take(p, pkt->data, pkt->len);
+      __real_ip_input(p, pkt->inp);
+    }
+    free(pkt);
+  }
+}
+
+/** Let the stack run: deliver looped packets and handle timeouts. */
+static void
+bench_pump(void)
+{
+  netif_poll_all();
+  bench_deliver_delayed();
+  sys_check_timeouts();
+}
+
+/** Pump the stack until *flag becomes nonzero or 'timeout' seconds passed.
+ * @return 1 if the flag was set, 0 on timeout */
+static int
+bench_wait(int *flag, double timeout)
+{
+  double end = bench_time() + timeout;
+  while (!*flag) {
+    if (bench_time() > end) {
+      return 0;
+    }
+    bench_pump();
+  }
+  return 1;
+}
+
+/** Reset the memory high-water mark and error counters so each result
+ * reports its own */
+static void
+bench_stats_reset(void)
+{
+#if MEMP_STATS
+  int i;
+  for (i = 0; i < MEMP_MAX; i++) {
+    lwip_stats.memp[i].err = 0;
+  }
+#endif
+#if MEM_STATS
+  lwip_stats.mem.max = lwip_stats.mem.used;
+  lwip_stats.mem.err = 0;
+#endif
+}
+
+static void
+bench_report(const struct bench_result *res)
+{
+  unsigned long memp_err = 0;
+#if MEMP_STATS
+  int i;
+  for (i = 0; i < MEMP_MAX; i++) {
+    memp_err += lwip_stats.memp[i].err;
+  }
+#endif
+  printf("{\"bench\":\"%s\",\"value\":%.3f,\"unit\":\"%s\",\"count\":%lu,"
+         "\"secs\":%.3f,\"errors\":%lu,\"mem_size\":%u,\"mem_max\":%lu,"
+         "\"mem_err\":%lu,\"memp_err\":%lu,\"tcp_mss\":%u,\"tcp_wnd\":%u,"
+         "\"tcp_sack\":%d,\"cc\":\"%s\",\"loss\":%.1f,\"delay_ms\":%.1f,"
+         "\"rev\":\"%s\"}\n",
+         res->name, res->value, res->unit, res->count, res->secs, res->errors,
+         (unsigned)MEM_SIZE,
+#if MEM_STATS
+         (unsigned long)lwip_stats.mem.max, (unsigned long)lwip_stats.mem.err,
+#else
+         0UL, 0UL,
+#endif
+         memp_err, (unsigned)TCP_MSS, (unsigned)TCP_WND, LWIP_TCP_SACK,
+#if LWIP_TCP_CC
+         (bench_cc != NULL) ? bench_cc->name : (TCP_CC_DEFAULT)->name,
+#else /* LWIP_TCP_CC */
+         "reno",
+#endif /* LWIP_TCP_CC */
+         res->loss, res->delay, bench_rev);
+  fflush(stdout);
+}
+
+/* ------------------------------------------------------------------ */
+/* server side, shared by the TCP benchmarks                            */
+/* ------------------------------------------------------------------ */
+
+static void
+bench_server_err(void *arg, err_t err)
+{
+  struct bench_server *srv = (struct bench_server *)arg;
+  LWIP_UNUSED_ARG(err);
+  /* pcb is already freed */
+  srv->conn = NULL;
+  srv->closed = 1;
+}
+
+static err_t
+bench_server_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  struct bench_server *srv = (struct bench_server *)arg;
+  LWIP_UNUSED_ARG(err);
+
+  tcp_accepted(srv->lpcb);
+  srv->conn = newpcb;
+  srv->closed = 0;
+  tcp_arg(newpcb, srv);
+  tcp_recv(newpcb, srv->recv);
+  tcp_err(newpcb, bench_server_err);
+  tcp_nagle_disable(newpcb);
+  return ERR_OK;
+}
+
+/** Handle the end of a connection in a server receive callback */
+static err_t
+bench_server_fin(struct bench_server *srv, struct tcp_pcb *pcb)
+{
+  srv->conn = NULL;
+  srv->closed = 1;
+  tcp_arg(pcb, NULL);
+  tcp_recv(pcb, NULL);
+  tcp_err(pcb, NULL);
+  if (tcp_close(pcb) != ERR_OK) {
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  return ERR_OK;
+}
+
+static int
+bench_server_start(struct bench_server *srv, tcp_recv_fn recv)
+{
+  struct tcp_pcb *pcb;
+
+  memset(srv, 0, sizeof(*srv));
+  srv->recv = recv;
+  pcb = tcp_new();
+  if (pcb == NULL) {
+    return -1;
+  }
+  if (tcp_bind(pcb, &bench_addr, BENCH_TCP_PORT) != ERR_OK) {
+    tcp_close(pcb);
+    return -1;
+  }
+#if LWIP_TCP_CC
+  if (bench_cc != NULL) {
+    tcp_set_cc(pcb, bench_cc);
+  }
+#endif /* LWIP_TCP_CC */
+  srv->lpcb = tcp_listen(pcb);
+  if (srv->lpcb == NULL) {
+    tcp_close(pcb);
+    return -1;
+  }
+  tcp_arg(srv->lpcb, srv);
+  tcp_accept(srv->lpcb, bench_server_accept);
+  return 0;
+}
+
+static void
+bench_server_stop(struct bench_server *srv)
+{
+  if (srv->conn != NULL) {
+    tcp_arg(srv->conn, NULL);
+    tcp_err(srv->conn, NULL);
+    tcp_abort(srv->conn);
+    srv->conn = NULL;
+  }
+  if (srv->lpcb != NULL) {
+    tcp_close(srv->lpcb);
+    srv->lpcb = NULL;
+  }
+}
+
+/* ------------------------------------------------------------------ */
+/* client side, shared by the TCP benchmarks                            */
+/* ------------------------------------------------------------------ */
+
+struct bench_client {
+  struct tcp_pcb *pcb;
+  int connected;
+  int failed;
+  /** time after which no more data is sent */
+  double deadline;
+  /** bytes received by the server (bulk) or payload bytes of the current
+   * response (rr) */
+  unsigned long rx;
+  unsigned long transactions;
+};
+
+static struct bench_client bench_cl;
+
+static void
+bench_client_err(void *arg, err_t err)
+{
+  struct bench_client *cl = (struct bench_client *)arg;
+  LWIP_UNUSED_ARG(err);
+  cl->pcb = NULL;
+  cl->failed = 1;
+}
+
+static err_t
+bench_client_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  struct bench_client *cl = (struct bench_client *)arg;
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(err);
+  cl->connected = 1;
+  return ERR_OK;
+}
+
+/** Open a client connection to the benchmark server and wait until it is
+ * established.
+ * @return 0 on success, -1 on failure */
+static int
+bench_client_open(struct bench_client *cl, struct bench_server *srv)
+{
+  memset(cl, 0, sizeof(*cl));
+  cl->pcb = tcp_new();
+  if (cl->pcb == NULL) {
+    return -1;
+  }
+  tcp_arg(cl->pcb, cl);
+  tcp_err(cl->pcb, bench_client_err);
+  tcp_nagle_disable(cl->pcb);
+#if LWIP_TCP_CC
+  if (bench_cc != NULL) {
+    tcp_set_cc(cl->pcb, bench_cc);
+  }
+#endif /* LWIP_TCP_CC */
+  if (tcp_connect(cl->pcb, &bench_addr, BENCH_TCP_PORT, bench_client_connected) != ERR_OK) {
+    tcp_abort(cl->pcb);
+    cl->pcb = NULL;
+    return -1;
+  }
+  if (!bench_wait(&cl->connected, BENCH_SETTLE_SECS) || (srv->conn == NULL)) {
+    return -1;
+  }
+  return 0;
+}
+
+static void
+bench_client_close(struct bench_client *cl, struct bench_server *srv)
+{
+  if (cl->pcb != NULL) {
+    tcp_sent(cl->pcb, NULL);
+    tcp_recv(cl->pcb, NULL);
+    tcp_err(cl->pcb, NULL);
+    if (tcp_close(cl->pcb) != ERR_OK) {
+      tcp_abort(cl->pcb);
+    }
+    cl->pcb = NULL;
+  }
+  bench_wait(&srv->closed, BENCH_SETTLE_SECS);
+}
+
+/* ------------------------------------------------------------------ */
+/* tcp_bulk: one-way throughput                                         */
+/* ------------------------------------------------------------------ */
+
+static err_t
+bulk_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  struct bench_server *srv = (struct bench_server *)arg;
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    return bench_server_fin(srv, pcb);
+  }
+  bench_cl.rx += p->tot_len;
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+/** Fill the send buffer until it is full or the deadline has passed */
+static void
+bulk_fill(struct tcp_pcb *pcb)
+{
+  u16_t len;
+
+  if (bench_time() >= bench_cl.deadline) {
+    return;
+  }
+  while ((len = LWIP_MIN(tcp_sndbuf(pcb), sizeof(bench_data))) > 0 &&
+         tcp_sndqueuelen(pcb) < TCP_SND_QUEUELEN) {
+    if (tcp_write(pcb, bench_data, len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+      break;
+    }
+  }
+  tcp_output(pcb);
+}
+
+static err_t
+bulk_client_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(len);
+  bulk_fill(pcb);
+  return ERR_OK;
+}
+
+static int
+bench_tcp_bulk(struct bench_result *res)
+{
+  struct bench_server srv;
+  double start;
+
+  res->unit = "Mbit/s";
+  if (bench_server_start(&srv, bulk_server_recv) != 0) {
+    return -1;
+  }
+  if (bench_client_open(&bench_cl, &srv) != 0) {
+    bench_server_stop(&srv);
+    return -1;
+  }
+  bench_stats_reset();
+  start = bench_time();
+  bench_cl.deadline = start + bench_duration;
+  tcp_sent(bench_cl.pcb, bulk_client_sent);
+  res->loss = bench_loss;
+  res->delay = bench_delay;
+  bench_link_on = (bench_loss > 0) || (bench_delay > 0);
+  bulk_fill(bench_cl.pcb);
+  while (bench_time() < bench_cl.deadline && !bench_cl.failed) {
+    bench_pump();
+  }
+  bench_link_on = 0;
+  res->secs = bench_time() - start;
+  res->count = bench_cl.rx;
+  res->value = (double)res->count * 8.0 / res->secs / 1e6;
+  res->errors = bench_cl.failed;
+
+  bench_client_close(&bench_cl, &srv);
+  bench_server_stop(&srv);
+  return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* tcp_rr: request/response transactions on one connection             */
+/* ------------------------------------------------------------------ */
+
+static err_t
+rr_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  struct bench_server *srv = (struct bench_server *)arg;
+  u16_t len;
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    return bench_server_fin(srv, pcb);
+  }
+  /* echo: the response has the same size as the request */
+  len = p->tot_len;
+  tcp_recved(pcb, len);
+  pbuf_free(p);
+  if (tcp_write(pcb, bench_data, len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+    return ERR_OK;
+  }
+  tcp_output(pcb);
+  return ERR_OK;
+}
+
+static void
+rr_send_request(struct tcp_pcb *pcb)
+{
+  bench_cl.rx = 0;
+  if (tcp_write(pcb, bench_data, bench_rr_size, TCP_WRITE_FLAG_COPY) == ERR_OK) {
+    tcp_output(pcb);
+  } else {
+    bench_cl.failed = 1;
+  }
+}
+
+static err_t
+rr_client_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    bench_cl.failed = 1;
+    return ERR_OK;
+  }
+  bench_cl.rx += p->tot_len;
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  if (bench_cl.rx >= bench_rr_size) {
+    bench_cl.transactions++;
+    if (bench_time() < bench_cl.deadline) {
+      rr_send_request(pcb);
+    }
+  }
+  return ERR_OK;
+}
+
+static int
+bench_tcp_rr(struct bench_result *res)
+{
+  struct bench_server srv;
+  double start;
+
+  res->unit = "trans/s";
+  if (bench_server_start(&srv, rr_server_recv) != 0) {
+    return -1;
+  }
+  if (bench_client_open(&bench_cl, &srv) != 0) {
+    bench_server_stop(&srv);
+    return -1;
+  }
+  bench_stats_reset();
+  tcp_recv(bench_cl.pcb, rr_client_recv);
+  start = bench_time();
+  bench_cl.deadline = start + bench_duration;
+  rr_send_request(bench_cl.pcb);
+  while (bench_time() < bench_cl.deadline && !bench_cl.failed) {
+    bench_pump();
+  }
+  res->secs = bench_time() - start;
+  res->count = bench_cl.transactions;
+  res->value = (double)res->count / res->secs;
+  res->errors = bench_cl.failed;
+
+  bench_client_close(&bench_cl, &srv);
+  bench_server_stop(&srv);
+  return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* tcp_conn: connection setup and teardown rate                         */
+/* ------------------------------------------------------------------ */
+
+static err_t
+conn_server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  struct bench_server *srv = (struct bench_server *)arg;
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    return bench_server_fin(srv, pcb);
+  }
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t
+conn_client_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  struct bench_client *cl = (struct bench_client *)arg;
+  LWIP_UNUSED_ARG(err);
+  cl->connected = 1;
+  cl->transactions++;
+  /* active close: the client side ends up in TIME_WAIT, as it would on a
+     device making short-lived connections */
+  tcp_arg(pcb, NULL);
+  tcp_err(pcb, NULL);
+  cl->pcb = NULL;
+  if (tcp_close(pcb) != ERR_OK) {
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  return ERR_OK;
+}
+
+static int
+bench_tcp_conn(struct bench_result *res)
+{
+  struct bench_server srv;
+  double start;
+  unsigned long errors = 0;
+
+  res->unit = "conn/s";
+  if (bench_server_start(&srv, conn_server_recv) != 0) {
+    return -1;
+  }
+  memset(&bench_cl, 0, sizeof(bench_cl));
+  bench_stats_reset();
+  start = bench_time();
+  while (bench_time() < start + bench_duration) {
+    struct tcp_pcb *pcb = tcp_new();
+    if (pcb == NULL) {
+      errors++;
+      bench_pump();
+      continue;
+    }
+    bench_cl.pcb = pcb;
+    bench_cl.connected = 0;
+    bench_cl.failed = 0;
+    srv.closed = 0;
+    tcp_arg(pcb, &bench_cl);
+    tcp_err(pcb, bench_client_err);
+    if (tcp_connect(pcb, &bench_addr, BENCH_TCP_PORT, conn_client_connected) != ERR_OK) {
+      tcp_abort(pcb);
+      errors++;
+      continue;
+    }
+    /* one cycle is complete when the server has seen the FIN */
+    while (!srv.closed && !bench_cl.failed) {
+      if (bench_time() > start + bench_duration + BENCH_SETTLE_SECS) {
+        break;
+      }
+      bench_pump();
+    }
+    if (bench_cl.failed || !srv.closed) {
+      errors++;
+      if (bench_cl.pcb != NULL) {
+        tcp_arg(bench_cl.pcb, NULL);
+        tcp_err(bench_cl.pcb, NULL);
+        tcp_abort(bench_cl.pcb);
+        bench_cl.pcb = NULL;
+      }
+    }
+  }
+  res->secs = bench_time() - start;
+  res->count = bench_cl.transactions;
+  res->value = (double)res->count / res->secs;
+  res->errors = errors;
+
+  bench_server_stop(&srv);
+  return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* udp_pps: small datagrams, one way                                    */
+/* ------------------------------------------------------------------ */
+
+static unsigned long udp_rx;
+
+static void
+udp_server_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  udp_rx++;
+  pbuf_free(p);
+}
+
+static int
+bench_udp_pps(struct bench_result *res)
+{
+  struct udp_pcb **servers, *client;
+  struct pbuf *p;
+  unsigned long errors = 0;
+  double start, end;
+  int i, n, next = 0;
+  int ret = -1;
+
+  res->unit = "pkt/s";
+  servers = (struct udp_pcb **)calloc(bench_udp_pcbs, sizeof(struct udp_pcb *));
+  client = udp_new();
+  if (servers == NULL || client == NULL) {
+    goto out;
+  }
+  for (n = 0; n < bench_udp_pcbs; n++) {
+    servers[n] = udp_new();
+    if (servers[n] == NULL ||
+        udp_bind(servers[n], &bench_addr, (u16_t)(BENCH_UDP_PORT + n)) != ERR_OK) {
+      goto out;
+    }
+    udp_recv(servers[n], udp_server_recv, NULL);
+  }
+  udp_rx = 0;
+
+  bench_stats_reset();
+  start = bench_time();
+  end = start + bench_duration;
+  while (bench_time() < end) {
+    for (i = 0; i < BENCH_UDP_BURST; i++) {
+      p = pbuf_alloc(PBUF_TRANSPORT, BENCH_UDP_SIZE, PBUF_RAM);
+      if (p == NULL) {
+        errors++;
+        break;
+      }
+      memcpy(p->payload, bench_data, BENCH_UDP_SIZE);
+      if (udp_sendto(client, p, &bench_addr, (u16_t)(BENCH_UDP_PORT + next)) != ERR_OK) {
+        errors++;
+      }
+      pbuf_free(p);
+      if (++next == bench_udp_pcbs) {
+        next = 0;
+      }
+    }
+    bench_pump();
+  }
+  res->secs = bench_time() - start;
+  res->count = udp_rx;
+  res->value = (double)res->count / res->secs;
+  res->errors = errors;
+  ret = 0;
+
+out:
+  if (client != NULL) {
+    udp_remove(client);
+  }
+  if (servers != NULL) {
+    for (n = 0; n < bench_udp_pcbs; n++) {
+      if (servers[n] != NULL) {
+        udp_remove(servers[n]);
+      }
+    }
+    free(servers);
+  }
+  return ret;
+}
+
+/* ------------------------------------------------------------------ */
+/* memp_pool: PBUF_POOL allocations from the stack and a "driver" thread */
+/* ------------------------------------------------------------------ */
+
+static volatile int memp_bench_stop;
+
+/** One allocating context: take BENCH_MEMP_BURST pool elements and give
+ * them back until memp_bench_stop is set. With 'end' != 0, this context
+ * sets memp_bench_stop once bench_time() passes 'end'.
+ * @return number of memp_malloc()/memp_free() pairs */
+static unsigned long
+memp_bench_loop(double end, unsigned long *errors)
+{
+  void *mem[BENCH_MEMP_BURST];
+  unsigned long n = 0;
+  int i;
+
+  while (!memp_bench_stop) {
+    for (i = 0; i < BENCH_MEMP_BURST; i++) {
+      mem[i] = memp_malloc(MEMP_PBUF_POOL);
+      if (mem[i] == NULL) {
+        (*errors)++;
+      }
+    }
+    for (i = 0; i < BENCH_MEMP_BURST; i++) {
+      if (mem[i] != NULL) {
+        memp_free(MEMP_PBUF_POOL, mem[i]);
+        n++;
+      }
+    }
+    if ((end != 0) && ((n & 0xfff) == 0) && (bench_time() > end)) {
+      memp_bench_stop = 1;
+    }
+  }
+  return n;
+}
+
+struct memp_bench_driver {
+  unsigned long count;
+  unsigned long errors;
+};
+
+static void *
+memp_bench_driver_thread(void *arg)
+{
+  struct memp_bench_driver *drv = (struct memp_bench_driver *)arg;
+  drv->count = memp_bench_loop(0, &drv->errors);
+  return NULL;
+}
+
+/** memp_malloc()/memp_free() throughput with a second thread standing in
+ * for a driver allocating receive buffers from interrupt context. Compare
+ * builds with and without MEMP_LOCKFREE. */
+static int
+bench_memp_pool(struct bench_result *res)
+{
+  struct memp_bench_driver drv;
+  pthread_t thread;
+  unsigned long count, errors = 0;
+  double start;
+
+  res->unit = "Mops/s";
+  memset(&drv, 0, sizeof(drv));
+  memp_bench_stop = 0;
+
+  bench_stats_reset();
+  start = bench_time();
+  if (pthread_create(&thread, NULL, memp_bench_driver_thread, &drv) != 0) {
+    return -1;
+  }
+  count = memp_bench_loop(start + bench_duration, &errors);
+  pthread_join(thread, NULL);
+  res->secs = bench_time() - start;
+  res->count = count + drv.count;
+  res->value = (double)res->count / res->secs / 1e6;
+  res->errors = errors + drv.errors;
+  return 0;
+}
+
+/* ------------------------------------------------------------------ */
+
+struct bench_desc {
+  const char *name;
+  int (*fn)(struct bench_result *res);
+};
+
+static const struct bench_desc benches[] = {
+  { "tcp_bulk", bench_tcp_bulk },
+  { "tcp_rr",   bench_tcp_rr },
+  { "tcp_conn", bench_tcp_conn },
+  { "udp_pps",  bench_udp_pps },
+  { "memp_pool", bench_memp_pool },
+};
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+static int
+bench_run(const struct bench_desc *b)
+{
+  struct bench_result res;
+
+  memset(&res, 0, sizeof(res));
+  res.name = b->name;
+  if (b->fn(&res) != 0) {
+    fprintf(stderr, "lwip_bench: %s: setup failed\n", b->name);
+    return -1;
+  }
+  bench_report(&res);
+  return 0;
+}
+
+static void
+usage(const char *prog)
+{
+  size_t i;
+  fprintf(stderr, "usage: %s [-t seconds] [-s rr_size] [-u udp_pcbs] [-l loss%%] [-d delay_ms]\n"
+          "       [-c cc] [-r revision] [benchmark...]\n", prog);
+  fprintf(stderr, "benchmarks:");
+  for (i = 0; i < NUM_BENCHES; i++) {
+    fprintf(stderr, " %s", benches[i].name);
+  }
+  fprintf(stderr, "\n");
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt, ret = EXIT_SUCCESS;
+  size_t i;
+
+  while ((opt = getopt(argc, argv, "t:s:u:l:d:c:r:h")) != -1) {
+    switch (opt) {
+    case 't':
+      bench_duration = atof(optarg);
+      break;
+    case 's':
+      bench_rr_size = (u16_t)atoi(optarg);
+      break;
+    case 'u':
+      bench_udp_pcbs = atoi(optarg);
+      break;
+    case 'l':
+      bench_loss = atof(optarg);
+      break;
+    case 'd':
+      bench_delay = atof(optarg);
+      break;
+    case 'c':
+#if LWIP_TCP_CC
+      bench_cc = tcp_cc_find(optarg);
+      if (bench_cc == NULL) {
+        fprintf(stderr, "lwip_bench: congestion control %s is not compiled in\n", optarg);
+        return EXIT_FAILURE;
+      }
+#else /* LWIP_TCP_CC */
+      fprintf(stderr, "lwip_bench: -c needs LWIP_TCP_CC\n");
+      return EXIT_FAILURE;
+#endif /* LWIP_TCP_CC */
+      break;
+    case 'r':
+      bench_rev = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (bench_duration <= 0 || bench_rr_size == 0 || bench_rr_size > sizeof(bench_data) ||
+      bench_udp_pcbs <= 0 || bench_loss < 0 || bench_loss >= 100 ||
+      bench_delay < 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < sizeof(bench_data); i++) {
+    bench_data[i] = (u8_t)i;
+  }
+  lwip_init();
+  IP4_ADDR(&bench_addr, 127,0,0,1);
+
+  if (optind == argc) {
+    for (i = 0; i < NUM_BENCHES; i++) {
+      if (bench_run(&benches[i]) != 0) {
+        ret = EXIT_FAILURE;
+      }
+    }
+  }
+  for (; optind < argc; optind++) {
+    for (i = 0; i < NUM_BENCHES; i++) {
+      if (strcmp(argv[optind], benches[i].name) == 0) {
+        break;
+      }
+    }
+    if (i == NUM_BENCHES) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (bench_run(&benches[i]) != 0) {
+      ret = EXIT_FAILURE;
+    }
+  }
+  return ret;
+}
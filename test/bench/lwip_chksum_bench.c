@@ -0,0 +1,236 @@
+/**
+ * @file
+ * Microbenchmark of the checksum kernels (LWIP_CHKSUM_SELECT).
+ *
+ * Every kernel in lwip_chksum_kernels[] the CPU supports is timed over
+ * a set of buffer sizes (IP header, small segments, full-sized segments,
+ * the largest IP packet) at byte offsets 0..3 from an aligned buffer.
+ * One JSON object per kernel, size and offset is printed on stdout, e.g.
+ *   {"bench":"chksum","kernel":"sse2","size":1460,"align":1,"value":12.3,"unit":"GB/s",...}
+ * The kernel lwip_init() would select is marked with "selected":1.
+ *
+ * Usage: lwip_chksum_bench [-t seconds] [-r revision] [kernel...]
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#include "lwip/inet_chksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if !LWIP_CHKSUM_SELECT
+#error "lwip_chksum_bench needs LWIP_CHKSUM_SELECT"
+#endif
+
+/** Checksums computed between two clock reads */
+#define CHKSUM_BENCH_BATCH 64
+
+static double bench_duration = 0.1;
+static const char *bench_rev = "";
+static const int bench_sizes[] = { 20, 40, 64, 128, 536, 1460, 4096, 65535 };
+/* the buffer is aligned for every kernel, offsets are added to it */
+static unsigned long long bench_buf[(65535 + 3) / sizeof(unsigned long long) + 1];
+#if LWIP_CHECKSUM_ON_COPY
+static unsigned long long bench_dst[(65535 + 3) / sizeof(unsigned long long) + 1];
+#endif /* LWIP_CHECKSUM_ON_COPY */
+
+static double
+bench_time(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/** Time one kernel on one size and offset, print the result */
+static void
+bench_kernel(const struct lwip_chksum_kernel *k, int selected, int size, int align)
+{
+  u8_t *data = (u8_t *)bench_buf + align;
+  volatile u16_t sink = 0;
+  unsigned long n = 0;
+  double start, end, secs;
+  int i;
+
+  start = bench_time();
+  end = start + bench_duration;
+  do {
+    for (i = 0; i < CHKSUM_BENCH_BATCH; i++) {
+      sink += k->fn(data, size);
+    }
+    n += CHKSUM_BENCH_BATCH;
+  } while (bench_time() < end);
+  secs = bench_time() - start;
+
+  printf("{\"bench\":\"chksum\",\"kernel\":\"%s\",\"selected\":%d,\"size\":%d,"
+         "\"align\":%d,\"value\":%.3f,\"unit\":\"GB/s\",\"ns_per_call\":%.1f,"
+         "\"count\":%lu,\"secs\":%.3f,\"rev\":\"%s\"}\n",
+         k->name, selected, size, align, (double)n * size / secs / 1e9,
+         secs * 1e9 / n, n, secs, bench_rev);
+  fflush(stdout);
+}
+
+#if LWIP_CHECKSUM_ON_COPY
+/** Copy routines: MEMCPY as the baseline and LWIP_CHKSUM_COPY */
+static u16_t
+bench_memcpy(void *dst, const void *src, u16_t len)
+{
+  MEMCPY(dst, src, len);
+  return 0;
+}
+
+static u16_t
+bench_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  return LWIP_CHKSUM_COPY(dst, src, len);
+}
+
+/** Time one copy routine on one size and source offset, print the result */
+static void
+bench_copy(const char *name, u16_t (*fn)(void *, const void *, u16_t), int size, int align)
+{
+  const u8_t *src = (const u8_t *)bench_buf + align;
+  volatile u16_t sink = 0;
+  unsigned long n = 0;
+  double start, end, secs;
+  int i;
+
+  start = bench_time();
+  end = start + bench_duration;
+  do {
+    for (i = 0; i < CHKSUM_BENCH_BATCH; i++) {
+      sink += fn(bench_dst, src, (u16_t)size);
+    }
+    n += CHKSUM_BENCH_BATCH;
+  } while (bench_time() < end);
+  secs = bench_time() - start;
+
+  printf("{\"bench\":\"chksum_copy\",\"kernel\":\"%s\",\"algorithm\":%d,\"size\":%d,"
+         "\"align\":%d,\"value\":%.3f,\"unit\":\"GB/s\",\"ns_per_call\":%.1f,"
+         "\"count\":%lu,\"secs\":%.3f,\"rev\":\"%s\"}\n",
+         name, LWIP_CHKSUM_COPY_ALGORITHM, size, align, (double)n * size / secs / 1e9,
+         secs * 1e9 / n, n, secs, bench_rev);
+  fflush(stdout);
+}
+#endif /* LWIP_CHECKSUM_ON_COPY */
+
+static void
+usage(const char *prog)
+{
+  const struct lwip_chksum_kernel *k;
+  fprintf(stderr, "usage: %s [-t seconds] [-r revision] [-c] [kernel...]\n", prog);
+  fprintf(stderr, "  -c  also time LWIP_CHKSUM_COPY against MEMCPY\n");
+  fprintf(stderr, "kernels:");
+  for (k = lwip_chksum_kernels; k->name != NULL; k++) {
+    fprintf(stderr, " %s", k->name);
+  }
+  fprintf(stderr, "\n");
+}
+
+/** @return nonzero if k is to be run with the kernel names on the command line */
+static int
+bench_wanted(const struct lwip_chksum_kernel *k, int argc, char **argv)
+{
+  int i;
+
+  if (optind == argc) {
+    return 1;
+  }
+  for (i = optind; i < argc; i++) {
+    if (strcmp(argv[i], k->name) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  const struct lwip_chksum_kernel *k;
+  const char *selected;
+  int opt, align, copy = 0;
+  size_t i;
+
+  while ((opt = getopt(argc, argv, "t:r:ch")) != -1) {
+    switch (opt) {
+    case 'c':
+      copy = 1;
+      break;
+    case 't':
+      bench_duration = atof(optarg);
+      break;
+    case 'r':
+      bench_rev = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (bench_duration <= 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < sizeof(bench_buf); i++) {
+    ((u8_t *)bench_buf)[i] = (u8_t)(i * 7);
+  }
+  inet_chksum_init();
+  selected = inet_chksum_selected();
+
+  for (k = lwip_chksum_kernels; k->name != NULL; k++) {
+    if (((k->supported != NULL) && !k->supported()) || !bench_wanted(k, argc, argv)) {
+      continue;
+    }
+    for (i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+      for (align = 0; align < 4; align++) {
+        bench_kernel(k, strcmp(k->name, selected) == 0, bench_sizes[i], align);
+      }
+    }
+  }
+  if (copy) {
+#if LWIP_CHECKSUM_ON_COPY
+    for (i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+      for (align = 0; align < 4; align++) {
+        bench_copy("memcpy", bench_memcpy, bench_sizes[i], align);
+        bench_copy("chksum_copy", bench_chksum_copy, bench_sizes[i], align);
+      }
+    }
+#else /* LWIP_CHECKSUM_ON_COPY */
+    fprintf(stderr, "-c: built without LWIP_CHECKSUM_ON_COPY\n");
+#endif /* LWIP_CHECKSUM_ON_COPY */
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,481 @@
+/**
+ * @file
+ * Deterministic capture replay benchmark for the receive path.
+ *
+ * Frames from a pcap file are fed into ethernet_input() through pcapif,
+ * with sys_now() following the capture's timestamps so that timers (ARP
+ * aging, reassembly timeouts, TCP retransmissions, DHCP) fire exactly as
+ * often as they would have on the device, independent of how fast the
+ * host replays the traffic. Random numbers are seeded with a fixed value,
+ * so two runs over the same capture execute the same code paths.
+ *
+ * The time spent in each layer of the input path is measured by wrapping
+ * the layer entry points at link time (-Wl,--wrap=ip_input etc., see
+ * Makefile.host), so the core needs no instrumentation. Times are
+ * exclusive: the cost reported for ip_input does not include the
+ * tcp_input() it calls. Output of the stack (ARP replies, ACKs, RSTs...)
+ * is accounted to the layer that generated it.
+ *
+ * One JSON object per layer is printed on stdout, e.g.
+ *   {"bench":"replay","layer":"tcp_input","calls":1200,"per_call":812.5,...}
+ *
+ * Only the receive direction is replayed: TCP segments of connections the
+ * stack doesn't know (e.g. a download recorded with another device) take
+ * the demux/RST path. Use -l to accept connections opened by the capture.
+ *
+ * Usage: lwip_replay [options] capture.pcap (see usage())
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/dhcp.h"
+#include "lwip/timers.h"
+#include "netif/etharp.h"
+#include "netif/pcapif.h"
+#include "arch/sys_arch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if !NO_SYS
+#error "lwip_replay needs NO_SYS"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define REPLAY_UNIT "cycles"
+static u64_t
+replay_clock(void)
+{
+  return __rdtsc();
+}
+#else
+#define REPLAY_UNIT "ns"
+static u64_t
+replay_clock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000ULL + (u64_t)ts.tv_nsec;
+}
+#endif
+
+/** Layers of the input path, in the order they are reported */
+enum replay_layer {
+  LAYER_ETHERNET,
+  LAYER_IP,
+  LAYER_IP_REASS,
+  LAYER_ICMP,
+  LAYER_IGMP,
+  LAYER_UDP,
+  LAYER_TCP,
+  LAYER_TIMERS,
+  LAYER_MAX
+};
+
+static const char *const replay_layer_names[LAYER_MAX] = {
+  "ethernet_input",
+  "ip_input",
+  "ip_reass",
+  "icmp_input",
+  "igmp_input",
+  "udp_input",
+  "tcp_input",
+  "sys_check_timeouts",
+};
+
+struct replay_stat {
+  unsigned long calls;
+  /** exclusive time spent in the layer */
+  u64_t time;
+};
+
+static struct replay_stat replay_stats[LAYER_MAX];
+
+/** Nesting of wrapped calls; each level collects the inclusive time of the
+ * calls made from it, which is subtracted from its own time. */
+#define REPLAY_MAX_DEPTH 16
+static u64_t replay_child_time[REPLAY_MAX_DEPTH];
+static int replay_depth;
+
+static u64_t
+replay_enter(void)
+{
+  LWIP_ASSERT("replay nesting too deep", replay_depth < REPLAY_MAX_DEPTH - 1);
+  replay_child_time[++replay_depth] = 0;
+  return replay_clock();
+}
+
+static void
+replay_leave(enum replay_layer layer, u64_t start)
+{
+  u64_t incl = replay_clock() - start;
+
+  replay_stats[layer].calls++;
+  replay_stats[layer].time += incl - replay_child_time[replay_depth];
+  replay_depth--;
+  replay_child_time[replay_depth] += incl;
+}
+
+/* Link-time wrappers (-Wl,--wrap=<function>) around the layer entry points */
+
+err_t __real_ethernet_input(struct pbuf *p, struct netif *netif);
+err_t __wrap_ethernet_input(struct pbuf *p, struct netif *netif);
+err_t __real_ip_input(struct pbuf *p, struct netif *inp);
+err_t __wrap_ip_input(struct pbuf *p, struct netif *inp);
+struct pbuf *__real_ip_reass(struct pbuf *p);
+struct pbuf *__wrap_ip_reass(struct pbuf *p);
+void __real_icmp_input(struct pbuf *p, struct netif *inp);
+void __wrap_icmp_input(struct pbuf *p, struct netif *inp);
+void __real_igmp_input(struct pbuf *p, struct netif *inp, ip_addr_t *dest);
+void __wrap_igmp_input(struct pbuf *p, struct netif *inp, ip_addr_t *dest);
+void __real_udp_input(struct pbuf *p, struct netif *inp);
+void __wrap_udp_input(struct pbuf *p, struct netif *inp);
+void __real_tcp_input(struct pbuf *p, struct netif *inp);
+void __wrap_tcp_input(struct pbuf *p, struct netif *inp);
+void __real_sys_check_timeouts(void);
+void __wrap_sys_check_timeouts(void);
+
+err_t
+__wrap_ethernet_input(struct pbuf *p, struct netif *netif)
+{
+  u64_t start = replay_enter();
+  err_t err = __real_ethernet_input(p, netif);
+  replay_leave(LAYER_ETHERNET, start);
+  return err;
+}
+
+err_t
+__wrap_ip_input(struct pbuf *p, struct netif *inp)
+{
+  u64_t start = replay_enter();
+  err_t err = __real_ip_input(p, inp);
+  replay_leave(LAYER_IP, start);
+  return err;
+}
+
+struct pbuf *
+__wrap_ip_reass(struct pbuf *p)
+{
+  u64_t start = replay_enter();
+  struct pbuf *r = __real_ip_reass(p);
+  replay_leave(LAYER_IP_REASS, start);
+  return r;
+}
+
+void
+__wrap_icmp_input(struct pbuf *p, struct netif *inp)
+{
+  u64_t start = replay_enter();
+  __real_icmp_input(p, inp);
+  replay_leave(LAYER_ICMP, start);
+}
+
+void
+__wrap_igmp_input(struct pbuf *p, struct netif *inp, ip_addr_t *dest)
+{
+  u64_t start = replay_enter();
+  __real_igmp_input(p, inp, dest);
+  replay_leave(LAYER_IGMP, start);
+}
+
+void
+__wrap_udp_input(struct pbuf *p, struct netif *inp)
+{
+  u64_t start = replay_enter();
+  __real_udp_input(p, inp);
+  replay_leave(LAYER_UDP, start);
+}
+
+void
+__wrap_tcp_input(struct pbuf *p, struct netif *inp)
+{
+  u64_t start = replay_enter();
+  __real_tcp_input(p, inp);
+  replay_leave(LAYER_TCP, start);
+}
+
+void
+__wrap_sys_check_timeouts(void)
+{
+  u64_t start = replay_enter();
+  __real_sys_check_timeouts();
+  replay_leave(LAYER_TIMERS, start);
+}
+
+/* Sinks for traffic opened by the capture (-l, -u) */
+
+static err_t
+replay_tcp_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    tcp_recv(pcb, NULL);
+    if (tcp_close(pcb) != ERR_OK) {
+      tcp_abort(pcb);
+      return ERR_ABRT;
+    }
+    return ERR_OK;
+  }
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t
+replay_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  struct tcp_pcb *lpcb = (struct tcp_pcb *)arg;
+  LWIP_UNUSED_ARG(err);
+  tcp_accepted(lpcb);
+  tcp_recv(newpcb, replay_tcp_recv);
+  return ERR_OK;
+}
+
+static void
+replay_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  pbuf_free(p);
+}
+
+static int
+replay_listen(u16_t port)
+{
+  struct tcp_pcb *pcb, *lpcb;
+
+  pcb = tcp_new();
+  if (pcb == NULL || tcp_bind(pcb, IP_ADDR_ANY, port) != ERR_OK) {
+    return -1;
+  }
+  lpcb = tcp_listen(pcb);
+  if (lpcb == NULL) {
+    tcp_close(pcb);
+    return -1;
+  }
+  tcp_arg(lpcb, lpcb);
+  tcp_accept(lpcb, replay_tcp_accept);
+  return 0;
+}
+
+static int
+replay_udp_bind(u16_t port)
+{
+  struct udp_pcb *pcb = udp_new();
+  if (pcb == NULL || udp_bind(pcb, IP_ADDR_ANY, port) != ERR_OK) {
+    return -1;
+  }
+  udp_recv(pcb, replay_udp_recv, NULL);
+  return 0;
+}
+
+static int
+replay_parse_mac(const char *str, u8_t *mac)
+{
+  unsigned int b[ETHARP_HWADDR_LEN];
+  int i;
+
+  if (sscanf(str, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+    return -1;
+  }
+  for (i = 0; i < ETHARP_HWADDR_LEN; i++) {
+    mac[i] = (u8_t)b[i];
+  }
+  return 0;
+}
+
+static void
+replay_report(const char *file, unsigned long frames, const char *rev)
+{
+  u64_t rx_total = 0;
+  int i;
+
+  for (i = 0; i < LAYER_MAX; i++) {
+    const struct replay_stat *st = &replay_stats[i];
+    if (i != LAYER_TIMERS) {
+      rx_total += st->time;
+    }
+    printf("{\"bench\":\"replay\",\"file\":\"%s\",\"layer\":\"%s\",\"calls\":%lu,"
+           "\"total\":%llu,\"per_call\":%.1f,\"per_frame\":%.1f,\"unit\":\"%s\","
+           "\"rev\":\"%s\"}\n",
+           file, replay_layer_names[i], st->calls, (unsigned long long)st->time,
+           st->calls ? (double)st->time / st->calls : 0.0,
+           frames ? (double)st->time / frames : 0.0, REPLAY_UNIT, rev);
+  }
+  printf("{\"bench\":\"replay\",\"file\":\"%s\",\"layer\":\"rx_path\",\"calls\":%lu,"
+         "\"total\":%llu,\"per_call\":%.1f,\"per_frame\":%.1f,\"unit\":\"%s\","
+         "\"rev\":\"%s\"}\n",
+         file, frames, (unsigned long long)rx_total,
+         frames ? (double)rx_total / frames : 0.0,
+         frames ? (double)rx_total / frames : 0.0, REPLAY_UNIT, rev);
+}
+
+static void
+usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [options] capture.pcap\n"
+    "  -a addr     IP address of the interface (default 192.168.1.100)\n"
+    "  -n netmask  netmask (default 255.255.255.0)\n"
+    "  -g gw       gateway (default none)\n"
+    "  -e mac      MAC address of the interface (default: pcapif's)\n"
+    "  -d          start DHCP on the interface\n"
+    "  -l port     accept TCP connections on 'port' (may be repeated)\n"
+    "  -u port     bind a UDP socket to 'port' (may be repeated)\n"
+    "  -w file     write the frames the stack sends to a capture file\n"
+    "  -s seed     seed for the stack's random numbers (default 1)\n"
+    "  -r rev      revision label copied into the results\n", prog);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct netif netif;
+  struct pcapif_files files;
+  ip_addr_t addr, netmask, gw;
+  u8_t mac[ETHARP_HWADDR_LEN];
+  int set_mac = 0, dhcp = 0;
+  u16_t tcp_ports[8], udp_ports[8];
+  int num_tcp = 0, num_udp = 0;
+  unsigned int seed = 1;
+  const char *rev = "";
+  unsigned long frames = 0;
+  int opt, i;
+
+  IP4_ADDR(&addr, 192,168,1,100);
+  IP4_ADDR(&netmask, 255,255,255,0);
+  ip_addr_set_zero(&gw);
+  memset(&files, 0, sizeof(files));
+  files.capture_clock = 1;
+
+  while ((opt = getopt(argc, argv, "a:n:g:e:dl:u:w:s:r:h")) != -1) {
+    switch (opt) {
+    case 'a':
+      addr.addr = ipaddr_addr(optarg);
+      break;
+    case 'n':
+      netmask.addr = ipaddr_addr(optarg);
+      break;
+    case 'g':
+      gw.addr = ipaddr_addr(optarg);
+      break;
+    case 'e':
+      if (replay_parse_mac(optarg, mac) != 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      set_mac = 1;
+      break;
+    case 'd':
+      dhcp = 1;
+      break;
+    case 'l':
+      if (num_tcp < (int)(sizeof(tcp_ports) / sizeof(tcp_ports[0]))) {
+        tcp_ports[num_tcp++] = (u16_t)atoi(optarg);
+      }
+      break;
+    case 'u':
+      if (num_udp < (int)(sizeof(udp_ports) / sizeof(udp_ports[0]))) {
+        udp_ports[num_udp++] = (u16_t)atoi(optarg);
+      }
+      break;
+    case 'w':
+      files.tx_file = optarg;
+      break;
+    case 's':
+      seed = (unsigned int)strtoul(optarg, NULL, 0);
+      break;
+    case 'r':
+      rev = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  files.rx_file = argv[optind];
+
+  /* deterministic: virtual time starts at 0 with the first frame and the
+     same random sequence is used on every run */
+  srandom(seed);
+  sys_now_set(0);
+  lwip_init();
+
+  if (netif_add(&netif, dhcp ? IP_ADDR_ANY : &addr, dhcp ? IP_ADDR_ANY : &netmask,
+                dhcp ? IP_ADDR_ANY : &gw, &files, pcapif_init, ethernet_input) == NULL) {
+    fprintf(stderr, "lwip_replay: cannot open %s\n", files.rx_file);
+    return EXIT_FAILURE;
+  }
+  if (set_mac) {
+    memcpy(netif.hwaddr, mac, ETHARP_HWADDR_LEN);
+  }
+  netif_set_default(&netif);
+  netif_set_up(&netif);
+#if LWIP_DHCP
+  if (dhcp) {
+    dhcp_start(&netif);
+  }
+#endif /* LWIP_DHCP */
+  for (i = 0; i < num_tcp; i++) {
+    if (replay_listen(tcp_ports[i]) != 0) {
+      fprintf(stderr, "lwip_replay: cannot listen on TCP port %u\n", tcp_ports[i]);
+    }
+  }
+  for (i = 0; i < num_udp; i++) {
+    if (replay_udp_bind(udp_ports[i]) != 0) {
+      fprintf(stderr, "lwip_replay: cannot bind UDP port %u\n", udp_ports[i]);
+    }
+  }
+
+  /* only count what the capture causes, not the setup above */
+  memset(replay_stats, 0, sizeof(replay_stats));
+  while (pcapif_poll(&netif)) {
+    frames++;
+  }
+
+  replay_report(files.rx_file, frames, rev);
+  pcapif_shutdown(&netif);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+#include "test_chksum.h"
+
+#include "lwip/inet_chksum.h"
+#include "lwip/def.h"
+
+#include <string.h>
+
+#if !LWIP_CHKSUM_SELECT || !LWIP_CHECKSUM_ON_COPY
+#error "This tests needs LWIP_CHKSUM_SELECT and LWIP_CHECKSUM_ON_COPY enabled"
+#endif
+
+/* room for the largest IP packet at every offset tested */
+#define CHKSUM_MAX_OFF  8
+static u8_t chksum_buf[0xffff + CHKSUM_MAX_OFF];
+
+/* Setups/teardown functions */
+
+static void
+chksum_setup(void)
+{
+}
+
+static void
+chksum_teardown(void)
+{
+  inet_chksum_init();
+}
+
+/** Byte-by-byte reference (LWIP_CHKSUM_ALGORITHM 1), in host order */
+static u16_t
+chksum_ref(const u8_t *data, int len)
+{
+  u32_t acc = 0;
+
+  for (; len > 1; len -= 2, data += 2) {
+    acc += (u32_t)((data[0] << 8) | data[1]);
+  }
+  if (len > 0) {
+    acc += (u32_t)(data[0] << 8);
+  }
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return htons((u16_t)acc);
+}
+
+/** Compare every kernel the CPU supports against the reference */
+static void
+chksum_check_all(int off, int len)
+{
+  const struct lwip_chksum_kernel *k;
+  u16_t ref = chksum_ref(chksum_buf + off, len);
+
+  for (k = lwip_chksum_kernels; k->name != NULL; k++) {
+    if ((k->supported == NULL) || k->supported()) {
+      u16_t sum = k->fn(chksum_buf + off, len);
+      fail_unless(sum == ref, "%s: off %d len %d: %04x != %04x", k->name, off, len, sum, ref);
+    }
+  }
+}
+
+/* Test functions */
+
+/** All kernels agree at all alignments, short lengths and full-sized packets */
+START_TEST(test_chksum_kernels)
+{
+  static const int big[] = { 536, 1460, 1500, 4096, 0x8000, 0xffff - CHKSUM_MAX_OFF };
+  int off, len;
+  u32_t r = 0x12345678;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(chksum_buf); i++) {
+    r = r * 1103515245 + 12345;
+    chksum_buf[i] = (u8_t)(r >> 16);
+  }
+  for (off = 0; off < CHKSUM_MAX_OFF; off++) {
+    for (len = 0; len < 200; len++) {
+      chksum_check_all(off, len);
+    }
+    for (i = 0; i < sizeof(big) / sizeof(big[0]); i++) {
+      chksum_check_all(off, big[i]);
+    }
+  }
+
+  /* all ones is the worst case for the accumulators */
+  memset(chksum_buf, 0xff, sizeof(chksum_buf));
+  for (off = 0; off < CHKSUM_MAX_OFF; off++) {
+    chksum_check_all(off, 0xffff - CHKSUM_MAX_OFF);
+    chksum_check_all(off, 1499);
+  }
+}
+END_TEST
+
+/** inet_chksum() uses the selected kernel */
+START_TEST(test_chksum_select)
+{
+  const struct lwip_chksum_kernel *k;
+  u16_t ref;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(chksum_buf, 0xa5, 100);
+  chksum_buf[3] = 0x17;
+  ref = ~chksum_ref(chksum_buf + 1, 99);
+
+  fail_unless(inet_chksum_select("no such kernel") == ERR_ARG);
+  for (k = lwip_chksum_kernels; k->name != NULL; k++) {
+    if ((k->supported == NULL) || k->supported()) {
+      fail_unless(inet_chksum_select(k->name) == ERR_OK);
+      fail_unless(strcmp(inet_chksum_selected(), k->name) == 0);
+      fail_unless(inet_chksum(chksum_buf + 1, 99) == ref);
+    }
+  }
+}
+END_TEST
+
+/** LWIP_CHKSUM_COPY copies and sums correctly for all src/dst alignments */
+START_TEST(test_chksum_copy)
+{
+  static u8_t dst[1600 + CHKSUM_MAX_OFF];
+  static const int lens[] = { 0, 1, 2, 3, 4, 5, 7, 15, 16, 17, 31, 33, 536, 1459, 1460, 1600 };
+  int soff, doff;
+  size_t i;
+  u32_t r = 0x2468ace1;
+  u16_t sum, ref;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < 1600 + CHKSUM_MAX_OFF; i++) {
+    r = r * 1103515245 + 12345;
+    chksum_buf[i] = (u8_t)(r >> 16);
+  }
+  for (soff = 0; soff < CHKSUM_MAX_OFF; soff++) {
+    for (doff = 0; doff < CHKSUM_MAX_OFF; doff++) {
+      for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        memset(dst, 0, sizeof(dst));
+        sum = LWIP_CHKSUM_COPY(dst + doff, chksum_buf + soff, (u16_t)lens[i]);
+        ref = chksum_ref(chksum_buf + soff, lens[i]);
+        fail_unless(sum == ref, "src %d dst %d len %d: %04x != %04x", soff, doff, lens[i], sum, ref);
+        fail_unless(memcmp(dst + doff, chksum_buf + soff, lens[i]) == 0);
+        fail_unless((doff == 0) || (dst[doff - 1] == 0));
+        fail_unless(dst[doff + lens[i]] == 0);
+      }
+    }
+  }
+}
+END_TEST
+
+/** Incremental updates (RFC 1624) match a full recompute */
+START_TEST(test_chksum_adjust)
+{
+  static const u16_t vals[] = { 0x0000, 0x0001, 0x00ff, 0x8000, 0xfffe, 0xffff };
+  u16_t hdr[10];
+  u16_t sum, old16;
+  u32_t old32, new32;
+  u32_t r = 0xdeadbeef;
+  size_t i, j, w;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < 1000; i++) {
+    for (w = 0; w < 10; w++) {
+      r = r * 1103515245 + 12345;
+      hdr[w] = (u16_t)(r >> 16);
+    }
+    hdr[5] = 0;
+    hdr[5] = inet_chksum(hdr, sizeof(hdr));
+
+    w = (i % 4) * 2;
+    for (j = 0; j < sizeof(vals) / sizeof(vals[0]); j++) {
+      /* 16 bit field (ttl/proto, wnd) */
+      old16 = hdr[w];
+      hdr[w] = (j & 1) ? vals[j] : (u16_t)(r ^ vals[j]);
+      sum = inet_chksum_adjust16(hdr[5], old16, hdr[w]);
+      hdr[5] = 0;
+      fail_unless(sum == inet_chksum(hdr, sizeof(hdr)));
+      hdr[5] = sum;
+
+      /* 32 bit field (ackno, timestamps) */
+      SMEMCPY(&old32, &hdr[w], sizeof(old32));
+      new32 = ((u32_t)vals[j] << 16) | vals[sizeof(vals) / sizeof(vals[0]) - 1 - j];
+      SMEMCPY(&hdr[w], &new32, sizeof(new32));
+      sum = inet_chksum_adjust32(hdr[5], old32, new32);
+      hdr[5] = 0;
+      fail_unless(sum == inet_chksum(hdr, sizeof(hdr)));
+      hdr[5] = sum;
+    }
+  }
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+chksum_suite(void)
+{
+  TFun tests[] = {
+    test_chksum_kernels,
+    test_chksum_select,
+    test_chksum_adjust,
+    test_chksum_copy,
+  };
+  return create_suite("CHKSUM", tests, sizeof(tests)/sizeof(TFun), chksum_setup, chksum_teardown);
+}
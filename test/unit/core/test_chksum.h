@@ -0,0 +1,8 @@
+#ifndef __TEST_CHKSUM_H__
+#define __TEST_CHKSUM_H__
+
+#include "../lwip_check.h"
+
+Suite *chksum_suite(void);
+
+#endif
@@ -1,7 +1,15 @@
 #include "test_mem.h"
 
 #include "lwip/mem.h"
+#include "lwip/memp.h"
 #include "lwip/stats.h"
+#include "lwip/sys.h"
+#include "arch/sys_arch.h" /* sys_now_set() */
+#if LWIP_SNMP && SNMP_MEMP_MIB
+#include "lwip/snmp_structs.h"
+#endif /* LWIP_SNMP && SNMP_MEMP_MIB */
+
+#include <string.h>
 
 #if !LWIP_STATS || !MEM_STATS
 #error "This tests needs MEM-statistics enabled"
@@ -10,6 +18,10 @@
 /*#error "This test needs DNS turned off (as it mallocs on init)"*/
 #endif
 
+#if !MEMP_STATS || !MEMP_STATS_CALLERS || (MEMP_STATS_HIST_BUCKETS < 8)
+#error "This tests needs MEMP-statistics with callers and a histogram of 8 buckets enabled"
+#endif
+
 /* Setups/teardown functions */
 
 static void
@@ -61,6 +73,229 @@ START_TEST(test_mem_one)
 }
 END_TEST
 
+/** Free blocks are combined again, whatever order they are freed in */
+START_TEST(test_mem_coalesce)
+{
+#define NUM_BLOCKS 8
+  void *p[NUM_BLOCKS];
+  void *big;
+  int i;
+  static const int order[NUM_BLOCKS] = {3, 1, 6, 0, 7, 2, 5, 4};
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(lwip_stats.mem.used == 0);
+
+  for (i = 0; i < NUM_BLOCKS; i++) {
+    p[i] = mem_malloc((mem_size_t)(100 + 37 * i));
+    fail_unless(p[i] != NULL);
+  }
+  /* shrink one in front of a used and one in front of a free block */
+  fail_unless(mem_trim(p[2], 20) == p[2]);
+  for (i = 0; i < NUM_BLOCKS; i++) {
+    mem_free(p[order[i]]);
+    if (i == 4) {
+      fail_unless(mem_trim(p[5], 20) == p[5]);
+    }
+  }
+  fail_unless(lwip_stats.mem.used == 0);
+
+  mem_frag_update();
+  fail_unless(lwip_stats.mem.frag == 0);
+  fail_unless(lwip_stats.mem.largest == lwip_stats.mem.avail);
+
+  /* the whole heap is one block again */
+  big = mem_malloc((mem_size_t)(lwip_stats.mem.avail / 2));
+  fail_unless(big != NULL);
+  mem_free(big);
+  fail_unless(lwip_stats.mem.used == 0);
+}
+END_TEST
+
+/** Holes between used blocks show up in the fragmentation figures */
+START_TEST(test_mem_frag)
+{
+  void *p[NUM_BLOCKS];
+  mem_size_t free_before;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(lwip_stats.mem.used == 0);
+
+  for (i = 0; i < NUM_BLOCKS; i++) {
+    p[i] = mem_malloc(256);
+    fail_unless(p[i] != NULL);
+  }
+  mem_frag_update();
+  free_before = lwip_stats.mem.largest;
+  fail_unless(lwip_stats.mem.frag == 0);
+
+  /* free every other block: the holes can't be combined */
+  for (i = 0; i < NUM_BLOCKS; i += 2) {
+    mem_free(p[i]);
+  }
+  mem_frag_update();
+  fail_unless(lwip_stats.mem.largest == free_before);
+  fail_unless(lwip_stats.mem.frag > 0);
+
+  /* a hole is reused for a block that fits */
+  p[0] = mem_malloc(200);
+  fail_unless(p[0] != NULL);
+  fail_unless((u8_t *)p[0] < (u8_t *)p[NUM_BLOCKS - 1]);
+
+  mem_free(p[0]);
+  for (i = 1; i < NUM_BLOCKS; i += 2) {
+    mem_free(p[i]);
+  }
+  fail_unless(lwip_stats.mem.used == 0);
+  mem_frag_update();
+  fail_unless(lwip_stats.mem.frag == 0);
+}
+END_TEST
+
+
+/** memp high-water mark, failing call sites and time-in-use histogram */
+START_TEST(test_memp_stats)
+{
+  void *p[MEMP_NUM_UDP_PCB];
+  struct stats_memp_caller *c = lwip_stats.memp_caller[MEMP_UDP_PCB];
+  STAT_COUNTER hist[MEMP_STATS_HIST_BUCKETS];
+  int i, line, num;
+  LWIP_UNUSED_ARG(_i);
+
+  /* the stack may hold some already (e.g. the SNMP agent) */
+  num = MEMP_NUM_UDP_PCB - lwip_stats.memp[MEMP_UDP_PCB].used;
+  fail_unless(num >= 3);
+  memcpy(hist, lwip_stats.memp_hist[MEMP_UDP_PCB], sizeof(hist));
+  sys_now_set(sys_now());
+
+  for (i = 0; i < num; i++) {
+    p[i] = memp_malloc(MEMP_UDP_PCB);
+    fail_unless(p[i] != NULL);
+  }
+  fail_unless(lwip_stats.memp[MEMP_UDP_PCB].max == MEMP_NUM_UDP_PCB);
+
+  /* two failures at one site, one at another */
+  for (i = 0; i < 2; i++) {
+    line = __LINE__; fail_unless(memp_malloc(MEMP_UDP_PCB) == NULL);
+  }
+  fail_unless(memp_malloc(MEMP_UDP_PCB) == NULL);
+  fail_unless(c[0].file != NULL);
+  fail_unless(strcmp(c[0].file, __FILE__) == 0);
+  fail_unless(c[0].line == line);
+  fail_unless(c[0].err == 2);
+  fail_unless(c[1].line == line + 2);
+  fail_unless(c[1].err == 1);
+
+  /* 0..1 ms, 4..7 ms and >= 2^(N-1) ms */
+  memp_free(MEMP_UDP_PCB, p[0]);
+  sys_now_set(sys_now() + 5);
+  memp_free(MEMP_UDP_PCB, p[1]);
+  sys_now_set(sys_now() + 100000);
+  for (i = 2; i < num; i++) {
+    memp_free(MEMP_UDP_PCB, p[i]);
+  }
+  fail_unless(lwip_stats.memp_hist[MEMP_UDP_PCB][0] == hist[0] + 1);
+  fail_unless(lwip_stats.memp_hist[MEMP_UDP_PCB][2] == hist[2] + 1);
+  fail_unless(lwip_stats.memp_hist[MEMP_UDP_PCB][MEMP_STATS_HIST_BUCKETS - 1] ==
+    hist[MEMP_STATS_HIST_BUCKETS - 1] + num - 2);
+  fail_unless(lwip_stats.memp[MEMP_UDP_PCB].max == MEMP_NUM_UDP_PCB);
+}
+END_TEST
+
+/** memp free lists hand out each element once and reuse the last freed first */
+START_TEST(test_memp_lifo)
+{
+  void *p[MEMP_NUM_UDP_PCB];
+  int i, j, num;
+  mem_size_t used;
+  LWIP_UNUSED_ARG(_i);
+
+  used = lwip_stats.memp[MEMP_UDP_PCB].used;
+  num = MEMP_NUM_UDP_PCB - used;
+  fail_unless(num >= 2);
+  for (i = 0; i < num; i++) {
+    p[i] = memp_malloc(MEMP_UDP_PCB);
+    fail_unless(p[i] != NULL);
+    for (j = 0; j < i; j++) {
+      fail_unless(p[i] != p[j]);
+    }
+  }
+  fail_unless(memp_malloc(MEMP_UDP_PCB) == NULL);
+
+  memp_free(MEMP_UDP_PCB, p[1]);
+  memp_free(MEMP_UDP_PCB, p[0]);
+  fail_unless(memp_malloc(MEMP_UDP_PCB) == p[0]);
+  fail_unless(memp_malloc(MEMP_UDP_PCB) == p[1]);
+  fail_unless(memp_malloc(MEMP_UDP_PCB) == NULL);
+
+  for (i = 0; i < num; i++) {
+    memp_free(MEMP_UDP_PCB, p[i]);
+  }
+  fail_unless(lwip_stats.memp[MEMP_UDP_PCB].used == used);
+}
+END_TEST
+
+#if LWIP_SNMP && SNMP_MEMP_MIB
+/** Get a Gauge32/Counter32 column of a pool's mempEntry through the MIB tree */
+static u32_t
+memp_mib_get(s32_t column, memp_t pool)
+{
+  /* private(4).enterprises(1).lwip(26381).lwipMemp(1).mempTable(1).mempEntry(1) */
+  s32_t ident[8] = { 4, 1, 26381, 1, 1, 1, 0, 0 };
+  struct snmp_name_ptr np;
+  struct mib_node *mn;
+  struct obj_def od;
+  u32_t value = 0xffffffffUL;
+
+  ident[6] = column;
+  ident[7] = pool + 1;
+  mn = snmp_search_tree((struct mib_node*)&internet, 8, ident, &np);
+  fail_unless(mn != NULL);
+  if (mn != NULL) {
+    mn->get_object_def(np.ident_len, np.ident, &od);
+    fail_unless(od.instance == MIB_OBJECT_TAB);
+    fail_unless(od.v_len == sizeof(value));
+    mn->get_value(&od, od.v_len, &value);
+  }
+  return value;
+}
+
+/** The mempTable reports the used/max/err statistics of a pool */
+START_TEST(test_memp_mib)
+{
+  void *p[MEMP_NUM_UDP_PCB];
+  u32_t err, used;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* the SNMP agent holds a UDP pcb of its own */
+  used = lwip_stats.memp[MEMP_UDP_PCB].used;
+  fail_unless(used < MEMP_NUM_UDP_PCB);
+  err = lwip_stats.memp[MEMP_UDP_PCB].err;
+  for (i = 0; i < (int)(MEMP_NUM_UDP_PCB - used); i++) {
+    p[i] = memp_malloc(MEMP_UDP_PCB);
+    fail_unless(p[i] != NULL);
+  }
+  fail_unless(memp_malloc(MEMP_UDP_PCB) == NULL);
+  memp_free(MEMP_UDP_PCB, p[0]);
+
+  fail_unless(memp_mib_get(3, MEMP_UDP_PCB) == MEMP_NUM_UDP_PCB - 1); /* mempUsed */
+  fail_unless(memp_mib_get(4, MEMP_UDP_PCB) == MEMP_NUM_UDP_PCB);     /* mempMax */
+  fail_unless(memp_mib_get(5, MEMP_UDP_PCB) == err + 1);              /* mempErr */
+  /* no such row */
+  {
+    s32_t ident[8] = { 4, 1, 26381, 1, 1, 1, 3, MEMP_MAX + 1 };
+    struct snmp_name_ptr np;
+    fail_unless(snmp_search_tree((struct mib_node*)&internet, 8, ident, &np) == NULL);
+  }
+
+  for (i = 1; i < (int)(MEMP_NUM_UDP_PCB - used); i++) {
+    memp_free(MEMP_UDP_PCB, p[i]);
+  }
+  fail_unless(memp_mib_get(3, MEMP_UDP_PCB) == used);
+}
+END_TEST
+#endif /* LWIP_SNMP && SNMP_MEMP_MIB */
 
 /** Create the suite including all tests for this module */
 Suite *
@@ -68,6 +303,13 @@ mem_suite(void)
 {
   TFun tests[] = {
     test_mem_one,
+    test_mem_coalesce,
+    test_mem_frag,
+    test_memp_stats,
+    test_memp_lifo,
+#if LWIP_SNMP && SNMP_MEMP_MIB
+    test_memp_mib,
+#endif /* LWIP_SNMP && SNMP_MEMP_MIB */
   };
   return create_suite("MEM", tests, sizeof(tests)/sizeof(TFun), mem_setup, mem_teardown);
 }
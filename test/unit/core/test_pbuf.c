@@ -0,0 +1,181 @@
+#include "test_pbuf.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+
+#include <string.h>
+
+#if !LWIP_STATS || !MEM_STATS || !MEMP_STATS
+#error "This tests needs MEM- and MEMP-statistics enabled"
+#endif
+#if !PBUF_RAM_SLAB
+#error "This tests needs PBUF_RAM_SLAB enabled"
+#endif
+
+/* Setups/teardown functions */
+
+static void
+pbuf_setup(void)
+{
+}
+
+static void
+pbuf_teardown(void)
+{
+}
+
+/** Allocate and free PBUF_RAM pbufs of one size until they come from a slab */
+static int
+pbuf_slab_train(u16_t len)
+{
+  struct pbuf *p;
+  u32_t i;
+  int slab = 0;
+
+  for (i = 0; (i < 0x20000) && !slab; i++) {
+    p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+    fail_unless(p != NULL);
+    slab = (p->flags & PBUF_FLAG_SLAB) != 0;
+    pbuf_free(p);
+  }
+  return slab;
+}
+
+
+/* Test functions */
+
+/** PBUF_RAM pbufs of a frequent size come from slab pages, not the heap */
+START_TEST(test_pbuf_slab)
+{
+#define SLAB_LEN  300
+#define NUM_PBUFS 72
+  struct pbuf *p[NUM_PBUFS];
+  mem_size_t heap_used;
+  int i, slab = 0, heap = 0;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(pbuf_slab_train(SLAB_LEN));
+  fail_unless(lwip_stats.memp[MEMP_PBUF_RAM_SLAB].used == 0);
+
+  heap_used = lwip_stats.mem.used;
+  for (i = 0; i < NUM_PBUFS; i++) {
+    p[i] = pbuf_alloc(PBUF_RAW, SLAB_LEN, PBUF_RAM);
+    fail_unless(p[i] != NULL);
+    fail_unless(p[i]->len == SLAB_LEN);
+    if (p[i]->flags & PBUF_FLAG_SLAB) {
+      /* slab objects must not overlap */
+      memset(p[i]->payload, i, SLAB_LEN);
+      fail_unless(heap == 0);
+      slab++;
+    } else {
+      heap++;
+    }
+  }
+  /* the first ones come from slabs until all pages are used, then the heap */
+  fail_unless(slab > 0);
+  fail_unless(heap > 0);
+  fail_unless(lwip_stats.memp[MEMP_PBUF_RAM_SLAB].used == PBUF_RAM_SLAB_PAGES);
+  fail_unless(lwip_stats.mem.used > heap_used);
+
+  for (i = 0; i < slab; i++) {
+    fail_unless(((u8_t *)p[i]->payload)[0] == (u8_t)i);
+    fail_unless(((u8_t *)p[i]->payload)[SLAB_LEN - 1] == (u8_t)i);
+  }
+  /* realloc leaves slab objects alone */
+  pbuf_realloc(p[0], 10);
+  fail_unless(p[0]->len == 10);
+  fail_unless((p[0]->flags & PBUF_FLAG_SLAB) != 0);
+
+  /* free every other pbuf first, then the rest */
+  for (i = 0; i < NUM_PBUFS; i += 2) {
+    pbuf_free(p[i]);
+  }
+  for (i = 1; i < NUM_PBUFS; i += 2) {
+    pbuf_free(p[i]);
+  }
+  fail_unless(lwip_stats.memp[MEMP_PBUF_RAM_SLAB].used == 0);
+  fail_unless(lwip_stats.mem.used == heap_used);
+}
+END_TEST
+
+/** Sizes too big for a page always come from the heap */
+START_TEST(test_pbuf_slab_big)
+{
+  struct pbuf *p;
+  mem_size_t heap_used;
+  LWIP_UNUSED_ARG(_i);
+
+  heap_used = lwip_stats.mem.used;
+  fail_unless(!pbuf_slab_train(PBUF_RAM_SLAB_PAGE_SIZE));
+  p = pbuf_alloc(PBUF_RAW, PBUF_RAM_SLAB_PAGE_SIZE, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless((p->flags & PBUF_FLAG_SLAB) == 0);
+  fail_unless(lwip_stats.mem.used > heap_used);
+  pbuf_free(p);
+  fail_unless(lwip_stats.mem.used == heap_used);
+}
+END_TEST
+
+#if LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+/** A chain whose tot_len has overflowed is split below 64 KiB */
+START_TEST(test_pbuf_split_64k)
+{
+#define SPLIT_LEN  0x4000
+#define SPLIT_NUM  5
+  static u8_t data[SPLIT_LEN];
+  struct pbuf *p, *q, *rest;
+  u32_t sum;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  p = NULL;
+  for (i = 0; i < SPLIT_NUM; i++) {
+    q = pbuf_alloc(PBUF_RAW, SPLIT_LEN, PBUF_REF);
+    fail_unless(q != NULL);
+    q->payload = data;
+    if (p == NULL) {
+      p = q;
+    } else {
+      pbuf_cat(p, q);
+    }
+  }
+  /* 80 KiB: tot_len wrapped */
+  fail_unless(p->tot_len == (u16_t)(SPLIT_NUM * SPLIT_LEN));
+
+  pbuf_split_64k(p, &rest);
+  fail_unless(rest != NULL);
+  fail_unless(pbuf_clen(p) == 3);
+  fail_unless(p->tot_len == 3 * SPLIT_LEN);
+  for (q = p, sum = 0; q != NULL; q = q->next) {
+    sum += q->len;
+    fail_unless((q->next != NULL) || (q->tot_len == q->len));
+  }
+  fail_unless(sum == 3 * SPLIT_LEN);
+  fail_unless(pbuf_clen(rest) == 2);
+  fail_unless(rest->tot_len == 2 * SPLIT_LEN);
+
+  /* what fits is left alone */
+  pbuf_split_64k(rest, &q);
+  fail_unless(q == NULL);
+  fail_unless(rest->tot_len == 2 * SPLIT_LEN);
+
+  pbuf_free(p);
+  pbuf_free(rest);
+}
+END_TEST
+#endif /* LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+
+
+/** Create the suite including all tests for this module */
+Suite *
+pbuf_suite(void)
+{
+  TFun tests[] = {
+    test_pbuf_slab,
+    test_pbuf_slab_big,
+#if LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+    test_pbuf_split_64k,
+#endif /* LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+  };
+  return create_suite("PBUF", tests, sizeof(tests)/sizeof(TFun), pbuf_setup, pbuf_teardown);
+}
@@ -0,0 +1,130 @@
+#include "test_perf.h"
+
+#include "lwip/perf.h"
+#include "lwip/pbuf.h"
+
+#include <string.h>
+
+#if !LWIP_PERF
+#error "This tests needs LWIP_PERF enabled"
+#endif
+
+/* Setups/teardown functions */
+
+static void
+perf_setup(void)
+{
+  perf_reset();
+}
+
+static void
+perf_teardown(void)
+{
+}
+
+/** Find the probe holding the statistics for 'name' */
+static struct perf_probe *
+perf_find(const char *name)
+{
+  struct perf_probe *p;
+  for (p = perf_probes; p != NULL; p = p->next) {
+    if (strcmp(p->name, name) == 0) {
+      return p->stats;
+    }
+  }
+  return NULL;
+}
+
+static u32_t
+perf_hist_sum(const struct perf_probe *p)
+{
+  u32_t sum = 0;
+  int i;
+  for (i = 0; i < LWIP_PERF_HIST_BUCKETS; i++) {
+    sum += p->hist[i];
+  }
+  return sum;
+}
+
+/** Two exits of the same function, recorded under one name */
+static void
+perf_two_exits(int first)
+{
+  PERF_START;
+  if (first) {
+    PERF_STOP("test_two_exits");
+    return;
+  }
+  PERF_STOP("test_two_exits");
+}
+
+/* Test functions */
+
+/** The pbuf_alloc probe counts every allocation */
+START_TEST(test_perf_pbuf_alloc)
+{
+#define PERF_NUM_ALLOC 5
+  struct perf_probe *probe;
+  struct pbuf *p;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < PERF_NUM_ALLOC; i++) {
+    p = pbuf_alloc(PBUF_RAW, 100, PBUF_RAM);
+    fail_unless(p != NULL);
+    pbuf_free(p);
+  }
+
+  probe = perf_find("pbuf_alloc");
+  fail_unless(probe != NULL);
+  fail_unless(probe->count == PERF_NUM_ALLOC);
+  fail_unless(probe->min <= probe->max);
+  fail_unless(probe->sum >= (unsigned long long)probe->min * probe->count);
+  fail_unless(probe->sum <= (unsigned long long)probe->max * probe->count);
+  fail_unless(perf_hist_sum(probe) == PERF_NUM_ALLOC);
+
+  probe = perf_find("pbuf_free");
+  fail_unless(probe != NULL);
+  fail_unless(probe->count == PERF_NUM_ALLOC);
+
+  perf_reset();
+  fail_unless(perf_find("pbuf_alloc")->count == 0);
+}
+END_TEST
+
+/** PERF_STOP sites with the same name share their statistics */
+START_TEST(test_perf_shared_name)
+{
+  struct perf_probe *probe, *p;
+  int sites = 0;
+  LWIP_UNUSED_ARG(_i);
+
+  perf_two_exits(1);
+  perf_two_exits(0);
+  perf_two_exits(0);
+
+  probe = perf_find("test_two_exits");
+  fail_unless(probe != NULL);
+  fail_unless(probe->count == 3);
+  fail_unless(perf_hist_sum(probe) == 3);
+  for (p = perf_probes; p != NULL; p = p->next) {
+    if (strcmp(p->name, "test_two_exits") == 0) {
+      fail_unless(p->stats == probe);
+      sites++;
+    }
+  }
+  fail_unless(sites == 2);
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+perf_suite(void)
+{
+  TFun tests[] = {
+    test_perf_pbuf_alloc,
+    test_perf_shared_name,
+  };
+  return create_suite("PERF", tests, sizeof(tests)/sizeof(TFun), perf_setup, perf_teardown);
+}
@@ -0,0 +1,8 @@
+#ifndef __TEST_PERF_H__
+#define __TEST_PERF_H__
+
+#include "../lwip_check.h"
+
+Suite *perf_suite(void);
+
+#endif
@@ -0,0 +1,178 @@
+#include "test_reclaim.h"
+
+#include "lwip/reclaim.h"
+#include "lwip/memp.h"
+
+#if !LWIP_RECLAIM
+#error "This tests needs LWIP_RECLAIM enabled"
+#endif
+
+/* The tests hold udp_pcbs (the built-in handlers have nothing to free there) */
+#define HELD_MAX  MEMP_NUM_UDP_PCB
+
+static void *held[HELD_MAX];
+static int num_held;
+/** order in which the handlers freed something ('a', 'b'...) */
+static char calls[16];
+static int num_calls;
+static int limit_a;
+
+static struct reclaim_handler handler_a, handler_b;
+
+static void
+hold_all(void)
+{
+  void *mem;
+  while ((mem = memp_malloc(MEMP_UDP_PCB)) != NULL) {
+    fail_unless(num_held < HELD_MAX);
+    held[num_held++] = mem;
+  }
+  fail_unless(memp_avail(MEMP_UDP_PCB) == 0);
+}
+
+static u8_t
+release_one(reclaim_src_t src, char name)
+{
+  if (((src != MEMP_UDP_PCB) && (src != RECLAIM_DRIVER)) || (num_held == 0)) {
+    return 0;
+  }
+  memp_free(MEMP_UDP_PCB, held[--num_held]);
+  if (num_calls < (int)sizeof(calls)) {
+    calls[num_calls++] = name;
+  }
+  return 1;
+}
+
+/** frees up to limit_a elements */
+static u8_t
+reclaim_a(reclaim_src_t src, void *arg)
+{
+  fail_unless(arg == &limit_a);
+  if (limit_a == 0) {
+    return 0;
+  }
+  if (release_one(src, 'a')) {
+    limit_a--;
+    return 1;
+  }
+  return 0;
+}
+
+static u8_t
+reclaim_b(reclaim_src_t src, void *arg)
+{
+  return release_one(src, 'b');
+}
+
+/* Setups/teardown functions */
+
+static void
+reclaim_setup(void)
+{
+  num_held = 0;
+  num_calls = 0;
+  limit_a = 0;
+  /* registered in reverse order, prio decides */
+  reclaim_register(&handler_b, reclaim_b, NULL, 2);
+  reclaim_register(&handler_a, reclaim_a, &limit_a, 1);
+}
+
+static void
+reclaim_teardown(void)
+{
+  reclaim_unregister(&handler_a);
+  reclaim_unregister(&handler_b);
+  while (num_held > 0) {
+    memp_free(MEMP_UDP_PCB, held[--num_held]);
+  }
+  reclaim_set_watermarks(MEMP_UDP_PCB, MEMP_RECLAIM_LOWAT(MEMP_NUM_UDP_PCB),
+    MEMP_RECLAIM_HIWAT(MEMP_NUM_UDP_PCB));
+  /* drop what the tests left pending */
+  reclaim_poll();
+}
+
+
+/* Test functions */
+
+/** Going below the low watermark runs the handlers by prio up to the high watermark */
+START_TEST(test_reclaim_watermarks)
+{
+  LWIP_UNUSED_ARG(_i);
+
+  reclaim_set_watermarks(MEMP_UDP_PCB, 2, 3);
+  limit_a = 1;
+  hold_all();
+  /* nothing runs before reclaim_poll() */
+  fail_unless(num_calls == 0);
+
+  reclaim_poll();
+  fail_unless(memp_avail(MEMP_UDP_PCB) == 3);
+  fail_unless(num_calls == 3);
+  fail_unless(calls[0] == 'a');
+  fail_unless(calls[1] == 'b');
+  fail_unless(calls[2] == 'b');
+  fail_unless(handler_a.freed == 1);
+  fail_unless(handler_b.freed == 2);
+
+  /* down to the low watermark: nothing to do */
+  held[num_held] = memp_malloc(MEMP_UDP_PCB);
+  fail_unless(held[num_held] != NULL);
+  num_held++;
+  fail_unless(memp_avail(MEMP_UDP_PCB) == 2);
+  reclaim_poll();
+  fail_unless(num_calls == 3);
+}
+END_TEST
+
+/** A failing allocation signals even without a low watermark, unregistered
+    handlers are not called */
+START_TEST(test_reclaim_alloc_fails)
+{
+  LWIP_UNUSED_ARG(_i);
+
+  reclaim_set_watermarks(MEMP_UDP_PCB, 0, 1);
+  limit_a = 10;
+  reclaim_unregister(&handler_a);
+  /* hold_all() runs the pool empty: the failing memp_malloc() signals */
+  hold_all();
+  fail_unless(num_calls == 0);
+  reclaim_poll();
+  fail_unless(memp_avail(MEMP_UDP_PCB) == 1);
+  fail_unless(num_calls == 1);
+  fail_unless(calls[0] == 'b');
+  fail_unless(limit_a == 10);
+}
+END_TEST
+
+/** A driver signal (no accounting) is done after one handler freed something */
+START_TEST(test_reclaim_driver)
+{
+  LWIP_UNUSED_ARG(_i);
+
+  reclaim_set_watermarks(MEMP_UDP_PCB, 0, 0);
+  limit_a = 10;
+  hold_all();
+  reclaim_signal(RECLAIM_DRIVER);
+  reclaim_poll();
+  fail_unless(num_calls == 1);
+  fail_unless(calls[0] == 'a');
+  fail_unless(limit_a == 9);
+
+  /* handled: polling again does nothing */
+  reclaim_poll();
+  fail_unless(num_calls == 1);
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+reclaim_suite(void)
+{
+  TFun tests[] = {
+    test_reclaim_watermarks,
+    test_reclaim_alloc_fails,
+    test_reclaim_driver,
+  };
+  return create_suite("RECLAIM", tests, sizeof(tests)/sizeof(TFun), reclaim_setup, reclaim_teardown);
+}
@@ -0,0 +1,8 @@
+#ifndef __TEST_RECLAIM_H__
+#define __TEST_RECLAIM_H__
+
+#include "../lwip_check.h"
+
+Suite *reclaim_suite(void);
+
+#endif
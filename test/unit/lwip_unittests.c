@@ -3,7 +3,11 @@
 #include "udp/test_udp.h"
 #include "tcp/test_tcp.h"
 #include "tcp/test_tcp_oos.h"
+#include "core/test_chksum.h"
 #include "core/test_mem.h"
+#include "core/test_perf.h"
+#include "core/test_pbuf.h"
+#include "core/test_reclaim.h"
 #include "etharp/test_etharp.h"
 
 #include "lwip/init.h"
@@ -18,7 +22,11 @@ int main()
     udp_suite,
     tcp_suite,
     tcp_oos_suite,
+    chksum_suite,
     mem_suite,
+    perf_suite,
+    pbuf_suite,
+    reclaim_suite,
     etharp_suite,
   };
   size_t num = sizeof(suites)/sizeof(void*);
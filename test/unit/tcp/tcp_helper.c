@@ -4,6 +4,7 @@
 #include "lwip/stats.h"
 #include "lwip/pbuf.h"
 #include "lwip/inet_chksum.h"
+#include "lwip/ip.h"
 
 #if !LWIP_STATS || !TCP_STATS || !MEMP_STATS
 #error "This tests needs TCP- and MEMP-statistics enabled"
@@ -53,11 +54,23 @@ struct pbuf*
 tcp_create_segment(ip_addr_t* src_ip, ip_addr_t* dst_ip,
                    u16_t src_port, u16_t dst_port, void* data, size_t data_len,
                    u32_t seqno, u32_t ackno, u8_t headerflags)
+{
+  return tcp_create_segment_opts(src_ip, dst_ip, src_port, dst_port, data, data_len,
+    seqno, ackno, headerflags, NULL, 0, TCP_WND);
+}
+
+/** Create a TCP segment with TCP options (optlen must be a multiple of 4)
+ * and a given window field usable for passing to tcp_input */
+struct pbuf*
+tcp_create_segment_opts(ip_addr_t* src_ip, ip_addr_t* dst_ip,
+                   u16_t src_port, u16_t dst_port, void* data, size_t data_len,
+                   u32_t seqno, u32_t ackno, u8_t headerflags,
+                   const u8_t* opts, u8_t optlen, u16_t wnd)
 {
   struct pbuf* p;
   struct ip_hdr* iphdr;
   struct tcp_hdr* tcphdr;
-  u16_t pbuf_len = (u16_t)(sizeof(struct ip_hdr) + sizeof(struct tcp_hdr) + data_len);
+  u16_t pbuf_len = (u16_t)(sizeof(struct ip_hdr) + sizeof(struct tcp_hdr) + optlen + data_len);
 
   p = pbuf_alloc(PBUF_RAW, pbuf_len, PBUF_POOL);
   EXPECT_RETNULL(p != NULL);
@@ -80,12 +93,13 @@ tcp_create_segment(ip_addr_t* src_ip, ip_addr_t* dst_ip,
   tcphdr->dest  = htons(dst_port);
   tcphdr->seqno = htonl(seqno);
   tcphdr->ackno = htonl(ackno);
-  TCPH_HDRLEN_SET(tcphdr, sizeof(struct tcp_hdr)/4);
+  TCPH_HDRLEN_SET(tcphdr, (sizeof(struct tcp_hdr) + optlen)/4);
   TCPH_FLAGS_SET(tcphdr, headerflags);
-  tcphdr->wnd   = htons(TCP_WND);
+  tcphdr->wnd   = htons(wnd);
 
-  /* copy data */
-  memcpy((char*)tcphdr + sizeof(struct tcp_hdr), data, data_len);
+  /* copy options and data */
+  memcpy((char*)tcphdr + sizeof(struct tcp_hdr), opts, optlen);
+  memcpy((char*)tcphdr + sizeof(struct tcp_hdr) + optlen, data, data_len);
 
   /* calculate checksum */
   tcphdr->chksum = inet_chksum_pseudo(p, &(iphdr->src), &(iphdr->dest),
@@ -104,22 +118,23 @@ tcp_set_state(struct tcp_pcb* pcb, enum tcp_state state, ip_addr_t* local_ip,
   /* @todo: are these all states? */
   /* @todo: remove from previous list */
   pcb->state = state;
+  /* set the 4-tuple first: it is the key of the pcb hash tables */
   if (state == ESTABLISHED) {
-    TCP_REG(&tcp_active_pcbs, pcb);
     pcb->local_ip.addr = local_ip->addr;
     pcb->local_port = local_port;
     pcb->remote_ip.addr = remote_ip->addr;
     pcb->remote_port = remote_port;
+    TCP_REG(&tcp_active_pcbs, pcb);
   } else if(state == LISTEN) {
-    TCP_REG(&tcp_listen_pcbs.pcbs, pcb);
     pcb->local_ip.addr = local_ip->addr;
     pcb->local_port = local_port;
+    TCP_REG(&tcp_listen_pcbs.pcbs, pcb);
   } else if(state == TIME_WAIT) {
-    TCP_REG(&tcp_tw_pcbs, pcb);
     pcb->local_ip.addr = local_ip->addr;
     pcb->local_port = local_port;
     pcb->remote_ip.addr = remote_ip->addr;
     pcb->remote_port = remote_port;
+    TCP_REG(&tcp_tw_pcbs, pcb);
   } else {
     fail();
   }
@@ -193,3 +208,22 @@ test_tcp_new_counters_pcb(struct test_tcp_counters* counters)
   }
   return pcb;
 }
+
+/** Pass a segment created by tcp_create_segment() to tcp_input(), setting up
+ * the current IP header information like ip_input() would. */
+void
+test_tcp_input(struct pbuf *p, struct netif *inp)
+{
+  struct ip_hdr *iphdr = (struct ip_hdr*)p->payload;
+  ip_addr_copy(current_iphdr_dest, iphdr->dest);
+  ip_addr_copy(current_iphdr_src, iphdr->src);
+  current_netif = inp;
+  current_header = iphdr;
+
+  tcp_input(p, inp);
+
+  current_iphdr_dest.addr = 0;
+  current_iphdr_src.addr = 0;
+  current_netif = NULL;
+  current_header = NULL;
+}
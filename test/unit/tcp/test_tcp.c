@@ -1,13 +1,35 @@
 #include "test_tcp.h"
 
 #include "lwip/tcp_impl.h"
+#include "lwip/tcp_cc.h"
 #include "lwip/stats.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip.h"
 #include "tcp_helper.h"
+#include "../txcheck_helper.h"
+#include "arch/sys_arch.h" /* sys_now_set() */
 
 #if !LWIP_STATS || !TCP_STATS || !MEMP_STATS
 #error "This tests needs TCP- and MEMP-statistics enabled"
 #endif
 
+/* the last segment sent through a txcheck netif */
+#define txcheck_tcphdr (&txcheck.hdr.tcp)
+#define txcheck_seqno  ntohl(txcheck_tcphdr->seqno)
+#define txcheck_ackno  ntohl(txcheck_tcphdr->ackno)
+#define txcheck_chksum (txcheck_tcphdr->chksum)
+#define txcheck_flags  TCPH_FLAGS(txcheck_tcphdr)
+#define txcheck_wnd    ntohs(txcheck_tcphdr->wnd)
+#define txcheck_opts   (txcheck.hdr.bytes + TCP_HLEN)
+#define txcheck_optlen ((u8_t)(TCPH_HDRLEN(txcheck_tcphdr) * 4 - TCP_HLEN))
+
+/* Let the retransmission timer of 'pcb' expire on the next tcp_slowtmr() */
+#if LWIP_TCP_TIMERS_MS
+#define test_tcp_expire_rtimer(pcb) ((pcb)->rtime_start = tcp_ticks - (u32_t)(pcb)->rto)
+#else /* LWIP_TCP_TIMERS_MS */
+#define test_tcp_expire_rtimer(pcb) ((pcb)->rtime = (pcb)->rto)
+#endif /* LWIP_TCP_TIMERS_MS */
+
 /* Setups/teardown functions */
 
 static void
@@ -76,7 +98,7 @@ START_TEST(test_tcp_recv_inseq)
   EXPECT(p != NULL);
   if (p != NULL) {
     /* pass the segment to tcp_input */
-    tcp_input(p, &netif);
+    test_tcp_input(p, &netif);
     /* check if counters are as expected */
     EXPECT(counters.close_calls == 0);
     EXPECT(counters.recv_calls == 1);
@@ -91,6 +113,1581 @@ START_TEST(test_tcp_recv_inseq)
 }
 END_TEST
 
+/** A retransmission with a new ackno and window still has a valid checksum
+ * (the header checksum is updated, not recomputed) */
+START_TEST(test_tcp_rexmit_chksum)
+{
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  char data[100];
+  ip_addr_t remote_ip, local_ip, netmask;
+  struct netif netif;
+  u32_t first_ackno;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(data); i++) {
+    data[i] = (char)i;
+  }
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  txcheck.count = 0;
+  txcheck.bad_chksum = 0;
+  memset(&counters, 0, sizeof(counters));
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, 0x101, 0x100);
+  pcb->snd_wnd = TCP_WND;
+  pcb->cwnd = TCP_WND;
+
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == 1);
+  first_ackno = txcheck_ackno;
+  EXPECT_RET(pcb->unacked != NULL);
+  EXPECT(pcb->unacked->flags & TF_SEG_HDR_CHECKSUMMED);
+
+  /* data received and window changed since the first transmission */
+  pcb->rcv_nxt += 0x12345;
+  pcb->rcv_ann_wnd -= 0x123;
+  tcp_rexmit_rto(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == 2);
+  EXPECT(txcheck_ackno == first_ackno + 0x12345);
+  EXPECT(txcheck.bad_chksum == 0);
+
+  /* checksum left to the netif: sent as 0, summed again once enabled */
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL & ~NETIF_CHECKSUM_GEN_TCP);
+  tcp_rexmit_rto(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == 3);
+  EXPECT(txcheck_chksum == 0);
+  EXPECT_RET(pcb->unacked != NULL);
+  EXPECT(!(pcb->unacked->flags & TF_SEG_HDR_CHECKSUMMED));
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL);
+  pcb->rcv_nxt++;
+  tcp_rexmit_rto(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == 4);
+  EXPECT(txcheck.bad_chksum == 1); /* the one sent with 0 */
+
+  tcp_abort(pcb);
+  netif_remove(&netif);
+}
+END_TEST
+
+#define DEMUX_NUM_PCBS 3
+
+static struct tcp_pcb *demux_accepted;
+
+static err_t
+test_tcp_demux_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  demux_accepted = newpcb;
+  return ERR_OK;
+}
+
+/** Segments find their pcb among several connections sharing the local
+ * address and port, also after one of them has been removed */
+START_TEST(test_tcp_demux)
+{
+  struct test_tcp_counters counters[DEMUX_NUM_PCBS];
+  struct tcp_pcb* pcbs[DEMUX_NUM_PCBS];
+  struct tcp_pcb *lpcb, *pcb;
+  struct pbuf* p;
+  char data[] = {1, 2, 3, 4};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t local_port = 0x101, listen_port = 0x102;
+  struct netif netif;
+  int i, round;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  /* route for the SYN+ACK */
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  memset(counters, 0, sizeof(counters));
+  for (i = 0; i < DEMUX_NUM_PCBS; i++) {
+    pcbs[i] = test_tcp_new_counters_pcb(&counters[i]);
+    EXPECT_RET(pcbs[i] != NULL);
+    tcp_set_state(pcbs[i], ESTABLISHED, &local_ip, &remote_ip, local_port, (u16_t)(0x100 + i));
+  }
+
+  for (round = 1; round <= 2; round++) {
+    for (i = 0; i < DEMUX_NUM_PCBS; i++) {
+      if (pcbs[i] == NULL) {
+        continue;
+      }
+      p = tcp_create_rx_segment(pcbs[i], data, sizeof(data), 0, 0, 0);
+      EXPECT_RET(p != NULL);
+      test_tcp_input(p, &netif);
+    }
+    for (i = 0; i < DEMUX_NUM_PCBS; i++) {
+      EXPECT(counters[i].recv_calls == (u32_t)((pcbs[i] == NULL) ? 1 : round));
+      EXPECT(counters[i].recved_bytes == counters[i].recv_calls * sizeof(data));
+    }
+    if (round == 1) {
+      /* unlink the middle one */
+      tcp_abort(pcbs[1]);
+      pcbs[1] = NULL;
+    }
+  }
+
+  /* a SYN to a listener creates a new pcb that receives the next segment */
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_bind(pcb, &local_ip, listen_port) == ERR_OK);
+  lpcb = tcp_listen(pcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_accept(lpcb, test_tcp_demux_accept);
+  demux_accepted = NULL;
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x200, listen_port, NULL, 0, 0x1000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    if (pcb->remote_port == 0x200) {
+      break;
+    }
+  }
+  EXPECT_RET(pcb != NULL);
+  EXPECT(pcb->state == SYN_RCVD);
+  EXPECT(pcb->local_port == listen_port);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(demux_accepted == pcb);
+  EXPECT(pcb->state == ESTABLISHED);
+
+  tcp_close(lpcb);
+  for (i = 0; i < DEMUX_NUM_PCBS; i++) {
+    if (pcbs[i] != NULL) {
+      tcp_abort(pcbs[i]);
+    }
+  }
+  netif_remove(&netif);
+}
+END_TEST
+
+/** Check tcp_pcb_num against the pcb lists */
+static void
+tcp_check_pcb_num(void)
+{
+  struct tcp_pcb *pcb;
+  u16_t active = 0, syn_rcvd = 0, time_wait = 0;
+
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    active++;
+    if (pcb->state == SYN_RCVD) {
+      syn_rcvd++;
+    }
+  }
+  for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+    time_wait++;
+  }
+  EXPECT(tcp_pcb_num.active == active);
+  EXPECT(tcp_pcb_num.syn_rcvd == syn_rcvd);
+  EXPECT(tcp_pcb_num.time_wait == time_wait);
+  EXPECT(lwip_stats.tcp_pcbs.active.used == active);
+  EXPECT(lwip_stats.tcp_pcbs.syn_rcvd.used == syn_rcvd);
+  EXPECT(lwip_stats.tcp_pcbs.time_wait.used == time_wait);
+}
+
+/** The per-state pcb counters follow the lists and refuse SYNs once all
+ * pcbs are active */
+START_TEST(test_tcp_pcb_num)
+{
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcbs[MEMP_NUM_TCP_PCB - 1];
+  struct tcp_pcb *lpcb, *pcb;
+  struct pbuf* p;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t listen_port = 0x102;
+  struct netif netif;
+  STAT_COUNTER refused;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  memset(&counters, 0, sizeof(counters));
+  tcp_check_pcb_num();
+  EXPECT(tcp_pcb_num.active == 0);
+
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_bind(pcb, &local_ip, listen_port) == ERR_OK);
+  lpcb = tcp_listen(pcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_accept(lpcb, test_tcp_demux_accept);
+  demux_accepted = NULL;
+
+  /* a SYN creates a SYN_RCVD pcb, the ACK establishes it */
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x200, listen_port, NULL, 0, 0x1000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(tcp_pcb_num.active == 1);
+  EXPECT(tcp_pcb_num.syn_rcvd == 1);
+  tcp_check_pcb_num();
+  pcb = tcp_active_pcbs;
+  EXPECT_RET(pcb != NULL && pcb->state == SYN_RCVD);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(demux_accepted == pcb);
+  EXPECT(tcp_pcb_num.active == 1);
+  EXPECT(tcp_pcb_num.syn_rcvd == 0);
+  tcp_check_pcb_num();
+
+  /* all pcbs active: the next SYN is refused */
+  for (i = 0; i < MEMP_NUM_TCP_PCB - 1; i++) {
+    pcbs[i] = test_tcp_new_counters_pcb(&counters);
+    EXPECT_RET(pcbs[i] != NULL);
+    tcp_set_state(pcbs[i], ESTABLISHED, &local_ip, &remote_ip, 0x101, (u16_t)(0x300 + i));
+  }
+  EXPECT(tcp_pcb_num.active == MEMP_NUM_TCP_PCB);
+  refused = lwip_stats.tcp_pcbs.active.err;
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x201, listen_port, NULL, 0, 0x2000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(tcp_pcb_num.active == MEMP_NUM_TCP_PCB);
+  EXPECT(lwip_stats.tcp_pcbs.active.err == refused + 1);
+  tcp_check_pcb_num();
+
+  /* active -> TIME_WAIT */
+  tcp_abort(pcbs[0]);
+  pcbs[0] = NULL;
+  tcp_check_pcb_num();
+  pcb->flags |= TF_RXCLOSED;
+  pcb->rcv_wnd--; /* unreceived data: tcp_close() moves it to TIME_WAIT */
+  EXPECT(tcp_close(pcb) == ERR_OK);
+  EXPECT(tcp_pcb_num.active == MEMP_NUM_TCP_PCB - 2);
+  EXPECT(tcp_pcb_num.time_wait == 1);
+  tcp_check_pcb_num();
+
+  tcp_close(lpcb);
+  for (i = 0; i < MEMP_NUM_TCP_PCB - 1; i++) {
+    if (pcbs[i] != NULL) {
+      tcp_abort(pcbs[i]);
+    }
+  }
+  tcp_remove_all();
+  tcp_check_pcb_num();
+  EXPECT(tcp_pcb_num.time_wait == 0);
+  netif_remove(&netif);
+}
+END_TEST
+
+#if TCP_SYNCOOKIES
+#if TCP_SYNCOOKIE_THRESHOLD >= MEMP_NUM_TCP_PCB
+#error "test_tcp_syncookie needs TCP_SYNCOOKIE_THRESHOLD < MEMP_NUM_TCP_PCB"
+#endif
+/** Once TCP_SYNCOOKIE_THRESHOLD connections are half-open, SYNs are answered
+ * with a cookie and the pcb is created by the ACK that returns it */
+START_TEST(test_tcp_syncookie)
+{
+  struct tcp_pcb *lpcb, *pcb;
+  struct pbuf* p;
+  char data[] = {1, 2, 3, 4};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t listen_port = 0x102;
+  struct netif netif;
+  STAT_COUNTER cookies;
+  u32_t segs, cookie;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  txcheck.bad_chksum = 0;
+
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_bind(pcb, &local_ip, listen_port) == ERR_OK);
+  lpcb = tcp_listen(pcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_accept(lpcb, test_tcp_demux_accept);
+  demux_accepted = NULL;
+
+  /* up to the threshold, SYNs get a pcb */
+  for (i = 0; i < TCP_SYNCOOKIE_THRESHOLD; i++) {
+    p = tcp_create_segment(&remote_ip, &local_ip, (u16_t)(0x200 + i), listen_port,
+      NULL, 0, 0x1000, 0, TCP_SYN);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+  }
+  EXPECT(tcp_pcb_num.syn_rcvd == TCP_SYNCOOKIE_THRESHOLD);
+
+  /* the next one is answered with a cookie */
+  cookies = lwip_stats.tcp_pcbs.syn_rcvd.err;
+  segs = txcheck.count;
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x280, listen_port, NULL, 0, 0x5000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(tcp_pcb_num.active == TCP_SYNCOOKIE_THRESHOLD);
+  EXPECT(lwip_stats.tcp_pcbs.syn_rcvd.err == cookies + 1);
+  EXPECT(txcheck.count == segs + 1);
+  EXPECT(txcheck_flags == (TCP_SYN | TCP_ACK));
+  EXPECT(txcheck_ackno == 0x5001);
+  cookie = txcheck_seqno;
+
+  /* a wrong cookie is reset */
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x280, listen_port, NULL, 0, 0x5001, cookie + 2, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(tcp_pcb_num.active == TCP_SYNCOOKIE_THRESHOLD);
+  EXPECT(txcheck_flags & TCP_RST);
+
+  /* the right one establishes the connection, including its data */
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x280, listen_port, data, sizeof(data),
+    0x5001, cookie + 1, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(tcp_pcb_num.active == TCP_SYNCOOKIE_THRESHOLD + 1);
+  EXPECT(tcp_pcb_num.syn_rcvd == TCP_SYNCOOKIE_THRESHOLD);
+  pcb = demux_accepted;
+  EXPECT_RET(pcb != NULL);
+  EXPECT(pcb->state == ESTABLISHED);
+  EXPECT(pcb->remote_port == 0x280);
+  EXPECT(pcb->rcv_nxt == 0x5001 + sizeof(data));
+  EXPECT(pcb->lastack == cookie + 1);
+  EXPECT(pcb->snd_nxt == cookie + 1);
+  EXPECT(pcb->snd_buf == TCP_SND_BUF);
+  EXPECT(pcb->mss == LWIP_MIN(536, TCP_MSS));
+  tcp_check_pcb_num();
+
+  /* cookies expire */
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x281, listen_port, NULL, 0, 0x6000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcheck_flags == (TCP_SYN | TCP_ACK));
+  cookie = txcheck_seqno;
+#if LWIP_TCP_TIMERS_MS
+  sys_now_set(sys_now() + 2 * 64000);
+#else /* LWIP_TCP_TIMERS_MS */
+  tcp_ticks += 2 * (64000 / TCP_TICK_MS);
+#endif /* LWIP_TCP_TIMERS_MS */
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x281, listen_port, NULL, 0, 0x6001, cookie + 1, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(tcp_pcb_num.active == TCP_SYNCOOKIE_THRESHOLD + 1);
+  EXPECT(txcheck_flags & TCP_RST);
+  EXPECT(txcheck.bad_chksum == 0);
+
+  tcp_close(lpcb);
+  tcp_remove_all();
+  netif_remove(&netif);
+}
+END_TEST
+#endif /* TCP_SYNCOOKIES */
+
+#if LWIP_WND_SCALE || LWIP_TCP_SACK || LWIP_TCP_TIMESTAMPS
+/** Find TCP option 'kind' in the last segment sent through tcp_txcheck_netif */
+static const u8_t *
+txcheck_opt(u8_t kind)
+{
+  u8_t i = 0;
+
+  while (i < txcheck_optlen) {
+    if (txcheck_opts[i] == kind) {
+      return &txcheck_opts[i];
+    }
+    if (txcheck_opts[i] <= 1) {
+      i++;
+    } else if (txcheck_opts[i + 1] == 0) {
+      break;
+    } else {
+      i = (u8_t)(i + txcheck_opts[i + 1]);
+    }
+  }
+  return NULL;
+}
+#endif /* LWIP_WND_SCALE || LWIP_TCP_SACK || LWIP_TCP_TIMESTAMPS */
+
+#if LWIP_WND_SCALE
+/** The window scale option is negotiated in the handshake and scales the
+ * windows announced in both directions afterwards */
+START_TEST(test_tcp_wnd_scale)
+{
+  /* NOP, window scale with a shift count of 4 */
+  static const u8_t ws_opt[] = {0x01, 0x03, 0x03, 4};
+  struct tcp_pcb *lpcb, *pcb;
+  struct pbuf* p;
+  const u8_t *opt;
+  char data[] = {1, 2, 3, 4};
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t listen_port = 0x102;
+  struct netif netif;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_bind(pcb, &local_ip, listen_port) == ERR_OK);
+  lpcb = tcp_listen(pcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_accept(lpcb, test_tcp_demux_accept);
+  demux_accepted = NULL;
+
+  /* passive open with the option: the SYN|ACK carries it, too */
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x200, listen_port, NULL, 0,
+    0x1000, 0, TCP_SYN, ws_opt, sizeof(ws_opt), 0x1000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  pcb = tcp_active_pcbs;
+  EXPECT_RET(pcb != NULL && pcb->state == SYN_RCVD);
+  EXPECT(pcb->flags & TF_WND_SCALE);
+  EXPECT(pcb->snd_scale == 4);
+  EXPECT(pcb->rcv_scale == TCP_RCV_SCALE);
+  EXPECT(pcb->snd_wnd == 0x1000); /* the window of a SYN is not scaled */
+  EXPECT(pcb->rcv_wnd == TCP_WND);
+  EXPECT(txcheck_flags == (TCP_SYN | TCP_ACK));
+  EXPECT(txcheck_wnd == TCPWND16(TCP_WND));
+  opt = txcheck_opt(3);
+  EXPECT(opt != NULL && opt[1] == 3 && opt[2] == TCP_RCV_SCALE);
+
+  /* from now on, both directions are scaled */
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x200, listen_port, NULL, 0,
+    0x1001, pcb->snd_nxt, TCP_ACK, NULL, 0, 0x100);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(demux_accepted == pcb);
+  EXPECT(pcb->state == ESTABLISHED);
+  EXPECT(pcb->snd_wnd == (0x100 << 4));
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x200, listen_port, data, sizeof(data),
+    0x1001, pcb->snd_nxt, TCP_ACK, NULL, 0, 0x100);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->rcv_nxt == 0x1001 + sizeof(data));
+  tcp_ack_now(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck_flags == TCP_ACK);
+  EXPECT(txcheck_optlen == 0);
+  EXPECT(txcheck_wnd == (u16_t)(pcb->rcv_ann_wnd >> TCP_RCV_SCALE));
+
+  /* passive open without the option: no scaling */
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x201, listen_port, NULL, 0, 0x2000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  pcb = tcp_active_pcbs;
+  EXPECT_RET(pcb != NULL && pcb->remote_port == 0x201);
+  EXPECT(!(pcb->flags & TF_WND_SCALE));
+  EXPECT(pcb->rcv_wnd == TCPWND16(TCP_WND));
+  EXPECT(txcheck_flags == (TCP_SYN | TCP_ACK));
+  EXPECT(txcheck_opt(3) == NULL);
+
+  /* active open: the SYN always offers scaling */
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_connect(pcb, &remote_ip, 0x300, NULL) == ERR_OK);
+  EXPECT(txcheck_flags == TCP_SYN);
+  opt = txcheck_opt(3);
+  EXPECT(opt != NULL && opt[1] == 3 && opt[2] == TCP_RCV_SCALE);
+  EXPECT(!(pcb->flags & TF_WND_SCALE));
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    0x3000, pcb->snd_nxt, TCP_SYN | TCP_ACK, ws_opt, sizeof(ws_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->state == ESTABLISHED);
+  EXPECT(pcb->flags & TF_WND_SCALE);
+  EXPECT(pcb->snd_scale == 4);
+  EXPECT(pcb->snd_wnd == 0x2000);
+  EXPECT(pcb->rcv_wnd == TCP_WND);
+
+  tcp_close(lpcb);
+  tcp_remove_all();
+  netif_remove(&netif);
+}
+END_TEST
+#endif /* LWIP_WND_SCALE */
+
+#if LWIP_TCP_SACK
+/** Read the n-th block of the SACK option in the last segment sent */
+static void
+txcheck_sack_block(const u8_t *opt, u8_t n, u32_t *left, u32_t *right)
+{
+  const u8_t *b = opt + 2 + 8 * n;
+  *left = ((u32_t)b[0] << 24) | ((u32_t)b[1] << 16) | ((u32_t)b[2] << 8) | b[3];
+  *right = ((u32_t)b[4] << 24) | ((u32_t)b[5] << 16) | ((u32_t)b[6] << 8) | b[7];
+}
+
+/** Build a SACK option with the blocks [left, left + len) of 'blocks' */
+static u8_t
+test_sack_opt(u8_t *opt, const u32_t *blocks, u8_t n)
+{
+  u8_t i;
+  opt[0] = 0x01;
+  opt[1] = 0x01;
+  opt[2] = 0x05;
+  opt[3] = (u8_t)(2 + 8 * n);
+  for (i = 0; i < 2 * n; i++) {
+    u32_t v = htonl(blocks[i]);
+    memcpy(&opt[4 + 4 * i], &v, 4);
+  }
+  return (u8_t)(4 + 8 * n);
+}
+
+/** SACK-permitted is negotiated in the handshake, the receiver reports its
+ * out-of-sequence data and the sender only retransmits the holes */
+START_TEST(test_tcp_sack)
+{
+  /* NOP, NOP, SACK-permitted */
+  static const u8_t sackperm_opt[] = {0x01, 0x01, 0x04, 0x02};
+  struct test_tcp_counters counters;
+  struct tcp_pcb *lpcb, *pcb;
+  struct tcp_seg *seg;
+  struct pbuf* p;
+  const u8_t *opt;
+  u8_t data[600];
+  u8_t sack_opt[4 + 8 * 2];
+  u32_t blocks[4], left, right, iss, segs;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t listen_port = 0x102;
+  struct netif netif;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(data); i++) {
+    data[i] = (u8_t)i;
+  }
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+
+  /* passive open: SACK-permitted is only answered if offered */
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_bind(pcb, &local_ip, listen_port) == ERR_OK);
+  lpcb = tcp_listen(pcb);
+  EXPECT_RET(lpcb != NULL);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x200, listen_port, NULL, 0,
+    0x1000, 0, TCP_SYN, sackperm_opt, sizeof(sackperm_opt), 0x1000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  pcb = tcp_active_pcbs;
+  EXPECT_RET(pcb != NULL && pcb->state == SYN_RCVD);
+  EXPECT(pcb->flags & TF_SACK);
+  EXPECT(txcheck_flags == (TCP_SYN | TCP_ACK));
+  opt = txcheck_opt(4);
+  EXPECT(opt != NULL && opt[1] == 2);
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x201, listen_port, NULL, 0, 0x2000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  pcb = tcp_active_pcbs;
+  EXPECT_RET(pcb != NULL && pcb->remote_port == 0x201);
+  EXPECT(!(pcb->flags & TF_SACK));
+  EXPECT(txcheck_opt(4) == NULL);
+  /* active open: the SYN always offers it */
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_connect(pcb, &remote_ip, 0x300, NULL) == ERR_OK);
+  EXPECT(txcheck_flags == TCP_SYN);
+  EXPECT(txcheck_opt(4) != NULL);
+  tcp_close(lpcb);
+  tcp_remove_all();
+
+  /* receiver: out-of-sequence data is reported, the latest block first */
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, 0x101, 0x100);
+  pcb->flags |= TF_SACK;
+  p = tcp_create_rx_segment(pcb, data, 100, 100, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  opt = txcheck_opt(5);
+  EXPECT_RET(opt != NULL && opt[1] == 10);
+  txcheck_sack_block(opt, 0, &left, &right);
+  EXPECT(left == pcb->rcv_nxt + 100 && right == pcb->rcv_nxt + 200);
+  p = tcp_create_rx_segment(pcb, data, 100, 300, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  opt = txcheck_opt(5);
+  EXPECT_RET(opt != NULL && opt[1] == 18);
+  txcheck_sack_block(opt, 0, &left, &right);
+  EXPECT(left == pcb->rcv_nxt + 300 && right == pcb->rcv_nxt + 400);
+  txcheck_sack_block(opt, 1, &left, &right);
+  EXPECT(left == pcb->rcv_nxt + 100 && right == pcb->rcv_nxt + 200);
+  /* filling the gap between them merges the blocks */
+  p = tcp_create_rx_segment(pcb, data, 100, 200, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  opt = txcheck_opt(5);
+  EXPECT_RET(opt != NULL && opt[1] == 10);
+  txcheck_sack_block(opt, 0, &left, &right);
+  EXPECT(left == pcb->rcv_nxt + 100 && right == pcb->rcv_nxt + 400);
+  /* in sequence again: no more SACK option */
+  p = tcp_create_rx_segment(pcb, data, 100, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(counters.recved_bytes == 400);
+  EXPECT(pcb->ooseq == NULL);
+  tcp_ack_now(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck_opt(5) == NULL);
+  tcp_abort(pcb);
+
+  /* sender: 6 segments, the 1st and 3rd are lost */
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, 0x101, 0x100);
+  pcb->flags |= TF_SACK;
+  pcb->mss = 100;
+  pcb->snd_wnd = TCP_WND;
+  pcb->cwnd = TCP_WND;
+  pcb->snd_wl1 = pcb->rcv_nxt;
+  pcb->snd_wl2 = pcb->lastack;
+  iss = pcb->snd_nxt;
+  txcheck.count = 0;
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == 6);
+
+  /* three duplicate ACKs reporting segments 2, 4, 5 and 6 */
+  blocks[0] = iss + 100;
+  blocks[1] = iss + 200;
+  blocks[2] = iss + 300;
+  blocks[3] = iss + 400;
+  for (i = 0; i < 3; i++) {
+    u8_t n = (i == 0) ? 1 : 2;
+    if (i == 2) {
+      blocks[3] = iss + 600;
+    }
+    p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+      pcb->rcv_nxt, iss, TCP_ACK, sack_opt, test_sack_opt(sack_opt, blocks, n), TCP_WND);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+  }
+  EXPECT(pcb->flags & TF_INFR);
+  /* fast retransmit sends both holes, nothing else */
+  EXPECT(txcheck.count == 8);
+  EXPECT(txcheck_seqno == iss + 200);
+  i = 0;
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      i++;
+    }
+  }
+  EXPECT(i == 4);
+  /* an RTO also skips the SACKed segments */
+  tcp_rexmit_rto(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == 10);
+  EXPECT(txcheck_seqno == iss + 200);
+
+  /* the cumulative ACK frees everything */
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 600, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(pcb->unsent == NULL);
+  EXPECT(txcheck.count == 10);
+  tcp_abort(pcb);
+
+  /* an ACK of new data that SACKs segments above a hole (reordering)
+     retransmits nothing outside of fast recovery */
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, 0x101, 0x100);
+  pcb->flags |= TF_SACK;
+  pcb->mss = 100;
+  pcb->snd_wnd = TCP_WND;
+  pcb->cwnd = TCP_WND;
+  pcb->snd_wl1 = pcb->rcv_nxt;
+  pcb->snd_wl2 = pcb->lastack;
+  iss = pcb->snd_nxt;
+  segs = txcheck.count;
+  EXPECT(tcp_write(pcb, data, 500, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == segs + 5);
+  segs = txcheck.count;
+  left = pcb->ssthresh;
+  blocks[0] = iss + 200;
+  blocks[1] = iss + 500;
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 100, TCP_ACK, sack_opt, test_sack_opt(sack_opt, blocks, 1), TCP_WND);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcheck.count == segs);
+  EXPECT(!(pcb->flags & TF_INFR));
+  EXPECT(pcb->ssthresh == left);
+  EXPECT(pcb->unsent == NULL);
+  /* the reordered segment arrives */
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 500, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(txcheck.count == segs);
+
+  tcp_abort(pcb);
+  netif_remove(&netif);
+}
+END_TEST
+#endif /* LWIP_TCP_SACK */
+
+#if LWIP_TCP_CC
+/** An established sender with 100 byte segments and a large window */
+static struct tcp_pcb *
+cc_new_sender(struct test_tcp_counters *counters, ip_addr_t *local_ip,
+              ip_addr_t *remote_ip, const struct tcp_cc_ops *ops)
+{
+  struct tcp_pcb *pcb;
+
+  memset(counters, 0, sizeof(*counters));
+  pcb = test_tcp_new_counters_pcb(counters);
+  if (pcb != NULL) {
+    tcp_set_state(pcb, ESTABLISHED, local_ip, remote_ip, 0x101, 0x100);
+    pcb->mss = 100;
+    pcb->snd_wnd = TCP_WND;
+    pcb->snd_wl1 = pcb->rcv_nxt;
+    pcb->snd_wl2 = pcb->lastack;
+    pcb->recover = pcb->lastack;
+    pcb->cwnd = 1000;
+    pcb->ssthresh = (tcpwnd_size_t)~0;
+    fail_unless(tcp_set_cc(pcb, ops) == ERR_OK);
+  }
+  return pcb;
+}
+
+/** Send an ACK without data from the peer of 'pcb' */
+static void
+cc_ack(struct tcp_pcb *pcb, struct netif *netif, u32_t ackno)
+{
+  struct pbuf *p = tcp_create_segment(&pcb->remote_ip, &pcb->local_ip,
+    pcb->remote_port, pcb->local_port, NULL, 0, pcb->rcv_nxt, ackno, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, netif);
+}
+
+START_TEST(test_tcp_cc)
+{
+  struct test_tcp_counters counters;
+  struct tcp_pcb *lpcb, *pcb;
+  struct pbuf *p;
+  u8_t data[600];
+  u32_t iss;
+  ip_addr_t remote_ip, local_ip, netmask;
+  u16_t listen_port = 0x102;
+  struct netif netif;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(data, 0x5a, sizeof(data));
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+
+  /* selection: by name, inherited from the listening pcb */
+  EXPECT(tcp_cc_find("newreno") == &tcp_cc_newreno);
+  EXPECT(tcp_cc_find("cubic") == &tcp_cc_cubic);
+  EXPECT(tcp_cc_find("lowmem") == &tcp_cc_lowmem);
+  EXPECT(tcp_cc_find("vegas") == NULL);
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(pcb->cc_ops == TCP_CC_DEFAULT);
+  EXPECT(tcp_set_cc(pcb, &tcp_cc_cubic) == ERR_OK);
+  EXPECT(tcp_bind(pcb, &local_ip, listen_port) == ERR_OK);
+  lpcb = tcp_listen(pcb);
+  EXPECT_RET(lpcb != NULL);
+  tcp_accept(lpcb, test_tcp_demux_accept);
+  demux_accepted = NULL;
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x200, listen_port, NULL, 0,
+    0x1000, 0, TCP_SYN);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  pcb = tcp_active_pcbs;
+  EXPECT_RET(pcb != NULL && pcb->state == SYN_RCVD);
+  EXPECT(pcb->cc_ops == &tcp_cc_cubic);
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x200, listen_port, NULL, 0,
+    0x1001, txcheck_seqno + 1, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(demux_accepted == pcb);
+  EXPECT_RET(pcb->state == ESTABLISHED);
+  /* slow start until the first loss */
+  EXPECT(pcb->ssthresh == (tcpwnd_size_t)~0);
+  EXPECT(pcb->recover == pcb->lastack);
+  tcp_close(lpcb);
+  tcp_remove_all();
+
+  /* NewReno: the 1st and 3rd of 6 segments are lost */
+  pcb = cc_new_sender(&counters, &local_ip, &remote_ip, &tcp_cc_newreno);
+  EXPECT_RET(pcb != NULL);
+  iss = pcb->snd_nxt;
+  txcheck.count = 0;
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == 6);
+  for (i = 0; i < 3; i++) {
+    cc_ack(pcb, &netif, iss);
+  }
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(txcheck.count == 7 && txcheck_seqno == iss);
+  EXPECT(pcb->recover == iss + 600);
+  /* half of the data in flight, inflated by the 3 dupacks */
+  EXPECT(pcb->ssthresh == 300);
+  EXPECT(pcb->cwnd == 600);
+  /* partial ACK: still in recovery, the next hole is resent at once */
+  cc_ack(pcb, &netif, iss + 200);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(txcheck.count == 8 && txcheck_seqno == iss + 200);
+  EXPECT(pcb->cwnd == 600 - 200 + 100);
+  /* full ACK: leave recovery with no more than ssthresh */
+  cc_ack(pcb, &netif, iss + 600);
+  EXPECT(!(pcb->flags & TF_INFR));
+  EXPECT(pcb->cwnd == 200);
+  EXPECT(pcb->unacked == NULL);
+
+  /* RTO: loss window, no fast retransmit for the data sent before it */
+  EXPECT(tcp_write(pcb, data, 400, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  pcb->cwnd = 400;
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == 12);
+  test_tcp_expire_rtimer(pcb);
+  tcp_slowtmr();
+  EXPECT(pcb->cwnd == 100);
+  EXPECT(pcb->ssthresh == 200);
+  EXPECT(pcb->recover == iss + 1000);
+  for (i = 0; i < 3; i++) {
+    cc_ack(pcb, &netif, iss + 600);
+  }
+  EXPECT(!(pcb->flags & TF_INFR));
+  EXPECT(pcb->ssthresh == 200);
+  cc_ack(pcb, &netif, iss + 1000);
+  EXPECT(pcb->unacked == NULL && pcb->unsent == NULL);
+
+  /* idle for more than an RTO: restart with the initial window */
+  pcb->cwnd = 1000;
+  pcb->tmr = tcp_ticks - pcb->rto - 1;
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  txcheck.count = 0;
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(pcb->cwnd == 400);
+  EXPECT(txcheck.count == 4);
+  tcp_abort(pcb);
+
+  /* congestion avoidance: one segment per window acked */
+  pcb = cc_new_sender(&counters, &local_ip, &remote_ip, &tcp_cc_newreno);
+  EXPECT_RET(pcb != NULL);
+  iss = pcb->snd_nxt;
+  pcb->ssthresh = 500;
+  pcb->cwnd = 500;
+  EXPECT(tcp_write(pcb, data, 500, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  for (i = 1; i <= 4; i++) {
+    cc_ack(pcb, &netif, iss + i * 100);
+    EXPECT(pcb->cwnd == 500);
+  }
+  cc_ack(pcb, &netif, iss + 500);
+  EXPECT(pcb->cwnd == 600);
+  tcp_abort(pcb);
+
+  /* CUBIC: beta 0.7 and fast convergence */
+  pcb = cc_new_sender(&counters, &local_ip, &remote_ip, &tcp_cc_cubic);
+  EXPECT_RET(pcb != NULL);
+  pcb->cwnd = 10000;
+  pcb->cc_ops->on_loss(pcb);
+  EXPECT(pcb->ssthresh == 7000);
+  EXPECT(pcb->cwnd == 7300);
+  /* lost again before getting back to the old maximum */
+  pcb->cwnd = 8000;
+  pcb->cc_ops->on_rto(pcb);
+  EXPECT(pcb->ssthresh == 5600);
+  EXPECT(pcb->cwnd == 100);
+  /* slow start below ssthresh, the cubic curve above it never shrinks cwnd */
+  pcb->cc_ops->on_ack(pcb, 100);
+  EXPECT(pcb->cwnd == 200);
+  pcb->cwnd = pcb->ssthresh;
+  for (i = 0; i < 100; i++) {
+    pcb->cc_ops->on_ack(pcb, 100);
+  }
+  EXPECT(pcb->cwnd >= 5600 && pcb->cwnd <= 5600 + 2800);
+  tcp_abort(pcb);
+
+  /* lowmem: cwnd stays within TCP_SND_BUF, decrease from the flight size */
+  pcb = cc_new_sender(&counters, &local_ip, &remote_ip, &tcp_cc_lowmem);
+  EXPECT_RET(pcb != NULL);
+  EXPECT(pcb->cwnd == 200);
+  EXPECT(pcb->ssthresh == TCP_SND_BUF);
+  pcb->cwnd = TCP_SND_BUF;
+  pcb->ssthresh = TCP_WND;
+  pcb->cc_ops->on_ack(pcb, 100);
+  EXPECT(pcb->cwnd == TCP_SND_BUF);
+  pcb->snd_nxt = pcb->lastack + 1000;
+  pcb->cc_ops->on_loss(pcb);
+  EXPECT(pcb->ssthresh == 500);
+  EXPECT(pcb->cwnd == 600);
+  pcb->snd_nxt = pcb->lastack;
+  tcp_abort(pcb);
+
+  netif_remove(&netif);
+}
+END_TEST
+#endif /* LWIP_TCP_CC */
+
+#if LWIP_TCP_TIMESTAMPS
+/** Build a timestamp option, padded with two NOPs */
+static u8_t
+test_ts_opt(u8_t *opt, u32_t tsval, u32_t tsecr)
+{
+  opt[0] = 0x01;
+  opt[1] = 0x01;
+  opt[2] = 0x08;
+  opt[3] = 0x0A;
+  tsval = htonl(tsval);
+  tsecr = htonl(tsecr);
+  memcpy(&opt[4], &tsval, 4);
+  memcpy(&opt[8], &tsecr, 4);
+  return 12;
+}
+
+/** Read TSval (n = 0) or TSecr (n = 1) of the last segment sent */
+static u32_t
+txcheck_ts(u8_t n)
+{
+  const u8_t *opt = txcheck_opt(8);
+  u32_t v;
+  if (opt == NULL) {
+    return 0;
+  }
+  memcpy(&v, &opt[2 + 4 * n], 4);
+  return ntohl(v);
+}
+
+/** Timestamps are negotiated in the handshake, every ACK of new data is an
+ * RTT measurement (also for a retransmission) and PAWS drops segments with
+ * an old timestamp, but only segments covering the last ACK sent update
+ * the timestamp to echo */
+START_TEST(test_tcp_timestamps)
+{
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  u8_t ts_opt[12];
+  u8_t data[200];
+  u32_t now, iss, rcv_nxt;
+  s32_t sa;
+#if LWIP_TCP_SACK
+  u8_t opts[sizeof(ts_opt) + 12];
+  u32_t blocks[2];
+  u8_t optlen;
+#endif /* LWIP_TCP_SACK */
+  ip_addr_t remote_ip, local_ip, netmask;
+  struct netif netif;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(data, 0x5a, sizeof(data));
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  now = sys_now() + 1000;
+  sys_now_set(now);
+
+  /* active open: the SYN offers timestamps, the SYN|ACK is a measurement */
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_connect(pcb, &remote_ip, 0x300, NULL) == ERR_OK);
+  EXPECT(txcheck_flags == TCP_SYN);
+  EXPECT(txcheck_opt(8) != NULL);
+  EXPECT(txcheck_ts(0) == now);
+  sys_now_set(now + 40);
+  test_ts_opt(ts_opt, 0x100, now);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    0x3000, pcb->snd_nxt, TCP_SYN | TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(pcb->state == ESTABLISHED);
+  EXPECT(pcb->flags & TF_TIMESTAMP);
+  EXPECT(pcb->ts_recent == 0x100);
+  EXPECT(tcp_srtt(pcb) == 40);
+  EXPECT(tcp_rttvar(pcb) == 20);
+  EXPECT(txcheck_flags == TCP_ACK);
+  EXPECT(txcheck_ts(1) == 0x100);
+
+  /* an ACK of new data is a measurement */
+  iss = pcb->snd_nxt;
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck_ts(0) == now + 40);
+  sys_now_set(now + 60);
+  test_ts_opt(ts_opt, 0x101, now + 40);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    0x3001, iss + sizeof(data), TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(tcp_srtt(pcb) == 37);
+  EXPECT(tcp_rttvar(pcb) == 20);
+
+  /* so is the ACK of a retransmission: the echo tells which copy arrived */
+  iss = pcb->snd_nxt;
+  EXPECT(tcp_write(pcb, data, 100, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  sys_now_set(now + 3000);
+  test_tcp_expire_rtimer(pcb);
+  tcp_slowtmr();
+  EXPECT(pcb->nrtx == 1);
+  EXPECT(txcheck_seqno == iss);
+  EXPECT(txcheck_ts(0) == now + 3000);
+  sys_now_set(now + 3030);
+  test_ts_opt(ts_opt, 0x102, now + 3000);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    0x3001, iss + 100, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(tcp_srtt(pcb) == 36);
+  EXPECT(tcp_rttvar(pcb) == 16);
+  EXPECT(pcb->ts_recent == 0x102);
+
+  /* with two ACKs per round-trip, each moves the estimate by half of its
+     error, and the halves of an error of 1 ms add up */
+  pcb->mss = 50 + 12; /* 50 bytes of data and the timestamp option */
+  pcb->cwnd = 4 * pcb->mss;
+  tcp_nagle_disable(pcb);
+  iss = pcb->snd_nxt;
+  EXPECT(tcp_write(pcb, data, 200, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(pcb->snd_nxt == iss + 200);
+  sa = pcb->sa;
+  sys_now_set(now + 3030 + tcp_srtt(pcb) + 1);
+  test_ts_opt(ts_opt, 0x102, now + 3030);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    0x3001, iss + 50, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->sa == sa);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    0x3001, iss + 100, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->sa == sa + 1);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    0x3001, iss + 200, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+
+  /* PAWS: an old timestamp is dropped and answered with an ACK */
+  rcv_nxt = pcb->rcv_nxt;
+  txcheck.count = 0;
+  test_ts_opt(ts_opt, 0x50, now + 3000);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, data, 10,
+    rcv_nxt, pcb->snd_nxt, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->rcv_nxt == rcv_nxt);
+  EXPECT(txcheck.count == 1 && txcheck_flags == TCP_ACK && txcheck_ackno == rcv_nxt);
+  EXPECT(pcb->ts_recent == 0x102);
+  test_ts_opt(ts_opt, 0x103, now + 3000);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, data, 10,
+    rcv_nxt, pcb->snd_nxt, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->rcv_nxt == rcv_nxt + 10);
+  EXPECT(pcb->ts_recent == 0x103);
+  /* ... unless the last one is too old to compare with */
+  tcp_ack_now(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  sys_now_set(sys_now() + TCP_PAWS_IDLE);
+  test_ts_opt(ts_opt, 0x50, now + 3000);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, data, 10,
+    rcv_nxt + 10, pcb->snd_nxt, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->rcv_nxt == rcv_nxt + 20);
+  EXPECT(pcb->ts_recent == 0x50);
+  /* an old duplicate does not update the timestamp to echo, so it cannot
+     make PAWS drop the data that follows */
+  tcp_ack_now(pcb);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  test_ts_opt(ts_opt, 0x7000, now + 3000);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, data, 10,
+    rcv_nxt + 10, pcb->snd_nxt, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->rcv_nxt == rcv_nxt + 20);
+  EXPECT(pcb->ts_recent == 0x50);
+  test_ts_opt(ts_opt, 0x51, now + 3000);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, data, 10,
+    rcv_nxt + 20, pcb->snd_nxt, TCP_ACK, ts_opt, sizeof(ts_opt), 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->rcv_nxt == rcv_nxt + 30);
+  EXPECT(pcb->ts_recent == 0x51);
+#if LWIP_TCP_SACK
+  /* nor do the SACK blocks of a segment PAWS drops count */
+  pcb->flags |= TF_SACK;
+  iss = pcb->snd_nxt;
+  EXPECT(tcp_write(pcb, data, 100, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT_RET(pcb->unacked != NULL && pcb->unacked->next != NULL);
+  blocks[0] = iss + 50;
+  blocks[1] = iss + 100;
+  test_ts_opt(opts, 0x40, now + 3000);
+  optlen = test_sack_opt(&opts[sizeof(ts_opt)], blocks, 1);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    rcv_nxt + 30, iss, TCP_ACK, opts, sizeof(ts_opt) + optlen, 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(!(pcb->unacked->next->flags & TF_SEG_SACKED));
+  test_ts_opt(opts, 0x52, now + 3000);
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x300, pcb->local_port, NULL, 0,
+    rcv_nxt + 30, iss, TCP_ACK, opts, sizeof(ts_opt) + optlen, 0x2000);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked->next->flags & TF_SEG_SACKED);
+#endif /* LWIP_TCP_SACK */
+  tcp_abort(pcb);
+
+  /* no timestamps in the SYN|ACK: none are sent afterwards */
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_connect(pcb, &remote_ip, 0x301, NULL) == ERR_OK);
+  EXPECT(txcheck_opt(8) != NULL);
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x301, pcb->local_port, NULL, 0,
+    0x4000, pcb->snd_nxt, TCP_SYN | TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->state == ESTABLISHED);
+  EXPECT(!(pcb->flags & TF_TIMESTAMP));
+  EXPECT(txcheck_flags == TCP_ACK);
+  EXPECT(txcheck_opt(8) == NULL);
+  tcp_abort(pcb);
+
+  tcp_remove_all();
+  netif_remove(&netif);
+}
+END_TEST
+#endif /* LWIP_TCP_TIMESTAMPS */
+
+#if LWIP_TCP_TIMERS_MS
+/** With millisecond timers the RTO follows a short RTT down to TCP_RTO_MIN
+ * and a long one up to TCP_RTO_MAX, delayed ACKs wait TCP_ACK_DELAY and the
+ * TCP timer is only needed while one of them is armed */
+START_TEST(test_tcp_timers_ms)
+{
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  u8_t data[100];
+  u32_t now, iss, segs;
+  ip_addr_t remote_ip, local_ip, netmask;
+  struct netif netif;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(data, 0x5a, sizeof(data));
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  now = sys_now() + 1000;
+  sys_now_set(now);
+
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data = (char*)data;
+  counters.expected_data_len = sizeof(data);
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, 0x101, 0x100);
+  pcb->snd_wnd = TCP_WND;
+  pcb->snd_wl1 = pcb->rcv_nxt;
+  pcb->snd_wl2 = pcb->lastack;
+  pcb->cwnd = TCP_WND;
+  /* an idle connection needs no timer */
+  EXPECT(tcp_next_timeout() == TCP_TMR_NONE);
+
+  /* a 5 ms round-trip gives the minimum RTO */
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(tcp_next_timeout() == 3000);
+  now += 5;
+  sys_now_set(now);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(tcp_srtt(pcb) == 5);
+  EXPECT(pcb->rto == TCP_RTO_MIN);
+  EXPECT(tcp_next_timeout() == TCP_TMR_NONE);
+
+  /* the retransmission is sent one RTO later to the millisecond */
+  iss = pcb->snd_nxt;
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(tcp_next_timeout() == TCP_RTO_MIN);
+  segs = txcheck.count;
+  sys_now_set(now + TCP_RTO_MIN - 1);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs);
+  now += TCP_RTO_MIN;
+  sys_now_set(now);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs + 1 && txcheck_seqno == iss);
+  EXPECT(pcb->nrtx == 1);
+  EXPECT(pcb->rto == 2 * TCP_RTO_MIN);
+  EXPECT(tcp_next_timeout() == 2 * TCP_RTO_MIN);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(tcp_next_timeout() == TCP_TMR_NONE);
+
+  /* received data is acknowledged TCP_ACK_DELAY later */
+  segs = txcheck.count;
+  p = tcp_create_rx_segment(pcb, data, 10, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(counters.recved_bytes == 10);
+  EXPECT(txcheck.count == segs);
+  EXPECT(tcp_next_timeout() == TCP_ACK_DELAY);
+  sys_now_set(now + TCP_ACK_DELAY - 1);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs);
+  now += TCP_ACK_DELAY;
+  sys_now_set(now);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs + 1);
+  EXPECT(txcheck_flags == TCP_ACK && txcheck_ackno == pcb->rcv_nxt);
+  EXPECT(tcp_next_timeout() == TCP_TMR_NONE);
+
+  /* a zero window starts the persist timer */
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, pcb->snd_nxt, TCP_ACK, NULL, 0, 0);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->snd_wnd == 0);
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(pcb->persist_backoff == 1);
+  segs = txcheck.count;
+  sys_now_set(now + 3 * TCP_SLOW_INTERVAL - 1);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs);
+  sys_now_set(now + 3 * TCP_SLOW_INTERVAL);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs + 1);
+  EXPECT(pcb->persist_backoff == 2);
+  tcp_abort(pcb);
+
+  /* a round-trip longer than 32 s is measured, not wrapped */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, 0x101, 0x100);
+  pcb->snd_wnd = TCP_WND;
+  pcb->cwnd = TCP_WND;
+  pcb->rto = TCP_RTO_MAX;
+  now = sys_now();
+  EXPECT(tcp_write(pcb, data, sizeof(data), TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  now += 40000;
+  sys_now_set(now);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(tcp_srtt(pcb) == 40000);
+  EXPECT(pcb->rto == TCP_RTO_MAX);
+  tcp_abort(pcb);
+
+  tcp_remove_all();
+  netif_remove(&netif);
+}
+END_TEST
+#endif /* LWIP_TCP_TIMERS_MS */
+
+#if LWIP_TCP_RACK
+/** A lost tail is drawn out by a probe after two round-trips instead of
+ * the RTO, and segments are resent once one sent after them has been
+ * SACKed and the reordering window has passed */
+START_TEST(test_tcp_rack)
+{
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  u8_t data[400];
+  u8_t sack_opt[4 + 8];
+  u32_t blocks[2];
+  u32_t now, iss, segs;
+  ip_addr_t remote_ip, local_ip, netmask;
+  struct netif netif;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(data, 0x5a, sizeof(data));
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  now = sys_now() + 1000;
+  sys_now_set(now);
+
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, 0x101, 0x100);
+  pcb->flags |= TF_SACK;
+  pcb->mss = 100;
+  pcb->snd_wnd = TCP_WND;
+  pcb->snd_wl1 = pcb->rcv_nxt;
+  pcb->snd_wl2 = pcb->lastack;
+  pcb->cwnd = TCP_WND;
+
+  /* no probe before there is an RTT estimate: 10 ms */
+  EXPECT(tcp_write(pcb, data, 100, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(!(pcb->flags & TF_TLP_PTO));
+  now += 10;
+  sys_now_set(now);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(tcp_srtt(pcb) == 10);
+  EXPECT(pcb->rto == TCP_RTO_MIN);
+
+  /* 3 segments, the last 2 are lost: the probe timeout of 2 * SRTT is
+     restarted by the ACK for the 1st one */
+  iss = pcb->snd_nxt;
+  EXPECT(tcp_write(pcb, data, 300, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(pcb->flags & TF_TLP_PTO);
+  EXPECT(tcp_next_timeout() == 20);
+  now += 10;
+  sys_now_set(now);
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 100, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(tcp_next_timeout() == 20);
+  segs = txcheck.count;
+  sys_now_set(now + 19);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs);
+  now += 20;
+  sys_now_set(now);
+  tcp_tmr();
+  /* the probe resends the last segment and restarts the RTO */
+  EXPECT(txcheck.count == segs + 1 && txcheck_seqno == iss + 200);
+  EXPECT(pcb->flags & TF_TLP_SENT);
+  EXPECT(pcb->nrtx == 0);
+  EXPECT(tcp_next_timeout() == TCP_RTO_MIN);
+
+  /* its SACK shows the 2nd segment lost: resent right away */
+  now += 10;
+  sys_now_set(now);
+  blocks[0] = iss + 200;
+  blocks[1] = iss + 300;
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 100, TCP_ACK, sack_opt, test_sack_opt(sack_opt, blocks, 1), TCP_WND);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcheck.count == segs + 2 && txcheck_seqno == iss + 100);
+  EXPECT(pcb->flags & TF_INFR);
+  now += 10;
+  sys_now_set(now);
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 300, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL && pcb->unsent == NULL);
+  EXPECT(!(pcb->flags & (TF_INFR | TF_TLP_SENT | TF_TLP_PTO)));
+  EXPECT(tcp_next_timeout() == TCP_TMR_NONE);
+
+  /* 4 segments, only the last one arrives: the others are resent when
+     the reordering window of min_rtt / 4 has passed */
+  pcb->cwnd = TCP_WND;
+  iss = pcb->snd_nxt;
+  segs = txcheck.count;
+  EXPECT(tcp_write(pcb, data, 400, TCP_WRITE_FLAG_COPY) == ERR_OK);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == segs + 4);
+  segs = txcheck.count;
+  now += 10;
+  sys_now_set(now);
+  blocks[0] = iss + 300;
+  blocks[1] = iss + 400;
+  p = tcp_create_segment_opts(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss, TCP_ACK, sack_opt, test_sack_opt(sack_opt, blocks, 1), TCP_WND);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcheck.count == segs);
+  EXPECT(pcb->flags & TF_RACK_REO);
+  EXPECT(tcp_next_timeout() == 2);
+  sys_now_set(now + 1);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs);
+  now += 2;
+  sys_now_set(now);
+  tcp_tmr();
+  EXPECT(txcheck.count == segs + 3 && txcheck_seqno == iss + 200);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(!(pcb->flags & TF_RACK_REO));
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 400, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL && pcb->unsent == NULL);
+  EXPECT(txcheck.bad_chksum == 0);
+  tcp_abort(pcb);
+
+  tcp_remove_all();
+  netif_remove(&netif);
+}
+END_TEST
+#endif /* LWIP_TCP_RACK */
+
+#if LWIP_TCP_WRITEV
+static struct tcp_iovec *writev_done[4];
+static u8_t writev_done_cnt;
+
+static void
+test_tcp_writev_done(void *arg, struct tcp_iovec *iov)
+{
+  EXPECT(arg == &writev_done_cnt);
+  EXPECT_RET(writev_done_cnt < sizeof(writev_done)/sizeof(writev_done[0]));
+  writev_done[writev_done_cnt++] = iov;
+}
+
+/** Buffers queued with tcp_writev() are sent from where they are and
+ * completed once the segments holding them are acknowledged */
+START_TEST(test_tcp_writev)
+{
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcb;
+  struct pbuf *p;
+  struct tcp_iovec iov[3];
+  u8_t data[300];
+  u8_t queued, i;
+  u32_t iss, segs;
+  ip_addr_t remote_ip, local_ip, netmask;
+  struct netif netif;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < 3; i++) {
+    memset(data + 100 * i, 0x11 * (i + 1), 100);
+  }
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  writev_done_cnt = 0;
+
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &local_ip, &remote_ip, 0x101, 0x100);
+  pcb->mss = 100;
+  pcb->snd_wnd = TCP_WND;
+  pcb->snd_wl1 = pcb->rcv_nxt;
+  pcb->snd_wl2 = pcb->lastack;
+  pcb->cwnd = TCP_WND;
+
+  /* 150 + 50 + 100 bytes: the 2nd buffer shares a segment with the 1st */
+  memset(iov, 0, sizeof(iov));
+  for (i = 0; i < 3; i++) {
+    iov[i].done = test_tcp_writev_done;
+    iov[i].arg = &writev_done_cnt;
+  }
+  iov[0].base = data;
+  iov[0].len = 150;
+  iov[1].base = data + 150;
+  iov[1].len = 50;
+  iov[2].base = data + 200;
+  iov[2].len = 100;
+  iss = pcb->snd_nxt;
+  segs = txcheck.count;
+  EXPECT(tcp_writev(pcb, iov, 3, 0, &queued) == ERR_OK);
+  EXPECT(queued == 3);
+  EXPECT(pcb->unsent != NULL && pcb->unsent->p->next != NULL);
+  EXPECT(pcb->unsent->p->next->payload == data);
+  EXPECT(tcp_output(pcb) == ERR_OK);
+  EXPECT(txcheck.count == segs + 3);
+  EXPECT(txcheck.bad_chksum == 0);
+  EXPECT(writev_done_cnt == 0);
+
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 100, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(writev_done_cnt == 0);
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 200, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(writev_done_cnt == 2);
+  EXPECT(writev_done[0] == &iov[0] && writev_done[1] == &iov[1]);
+  p = tcp_create_segment(&remote_ip, &local_ip, 0x100, 0x101, NULL, 0,
+    pcb->rcv_nxt, iss + 300, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(writev_done_cnt == 3 && writev_done[2] == &iov[2]);
+  EXPECT(pcb->unacked == NULL);
+
+  /* copied buffers are completed at once */
+  writev_done_cnt = 0;
+  EXPECT(tcp_writev(pcb, iov, 1, TCP_WRITE_FLAG_COPY, NULL) == ERR_OK);
+  EXPECT(writev_done_cnt == 1);
+
+  /* buffers are queued whole or not at all; aborting completes the
+     queued ones */
+  writev_done_cnt = 0;
+  iov[0].len = 100;
+  iov[1].base = data + 100;
+  iov[1].len = 100;
+  pcb->snd_buf = 150;
+  EXPECT(tcp_writev(pcb, iov, 2, 0, &queued) == ERR_MEM);
+  EXPECT(queued == 1 && iov[1].refs == 0);
+  EXPECT(writev_done_cnt == 0);
+  tcp_abort(pcb);
+  EXPECT(writev_done_cnt == 1 && writev_done[0] == &iov[0]);
+
+  tcp_remove_all();
+  netif_remove(&netif);
+}
+END_TEST
+#endif /* LWIP_TCP_WRITEV */
+
 
 /** Create the suite including all tests for this module */
 Suite *
@@ -99,6 +1696,33 @@ tcp_suite(void)
   TFun tests[] = {
     test_tcp_new_abort,
     test_tcp_recv_inseq,
+    test_tcp_rexmit_chksum,
+    test_tcp_demux,
+    test_tcp_pcb_num,
+#if TCP_SYNCOOKIES
+    test_tcp_syncookie,
+#endif /* TCP_SYNCOOKIES */
+#if LWIP_WND_SCALE
+    test_tcp_wnd_scale,
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+    test_tcp_sack,
+#endif /* LWIP_TCP_SACK */
+#if LWIP_TCP_CC
+    test_tcp_cc,
+#endif /* LWIP_TCP_CC */
+#if LWIP_TCP_TIMESTAMPS
+    test_tcp_timestamps,
+#endif /* LWIP_TCP_TIMESTAMPS */
+#if LWIP_TCP_TIMERS_MS
+    test_tcp_timers_ms,
+#endif /* LWIP_TCP_TIMERS_MS */
+#if LWIP_TCP_RACK
+    test_tcp_rack,
+#endif /* LWIP_TCP_RACK */
+#if LWIP_TCP_WRITEV
+    test_tcp_writev,
+#endif /* LWIP_TCP_WRITEV */
   };
   return create_suite("TCP", tests, sizeof(tests)/sizeof(TFun), tcp_setup, tcp_teardown);
 }
@@ -0,0 +1,28 @@
+#ifndef __TXCHECK_HELPER_H__
+#define __TXCHECK_HELPER_H__
+
+#include "lwip_check.h"
+#include "lwip/netif.h"
+#include "lwip/tcp_impl.h"
+#include "lwip/udp.h"
+
+/** What the netifs set up by txcheck_netif_init() have sent */
+struct txcheck_stats {
+  /** IP packets sent */
+  u32_t count;
+  /** packets whose TCP/UDP checksum did not verify */
+  u32_t bad_chksum;
+  /** transport header (with options) of the last packet */
+  union {
+    u8_t bytes[60];
+    struct tcp_hdr tcp;
+    struct udp_hdr udp;
+  } hdr;
+  u16_t hdr_len;
+};
+
+extern struct txcheck_stats txcheck;
+
+err_t txcheck_netif_init(struct netif *netif);
+
+#endif
@@ -2,6 +2,9 @@
 
 #include "lwip/udp.h"
 #include "lwip/stats.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip.h"
+#include "../txcheck_helper.h"
 
 #if !LWIP_STATS || !UDP_STATS || !MEMP_STATS
 #error "This tests needs UDP- and MEMP-statistics enabled"
@@ -56,6 +59,264 @@ START_TEST(test_udp_new_remove)
 }
 END_TEST
 
+/** A checksum computed while copying the payload gives the same datagram
+ * as summing it in udp_sendto() */
+START_TEST(test_udp_chksum_on_copy)
+{
+  struct udp_pcb* pcb;
+  struct pbuf* p;
+  struct netif netif;
+  ip_addr_t local_ip, remote_ip, netmask;
+  u8_t data[301];
+  u16_t len, chksum, ref;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(data); i++) {
+    data[i] = (u8_t)(i * 7);
+  }
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  txcheck.count = 0;
+  txcheck.bad_chksum = 0;
+
+  pcb = udp_new();
+  EXPECT_RET(pcb != NULL);
+  fail_unless(udp_bind(pcb, &local_ip, 0x123) == ERR_OK);
+
+  for (len = 0; len <= sizeof(data); len += 75) {
+    /* checksum over the payload by udp_sendto() */
+    p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    EXPECT_RET(p != NULL);
+    MEMCPY(p->payload, data, len);
+    fail_unless(udp_sendto(pcb, p, &remote_ip, 0x456) == ERR_OK);
+    pbuf_free(p);
+    ref = txcheck.hdr.udp.chksum;
+
+    /* checksum on copy */
+    p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    EXPECT_RET(p != NULL);
+    chksum = LWIP_CHKSUM_COPY(p->payload, data, len);
+    fail_unless(udp_sendto_chksum(pcb, p, &remote_ip, 0x456, 1, chksum) == ERR_OK);
+    pbuf_free(p);
+    fail_unless(txcheck.hdr.udp.chksum == ref);
+  }
+  fail_unless(txcheck.count == 2 * (sizeof(data) / 75 + 1));
+  fail_unless(txcheck.bad_chksum == 0);
+
+  udp_remove(pcb);
+  netif_remove(&netif);
+}
+END_TEST
+
+
+static u32_t rxcheck_count;
+
+static void
+udp_rxcheck_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  rxcheck_count++;
+  pbuf_free(p);
+}
+
+/** Pass an IP/UDP packet with wrong checksums from src to dst to ip_input */
+static void
+udp_input_bad_chksum(struct netif *inp, ip_addr_t *src, ip_addr_t *dst, u16_t dst_port)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  struct udp_hdr *udphdr;
+  u16_t len = IP_HLEN + UDP_HLEN + 4;
+
+  p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+  EXPECT_RET(p != NULL);
+  memset(p->payload, 0, len);
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHLTOS_SET(iphdr, 4, IP_HLEN / 4, 0);
+  IPH_LEN_SET(iphdr, htons(len));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  IPH_CHKSUM_SET(iphdr, PP_HTONS(0x1234));
+  ip_addr_copy(iphdr->src, *src);
+  ip_addr_copy(iphdr->dest, *dst);
+  udphdr = (struct udp_hdr *)(iphdr + 1);
+  udphdr->src = PP_HTONS(0x456);
+  udphdr->dest = htons(dst_port);
+  udphdr->len = htons(UDP_HLEN + 4);
+  udphdr->chksum = PP_HTONS(0x1234);
+  ip_input(p, inp);
+}
+
+/** Checksums turned off on a netif are neither generated nor verified */
+START_TEST(test_udp_chksum_ctrl)
+{
+  struct udp_pcb* pcb;
+  struct pbuf* p;
+  struct netif netif;
+  ip_addr_t local_ip, remote_ip, netmask;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  fail_unless(netif.chksum_flags == NETIF_CHECKSUM_ENABLE_ALL);
+  txcheck.count = 0;
+  txcheck.bad_chksum = 0;
+  rxcheck_count = 0;
+
+  pcb = udp_new();
+  EXPECT_RET(pcb != NULL);
+  fail_unless(udp_bind(pcb, &local_ip, 0x123) == ERR_OK);
+  udp_recv(pcb, udp_rxcheck_recv, NULL);
+
+  /* TX: checksum left to the netif */
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL & ~NETIF_CHECKSUM_GEN_UDP);
+  p = pbuf_alloc(PBUF_TRANSPORT, 10, PBUF_RAM);
+  EXPECT_RET(p != NULL);
+  memset(p->payload, 0x55, 10);
+  fail_unless(udp_sendto(pcb, p, &remote_ip, 0x456) == ERR_OK);
+  pbuf_free(p);
+  fail_unless(txcheck.count == 1);
+  fail_unless(txcheck.hdr.udp.chksum == 0);
+
+  /* RX: bad checksums are dropped... */
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL);
+  udp_input_bad_chksum(&netif, &remote_ip, &local_ip, 0x123);
+  fail_unless(rxcheck_count == 0);
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL & ~NETIF_CHECKSUM_CHECK_IP);
+  udp_input_bad_chksum(&netif, &remote_ip, &local_ip, 0x123);
+  fail_unless(rxcheck_count == 0);
+  /* ...unless the netif has verified them */
+  NETIF_SET_CHECKSUM_CTRL(&netif, NETIF_CHECKSUM_ENABLE_ALL &
+    ~(NETIF_CHECKSUM_CHECK_IP | NETIF_CHECKSUM_CHECK_UDP));
+  udp_input_bad_chksum(&netif, &remote_ip, &local_ip, 0x123);
+  fail_unless(rxcheck_count == 1);
+
+  udp_remove(pcb);
+  netif_remove(&netif);
+}
+END_TEST
+
+/** Pass a valid IP/UDP packet (without UDP checksum) to ip_input */
+static void
+udp_input_datagram(struct netif *inp, ip_addr_t *src, u16_t src_port,
+                   ip_addr_t *dst, u16_t dst_port)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  struct udp_hdr *udphdr;
+  u16_t len = IP_HLEN + UDP_HLEN + 4;
+
+  p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+  EXPECT_RET(p != NULL);
+  memset(p->payload, 0, len);
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHLTOS_SET(iphdr, 4, IP_HLEN / 4, 0);
+  IPH_LEN_SET(iphdr, htons(len));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  ip_addr_copy(iphdr->src, *src);
+  ip_addr_copy(iphdr->dest, *dst);
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+  udphdr = (struct udp_hdr *)(iphdr + 1);
+  udphdr->src = htons(src_port);
+  udphdr->dest = htons(dst_port);
+  udphdr->len = htons(UDP_HLEN + 4);
+  ip_input(p, inp);
+}
+
+static void
+udp_demux_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  (*(u32_t *)arg)++;
+  pbuf_free(p);
+}
+
+#define DEMUX_NUM_PCBS 4
+
+/** Datagrams reach the best matching pcb, also after pcbs have been
+ * connected, disconnected, rebound or removed */
+START_TEST(test_udp_demux)
+{
+  struct udp_pcb* pcbs[DEMUX_NUM_PCBS];
+  u32_t rx[DEMUX_NUM_PCBS];
+  struct netif netif;
+  ip_addr_t local_ip, remote_ip, netmask;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&netif, 0, sizeof(netif));
+  IP4_ADDR(&local_ip, 192, 168, 1, 1);
+  IP4_ADDR(&remote_ip, 192, 168, 1, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  fail_unless(netif_add(&netif, &local_ip, &netmask, &local_ip, NULL,
+    txcheck_netif_init, NULL) != NULL);
+  memset(rx, 0, sizeof(rx));
+  for (i = 0; i < DEMUX_NUM_PCBS; i++) {
+    pcbs[i] = udp_new();
+    EXPECT_RET(pcbs[i] != NULL);
+    udp_recv(pcbs[i], udp_demux_recv, &rx[i]);
+  }
+  fail_unless(udp_bind(pcbs[0], IP_ADDR_ANY, 0x200) == ERR_OK);
+  fail_unless(udp_bind(pcbs[1], &local_ip, 0x201) == ERR_OK);
+  fail_unless(udp_connect(pcbs[1], &remote_ip, 0x300) == ERR_OK);
+  /* connect binds */
+  fail_unless(udp_connect(pcbs[2], &remote_ip, 0x301) == ERR_OK);
+  fail_unless(udp_bind(pcbs[3], IP_ADDR_ANY, 0x203) == ERR_OK);
+
+  udp_input_datagram(&netif, &remote_ip, 0x300, &local_ip, 0x200);
+  fail_unless(rx[0] == 1);
+  udp_input_datagram(&netif, &remote_ip, 0x300, &local_ip, 0x201);
+  fail_unless(rx[1] == 1);
+  /* connected: only from its remote end */
+  udp_input_datagram(&netif, &remote_ip, 0x999, &local_ip, 0x201);
+  fail_unless(rx[1] == 1);
+  udp_input_datagram(&netif, &remote_ip, 0x301, &local_ip, pcbs[2]->local_port);
+  fail_unless(rx[2] == 1);
+
+  fail_unless(udp_connect(pcbs[3], &remote_ip, 0x302) == ERR_OK);
+  udp_input_datagram(&netif, &remote_ip, 0x303, &local_ip, 0x203);
+  fail_unless(rx[3] == 0);
+  udp_disconnect(pcbs[3]);
+  udp_input_datagram(&netif, &remote_ip, 0x303, &local_ip, 0x203);
+  fail_unless(rx[3] == 1);
+  fail_unless(udp_bind(pcbs[3], IP_ADDR_ANY, 0x204) == ERR_OK);
+  udp_input_datagram(&netif, &remote_ip, 0x303, &local_ip, 0x203);
+  fail_unless(rx[3] == 1);
+  udp_input_datagram(&netif, &remote_ip, 0x303, &local_ip, 0x204);
+  fail_unless(rx[3] == 2);
+
+  udp_remove(pcbs[1]);
+  udp_input_datagram(&netif, &remote_ip, 0x300, &local_ip, 0x201);
+  udp_input_datagram(&netif, &remote_ip, 0x300, &local_ip, 0x200);
+  udp_input_datagram(&netif, &remote_ip, 0x301, &local_ip, pcbs[2]->local_port);
+  udp_input_datagram(&netif, &remote_ip, 0x303, &local_ip, 0x204);
+  fail_unless(rx[0] == 2);
+  fail_unless(rx[1] == 1);
+  fail_unless(rx[2] == 2);
+  fail_unless(rx[3] == 3);
+
+  udp_remove(pcbs[0]);
+  udp_remove(pcbs[2]);
+  udp_remove(pcbs[3]);
+  netif_remove(&netif);
+}
+END_TEST
+
 
 /** Create the suite including all tests for this module */
 Suite *
@@ -63,6 +324,9 @@ udp_suite(void)
 {
   TFun tests[] = {
     test_udp_new_remove,
+    test_udp_chksum_on_copy,
+    test_udp_chksum_ctrl,
+    test_udp_demux,
   };
   return create_suite("UDP", tests, sizeof(tests)/sizeof(TFun), udp_setup, udp_teardown);
 }